@@ -0,0 +1,127 @@
+#!/bin/bash
+#
+# Test online_shard_move.sh: move shards between two datanodes while
+# writers keep inserting through the coordinator, then check that no row
+# was lost or duplicated and that the moved shards are on the target only.
+#
+# Usage: check_shard_move.sh [group [source_node [target_node]]]
+#
+# The cluster has to be running, nodes are reached with the same variables
+# as online_shard_move.sh.  The script moved is the one found in PATH, as
+# installed, "make check-shard-move" puts the install directory first.
+
+GROUP=${1:-default_group}
+SRC_NODE=${2:-dn001}
+DST_NODE=${3:-dn002}
+
+DBNAME=${DBNAME:-postgres}
+CN_HOST=${CN_HOST:-127.0.0.1}
+CN_PORT=${CN_PORT:-30004}
+SRC_HOST=${SRC_HOST:-127.0.0.1}
+SRC_PORT=${SRC_PORT:-40004}
+DST_HOST=${DST_HOST:-127.0.0.1}
+DST_PORT=${DST_PORT:-40005}
+export DBNAME CN_HOST CN_PORT SRC_HOST SRC_PORT DST_HOST DST_PORT
+
+NSHARDS=${NSHARDS:-4}
+NWRITERS=${NWRITERS:-4}
+PRELOAD=${PRELOAD:-100000}
+
+TABLE=shard_move_check
+TMP=/tmp/check_shard_move_$$
+STOP=$TMP/stop
+
+cn_sql()  { psql -X -A -t -q -h $CN_HOST -p $CN_PORT -d $DBNAME -c "$1"; }
+src_sql() { psql -X -A -t -q -h $SRC_HOST -p $SRC_PORT -d $DBNAME -c "$1"; }
+dst_sql() { psql -X -A -t -q -h $DST_HOST -p $DST_PORT -d $DBNAME -c "$1"; }
+
+# count and checksum of the rows, the payload of a row is md5(id)
+ROWSUM="count(*) || ' ' || coalesce(sum(hashtext(id || ':' || v)), 0)"
+
+failures=0
+
+check()
+{
+	if [ "$2" = "$3" ]
+	then
+		echo "ok: $1"
+	else
+		echo "FAILED: $1: got '$2', expected '$3'"
+		failures=$((failures + 1))
+	fi
+}
+
+# Insert ids writer, writer + NWRITERS, ... until told to stop, logging the
+# committed ones.  A failed insert is retried with the same id, a duplicate
+# key means the commit went through before the error.
+writer()
+{
+	local id=$((PRELOAD + $1))
+	local out
+
+	while [ ! -f $STOP ]
+	do
+		out=$(cn_sql "INSERT INTO $TABLE VALUES ($id, md5('$id'))" 2>&1)
+		if [ $? -eq 0 ] || echo "$out" | grep -q "duplicate key"
+		then
+			echo $id >> $TMP/writer.$1
+			id=$((id + NWRITERS))
+		fi
+	done
+}
+
+mkdir -p $TMP
+
+cn_sql "DROP TABLE IF EXISTS $TABLE" > /dev/null
+cn_sql "CREATE TABLE $TABLE (id int PRIMARY KEY, v text) DISTRIBUTE BY SHARD (id) TO GROUP $GROUP" || exit 1
+cn_sql "INSERT INTO $TABLE SELECT i, md5(i::text) FROM generate_series(1, $PRELOAD) i" || exit 1
+seq 1 $PRELOAD > $TMP/preload
+
+SHARDS=$(cn_sql "SELECT string_agg(shardgroupid::text, ',') FROM
+                 (SELECT m.shardgroupid FROM pgxc_shard_map m, pgxc_node n
+                  WHERE m.primarycopy = n.oid AND n.node_name = '$SRC_NODE'
+                  ORDER BY 1 LIMIT $NSHARDS) s")
+[ -z "$SHARDS" ] && { echo "FAILED: $SRC_NODE has no shard"; exit 1; }
+
+for w in $(seq 1 $NWRITERS)
+do
+	writer $w &
+done
+
+online_shard_move.sh $GROUP $SRC_NODE $DST_NODE $SHARDS
+check "move of shards ($SHARDS)" $? 0
+
+touch $STOP
+wait
+
+cat $TMP/preload $TMP/writer.* > $TMP/expected
+expected=$(psql -X -A -t -q -h $CN_HOST -p $CN_PORT -d $DBNAME <<EOF
+CREATE TEMP TABLE expected (id int);
+\copy expected FROM '$TMP/expected'
+SELECT $ROWSUM FROM (SELECT id, md5(id::text) AS v FROM expected) e;
+EOF
+)
+
+check "rows through the coordinator" "$(cn_sql "SELECT $ROWSUM FROM $TABLE")" "$expected"
+check "moved shards on the target" \
+	"$(dst_sql "SELECT $ROWSUM FROM $TABLE WHERE shardid IN ($SHARDS)")" \
+	"$(cn_sql "SELECT $ROWSUM FROM $TABLE WHERE shardid IN ($SHARDS)")"
+check "moved shards left on the source" \
+	"$(src_sql "SELECT count(*) FROM $TABLE WHERE shardid IN ($SHARDS)")" 0
+check "shardmap points to the target" \
+	"$(cn_sql "SELECT count(*) FROM pgxc_shard_map m, pgxc_node n
+	           WHERE m.primarycopy = n.oid AND n.node_name = '$DST_NODE'
+	             AND m.shardgroupid IN ($SHARDS)")" \
+	$(echo $SHARDS | tr ',' '\n' | wc -l)
+check "fence released on the source" \
+	"$(src_sql "SELECT fenced_shards IS NULL FROM pg_stat_shard_move()")" t
+
+cn_sql "DROP TABLE $TABLE" > /dev/null
+rm -rf $TMP
+
+if [ $failures -ne 0 ]
+then
+	echo "$failures check(s) failed"
+	exit 1
+fi
+echo "all checks passed"
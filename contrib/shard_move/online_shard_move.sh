@@ -0,0 +1,192 @@
+#!/bin/bash
+#
+# Move shards between two datanodes while they keep taking writes.
+#
+#  1. The source publishes the shards, the target subscribes to them: the
+#     initial table sync copies the extents of the shards, then logical
+#     decoding filtered by shard streams the changes made in the meantime.
+#  2. Once the target is close behind, the shards are fenced on the source.
+#     Writes to them wait, and the fence returns the LSN the target has to
+#     reach.  The fence lasts as long as the session that set it, which is
+#     kept open until the end of the switch-over.
+#  3. When the target reached it, the shardmap is flipped through the
+#     coordinator, the fence is released and the writers waiting on it fail
+#     with a retryable error.
+#  4. The replication is dropped and the shards left on the source vacuumed.
+#
+# Usage: online_shard_move.sh group source_node target_node shard_list
+#
+# The shard list is comma separated.  Nodes are reached through psql with
+# the host/port variables below, e.g. for a single host cluster:
+#
+#   CN_PORT=30004 SRC_PORT=40004 DST_PORT=40005 \
+#       online_shard_move.sh default_group dn001 dn002 1,2,3
+
+GROUP=$1
+SRC_NODE=$2
+DST_NODE=$3
+SHARDS=$4
+
+if [ -z "$SHARDS" ]
+then
+	echo "Usage: $0 group source_node target_node shard_list"
+	exit 1
+fi
+
+DBNAME=${DBNAME:-postgres}
+CN_HOST=${CN_HOST:-127.0.0.1}
+CN_PORT=${CN_PORT:-30004}
+SRC_HOST=${SRC_HOST:-127.0.0.1}
+SRC_PORT=${SRC_PORT:-40004}
+DST_HOST=${DST_HOST:-127.0.0.1}
+DST_PORT=${DST_PORT:-40005}
+
+# Start the fence when the target is less than this many bytes behind
+CATCHUP_LAG=${CATCHUP_LAG:-65536}
+# Give up waiting for the target after this many seconds
+CATCHUP_TIMEOUT=${CATCHUP_TIMEOUT:-3600}
+FENCE_TIMEOUT=${FENCE_TIMEOUT:-5}
+
+NAME=shard_move_$$
+FENCE_OUT=/tmp/$NAME.fence
+FENCE_JOB=
+
+cn_sql()  { psql -X -A -t -q -h $CN_HOST -p $CN_PORT -d $DBNAME -c "$1"; }
+src_sql() { psql -X -A -t -q -h $SRC_HOST -p $SRC_PORT -d $DBNAME -c "$1"; }
+dst_sql() { psql -X -A -t -q -h $DST_HOST -p $DST_PORT -d $DBNAME -c "$1"; }
+
+now() { date +%s.%N; }
+elapsed() { echo "$(now) - $1" | bc; }
+
+# The session holding the fence on the source
+fence_open()
+{
+	coproc FENCE { psql -X -A -t -q -v ON_ERROR_STOP=1 -h $SRC_HOST -p $SRC_PORT -d $DBNAME; }
+	FENCE_JOB=$FENCE_PID
+}
+
+fence_close()
+{
+	[ -z "$FENCE_JOB" ] && return
+	kill -0 $FENCE_JOB 2> /dev/null && echo '\q' >&${FENCE[1]}
+	wait $FENCE_JOB 2> /dev/null
+	FENCE_JOB=
+	rm -f $FENCE_OUT
+}
+
+# Run a query in the fence session, fails if the session is gone
+fence_sql()
+{
+	rm -f $FENCE_OUT
+	kill -0 $FENCE_JOB 2> /dev/null || return 1
+	echo "$1 \\g $FENCE_OUT" >&${FENCE[1]}
+	while [ ! -s $FENCE_OUT ]
+	do
+		kill -0 $FENCE_JOB 2> /dev/null || return 1
+		sleep 0.01
+	done
+	cat $FENCE_OUT
+}
+
+fail()
+{
+	echo "ERROR: $1"
+	fence_close
+	cleanup_replication
+	exit 1
+}
+
+cleanup_replication()
+{
+	dst_sql "DROP SUBSCRIPTION IF EXISTS $NAME" > /dev/null
+	src_sql "DROP PUBLICATION IF EXISTS $NAME" > /dev/null
+}
+
+# Bytes the subscription is behind the source WAL
+source_lag()
+{
+	src_sql "SELECT coalesce(pg_wal_lsn_diff(pg_current_wal_lsn(), confirmed_flush_lsn), -1)
+	         FROM pg_replication_slots WHERE slot_name = '$NAME'"
+}
+
+start=$(now)
+
+echo "moving shards ($SHARDS) of group $GROUP from $SRC_NODE to $DST_NODE"
+
+src_sql "CREATE PUBLICATION $NAME FOR ALL TABLES BY SHARDING ($SHARDS)" || fail "could not create publication"
+dst_sql "CREATE SUBSCRIPTION $NAME
+         CONNECTION 'host=$SRC_HOST port=$SRC_PORT dbname=$DBNAME'
+         PUBLICATION $NAME" || fail "could not create subscription"
+
+# Bulk copy: wait for all the tables to be synchronized
+copy_start=$(now)
+while true
+do
+	pending=$(dst_sql "SELECT count(*) FROM pg_subscription_rel r, pg_subscription s
+	                   WHERE r.srsubid = s.oid AND s.subname = '$NAME' AND r.srsubstate <> 'r'")
+	[ "$pending" = "0" ] && break
+	[ -z "$pending" ] && fail "could not read the subscription state"
+
+	src_sql "SELECT copy_tuples, pg_size_pretty(copy_bytes), pg_size_pretty(coalesce(copy_rate, 0)::bigint)
+	         FROM pg_stat_shard_move()" |
+		awk -F'|' -v p=$pending '{ printf "copy: %s tuples, %s, %s/s, %s tables pending\n", $1, $2, $3, p }'
+
+	[ $(echo "$(elapsed $copy_start) > $CATCHUP_TIMEOUT" | bc) = 1 ] && fail "copy timed out"
+	sleep 1
+done
+echo "copy done in $(elapsed $copy_start) s"
+
+# Catch-up: follow the source until the lag is small
+while true
+do
+	lag=$(source_lag)
+	[ -z "$lag" ] && fail "could not read the replication lag"
+	echo "catch-up: $lag bytes behind"
+	[ "$lag" -ge 0 ] && [ "$lag" -le $CATCHUP_LAG ] && break
+
+	[ $(echo "$(elapsed $copy_start) > $CATCHUP_TIMEOUT" | bc) = 1 ] && fail "catch-up timed out"
+	sleep 1
+done
+
+# Fence the shards and wait for the target to reach the fence
+fence_start=$(now)
+fence_open
+fence_lsn=$(fence_sql "SELECT pg_shard_move_fence('$SHARDS')") || fail "could not fence shards"
+echo "fenced at $fence_lsn"
+
+while true
+do
+	reached=$(src_sql "SELECT confirmed_flush_lsn >= '$fence_lsn'::pg_lsn
+	                   FROM pg_replication_slots WHERE slot_name = '$NAME'")
+	[ "$reached" = "t" ] && break
+
+	if [ $(echo "$(elapsed $fence_start) > $FENCE_TIMEOUT" | bc) = 1 ]
+	then
+		fence_sql "SELECT pg_shard_move_unfence(false)" > /dev/null
+		fail "target did not reach $fence_lsn, shards are left on $SRC_NODE"
+	fi
+	sleep 0.01
+done
+
+# Flip the shardmap only while the fence is still held, then let the
+# writers retry on the target
+held=$(fence_sql "SELECT fence_pid = pg_backend_pid() FROM pg_stat_shard_move()")
+[ "$held" = "t" ] || fail "the fence was lost, shards are left on $SRC_NODE"
+if ! cn_sql "MOVE GROUP $GROUP DATA FROM $SRC_NODE TO $DST_NODE WITH ($SHARDS)"
+then
+	fence_sql "SELECT pg_shard_move_unfence(false)" > /dev/null
+	fail "could not move shards in the shardmap"
+fi
+cn_sql "CLEAN SHARDING" || echo "WARNING: CLEAN SHARDING failed, run it again on the coordinator"
+unfenced=$(fence_sql "SELECT pg_shard_move_unfence(true)")
+fence_close
+[ "$unfenced" = "t" ] || fail "the fence was lost during the switch-over, check the shards on $SRC_NODE"
+echo "switched over in $(elapsed $fence_start) s"
+
+src_sql "SELECT fence_waits, round(fence_wait_time::numeric, 3), fence_timeouts FROM pg_stat_shard_move()" |
+	awk -F'|' '{ printf "writes fenced: %s, waited %s ms, timed out %s\n", $1, $2, $3 }'
+
+cleanup_replication
+src_sql "SELECT vacuum_hidden_shards('$SHARDS')" > /dev/null || echo "WARNING: could not vacuum shards on $SRC_NODE"
+
+echo "done in $(elapsed $start) s"
@@ -0,0 +1,14 @@
+/* contrib/tbase_pooler_stat/tbase_pooler_stat--1.0--1.1.sql */
+
+-- complain if script is sourced in psql, rather than via ALTER EXTENSION
+\echo Use "ALTER EXTENSION tbase_pooler_stat UPDATE TO '1.1'" to load this file. \quit
+
+-- costtime_below is the exclusive upper bound of the bucket in ms, NULL for the last one
+CREATE OR REPLACE FUNCTION tbase_get_pooler_cmd_histogram(
+	OUT command_type text,
+	OUT costtime_below int8,
+	OUT request_times int8
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C;
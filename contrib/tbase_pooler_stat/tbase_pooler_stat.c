@@ -38,6 +38,7 @@ PG_MODULE_MAGIC;
 PG_FUNCTION_INFO_V1(tbase_get_pooler_cmd_statistics);
 PG_FUNCTION_INFO_V1(tbase_reset_pooler_cmd_statistics);
 PG_FUNCTION_INFO_V1(tbase_get_pooler_conn_statistics);
+PG_FUNCTION_INFO_V1(tbase_get_pooler_cmd_histogram);
 
 typedef struct
 {
@@ -165,6 +166,91 @@ tbase_get_pooler_cmd_statistics(PG_FUNCTION_ARGS)
     SRF_RETURN_DONE(funcctx);
 }
 
+/*
+ * get pooler command time histogram, one row per command and bucket
+ */
+Datum
+tbase_get_pooler_cmd_histogram(PG_FUNCTION_ARGS)
+{
+#define  LIST_POOLER_CMD_HISTOGRAM_COLUMNS 3
+    FuncCallContext     *funcctx;
+    int32               ret = 0;
+    Pooler_CmdState     *status = NULL;
+    Datum               values[LIST_POOLER_CMD_HISTOGRAM_COLUMNS];
+    bool                nulls[LIST_POOLER_CMD_HISTOGRAM_COLUMNS];
+    HeapTuple           tuple;
+    Datum               result;
+    uint32              cmd = 0;
+    uint32              bucket = 0;
+    int                 size = sizeof(PoolerCmdStatistics) * POOLER_CMD_COUNT;
+
+    MemSet(values, 0, sizeof(values));
+    MemSet(nulls,  0, sizeof(nulls));
+
+    if (SRF_IS_FIRSTCALL())
+    {
+        MemoryContext oldcontext;
+        TupleDesc     tupdesc;
+
+        funcctx = SRF_FIRSTCALL_INIT();
+
+        oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        tupdesc = CreateTemplateTupleDesc(LIST_POOLER_CMD_HISTOGRAM_COLUMNS, false);
+
+        TupleDescInitEntry(tupdesc, (AttrNumber) 1, "command_type",
+                           TEXTOID, -1, 0);
+        TupleDescInitEntry(tupdesc, (AttrNumber) 2, "costtime_below",
+                           INT8OID, -1, 0);
+        TupleDescInitEntry(tupdesc, (AttrNumber) 3, "request_times",
+                           INT8OID, -1, 0);
+        funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+
+        status = (Pooler_CmdState*) palloc(sizeof(Pooler_CmdState));
+        status->currIdx = 0;
+        status->buf = (PoolerCmdStatistics*) palloc(size);
+
+        funcctx->user_fctx = (void*) status;
+
+        ret = PoolManagerGetCmdStatistics((char*)status->buf, size);
+        if (ret)
+        {
+            elog(ERROR, "get pooler cmd statictics info from pooler failed");
+        }
+
+        MemoryContextSwitchTo(oldcontext);
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+    status  = (Pooler_CmdState *) funcctx->user_fctx;
+
+    while (status->currIdx < POOLER_CMD_COUNT * POOLER_CMD_HIST_BUCKETS)
+    {
+        cmd    = status->currIdx / POOLER_CMD_HIST_BUCKETS;
+        bucket = status->currIdx % POOLER_CMD_HIST_BUCKETS;
+
+        values[0] = CStringGetTextDatum(g_pooler_cmd_name_tab[cmd]);
+        /* the last bucket has no upper bound */
+        if (bucket < POOLER_CMD_HIST_BUCKETS - 1)
+        {
+            values[1] = Int64GetDatum(g_pooler_cmd_hist_bound[bucket]);
+        }
+        else
+        {
+            nulls[1] = true;
+        }
+        values[2] = Int64GetDatum(be64toh(status->buf[cmd].costtime_hist[bucket]));
+
+        status->currIdx++;
+
+        tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+        result = HeapTupleGetDatum(tuple);
+        SRF_RETURN_NEXT(funcctx, result);
+    }
+
+    SRF_RETURN_DONE(funcctx);
+}
+
 /*
  * reset pooler command statistics
  */
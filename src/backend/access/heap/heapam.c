@@ -61,6 +61,7 @@
 #include "pgstat.h"
 #include "port/atomics.h"
 #include "storage/bufmgr.h"
+#include "storage/extentmapping.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
@@ -109,6 +110,13 @@ static HeapScanDesc heap_beginscan_internal(Relation relation,
                         bool temp_snap);
 static void heap_parallelscan_startblock_init(HeapScanDesc scan);
 static BlockNumber heap_parallelscan_nextpage(HeapScanDesc scan);
+#ifdef _SHARDING_
+static bool heap_parallelscan_shards(Relation relation, Snapshot snapshot,
+                        Bitmapset **shards);
+static int    heap_collect_shard_extents(Relation relation, Bitmapset *shards,
+                        BlockNumber nblocks, ExtentID *extents, int maxextents);
+static BlockNumber heap_extentscan_nextpage(HeapScanDesc scan);
+#endif
 static HeapTuple heap_prepare_insert(Relation relation, HeapTuple tup,
                     TransactionId xid, CommandId cid, int options);
 static XLogRecPtr log_heap_update(Relation reln, Buffer oldbuf,
@@ -316,6 +324,10 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 
     scan->rs_numblocks = InvalidBlockNumber;
     scan->rs_inited = false;
+#ifdef _SHARDING_
+    scan->rs_extent_next = scan->rs_extent_end = 0;
+    scan->rs_prefetch_next = 0;
+#endif
 
     scan->rs_ctup.t_data = NULL;
     ItemPointerSetInvalid(&scan->rs_ctup.t_self);
@@ -1670,6 +1682,9 @@ heap_beginscan_internal(Relation relation, Snapshot snapshot,
     scan->rs_allow_sync = allow_sync;
     scan->rs_temp_snap = temp_snap;
     scan->rs_parallel = parallel_scan;
+#ifdef _SHARDING_
+    scan->rs_own_parallel = false;
+#endif
 
     /*
      * we can use page-at-a-time mode if it's an MVCC-safe snapshot
@@ -1863,6 +1878,11 @@ heap_endscan(HeapScanDesc scan)
     if (scan->rs_temp_snap)
         UnregisterSnapshot(scan->rs_snapshot);
 
+#ifdef _SHARDING_
+    if (scan->rs_own_parallel)
+        pfree(scan->rs_parallel);
+#endif
+
     pfree(scan);
 }
 
@@ -1874,23 +1894,37 @@ heap_endscan(HeapScanDesc scan)
  * ----------------
  */
 Size
-heap_parallelscan_estimate(Snapshot snapshot)
+heap_parallelscan_estimate(Relation relation, Snapshot snapshot)
 {
-    return add_size(offsetof(ParallelHeapScanDescData, phs_snapshot_data),
+    Size        size;
+
+    size = add_size(offsetof(ParallelHeapScanDescData, phs_snapshot_data),
                     EstimateSnapshotSpace(snapshot));
+#ifdef _SHARDING_
+    /* room for the extents of the relation, in case of a scan by extents */
+    if (heap_parallelscan_shards(relation, snapshot, NULL))
+    {
+        BlockNumber nextents;
+
+        nextents = RelationGetNumberOfBlocks(relation) / PAGES_PER_EXTENTS + 1;
+        size = add_size(MAXALIGN(size), mul_size(nextents, sizeof(ExtentID)));
+    }
+#endif
+    return size;
 }
 
 /* ----------------
  *        heap_parallelscan_initialize - initialize ParallelHeapScanDesc
  *
  *        Must allow as many bytes of shared memory as returned by
- *        heap_parallelscan_estimate.  Call this just once in the leader
- *        process; then, individual workers attach via heap_beginscan_parallel.
+ *        heap_parallelscan_estimate, passed as size.  Call this just once in
+ *        the leader process; then, individual workers attach via
+ *        heap_beginscan_parallel.
  * ----------------
  */
 void
-heap_parallelscan_initialize(ParallelHeapScanDesc target, Relation relation,
-                             Snapshot snapshot)
+heap_parallelscan_initialize(ParallelHeapScanDesc target, Size size,
+                             Relation relation, Snapshot snapshot)
 {
     target->phs_relid = RelationGetRelid(relation);
     target->phs_nblocks = RelationGetNumberOfBlocks(relation);
@@ -1902,6 +1936,40 @@ heap_parallelscan_initialize(ParallelHeapScanDesc target, Relation relation,
     target->phs_startblock = InvalidBlockNumber;
 	pg_atomic_write_u64(&target->phs_nallocated, 0);
     SerializeSnapshot(snapshot, target->phs_snapshot_data);
+#ifdef _SHARDING_
+    target->phs_extentscan = false;
+    target->phs_nextents = 0;
+    target->phs_extents_offset = 0;
+    {
+        Bitmapset  *shards = NULL;
+
+        if (heap_parallelscan_shards(relation, snapshot, &shards))
+        {
+            Size        offset;
+            int            maxextents;
+            int            nextents;
+
+            /*
+             * The relation may have grown since heap_parallelscan_estimate,
+             * fall back to a scan by blocks if its extents don't fit.
+             */
+            offset = MAXALIGN(offsetof(ParallelHeapScanDescData, phs_snapshot_data) +
+                              EstimateSnapshotSpace(snapshot));
+            maxextents = size > offset ? (size - offset) / sizeof(ExtentID) : 0;
+            nextents = heap_collect_shard_extents(relation, shards, target->phs_nblocks,
+                                                  (ExtentID *) ((char *) target + offset),
+                                                  maxextents);
+            if (nextents >= 0)
+            {
+                target->phs_extentscan = true;
+                target->phs_nextents = nextents;
+                target->phs_extents_offset = offset;
+                target->phs_syncscan = false;
+            }
+            bms_free(shards);
+        }
+    }
+#endif
 }
 
 /* ----------------
@@ -2002,6 +2070,11 @@ heap_parallelscan_nextpage(HeapScanDesc scan)
 	Assert(scan->rs_parallel);
 	parallel_scan = scan->rs_parallel;
 
+#ifdef _SHARDING_
+    if (parallel_scan->phs_extentscan)
+        return heap_extentscan_nextpage(scan);
+#endif
+
 	/*
 	 * phs_nallocated tracks how many pages have been allocated to workers
 	 * already.  When phs_nallocated >= rs_nblocks, all blocks have been
@@ -2041,6 +2114,166 @@ heap_parallelscan_nextpage(HeapScanDesc scan)
     return page;
 }
 
+#ifdef _SHARDING_
+/* ----------------
+ *        heap_beginscan_shards - scan only the given shards of a relation
+ *
+ *        The extents of the shards are read in block order, following their
+ *        scan lists, instead of reading every block of the relation.  This
+ *        is a scan by extents with a single participant, so it cannot be
+ *        rescanned.
+ * ----------------
+ */
+HeapScanDesc
+heap_beginscan_shards(Relation relation, Snapshot snapshot, Bitmapset *shards)
+{
+    ParallelHeapScanDesc pscan;
+    HeapScanDesc scan;
+    BlockNumber nblocks;
+    int            maxextents;
+    Size        offset;
+
+    if (!RelationHasExtent(relation))
+        return heap_beginscan(relation, snapshot, 0, NULL);
+
+    nblocks = RelationGetNumberOfBlocks(relation);
+    maxextents = nblocks / PAGES_PER_EXTENTS + 1;
+    offset = MAXALIGN(offsetof(ParallelHeapScanDescData, phs_snapshot_data));
+
+    pscan = (ParallelHeapScanDesc) palloc0(offset + maxextents * sizeof(ExtentID));
+    pscan->phs_relid = RelationGetRelid(relation);
+    pscan->phs_nblocks = nblocks;
+    pscan->phs_syncscan = false;
+    SpinLockInit(&pscan->phs_mutex);
+    pscan->phs_startblock = InvalidBlockNumber;
+    pg_atomic_init_u64(&pscan->phs_nallocated, 0);
+    pscan->phs_extentscan = true;
+    pscan->phs_extents_offset = offset;
+    pscan->phs_nextents = heap_collect_shard_extents(relation, shards, nblocks,
+                                                     (ExtentID *) ((char *) pscan + offset),
+                                                     maxextents);
+    Assert(pscan->phs_nextents >= 0);
+
+    scan = heap_beginscan_internal(relation, snapshot, 0, NULL, pscan,
+                                   true, false, true, false, false, false);
+    scan->rs_own_parallel = true;
+
+    return scan;
+}
+
+/*
+ * Decide whether a parallel scan of the relation can be done by extents,
+ * and if so which shards it has to read.  This mirrors the page skipping of
+ * heapgettup: a datanode serving an application only shows the shards
+ * visible, or hidden, in the snapshot, so the extents of the other shards
+ * need not be read at all.
+ */
+static bool
+heap_parallelscan_shards(Relation relation, Snapshot snapshot, Bitmapset **shards)
+{
+    Bitmapset  *shardtable;
+    bool        want_visible;
+    int            sid;
+
+    if (!IS_PGXC_DATANODE
+        || !IsConnFromApp()
+        || g_ShardVisibleMode == SHARD_VISIBLE_MODE_ALL
+        || !RelationHasExtent(relation)
+        || !IsMVCCSnapshot(snapshot))
+        return false;
+
+    if (shards == NULL)
+        return true;
+
+    shardtable = SnapshotGetShardTable(snapshot);
+    want_visible = (g_ShardVisibleMode == SHARD_VISIBLE_MODE_VISIBLE);
+    for (sid = 0; sid < MAX_SHARDS; sid++)
+    {
+        if (bms_is_member(sid / snapshot->groupsize, shardtable) == want_visible)
+            *shards = bms_add_member(*shards, sid);
+    }
+
+    return true;
+}
+
+/*
+ * Collect the extents of the shards which start within the first nblocks
+ * blocks, sorted so that they are read in block order.  Returns the number of
+ * extents, or -1 if there are more than maxextents.
+ */
+static int
+heap_collect_shard_extents(Relation relation, Bitmapset *shards,
+                           BlockNumber nblocks, ExtentID *extents, int maxextents)
+{
+    int            nextents = 0;
+    int            sid = -1;
+
+    while ((sid = bms_next_member(shards, sid)) >= 0)
+    {
+        ExtentID    eid;
+
+        LockShard(relation, sid, AccessShareLock);
+        eid = GetShardScanHead(relation, sid);
+        while (ExtentIdIsValid(eid))
+        {
+            if ((BlockNumber) eid * PAGES_PER_EXTENTS < nblocks)
+            {
+                if (nextents >= maxextents)
+                {
+                    UnlockShard(relation, sid, AccessShareLock);
+                    return -1;
+                }
+                extents[nextents++] = eid;
+            }
+            eid = ema_next_scan(relation, eid, false, NULL, NULL, NULL, NULL);
+        }
+        UnlockShard(relation, sid, AccessShareLock);
+    }
+
+    qsort(extents, nextents, sizeof(ExtentID), extentid_comparator);
+
+    return nextents;
+}
+
+/*
+ * Get the next page of a scan by extents.  A participant takes a whole
+ * extent at a time and reads it to the end, prefetching ahead within the
+ * extent, so that each one reads a contiguous range of the relation.
+ */
+static BlockNumber
+heap_extentscan_nextpage(HeapScanDesc scan)
+{
+    ParallelHeapScanDesc parallel_scan = scan->rs_parallel;
+    BlockNumber page;
+
+    if (scan->rs_extent_next >= scan->rs_extent_end)
+    {
+        ExtentID   *extents;
+        uint64        nallocated;
+
+        nallocated = pg_atomic_fetch_add_u64(&parallel_scan->phs_nallocated, 1);
+        if (nallocated >= parallel_scan->phs_nextents)
+            return InvalidBlockNumber;
+
+        extents = (ExtentID *) ((char *) parallel_scan + parallel_scan->phs_extents_offset);
+        scan->rs_extent_next = extents[nallocated] * PAGES_PER_EXTENTS;
+        scan->rs_extent_end = Min(scan->rs_extent_next + PAGES_PER_EXTENTS,
+                                  scan->rs_nblocks);
+        scan->rs_prefetch_next = scan->rs_extent_next;
+    }
+
+    page = scan->rs_extent_next++;
+
+#ifdef USE_PREFETCH
+    while (scan->rs_prefetch_next < scan->rs_extent_end &&
+           scan->rs_prefetch_next <= page + target_prefetch_pages)
+        PrefetchBuffer(scan->rs_rd, MAIN_FORKNUM, scan->rs_prefetch_next++);
+#endif
+
+    return page;
+}
+#endif
+
 /* ----------------
  *        heap_update_snapshot
  *
@@ -2744,6 +2977,8 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
     {
         elog(ERROR, "shard is be vacuuming now, so it is forbidden to write.");
     }
+    if(RelationHasShardMoveFence(relation))
+        WaitForShardMoveFence(HeapTupleGetShardId(tup));
 #endif
 
 #ifdef _MLS_
@@ -2813,6 +3048,10 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 
     MarkBufferDirty(buffer);
 
+#ifdef __TBASE__
+    if (!RelationNeedsWAL(relation))
+        MyXactFlags |= XACT_FLAGS_WROTENOWALREL;
+#endif
     /* XLOG stuff */
     if (!(options & HEAP_INSERT_SKIP_WAL) && RelationNeedsWAL(relation))
     {
@@ -3051,6 +3290,10 @@ heap_multi_insert(Relation relation, HeapTuple *tuples, int ntuples,
 #endif
 
     needwal = !(options & HEAP_INSERT_SKIP_WAL) && RelationNeedsWAL(relation);
+#ifdef __TBASE__
+    if (!RelationNeedsWAL(relation))
+        MyXactFlags |= XACT_FLAGS_WROTENOWALREL;
+#endif
     saveFreeSpace = RelationGetTargetPageFreeSpace(relation,
                                                    HEAP_DEFAULT_FILLFACTOR);
 
@@ -3060,6 +3303,14 @@ heap_multi_insert(Relation relation, HeapTuple *tuples, int ntuples,
         heaptuples[i] = heap_prepare_insert(relation, tuples[i],
                                             xid, cid, options);
 
+#ifdef _SHARDING_
+    if (RelationHasShardMoveFence(relation))
+    {
+        for (i = 0; i < ntuples; i++)
+            WaitForShardMoveFence(HeapTupleGetShardId(heaptuples[i]));
+    }
+#endif
+
 #ifdef _MLS_
     if (NULL != relation->rd_att->transp_crypt)
     {
@@ -3507,6 +3758,21 @@ heap_delete(Relation relation, ItemPointer tid,
     {
         elog(ERROR, "shard is be vacuuming now, so it is forbidden to write.");
     }
+    if(RelationHasExtent(relation))
+        WaitForShardMoveFence(PageGetShardId(page));
+    else if(RelationIsSharded(relation) && ShardMoveFenceIsActive())
+    {
+        /* without extents the shard is only known from the tuple itself */
+        ShardID sid;
+
+        LockBuffer(buffer, BUFFER_LOCK_SHARE);
+        lp = PageGetItemId(page, ItemPointerGetOffsetNumber(tid));
+        Assert(ItemIdIsNormal(lp));
+        sid = HeapTupleHeaderGetShardId((HeapTupleHeader) PageGetItem(page, lp));
+        LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+
+        WaitForShardMoveFence(sid);
+    }
 #endif
 
     /*
@@ -3818,6 +4084,10 @@ l1:
 
     MarkBufferDirty(buffer);
 
+#ifdef __TBASE__
+    if (!RelationNeedsWAL(relation))
+        MyXactFlags |= XACT_FLAGS_WROTENOWALREL;
+#endif
     /*
      * XLOG stuff
      *
@@ -4074,6 +4344,8 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
     {
         elog(ERROR, "shard is be vacuuming now, so it is forbidden to write.");
     }
+    if(RelationHasShardMoveFence(relation))
+        WaitForShardMoveFence(HeapTupleGetShardId(newtup));
 #endif
 
 #ifdef __TBASE__
@@ -4874,6 +5146,10 @@ l2:
         MarkBufferDirty(newbuf);
     MarkBufferDirty(buffer);
 
+#ifdef __TBASE__
+    if (!RelationNeedsWAL(relation))
+        MyXactFlags |= XACT_FLAGS_WROTENOWALREL;
+#endif
     /* XLOG stuff */
     if (RelationNeedsWAL(relation))
     {
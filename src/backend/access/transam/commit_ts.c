@@ -31,16 +31,22 @@
 #include "access/htup_details.h"
 #include "access/lru.h"
 #include "access/transam.h"
+#include "access/xlog.h"
 #include "catalog/pg_type.h"
 #include "funcapi.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
+#include "portability/instr_time.h"
 #include "storage/shmem.h"
 #include "utils/builtins.h"
+#include "utils/memutils.h"
 #include "utils/snapmgr.h"
 #include "utils/timestamp.h"
 
 bool enable_committs_print = false;
+#ifdef __TBASE__
+bool enable_committs_cache = true;
+#endif
 
 
 /*
@@ -105,15 +111,72 @@ static LruCtlData CommitTsCtlData;
  * without acquiring the lock; where this happens, a comment explains the
  * rationale for it.
  */
+#ifdef __TBASE__
+/* How a commit timestamp was read by TransactionIdGetCommitTsData */
+typedef enum CommitTsReadPath
+{
+    COMMIT_TS_READ_CACHE,       /* backend local copy of the page */
+    COMMIT_TS_READ_LOCKFREE,    /* shared buffer, without lock */
+    COMMIT_TS_READ_LOCKED,      /* shared buffer, under the partition lock */
+    COMMIT_TS_READ_PATHS
+} CommitTsReadPath;
+#endif
+
 typedef struct CommitTimestampShared
 {
     TransactionId xidLastCommit;
     CommitTimestampEntry dataLastCommit;
     bool        commitTsActive;
+#ifdef __TBASE__
+    /* Read statistics added by the backends, times are in nanoseconds */
+    pg_atomic_uint64 reads[COMMIT_TS_READ_PATHS];
+    pg_atomic_uint64 timed_reads[COMMIT_TS_READ_PATHS];
+    pg_atomic_uint64 read_time[COMMIT_TS_READ_PATHS];
+#endif
 } CommitTimestampShared;
 
 CommitTimestampShared *commitTsShared;
 
+#ifdef __TBASE__
+/*
+ * Backend local copies of recently read commit timestamp pages, so that a
+ * scan checking many transactions of the same page reads the shared buffer
+ * once. A commit timestamp does not change once set; an entry not set in
+ * the copy is read again from the shared buffer.
+ *
+ * The copies are dropped when RecentXmin moved far from where it was when
+ * they were made, or when the xid epoch changed, before xid wraparound can
+ * reuse their page numbers.
+ */
+#define COMMIT_TS_CACHE_PAGES       16
+#define COMMIT_TS_CACHE_HORIZON     (1U << 30)
+
+/* Time one read in that many, add local statistics every that many reads */
+#define COMMIT_TS_TIMING_INTERVAL   64
+#define COMMIT_TS_STATS_INTERVAL    1024
+
+typedef struct CommitTsCachePage
+{
+    int            pageno;        /* -1 if the copy is not valid */
+    char        data[BLCKSZ];
+} CommitTsCachePage;
+
+static CommitTsCachePage *CommitTsCache = NULL;
+static TransactionId CommitTsCacheHorizon = InvalidTransactionId;
+static uint32 CommitTsCacheEpoch = 0;
+static TransactionId CommitTsCacheXmin = InvalidTransactionId;
+
+typedef struct CommitTsReadStats
+{
+    uint64        reads[COMMIT_TS_READ_PATHS];
+    uint64        timed_reads[COMMIT_TS_READ_PATHS];
+    uint64        read_time[COMMIT_TS_READ_PATHS];
+} CommitTsReadStats;
+
+static CommitTsReadStats CommitTsLocalStats;
+static uint64 CommitTsReadCount = 0;
+#endif
+
 
 /* GUC variable */
 bool        track_commit_timestamp = true;
@@ -127,6 +190,13 @@ SetXidCommitTsInPage(TransactionId xid, int nsubxids,
 static void TransactionIdSetCommitTs(TransactionId xid, TimestampTz gts, TimestampTz ts,
                          RepOriginId nodeid, int partitionno, int slotno, XLogRecPtr lsn);
 static void error_commit_ts_disabled(void);
+static void CommitTsLockedRead(TransactionId xid, int pageno, int entryno,
+                   CommitTimestampEntry *entry, char *copy);
+#ifdef __TBASE__
+static CommitTsReadPath CommitTsCachedRead(TransactionId xid, int pageno,
+                   int entryno, CommitTimestampEntry *entry);
+static void CommitTsFlushReadStats(void);
+#endif
 static int    ZeroCommitTsPage(int pageno, int partitionno, bool writeXlog);
 static bool CommitTsPagePrecedes(int page1, int page2);
 static void ActivateCommitTs(void);
@@ -333,11 +403,13 @@ TransactionIdSetCommitTs(TransactionId xid, TimestampTz gts, TimestampTz ts,
 	entry.time = ts;
 	entry.nodeid = nodeid;
 
+	LruSlotChangeBegin(CommitTsCtl->shared[partitionno], slotno);
 	LruTlogDisableMemoryProtection(CommitTsCtl->shared[partitionno]->page_buffer[slotno]);
 	memcpy(CommitTsCtl->shared[partitionno]->page_buffer[slotno] +
 		   SizeOfCommitTimestampEntry * entryno,
 		   &entry, SizeOfCommitTimestampEntry);
 	LruTlogEnableMemoryProtection(CommitTsCtl->shared[partitionno]->page_buffer[slotno]);
+	LruSlotChangeEnd(CommitTsCtl->shared[partitionno], slotno);
 
 #ifdef __TBASE__
     /*
@@ -375,9 +447,6 @@ TransactionIdGetCommitTsData(TransactionId xid, TimestampTz *gts,
 {
     int            pageno = TransactionIdToCTsPage(xid);
     int            entryno = TransactionIdToCTsEntry(xid);
-    int            slotno;
-    int         partitionno;
-    LWLock       *partitionLock;    /* buffer partition lock for it */
     CommitTimestampEntry entry;
 
     
@@ -395,6 +464,59 @@ TransactionIdGetCommitTsData(TransactionId xid, TimestampTz *gts,
         return true;
     }
 
+#ifdef __TBASE__
+    if (enable_committs_cache)
+    {
+        CommitTsReadPath path;
+        instr_time    start;
+        instr_time    duration;
+        bool        timed;
+
+        timed = (CommitTsReadCount % COMMIT_TS_TIMING_INTERVAL) == 0;
+        if (timed)
+            INSTR_TIME_SET_CURRENT(start);
+
+        path = CommitTsCachedRead(xid, pageno, entryno, &entry);
+
+        CommitTsLocalStats.reads[path]++;
+        if (timed)
+        {
+            INSTR_TIME_SET_CURRENT(duration);
+            INSTR_TIME_SUBTRACT(duration, start);
+            CommitTsLocalStats.timed_reads[path]++;
+            CommitTsLocalStats.read_time[path] +=
+                (uint64) (INSTR_TIME_GET_DOUBLE(duration) * 1000000000.0);
+        }
+        if (++CommitTsReadCount % COMMIT_TS_STATS_INTERVAL == 0)
+            CommitTsFlushReadStats();
+    }
+    else
+#endif
+    CommitTsLockedRead(xid, pageno, entryno, &entry, NULL);
+
+    *gts = entry.global_timestamp;
+    
+    if (nodeid)
+    {
+        *nodeid = entry.nodeid;
+    }
+    
+    //elog(DEBUG8, "Get committs xid %d time " INT64_FORMAT, xid, *ts);
+    return *gts != 0;
+}
+
+/*
+ * Read the commit timestamp entry of xid under the partition lock. If copy is
+ * not NULL the whole page is copied there too.
+ */
+static void
+CommitTsLockedRead(TransactionId xid, int pageno, int entryno,
+                   CommitTimestampEntry *entry, char *copy)
+{
+    int            slotno;
+    int         partitionno;
+    LWLock       *partitionLock;    /* buffer partition lock for it */
+
     //elog(DEBUG8, "Get committs xid %d.", xid);
     partitionno = PagenoMappingPartitionno(CommitTsCtl, pageno);
 
@@ -402,23 +524,127 @@ TransactionIdGetCommitTsData(TransactionId xid, TimestampTz *gts,
     
     /* lock is acquired by SimpleLruReadPage_ReadOnly */
     slotno = LruReadPage_ReadOnly(CommitTsCtl, partitionno, pageno, xid);
-    memcpy(&entry,
+    memcpy(entry,
            CommitTsCtl->shared[partitionno]->page_buffer[slotno] +
            SizeOfCommitTimestampEntry * entryno,
            SizeOfCommitTimestampEntry);
+    if (copy)
+        memcpy(copy, CommitTsCtl->shared[partitionno]->page_buffer[slotno], BLCKSZ);
 
-    
-    *gts = entry.global_timestamp;
-    
-    if (nodeid)
+    LWLockRelease(partitionLock);
+}
+
+#ifdef __TBASE__
+/*
+ * Read the commit timestamp entry of xid through the backend local copy of
+ * its page, and return how it was read.
+ */
+static CommitTsReadPath
+CommitTsCachedRead(TransactionId xid, int pageno, int entryno,
+                   CommitTimestampEntry *entry)
+{
+    CommitTsCachePage *page;
+    int            offset = SizeOfCommitTimestampEntry * entryno;
+    bool        reset = false;
+    int            i;
+
+    if (CommitTsCache == NULL)
     {
-        *nodeid = entry.nodeid;
+        CommitTsCache = (CommitTsCachePage *)
+            MemoryContextAlloc(TopMemoryContext,
+                               COMMIT_TS_CACHE_PAGES * sizeof(CommitTsCachePage));
+        reset = true;
     }
-    
-    //elog(DEBUG8, "Get committs xid %d time " INT64_FORMAT, xid, *ts);
-    LWLockRelease(partitionLock);
-    return *gts != 0;
+    else if (TransactionIdIsNormal(RecentXmin) && RecentXmin != CommitTsCacheXmin)
+    {
+        TransactionId limit = CommitTsCacheHorizon + COMMIT_TS_CACHE_HORIZON;
+        TransactionId nextXid;
+        uint32        epoch;
+
+        if (!TransactionIdIsNormal(limit))
+            limit += FirstNormalTransactionId;
+
+        /*
+         * A modulo-2^32 distance cannot tell a small move from one of several
+         * wraparounds, so also compare the epoch.
+         */
+        GetNextXidAndEpoch(&nextXid, &epoch);
+        if (epoch != CommitTsCacheEpoch ||
+            !TransactionIdIsNormal(CommitTsCacheHorizon) ||
+            TransactionIdPrecedes(limit, RecentXmin))
+            reset = true;
+        CommitTsCacheXmin = RecentXmin;
+    }
+
+    if (reset)
+    {
+        TransactionId nextXid;
+
+        for (i = 0; i < COMMIT_TS_CACHE_PAGES; i++)
+            CommitTsCache[i].pageno = -1;
+        CommitTsCacheHorizon = RecentXmin;
+        CommitTsCacheXmin = RecentXmin;
+        GetNextXidAndEpoch(&nextXid, &CommitTsCacheEpoch);
+    }
+
+    page = &CommitTsCache[pageno % COMMIT_TS_CACHE_PAGES];
+    if (page->pageno == pageno)
+    {
+        memcpy(entry, page->data + offset, SizeOfCommitTimestampEntry);
+        if (entry->global_timestamp != 0)
+            return COMMIT_TS_READ_CACHE;
+
+        /* Not committed when copied, read the entry again */
+        if (LruReadResidentPage(CommitTsCtl, pageno, offset, (char *) entry,
+                                SizeOfCommitTimestampEntry))
+        {
+            memcpy(page->data + offset, entry, SizeOfCommitTimestampEntry);
+            return COMMIT_TS_READ_LOCKFREE;
+        }
+
+        CommitTsLockedRead(xid, pageno, entryno, entry, NULL);
+        memcpy(page->data + offset, entry, SizeOfCommitTimestampEntry);
+        return COMMIT_TS_READ_LOCKED;
+    }
+
+    /* Replace the copy, it is not valid until done */
+    page->pageno = -1;
+    if (LruReadResidentPage(CommitTsCtl, pageno, 0, page->data, BLCKSZ))
+    {
+        page->pageno = pageno;
+        memcpy(entry, page->data + offset, SizeOfCommitTimestampEntry);
+        return COMMIT_TS_READ_LOCKFREE;
+    }
+
+    CommitTsLockedRead(xid, pageno, entryno, entry, page->data);
+    page->pageno = pageno;
+    return COMMIT_TS_READ_LOCKED;
+}
+
+/*
+ * Add the read statistics of this backend to the shared ones.
+ */
+static void
+CommitTsFlushReadStats(void)
+{
+    int            i;
+
+    for (i = 0; i < COMMIT_TS_READ_PATHS; i++)
+    {
+        if (CommitTsLocalStats.reads[i] > 0)
+            pg_atomic_fetch_add_u64(&commitTsShared->reads[i],
+                                    CommitTsLocalStats.reads[i]);
+        if (CommitTsLocalStats.timed_reads[i] > 0)
+        {
+            pg_atomic_fetch_add_u64(&commitTsShared->timed_reads[i],
+                                    CommitTsLocalStats.timed_reads[i]);
+            pg_atomic_fetch_add_u64(&commitTsShared->read_time[i],
+                                    CommitTsLocalStats.read_time[i]);
+        }
+    }
+    MemSet(&CommitTsLocalStats, 0, sizeof(CommitTsLocalStats));
 }
+#endif
 
 
 bool
@@ -593,6 +819,92 @@ pg_last_committed_xact(PG_FUNCTION_ARGS)
 }
 
 
+#ifdef __TBASE__
+/*
+ * pg_stat_get_committs_cache
+ *        Return how the commit timestamps were read on this node, used by the
+ *        pg_stat_committs_cache view. The time saved is estimated from the
+ *        timed reads, times are reported in microseconds but time_saved in
+ *        milliseconds.
+ */
+Datum
+pg_stat_get_committs_cache(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_COMMITTS_CACHE_COLS 9
+    TupleDesc    tupdesc;
+    Datum        values[PG_STAT_GET_COMMITTS_CACHE_COLS];
+    bool        nulls[PG_STAT_GET_COMMITTS_CACHE_COLS];
+    uint64        reads[COMMIT_TS_READ_PATHS];
+    double        avg_time[COMMIT_TS_READ_PATHS];
+    bool        timed[COMMIT_TS_READ_PATHS];
+    uint64        total = 0;
+    int            i;
+
+    /* Include the reads of this backend */
+    CommitTsFlushReadStats();
+
+    /* this had better match pg_stat_committs_cache view in system_views.sql */
+    tupdesc = CreateTemplateTupleDesc(PG_STAT_GET_COMMITTS_CACHE_COLS, false);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 1, "reads",
+                       INT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 2, "cache_hits",
+                       INT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 3, "lockfree_reads",
+                       INT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 4, "locked_reads",
+                       INT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 5, "hit_ratio",
+                       FLOAT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 6, "avg_cache_time",
+                       FLOAT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 7, "avg_lockfree_time",
+                       FLOAT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 8, "avg_locked_time",
+                       FLOAT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 9, "time_saved",
+                       FLOAT8OID, -1, 0);
+    BlessTupleDesc(tupdesc);
+
+    MemSet(nulls, 0, sizeof(nulls));
+    for (i = 0; i < COMMIT_TS_READ_PATHS; i++)
+    {
+        uint64        timed_reads = pg_atomic_read_u64(&commitTsShared->timed_reads[i]);
+
+        reads[i] = pg_atomic_read_u64(&commitTsShared->reads[i]);
+        total += reads[i];
+        timed[i] = timed_reads > 0;
+        avg_time[i] = timed[i] ?
+            pg_atomic_read_u64(&commitTsShared->read_time[i]) / 1000.0 / timed_reads : 0;
+
+        values[1 + i] = Int64GetDatum(reads[i]);
+        values[5 + i] = Float8GetDatum(avg_time[i]);
+        nulls[5 + i] = !timed[i];
+    }
+    values[0] = Int64GetDatum(total);
+    if (total > 0)
+        values[4] = Float8GetDatum((double) reads[COMMIT_TS_READ_CACHE] / total);
+    else
+        nulls[4] = true;
+
+    /* What the reads not taking the lock would have cost with it */
+    if (timed[COMMIT_TS_READ_LOCKED])
+    {
+        double        saved = 0;
+
+        for (i = 0; i < COMMIT_TS_READ_LOCKED; i++)
+        {
+            if (timed[i])
+                saved += reads[i] * (avg_time[COMMIT_TS_READ_LOCKED] - avg_time[i]);
+        }
+        values[8] = Float8GetDatum(saved / 1000.0);
+    }
+    else
+        nulls[8] = true;
+
+    PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+#endif
+
 /*
  * Number of shared CommitTS buffers.
  *
@@ -645,6 +957,18 @@ CommitTsShmemInit(void)
         TIMESTAMP_NOBEGIN(commitTsShared->dataLastCommit.time);
         commitTsShared->dataLastCommit.nodeid = InvalidRepOriginId;
         commitTsShared->commitTsActive = false;
+#ifdef __TBASE__
+        {
+            int        i;
+
+            for (i = 0; i < COMMIT_TS_READ_PATHS; i++)
+            {
+                pg_atomic_init_u64(&commitTsShared->reads[i], 0);
+                pg_atomic_init_u64(&commitTsShared->timed_reads[i], 0);
+                pg_atomic_init_u64(&commitTsShared->read_time[i], 0);
+            }
+        }
+#endif
     }
     else
         Assert(found);
@@ -907,10 +1231,12 @@ TrimCommitTs(void)
         
         byteptr = CommitTsCtl->shared[partitionno]->page_buffer[slotno] + byteno;
         
+        LruSlotChangeBegin(CommitTsCtl->shared[partitionno], slotno);
 		LruTlogDisableMemoryProtection(CommitTsCtl->shared[partitionno]->page_buffer[slotno]);
         /* Zero the rest of the page */
         MemSet(byteptr, 0, BLCKSZ - byteno);
 		LruTlogEnableMemoryProtection(CommitTsCtl->shared[partitionno]->page_buffer[slotno]);
+        LruSlotChangeEnd(CommitTsCtl->shared[partitionno], slotno);
 
         elog(DEBUG10, "zero out the remaining page starting from byteno %d len BLCKSZ -byteno %d entryno %d sizeofentry %lu",
             byteno, BLCKSZ - byteno, entryno, SizeOfCommitTimestampEntry);
@@ -43,6 +43,10 @@
 #include "pgxc/nodemgr.h"
 #include "access/xlog.h"
 #include "storage/lmgr.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "pgstat.h"
 #endif
 
 /* To access sequences */
@@ -96,6 +100,58 @@ static int GetGTMStoreTransaction(GTM_StoredTransactionInfo **store_txn);
 static int CheckGTMStoreTransaction(GTMStorageTransactionStatus **store_txn, bool need_fix);
 static int CheckGTMStoreSequence(GTMStorageSequneceStatus **store_seq, bool need_fix);
 static void ResetGtmInfo(void);
+#ifdef __SUPPORT_DISTRIBUTED_TRANSACTION__
+static GTM_Timestamp CheckGlobalTimestamp(Get_GTS_Result gts_result);
+static void HLCSynchronize(GTM_Timestamp gts);
+
+/* Token of the GTS request sent by RequestGlobalTimestampGTM, not read yet */
+static GTM_AsyncToken gts_token = InvalidGTMAsyncToken;
+
+/*
+ * Shared state of the GTS broker: the backends waiting for a GTS, and how
+ * they were served. Times are in microseconds.
+ */
+typedef struct GTSBrokerData
+{
+    pg_atomic_uint32 first;         /* first proc waiting for a GTS */
+    pg_atomic_uint64 batches;       /* GTM requests sent for the waiters */
+    pg_atomic_uint64 requests;      /* GTS requests served */
+    pg_atomic_uint64 max_batch;
+    pg_atomic_uint64 wait_time;     /* by all the requests */
+    pg_atomic_uint64 gtm_time;      /* waiting for GTM */
+} GTSBrokerData;
+
+static GTSBrokerData *GTSBroker = NULL;
+
+bool enable_gts_broker = false;
+
+/*
+ * Shared hybrid logical clock of a coordinator. It follows the GTM clock
+ * from the last GTS got from GTM and the local clock elapsed since then.
+ * Times are in microseconds.
+ */
+typedef struct HLCClockData
+{
+    slock_t         mutex;
+    bool            valid;          /* can serve read-only snapshots */
+    GTM_Timestamp   sync_gts;       /* last GTS got from GTM */
+    TimestampTz     sync_time;      /* local clock when it was got */
+    GTM_Timestamp   floor_gts;      /* highest GTS got or served */
+    int64           last_skew;      /* local estimate minus GTS at last sync */
+    int64           max_skew;       /* largest absolute skew seen */
+    uint64          syncs;
+    uint64          local_snapshots;
+    uint64          gtm_snapshots;  /* read-only ones served by GTM */
+    uint64          skew_violations;
+} HLCClockData;
+
+static HLCClockData *HLCClock = NULL;
+
+bool enable_hlc_readonly_gts = false;
+int  hlc_max_skew = 50;
+int  hlc_sync_interval = 1000;
+int  hlc_simulated_skew = 0;
+#endif
 extern GlobalTimestamp GetLatestCommitTS(void);
 
 
@@ -1178,6 +1234,28 @@ GetMasterGtmInfo(void)
 static void
 CheckConnection(void)
 {
+#ifdef __SUPPORT_DISTRIBUTED_TRANSACTION__
+	/*
+	 * The reply to a GTS request was left unread, e.g. because of an error,
+	 * consume it so that it is not taken for the reply of the next request.
+	 * If it cannot be read, drop the connection instead.
+	 */
+	if (gts_token != InvalidGTMAsyncToken)
+	{
+		if (conn && gtm_async_wait(conn, gts_token, NULL) == GTM_RESULT_COMM_ERROR)
+		{
+			CloseGTM();
+			InitGTM();
+			return;
+		}
+		gts_token = InvalidGTMAsyncToken;
+	}
+
+	/* The synchronous calls below must not meet an asynchronous reply */
+	if (conn && gtm_async_pending(conn))
+		elog(ERROR, "GTM connection has outstanding asynchronous requests");
+#endif
+
 	/* Be sure that a backend does not use a postmaster connection */
 	if (IsUnderPostmaster && GTMPQispostmaster(conn) == 1)
 	{
@@ -1451,6 +1529,9 @@ CloseGTM(void)
         GTMPQfinish(conn);
         conn = NULL;
     }
+#ifdef __SUPPORT_DISTRIBUTED_TRANSACTION__
+    gts_token = InvalidGTMAsyncToken;
+#endif
 
     /* Log activity of GTM connections */
     if (!IsUnderPostmaster)
@@ -1470,28 +1551,22 @@ CloseGTM(void)
 }
 
 #ifdef __SUPPORT_DISTRIBUTED_TRANSACTION__
-GTM_Timestamp 
-GetGlobalTimestampGTM(void)
+/*
+ * Get a global timestamp for count requests from GTM, reconnecting and
+ * retrying on failure.
+ */
+static Get_GTS_Result
+FetchGlobalTimestampGTM(int count)
 {
-	struct rusage start_r;
-	struct timeval start_t;
 	int  retry_cnt = 0;
 	Get_GTS_Result gts_result = {InvalidGlobalTimestamp,false};
-	GTM_Timestamp  latest_gts = InvalidGlobalTimestamp;
-
-	if (!g_set_global_snapshot)
-	{
-		return LocalCommitTimestamp;
-	}
-
-    if (log_gtm_stats)
-        ResetUsageCommon(&start_r, &start_t);
 
     CheckConnection();
     // TODO Isolation level
     if (conn)
     {
-        gts_result =  get_global_timestamp(conn);
+        gts_result = count > 1 ? get_global_timestamp_multi(conn, count) :
+                                 get_global_timestamp(conn);
     }
     else if(GTMDebugPrint)
     {
@@ -1516,7 +1591,8 @@ GetGlobalTimestampGTM(void)
 
         if (conn)
         {
-            gts_result = get_global_timestamp(conn);
+            gts_result = count > 1 ? get_global_timestamp_multi(conn, count) :
+                                     get_global_timestamp(conn);
 			if (GlobalTimestampIsValid(gts_result.gts))
 			{
 				elog(DEBUG5, "retry get global timestamp gts " INT64_FORMAT,
@@ -1544,9 +1620,464 @@ GetGlobalTimestampGTM(void)
 		ResetGTMConnection();
 	}
 
+	return gts_result;
+}
+
+/*
+ * Wake up the members of a GTS group, handing them the timestamp got by the
+ * leader.
+ */
+static void
+GTSBrokerWakeGroup(uint32 wakeidx, Get_GTS_Result gts_result)
+{
+    PGPROC *proc = NULL;
+
+    while (wakeidx != INVALID_PGPROCNO)
+    {
+        proc = &ProcGlobal->allProcs[wakeidx];
+
+        wakeidx = pg_atomic_read_u32(&proc->gtsBrokerNext);
+        pg_atomic_write_u32(&proc->gtsBrokerNext, INVALID_PGPROCNO);
+
+        proc->gtsBrokerResult = gts_result.gts;
+        proc->gtsBrokerReadOnly = gts_result.gtm_readonly;
+
+        /* ensure all previous writes are visible before follower continues. */
+        pg_write_barrier();
+
+        proc->gtsBrokerMember = false;
+
+        if (proc != MyProc)
+            PGSemaphoreUnlock(proc->sem);
+    }
+}
+
+/*
+ * Get a global timestamp through the GTS broker of this node.
+ *
+ * The backend adds itself to the list of backends waiting for a timestamp.
+ * The first one to do so becomes the leader: once the previous leader is done
+ * with GTM, it takes the whole list, gets a single timestamp for all of them
+ * and wakes them up. As the timestamp is got after every member asked for
+ * one, it serves as well as a timestamp got by each of them.
+ */
+static Get_GTS_Result
+GetGlobalTimestampBroker(void)
+{
+    GTSBrokerData  *broker = GTSBroker;
+    PGPROC         *proc = MyProc;
+    Get_GTS_Result  gts_result = {InvalidGlobalTimestamp,false};
+    TimestampTz     start = GetCurrentTimestamp();
+    TimestampTz     fetch_start = 0;
+    uint32          nextidx;
+    uint32          wakeidx;
+    uint64          count = 0;
+    uint64          max_batch = 0;
+
+    /* Add ourselves to the list of backends waiting for a GTS. */
+    proc->gtsBrokerMember = true;
+    while (true)
+    {
+        nextidx = pg_atomic_read_u32(&broker->first);
+        pg_atomic_write_u32(&proc->gtsBrokerNext, nextidx);
+
+        if (pg_atomic_compare_exchange_u32(&broker->first,
+                                           &nextidx,
+                                           (uint32) proc->pgprocno))
+            break;
+    }
+
+    /* If the list was not empty, the leader gets the GTS for us. */
+    if (nextidx != INVALID_PGPROCNO)
+    {
+        int            extraWaits = 0;
+
+        pgstat_report_wait_start(WAIT_EVENT_GTS_BROKER);
+        for (;;)
+        {
+            /* acts as a read barrier */
+            PGSemaphoreLock(proc->sem);
+            if (!proc->gtsBrokerMember)
+                break;
+            extraWaits++;
+        }
+        pgstat_report_wait_end();
+
+        Assert(pg_atomic_read_u32(&proc->gtsBrokerNext) == INVALID_PGPROCNO);
+
+        /* Fix semaphore count for any absorbed wakeups */
+        while (extraWaits-- > 0)
+            PGSemaphoreUnlock(proc->sem);
+
+        gts_result.gts = proc->gtsBrokerResult;
+        gts_result.gtm_readonly = proc->gtsBrokerReadOnly;
+
+        pg_atomic_fetch_add_u64(&broker->wait_time, GetCurrentTimestamp() - start);
+        return gts_result;
+    }
+
+    /* We are the leader, wait for the previous group to be served. */
+    LWLockAcquire(GTSBrokerLock, LW_EXCLUSIVE);
+
+    /*
+     * Take the whole list at once, backends coming from now on form the next
+     * group.
+     */
+    while (true)
+    {
+        nextidx = pg_atomic_read_u32(&broker->first);
+        if (pg_atomic_compare_exchange_u32(&broker->first,
+                                           &nextidx,
+                                           INVALID_PGPROCNO))
+            break;
+    }
+
+    wakeidx = nextidx;
+    while (nextidx != INVALID_PGPROCNO)
+    {
+        count++;
+        nextidx = pg_atomic_read_u32(&ProcGlobal->allProcs[nextidx].gtsBrokerNext);
+    }
+
+    /* The members must not wait forever if we fail. */
+    PG_TRY();
+    {
+        fetch_start = GetCurrentTimestamp();
+        gts_result = FetchGlobalTimestampGTM((int) count);
+    }
+    PG_CATCH();
+    {
+        Get_GTS_Result invalid_result = {InvalidGlobalTimestamp,false};
+
+        GTSBrokerWakeGroup(wakeidx, invalid_result);
+        PG_RE_THROW();
+    }
+    PG_END_TRY();
+
+    LWLockRelease(GTSBrokerLock);
+
+    pg_atomic_fetch_add_u64(&broker->batches, 1);
+    pg_atomic_fetch_add_u64(&broker->requests, count);
+    pg_atomic_fetch_add_u64(&broker->gtm_time, GetCurrentTimestamp() - fetch_start);
+    pg_atomic_fetch_add_u64(&broker->wait_time, GetCurrentTimestamp() - start);
+    max_batch = pg_atomic_read_u64(&broker->max_batch);
+    while (count > max_batch &&
+           !pg_atomic_compare_exchange_u64(&broker->max_batch, &max_batch, count))
+        ;
+
+    GTSBrokerWakeGroup(wakeidx, gts_result);
+
+    return gts_result;
+}
+
+GTM_Timestamp 
+GetGlobalTimestampGTM(void)
+{
+	struct rusage start_r;
+	struct timeval start_t;
+	Get_GTS_Result gts_result = {InvalidGlobalTimestamp,false};
+
+	if (!g_set_global_snapshot)
+	{
+		return LocalCommitTimestamp;
+	}
+
+    if (log_gtm_stats)
+        ResetUsageCommon(&start_r, &start_t);
+
+    /* Only backends with a PGPROC can wait for a leader */
+    if (enable_gts_broker && IsUnderPostmaster && MyProc != NULL)
+    {
+        gts_result = GetGlobalTimestampBroker();
+    }
+    else
+    {
+        gts_result = FetchGlobalTimestampGTM(1);
+    }
+
     if (log_gtm_stats)
         ShowUsageCommon("BeginTranGTM", &start_r, &start_t);
 
+	return CheckGlobalTimestamp(gts_result);
+}
+
+Size
+GTSBrokerShmemSize(void)
+{
+    return sizeof(GTSBrokerData);
+}
+
+void
+GTSBrokerShmemInit(void)
+{
+    bool        found;
+
+    GTSBroker = (GTSBrokerData *)
+        ShmemInitStruct("GTS broker", GTSBrokerShmemSize(), &found);
+
+    if (!found)
+    {
+        pg_atomic_init_u32(&GTSBroker->first, INVALID_PGPROCNO);
+        pg_atomic_init_u64(&GTSBroker->batches, 0);
+        pg_atomic_init_u64(&GTSBroker->requests, 0);
+        pg_atomic_init_u64(&GTSBroker->max_batch, 0);
+        pg_atomic_init_u64(&GTSBroker->wait_time, 0);
+        pg_atomic_init_u64(&GTSBroker->gtm_time, 0);
+    }
+}
+
+/*
+ * pg_stat_get_gts_broker
+ *        Return the statistics of the GTS broker of this node, used by the
+ *        pg_stat_gts_broker view. Times are reported in milliseconds.
+ */
+Datum
+pg_stat_get_gts_broker(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_GTS_BROKER_COLS 6
+    TupleDesc       tupdesc;
+    Datum           values[PG_STAT_GET_GTS_BROKER_COLS];
+    bool            nulls[PG_STAT_GET_GTS_BROKER_COLS];
+    uint64          batches = pg_atomic_read_u64(&GTSBroker->batches);
+    uint64          requests = pg_atomic_read_u64(&GTSBroker->requests);
+
+    /* this had better match pg_stat_gts_broker view in system_views.sql */
+    tupdesc = CreateTemplateTupleDesc(PG_STAT_GET_GTS_BROKER_COLS, false);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 1, "batches",
+                       INT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 2, "requests",
+                       INT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 3, "avg_batch_size",
+                       FLOAT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 4, "max_batch_size",
+                       INT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 5, "wait_time",
+                       FLOAT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 6, "gtm_time",
+                       FLOAT8OID, -1, 0);
+    BlessTupleDesc(tupdesc);
+
+    MemSet(nulls, 0, sizeof(nulls));
+    values[0] = Int64GetDatum(batches);
+    values[1] = Int64GetDatum(requests);
+    if (batches > 0)
+        values[2] = Float8GetDatum((double) requests / batches);
+    else
+        nulls[2] = true;
+    values[3] = Int64GetDatum(pg_atomic_read_u64(&GTSBroker->max_batch));
+    values[4] = Float8GetDatum(pg_atomic_read_u64(&GTSBroker->wait_time) / 1000.0);
+    values[5] = Float8GetDatum(pg_atomic_read_u64(&GTSBroker->gtm_time) / 1000.0);
+
+    PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
+/*
+ * Read the local clock, moved by hlc_simulated_skew to test how the hybrid
+ * logical clock behaves when the clock of this node jumps.
+ */
+static TimestampTz
+HLCLocalClock(void)
+{
+    return GetCurrentTimestamp() + (int64) hlc_simulated_skew * 1000;
+}
+
+/*
+ * Synchronize the hybrid logical clock with a GTS just got from GTM.
+ *
+ * The GTS is compared with what the clock expected. If they differ by more
+ * than hlc_max_skew the local clock can not be trusted, and read-only
+ * snapshots go to GTM until the next synchronization.
+ */
+static void
+HLCSynchronize(GTM_Timestamp gts)
+{
+    TimestampTz now = HLCLocalClock();
+    int64       skew = 0;
+    bool        checked = false;
+    bool        violated = false;
+
+    SpinLockAcquire(&HLCClock->mutex);
+    if (GlobalTimestampIsValid(HLCClock->sync_gts))
+    {
+        skew = HLCClock->sync_gts + (now - HLCClock->sync_time) - gts;
+        checked = true;
+        violated = Abs(skew) > (int64) hlc_max_skew * 1000;
+        HLCClock->last_skew = skew;
+        if (Abs(skew) > HLCClock->max_skew)
+            HLCClock->max_skew = Abs(skew);
+        if (violated)
+            HLCClock->skew_violations++;
+    }
+    HLCClock->valid = checked && !violated;
+    HLCClock->sync_gts = gts;
+    HLCClock->sync_time = now;
+    if (gts > HLCClock->floor_gts)
+        HLCClock->floor_gts = gts;
+    HLCClock->syncs++;
+    SpinLockRelease(&HLCClock->mutex);
+
+    if (violated)
+    {
+        elog(LOG, "local clock is " INT64_FORMAT " us away from GTM, more than hlc_max_skew",
+             skew);
+    }
+}
+
+/*
+ * Get a global timestamp for the snapshot of a read-only transaction.
+ *
+ * The safe time is the GTM time estimated by the hybrid logical clock, less
+ * hlc_max_skew so that it is not ahead of GTM even if the clocks drifted
+ * apart. It is only used once it is past every GTS got or served here, so it
+ * never goes back and sees the commits whose GTS were got here already; it is
+ * not bumped past them, since GTM may hand out the same GTS again. When the
+ * clock was not synchronized within hlc_sync_interval, can not be trusted, or
+ * is not past those GTS yet, the GTS is got from GTM.
+ */
+GTM_Timestamp
+GetGlobalTimestampHLC(void)
+{
+    TimestampTz     now = HLCLocalClock();
+    GTM_Timestamp   gts = InvalidGlobalTimestamp;
+
+    if (!g_set_global_snapshot)
+    {
+        return LocalCommitTimestamp;
+    }
+
+    SpinLockAcquire(&HLCClock->mutex);
+    if (HLCClock->valid && now >= HLCClock->sync_time &&
+        now - HLCClock->sync_time <= (int64) hlc_sync_interval * 1000)
+    {
+        gts = HLCClock->sync_gts + (now - HLCClock->sync_time) -
+              (int64) hlc_max_skew * 1000;
+    }
+
+    if (gts > HLCClock->floor_gts)
+    {
+        HLCClock->floor_gts = gts;
+        HLCClock->local_snapshots++;
+    }
+    else
+    {
+        gts = InvalidGlobalTimestamp;
+        HLCClock->gtm_snapshots++;
+    }
+    SpinLockRelease(&HLCClock->mutex);
+
+    if (GlobalTimestampIsValid(gts))
+    {
+        if (enable_distri_print)
+        {
+            elog(LOG, "hybrid logical clock global timestamp " INT64_FORMAT, gts);
+        }
+        return gts;
+    }
+
+    /* Synchronizes the clock */
+    return GetGlobalTimestampGTM();
+}
+
+Size
+HLCShmemSize(void)
+{
+    return sizeof(HLCClockData);
+}
+
+void
+HLCShmemInit(void)
+{
+    bool        found;
+
+    HLCClock = (HLCClockData *)
+        ShmemInitStruct("Hybrid logical clock", HLCShmemSize(), &found);
+
+    if (!found)
+    {
+        MemSet(HLCClock, 0, sizeof(HLCClockData));
+        SpinLockInit(&HLCClock->mutex);
+        HLCClock->sync_gts = InvalidGlobalTimestamp;
+        HLCClock->floor_gts = InvalidGlobalTimestamp;
+    }
+}
+
+/*
+ * pg_stat_get_hlc
+ *        Return the state of the hybrid logical clock of this node, used by
+ *        the pg_stat_hlc view. Times are reported in milliseconds.
+ */
+Datum
+pg_stat_get_hlc(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_HLC_COLS 9
+    TupleDesc       tupdesc;
+    Datum           values[PG_STAT_GET_HLC_COLS];
+    bool            nulls[PG_STAT_GET_HLC_COLS];
+    HLCClockData    clock;
+    TimestampTz     now = HLCLocalClock();
+
+    SpinLockAcquire(&HLCClock->mutex);
+    clock = *HLCClock;
+    SpinLockRelease(&HLCClock->mutex);
+
+    /* this had better match pg_stat_hlc view in system_views.sql */
+    tupdesc = CreateTemplateTupleDesc(PG_STAT_GET_HLC_COLS, false);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 1, "valid",
+                       BOOLOID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 2, "sync_gts",
+                       INT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 3, "sync_age",
+                       FLOAT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 4, "syncs",
+                       INT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 5, "local_snapshots",
+                       INT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 6, "gtm_snapshots",
+                       INT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 7, "skew_violations",
+                       INT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 8, "last_skew",
+                       FLOAT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 9, "max_skew",
+                       FLOAT8OID, -1, 0);
+    BlessTupleDesc(tupdesc);
+
+    MemSet(nulls, 0, sizeof(nulls));
+    values[0] = BoolGetDatum(clock.valid);
+    if (GlobalTimestampIsValid(clock.sync_gts))
+    {
+        values[1] = Int64GetDatum(clock.sync_gts);
+        values[2] = Float8GetDatum((now - clock.sync_time) / 1000.0);
+    }
+    else
+    {
+        nulls[1] = true;
+        nulls[2] = true;
+    }
+    values[3] = Int64GetDatum(clock.syncs);
+    values[4] = Int64GetDatum(clock.local_snapshots);
+    values[5] = Int64GetDatum(clock.gtm_snapshots);
+    values[6] = Int64GetDatum(clock.skew_violations);
+    values[7] = Float8GetDatum(clock.last_skew / 1000.0);
+    values[8] = Float8GetDatum(clock.max_skew / 1000.0);
+
+    PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
+/*
+ * Validate a global timestamp got from GTM and adjust it for standby.
+ */
+static GTM_Timestamp
+CheckGlobalTimestamp(Get_GTS_Result gts_result)
+{
+	GTM_Timestamp  latest_gts = InvalidGlobalTimestamp;
+
+	if (enable_hlc_readonly_gts && HLCClock != NULL &&
+		GlobalTimestampIsValid(gts_result.gts))
+	{
+		HLCSynchronize(gts_result.gts);
+	}
+
 	latest_gts = GetLatestCommitTS();
 	if (gts_result.gts != InvalidGlobalTimestamp && latest_gts > (gts_result.gts + GTM_CHECK_DELTA))
 	{
@@ -1570,6 +2101,66 @@ GetGlobalTimestampGTM(void)
 	
 	return gts_result.gts;
 }
+
+/*
+ * Send the request for a global timestamp to GTM and return at once, so that
+ * the caller can do other work while GTM answers. The timestamp is read by
+ * ReceiveGlobalTimestampGTM; another GTM request made meanwhile consumes and
+ * drops it. Return false if the request could not be sent,
+ * ReceiveGlobalTimestampGTM falls back to GetGlobalTimestampGTM then.
+ */
+bool
+RequestGlobalTimestampGTM(void)
+{
+	if (!g_set_global_snapshot)
+	{
+		return false;
+	}
+
+	CheckConnection();
+	if (conn)
+	{
+		gts_token = send_global_timestamp_async(conn);
+	}
+
+	if (gts_token == InvalidGTMAsyncToken && GTMDebugPrint)
+	{
+		elog(LOG, "request global timestamp failed");
+	}
+
+	return gts_token != InvalidGTMAsyncToken;
+}
+
+GTM_Timestamp
+ReceiveGlobalTimestampGTM(void)
+{
+	Get_GTS_Result	gts_result = {InvalidGlobalTimestamp,false};
+	GTM_AsyncResult	result;
+
+	if (gts_token == InvalidGTMAsyncToken)
+	{
+		return GetGlobalTimestampGTM();
+	}
+
+	if (conn && gtm_async_wait(conn, gts_token, &result) == GTM_RESULT_OK)
+	{
+		gts_result = result.data.gts;
+	}
+	gts_token = InvalidGTMAsyncToken;
+
+	/* Something went wrong, reconnect and retry the usual way. */
+	if (!GlobalTimestampIsValid(gts_result.gts))
+	{
+		if (GTMDebugPrint)
+		{
+			elog(LOG, "receive global timestamp failed, retry");
+		}
+		ResetGTMConnection();
+		return GetGlobalTimestampGTM();
+	}
+
+	return CheckGlobalTimestamp(gts_result);
+}
 #endif
 
 GlobalTransactionId
@@ -283,6 +283,7 @@ LruShmemSize(int nslots, int nlsns)
     sz += MAXALIGN(nslots * sizeof(bool));    /* page_dirty[] */
     sz += MAXALIGN(nslots * sizeof(int));    /* page_number[] */
     sz += MAXALIGN(nslots * sizeof(int));    /* page_lru_count[] */
+    sz += MAXALIGN(nslots * sizeof(pg_atomic_uint32));    /* page_version[] */
     sz += MAXALIGN((nslots + 1) * sizeof(LWLockPadded));    /* buffer_locks[] */
 
     if (nlsns > 0)
@@ -518,6 +519,8 @@ LruInit(LruCtl ctl, const char *name, int nslots, int nlsns, int nbufs,
             offset += MAXALIGN(nslots * sizeof(int));
             shared->page_lru_count = (int *) (ptr + offset);
             offset += MAXALIGN(nslots * sizeof(int));
+            shared->page_version = (pg_atomic_uint32 *) (ptr + offset);
+            offset += MAXALIGN(nslots * sizeof(pg_atomic_uint32));
 
             if (nlsns > 0)
             {
@@ -550,6 +553,7 @@ LruInit(LruCtl ctl, const char *name, int nslots, int nlsns, int nbufs,
                 shared->page_status[slotno] = LRU_PAGE_EMPTY;
                 shared->page_dirty[slotno] = false;
                 shared->page_lru_count[slotno] = 0;
+                pg_atomic_init_u32(&shared->page_version[slotno], 0);
                 ptr += BLCKSZ;
             }
             LWLockInitialize(&shared->buffer_locks[slotno].lock,
@@ -614,6 +618,7 @@ LruZeroPage(LruCtl ctl, int partitionno, int pageno)
     }
 
     /* Mark the slot as containing this page */
+    LruSlotChangeBegin(shared, slotno);
     shared->page_number[slotno] = pageno;
     shared->page_status[slotno] = LRU_PAGE_VALID;
     shared->page_dirty[slotno] = true;
@@ -623,6 +628,7 @@ LruZeroPage(LruCtl ctl, int partitionno, int pageno)
     /* Set the buffer to zeroes */
     MemSet(shared->page_buffer[slotno], 0, BLCKSZ);
 	LruTlogEnableMemoryProtection(shared->page_buffer[slotno]);
+    LruSlotChangeEnd(shared, slotno);
 
     /* Set the LSNs for this new page to zero */
     LruZeroLSNs(ctl, partitionno, slotno);
@@ -708,7 +714,9 @@ LruWaitIO(LruCtl ctl, int partitionno, int slotno)
                 INIT_LRUBUFTAG(tag, pageno);
                 hash = LruBufTableHashCode(&tag);
                 LruBufTableDelete(&tag, hash);        
+                LruSlotChangeBegin(shared, slotno);
                 shared->page_status[slotno] = LRU_PAGE_EMPTY;
+                LruSlotChangeEnd(shared, slotno);
             }
             else                /* write_in_progress */
             {
@@ -814,6 +822,7 @@ LruReadPage(LruCtl ctl, int partitionno, int pageno, bool write_ok,
             Assert(lookupno == slotno);
         }
 #endif
+        LruSlotChangeBegin(shared, slotno);
         shared->page_number[slotno] = pageno;
         shared->page_status[slotno] = LRU_PAGE_READ_IN_PROGRESS;
         shared->page_dirty[slotno] = false;
@@ -841,6 +850,7 @@ LruReadPage(LruCtl ctl, int partitionno, int pageno, bool write_ok,
 
         
         shared->page_status[slotno] = ok ? LRU_PAGE_VALID : LRU_PAGE_EMPTY;
+        LruSlotChangeEnd(shared, slotno);
         
         
         LWLockRelease(&shared->buffer_locks[slotno].lock);
@@ -941,6 +951,76 @@ LruReadPage_ReadOnly(LruCtl ctl, int partitionno, int pageno, TransactionId xid)
     return LruReadPage(ctl, partitionno, pageno, true, xid);
 }
 
+/*
+ * Copy len bytes at offset of a page without any lock, if the page is in a
+ * shared buffer. The version of the slot is checked before and after the
+ * copy, the copy is consistent if it did not change.
+ *
+ * Return false if the page is not in a buffer or changed during the copy,
+ * the caller then reads it through LruReadPage_ReadOnly.
+ */
+bool
+LruReadResidentPage(LruCtl ctl, int pageno, int offset, char *dst, int len)
+{
+    LruShared    shared = ctl->shared[PagenoMappingPartitionno(ctl, pageno)];
+    int            slotno;
+
+    Assert(offset >= 0 && offset + len <= BLCKSZ);
+
+    for (slotno = 0; slotno < shared->num_slots; slotno++)
+    {
+        uint32        version;
+
+        if (shared->page_number[slotno] != pageno)
+            continue;
+
+        version = pg_atomic_read_u32(&shared->page_version[slotno]);
+        if (version & 1)
+            return false;
+        pg_read_barrier();
+
+        /* An empty slot may still carry the page number */
+        if (shared->page_number[slotno] != pageno ||
+            (shared->page_status[slotno] != LRU_PAGE_VALID &&
+             shared->page_status[slotno] != LRU_PAGE_WRITE_IN_PROGRESS))
+            continue;
+
+        memcpy(dst, shared->page_buffer[slotno] + offset, len);
+        pg_read_barrier();
+        if (pg_atomic_read_u32(&shared->page_version[slotno]) != version)
+            return false;
+
+        LruRecentlyUsed(shared, slotno);
+        return true;
+    }
+
+    return false;
+}
+
+/*
+ * Make the version of a slot odd before changing the page it holds or the
+ * content of the page, and even again after. Control lock must be held in
+ * exclusive mode.
+ *
+ * A change interrupted by an error leaves the version odd, the next change
+ * of the slot makes it even again.
+ */
+void
+LruSlotChangeBegin(LruShared shared, int slotno)
+{
+    if (pg_atomic_read_u32(&shared->page_version[slotno]) & 1)
+        pg_memory_barrier();
+    else
+        pg_atomic_fetch_add_u32(&shared->page_version[slotno], 1);
+}
+
+void
+LruSlotChangeEnd(LruShared shared, int slotno)
+{
+    if (pg_atomic_read_u32(&shared->page_version[slotno]) & 1)
+        pg_atomic_fetch_add_u32(&shared->page_version[slotno], 1);
+}
+
 /*
  * Write a page from a shared buffer, if necessary.
  * Does nothing if the specified slot is not dirty.
@@ -1764,7 +1844,9 @@ restart:;
             oldPartitionno = BufHashPartition(oldHash);
             Assert(oldPartitionno == partitionno);
             LruBufTableDelete(&oldTag, oldHash);
+            LruSlotChangeBegin(shared, slotno);
             shared->page_status[slotno] = LRU_PAGE_EMPTY;
+            LruSlotChangeEnd(shared, slotno);
             elog(DEBUG10, "truncate pageno %d partition %d slotno %d cutoffpage %d.", oldPageno, partitionno, slotno, cutoffPage);
             continue;
         }
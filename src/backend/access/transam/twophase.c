@@ -280,6 +280,28 @@ typedef struct GlobalTransactionData
  * Two Phase Commit shared state.  Access to this struct is protected
  * by TwoPhaseStateLock.
  */
+#ifdef __TBASE__
+/*
+ * Latency of two-phase commit broken down by phase, times in microseconds.
+ * The remote_* counters are kept by the coordinator driving the transaction,
+ * the others by the node preparing and finishing it locally.
+ */
+typedef struct TwoPhaseStatsData
+{
+    pg_atomic_uint64 remote_prepares;
+    pg_atomic_uint64 remote_prepare_gts_time;
+    pg_atomic_uint64 remote_prepare_time;
+    pg_atomic_uint64 remote_finishes;
+    pg_atomic_uint64 remote_finish_gts_time;
+    pg_atomic_uint64 remote_finish_time;
+    pg_atomic_uint64 one_phase_commits;     /* single written node, no 2PC */
+    pg_atomic_uint64 prepares;
+    pg_atomic_uint64 prepare_flush_time;
+    pg_atomic_uint64 finishes;
+    pg_atomic_uint64 finish_time;
+} TwoPhaseStatsData;
+#endif
+
 typedef struct TwoPhaseStateData
 {
     /* Head of linked list of free GlobalTransactionData structs */
@@ -288,6 +310,11 @@ typedef struct TwoPhaseStateData
     /* Number of valid prepXacts entries. */
     int            numPrepXacts;
 
+#ifdef __TBASE__
+    /* Phase statistics shown by pg_stat_2pc */
+    TwoPhaseStatsData stats;
+#endif
+
     /* There are max_prepared_xacts items in this array */
     GlobalTransaction prepXacts[FLEXIBLE_ARRAY_MEMBER];
 } TwoPhaseStateData;
@@ -330,6 +357,10 @@ static void MarkAsPreparingGuts(GlobalTransaction gxact, TransactionId xid,
                     Oid databaseid);
 static void RemoveTwoPhaseFile(TransactionId xid, bool giveWarning);
 static void RecreateTwoPhaseFile(TransactionId xid, void *content, int len);
+#ifdef __TBASE__
+static void TwoPhaseStatsInit(TwoPhaseStatsData *stats);
+static void TwoPhaseFlushPrepare(XLogRecPtr lsn);
+#endif
 
 /*
  * Initialization of shared memory
@@ -366,6 +397,9 @@ TwoPhaseShmemInit(void)
         Assert(!found);
         TwoPhaseState->freeGXacts = NULL;
         TwoPhaseState->numPrepXacts = 0;
+#ifdef __TBASE__
+        TwoPhaseStatsInit(&TwoPhaseState->stats);
+#endif
 
         /*
          * Initialize the linked list of free GlobalTransactionData structs
@@ -402,6 +436,133 @@ TwoPhaseShmemInit(void)
         Assert(found);
 }
 
+#ifdef __TBASE__
+static void
+TwoPhaseStatsInit(TwoPhaseStatsData *stats)
+{
+    pg_atomic_init_u64(&stats->remote_prepares, 0);
+    pg_atomic_init_u64(&stats->remote_prepare_gts_time, 0);
+    pg_atomic_init_u64(&stats->remote_prepare_time, 0);
+    pg_atomic_init_u64(&stats->remote_finishes, 0);
+    pg_atomic_init_u64(&stats->remote_finish_gts_time, 0);
+    pg_atomic_init_u64(&stats->remote_finish_time, 0);
+    pg_atomic_init_u64(&stats->one_phase_commits, 0);
+    pg_atomic_init_u64(&stats->prepares, 0);
+    pg_atomic_init_u64(&stats->prepare_flush_time, 0);
+    pg_atomic_init_u64(&stats->finishes, 0);
+    pg_atomic_init_u64(&stats->finish_time, 0);
+}
+
+/*
+ * Account a PREPARE or COMMIT/ROLLBACK PREPARED round driven by this
+ * coordinator: time spent waiting for the GTS and time spent sending the
+ * command to the participants and collecting their responses.
+ */
+void
+TwoPhaseStatsReportRemote(bool finish, int64 gts_time, int64 fanout_time)
+{
+    TwoPhaseStatsData *stats = &TwoPhaseState->stats;
+
+    if (finish)
+    {
+        pg_atomic_fetch_add_u64(&stats->remote_finishes, 1);
+        pg_atomic_fetch_add_u64(&stats->remote_finish_gts_time, gts_time);
+        pg_atomic_fetch_add_u64(&stats->remote_finish_time, fanout_time);
+    }
+    else
+    {
+        pg_atomic_fetch_add_u64(&stats->remote_prepares, 1);
+        pg_atomic_fetch_add_u64(&stats->remote_prepare_gts_time, gts_time);
+        pg_atomic_fetch_add_u64(&stats->remote_prepare_time, fanout_time);
+    }
+}
+
+/*
+ * Account a transaction which wrote a single remote node and so was committed
+ * there with a plain COMMIT, skipping two-phase commit.
+ */
+void
+TwoPhaseStatsReportOnePhase(void)
+{
+    pg_atomic_fetch_add_u64(&TwoPhaseState->stats.one_phase_commits, 1);
+}
+
+/*
+ * Flush the PREPARE record up to lsn. Concurrent PREPARE records share a WAL
+ * flush the same way commit records do: XLogFlush lets the backend holding
+ * WALWriteLock flush for the ones waiting on it, after commit_delay if there
+ * are commit_siblings. Called in a critical section.
+ */
+static void
+TwoPhaseFlushPrepare(XLogRecPtr lsn)
+{
+    TwoPhaseStatsData *stats = &TwoPhaseState->stats;
+    TimestampTz        start = GetCurrentTimestamp();
+
+    XLogFlush(lsn);
+
+    pg_atomic_fetch_add_u64(&stats->prepares, 1);
+    pg_atomic_fetch_add_u64(&stats->prepare_flush_time,
+                            GetCurrentTimestamp() - start);
+}
+
+/*
+ * pg_stat_get_2pc
+ *        Return the two-phase commit statistics of this node, used by the
+ *        pg_stat_2pc view. Times are reported in milliseconds.
+ */
+Datum
+pg_stat_get_2pc(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_2PC_COLS 11
+    TupleDesc          tupdesc;
+    Datum              values[PG_STAT_GET_2PC_COLS];
+    bool               nulls[PG_STAT_GET_2PC_COLS];
+    TwoPhaseStatsData *stats = &TwoPhaseState->stats;
+
+    /* this had better match pg_stat_2pc view in system_views.sql */
+    tupdesc = CreateTemplateTupleDesc(PG_STAT_GET_2PC_COLS, false);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 1, "remote_prepares",
+                       INT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 2, "remote_prepare_gts_time",
+                       FLOAT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 3, "remote_prepare_time",
+                       FLOAT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 4, "remote_finishes",
+                       INT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 5, "remote_finish_gts_time",
+                       FLOAT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 6, "remote_finish_time",
+                       FLOAT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 7, "one_phase_commits",
+                       INT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 8, "prepares",
+                       INT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 9, "prepare_flush_time",
+                       FLOAT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 10, "finishes",
+                       INT8OID, -1, 0);
+    TupleDescInitEntry(tupdesc, (AttrNumber) 11, "finish_time",
+                       FLOAT8OID, -1, 0);
+    BlessTupleDesc(tupdesc);
+
+    MemSet(nulls, 0, sizeof(nulls));
+    values[0] = Int64GetDatum(pg_atomic_read_u64(&stats->remote_prepares));
+    values[1] = Float8GetDatum(pg_atomic_read_u64(&stats->remote_prepare_gts_time) / 1000.0);
+    values[2] = Float8GetDatum(pg_atomic_read_u64(&stats->remote_prepare_time) / 1000.0);
+    values[3] = Int64GetDatum(pg_atomic_read_u64(&stats->remote_finishes));
+    values[4] = Float8GetDatum(pg_atomic_read_u64(&stats->remote_finish_gts_time) / 1000.0);
+    values[5] = Float8GetDatum(pg_atomic_read_u64(&stats->remote_finish_time) / 1000.0);
+    values[6] = Int64GetDatum(pg_atomic_read_u64(&stats->one_phase_commits));
+    values[7] = Int64GetDatum(pg_atomic_read_u64(&stats->prepares));
+    values[8] = Float8GetDatum(pg_atomic_read_u64(&stats->prepare_flush_time) / 1000.0);
+    values[9] = Int64GetDatum(pg_atomic_read_u64(&stats->finishes));
+    values[10] = Float8GetDatum(pg_atomic_read_u64(&stats->finish_time) / 1000.0);
+
+    PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+#endif
+
 /*
  * Exit hook to unlock the global transaction entry we're working on.
  */
@@ -1522,7 +1683,11 @@ EndPrepare(GlobalTransaction gxact)
     for (record = records.head; record != NULL; record = record->next)
         XLogRegisterData(record->data, record->len);
     gxact->prepare_end_lsn = XLogInsert(RM_XACT_ID, XLOG_XACT_PREPARE);
+#ifdef __TBASE__
+    TwoPhaseFlushPrepare(gxact->prepare_end_lsn);
+#else
     XLogFlush(gxact->prepare_end_lsn);
+#endif
 
     /* If we crash now, we have prepared: WAL replay will fix things */
 
@@ -1819,6 +1984,7 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
     RenameInfo  *rename_info = NULL;
     CreateInfo    *create_info = NULL;
     DropInfo    *drop_info   = NULL;
+    TimestampTz  finish_start = GetCurrentTimestamp();
 #endif
     int            i;
 
@@ -2192,6 +2358,11 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
     }
 #endif    
 
+#ifdef __TBASE__
+    pg_atomic_fetch_add_u64(&TwoPhaseState->stats.finishes, 1);
+    pg_atomic_fetch_add_u64(&TwoPhaseState->stats.finish_time,
+                            GetCurrentTimestamp() - finish_start);
+#endif
 }
 
 /*
@@ -2826,6 +2826,19 @@ CommitTransaction(void)
          * first. If that fails, the transaction is aborted on all the remote
          * nodes
          */
+#ifdef __TBASE__
+        /*
+         * Remote utilities register the local node as written even if they
+         * ran on the datanodes only. If nothing was written here, WAL-logged
+         * or not, there is nothing to prepare locally, so that a transaction
+         * writing a single datanode commits there with a plain COMMIT.
+         */
+        if (XactWriteLocalNode && XactLastRecEnd == 0 &&
+            !(MyXactFlags & (XACT_FLAGS_WROTENOWALREL | XACT_FLAGS_ACCESSEDTEMPREL)))
+        {
+            XactWriteLocalNode = false;
+        }
+#endif
         /*
          * Fired OnCommit actions would fail 2PC process
          */
@@ -115,6 +115,9 @@
 #ifdef __COLD_HOT__
 #include "catalog/pgxc_key_values.h"
 #endif
+#ifdef _SHARDING_
+#include "catalog/pg_shard_statistic.h"
+#endif
 
 #ifdef __TBASE__
 extern bool enable_parallel_ddl;
@@ -2938,6 +2941,9 @@ heap_drop_with_catalog(Oid relid)
      * delete statistics
      */
     RemoveStatistics(relid, 0);
+#ifdef _SHARDING_
+    RemoveShardStatistic(relid);
+#endif
 
     /*
      * delete attribute tuples
@@ -0,0 +1,224 @@
+/*
+ * Tencent is pleased to support the open source community by making TBase available.  
+ * 
+ * Copyright (C) 2019 Tencent.  All rights reserved.
+ * 
+ * TBase is licensed under the BSD 3-Clause License, except for the third-party component listed below. 
+ * 
+ * A copy of the BSD 3-Clause License is included in this file.
+ * 
+ * Other dependencies and licenses:
+ * 
+ * Open Source Software Licensed Under the PostgreSQL License: 
+ * --------------------------------------------------------------------
+ * 1. Postgres-XL XL9_5_STABLE
+ * Portions Copyright (c) 2015-2016, 2ndQuadrant Ltd
+ * Portions Copyright (c) 2012-2015, TransLattice, Inc.
+ * Portions Copyright (c) 2010-2017, Postgres-XC Development Group
+ * Portions Copyright (c) 1996-2015, The PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, The Regents of the University of California
+ * 
+ * Terms of the PostgreSQL License: 
+ * --------------------------------------------------------------------
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation for any purpose, without fee, and without a written agreement
+ * is hereby granted, provided that the above copyright notice and this
+ * paragraph and the following two paragraphs appear in all copies.
+ * 
+ * IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING
+ * LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+ * DOCUMENTATION, EVEN IF THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATIONS TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ * 
+ * 
+ * Terms of the BSD 3-Clause License:
+ * --------------------------------------------------------------------
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation 
+ * and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of Tencent nor the names of its contributors may be used to endorse or promote products derived from this software without 
+ * specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS 
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE 
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE.
+ * 
+ */
+/*-------------------------------------------------------------------------
+ *
+ * pg_shard_statistic.c
+ *    routines to support manipulation of the pg_shard_statistic relation
+ *
+ * Copyright (c) 1996-2010, PostgreSQL Global Development Group
+ * Portions Copyright (c) 2010-2012 Postgres-XC Development Group
+ *
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "catalog/indexing.h"
+#include "catalog/pg_shard_statistic.h"
+#include "catalog/pg_type.h"
+#include "utils/array.h"
+#include "utils/rel.h"
+#include "utils/syscache.h"
+
+
+static ArrayType *
+make_shard_array(void *elems, int nelems, Oid elemtype)
+{
+    Datum      *datums = (Datum *) palloc(nelems * sizeof(Datum));
+    int         i;
+
+    for (i = 0; i < nelems; i++)
+    {
+        if (elemtype == INT4OID)
+            datums[i] = Int32GetDatum(((int32 *) elems)[i]);
+        else
+            datums[i] = Float4GetDatum(((float4 *) elems)[i]);
+    }
+
+    return construct_array(datums, nelems, elemtype, sizeof(int32),
+                           elemtype == INT4OID ? true : FLOAT4PASSBYVAL, 'i');
+}
+
+/*
+ * Copy a column of a pg_shard_statistic tuple, all of them are 1-D arrays
+ * of 4 byte elements without nulls.
+ */
+static int
+copy_shard_array(HeapTuple tup, AttrNumber attnum, Oid elemtype, void **elems)
+{
+    ArrayType  *arr;
+    Datum       datum;
+    bool        isnull;
+    int         nelems;
+
+    datum = SysCacheGetAttr(SHARDSTATRELID, tup, attnum, &isnull);
+    if (isnull)
+        elog(ERROR, "null column %d in pg_shard_statistic", attnum);
+
+    arr = DatumGetArrayTypeP(datum);
+    /* a relation without extents is stored as empty arrays */
+    nelems = ARR_NDIM(arr) == 0 ? 0 : ARR_DIMS(arr)[0];
+    if (ARR_NDIM(arr) > 1 || ARR_HASNULL(arr) ||
+        ARR_ELEMTYPE(arr) != elemtype)
+        elog(ERROR, "column %d of pg_shard_statistic is not a 1-D array of type %u",
+                    attnum, elemtype);
+
+    *elems = palloc(Max(nelems, 1) * sizeof(int32));
+    memcpy(*elems, ARR_DATA_PTR(arr), nelems * sizeof(int32));
+
+    if ((Pointer) arr != DatumGetPointer(datum))
+        pfree(arr);
+
+    return nelems;
+}
+
+/*
+ * Replace the shard statistics of a relation, shards holds the ids of the
+ * shards in ascending order and pages/tuples their estimates.
+ */
+void
+StoreShardStatistic(Oid relid, int nshards, int32 *shards,
+                    float4 *pages, float4 *tuples)
+{
+    Relation    rel;
+    HeapTuple   oldtup;
+    HeapTuple   tup;
+    Datum       values[Natts_pg_shard_statistic];
+    bool        nulls[Natts_pg_shard_statistic];
+    bool        replaces[Natts_pg_shard_statistic];
+
+    memset(nulls, false, sizeof(nulls));
+    memset(replaces, true, sizeof(replaces));
+
+    values[Anum_pg_shard_statistic_starelid - 1] = ObjectIdGetDatum(relid);
+    values[Anum_pg_shard_statistic_stashards - 1] =
+        PointerGetDatum(make_shard_array(shards, nshards, INT4OID));
+    values[Anum_pg_shard_statistic_stapages - 1] =
+        PointerGetDatum(make_shard_array(pages, nshards, FLOAT4OID));
+    values[Anum_pg_shard_statistic_statuples - 1] =
+        PointerGetDatum(make_shard_array(tuples, nshards, FLOAT4OID));
+
+    rel = heap_open(ShardStatisticRelationId, RowExclusiveLock);
+
+    oldtup = SearchSysCache1(SHARDSTATRELID, ObjectIdGetDatum(relid));
+    if (HeapTupleIsValid(oldtup))
+    {
+        tup = heap_modify_tuple(oldtup, RelationGetDescr(rel),
+                                values, nulls, replaces);
+        ReleaseSysCache(oldtup);
+        CatalogTupleUpdate(rel, &tup->t_self, tup);
+    }
+    else
+    {
+        tup = heap_form_tuple(RelationGetDescr(rel), values, nulls);
+        CatalogTupleInsert(rel, tup);
+    }
+
+    heap_freetuple(tup);
+    heap_close(rel, RowExclusiveLock);
+}
+
+/* remove the shard statistics of a relation being dropped */
+void
+RemoveShardStatistic(Oid relid)
+{
+    Relation    rel;
+    HeapTuple   tup;
+
+    tup = SearchSysCache1(SHARDSTATRELID, ObjectIdGetDatum(relid));
+    if (!HeapTupleIsValid(tup))
+        return;
+
+    rel = heap_open(ShardStatisticRelationId, RowExclusiveLock);
+    CatalogTupleDelete(rel, &tup->t_self);
+    heap_close(rel, RowExclusiveLock);
+
+    ReleaseSysCache(tup);
+}
+
+/*
+ * Get the shard statistics of a relation in palloc'd arrays, returns the
+ * number of shards or -1 if the relation has never been analyzed.
+ */
+int
+FetchShardStatistic(Oid relid, int32 **shards, float4 **pages, float4 **tuples)
+{
+    HeapTuple   tup;
+    int         nshards;
+
+    tup = SearchSysCache1(SHARDSTATRELID, ObjectIdGetDatum(relid));
+    if (!HeapTupleIsValid(tup))
+        return -1;
+
+    nshards = copy_shard_array(tup, Anum_pg_shard_statistic_stashards,
+                               INT4OID, (void **) shards);
+    if (copy_shard_array(tup, Anum_pg_shard_statistic_stapages,
+                         FLOAT4OID, (void **) pages) != nshards ||
+        copy_shard_array(tup, Anum_pg_shard_statistic_statuples,
+                         FLOAT4OID, (void **) tuples) != nshards)
+        elog(ERROR, "inconsistent pg_shard_statistic entry for relation %u", relid);
+
+    ReleaseSysCache(tup);
+
+    return nshards;
+}
@@ -867,6 +867,87 @@ CREATE VIEW pg_stat_archiver AS
         s.stats_reset
     FROM pg_stat_get_archiver() s;
 
+CREATE VIEW pg_stat_2pc AS
+    SELECT
+        s.remote_prepares,
+        s.remote_prepare_gts_time,
+        s.remote_prepare_time,
+        s.remote_finishes,
+        s.remote_finish_gts_time,
+        s.remote_finish_time,
+        s.one_phase_commits,
+        s.prepares,
+        s.prepare_flush_time,
+        s.finishes,
+        s.finish_time
+    FROM pg_stat_get_2pc() s;
+
+CREATE VIEW pg_stat_committs_cache AS
+    SELECT
+        s.reads,
+        s.cache_hits,
+        s.lockfree_reads,
+        s.locked_reads,
+        s.hit_ratio,
+        s.avg_cache_time,
+        s.avg_lockfree_time,
+        s.avg_locked_time,
+        s.time_saved
+    FROM pg_stat_get_committs_cache() s;
+
+CREATE VIEW pg_stat_gts_broker AS
+    SELECT
+        s.batches,
+        s.requests,
+        s.avg_batch_size,
+        s.max_batch_size,
+        s.wait_time,
+        s.gtm_time
+    FROM pg_stat_get_gts_broker() s;
+
+CREATE VIEW pg_stat_hlc AS
+    SELECT
+        s.valid,
+        s.sync_gts,
+        s.sync_age,
+        s.syncs,
+        s.local_snapshots,
+        s.gtm_snapshots,
+        s.skew_violations,
+        s.last_skew,
+        s.max_skew
+    FROM pg_stat_get_hlc() s;
+
+CREATE VIEW pg_stat_sequence_cache AS
+    SELECT
+        s.datid,
+        s.relid,
+        s.seqname,
+        s.range,
+        s.cached,
+        s.hits,
+        s.misses,
+        s.refills,
+        s.refill_failures,
+        s.avg_refill_time,
+        s.max_refill_time,
+        s.avg_miss_time
+    FROM pg_stat_get_sequence_cache() s;
+
+CREATE VIEW pg_stat_datapump AS
+    SELECT
+        s.node_index,
+        s.node_name,
+        s.senders,
+        s.max_queue_depth,
+        s.stalls,
+        s.stall_time,
+        s.raw_bytes,
+        s.compressed_bytes,
+        s.compress_ratio,
+        s.compress_time
+    FROM pg_stat_get_datapump() s;
+
 CREATE VIEW pg_stat_bgwriter AS
     SELECT
         pg_stat_get_bgwriter_timed_checkpoints() AS checkpoints_timed,
@@ -1256,3 +1337,23 @@ $$
 		) AS extentinfo(shardid, num_of_extent) ON shardinfo.shardid = extentinfo.shardid;
 $$
 LANGUAGE SQL STRICT STABLE;
+
+CREATE FUNCTION pg_shard_skew()
+RETURNS TABLE(relid regclass, shardid integer, nodename name, pages real,
+	tuples real, skew numeric, rank bigint) AS
+$$
+	SELECT s.starelid::regclass,
+		u.shardid,
+		node.node_name,
+		u.pages,
+		u.tuples,
+		round((u.tuples / nullif(avg(u.tuples) OVER (PARTITION BY s.starelid), 0))::numeric, 2),
+		rank() OVER (PARTITION BY s.starelid ORDER BY u.tuples DESC)
+	FROM pg_shard_statistic s
+	CROSS JOIN LATERAL unnest(s.stashards, s.stapages, s.statuples) AS u(shardid, pages, tuples)
+	LEFT JOIN pgxc_class pc ON pc.pcrelid = s.starelid
+	LEFT JOIN pgxc_shard_map m ON m.disgroup = pc.pgroup AND m.shardgroupid = u.shardid
+	LEFT JOIN pgxc_node node ON node.oid = m.primarycopy
+	ORDER BY s.starelid, 7;
+$$
+LANGUAGE SQL STABLE;
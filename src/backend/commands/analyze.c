@@ -72,6 +72,11 @@
 #include "pgxc/planner.h"
 #include "utils/snapmgr.h"
 #endif
+#ifdef _SHARDING_
+#include "catalog/pg_shard_statistic.h"
+#include "pgxc/shardmap.h"
+#include "utils/array.h"
+#endif
 #ifdef __TBASE__
 #include "funcapi.h"
 #include "nodes/nodes.h"
@@ -165,6 +170,9 @@ static int acquire_coordinator_sample_rows(Relation onerel, int elevel,
 												int64 *totalpages, int64 *visiblepages);
 
 #endif
+#ifdef _SHARDING_
+static void coord_collect_shard_stats(Relation onerel);
+#endif
 
 /*
  *    analyze_rel() -- analyze one relation
@@ -663,6 +671,11 @@ do_analyze_rel(Relation				 onerel,
         analyze_rel_coordinator(onerel, inh, attr_cnt, vacattrstats,
                                 nindexes, Irel, indexdata);
 
+#ifdef _SHARDING_
+        if (!inh && RelationGetLocatorType(onerel) == LOCATOR_TYPE_SHARD)
+            coord_collect_shard_stats(onerel);
+#endif
+
         /*
          * Skip acquiring local stats. Coordinator does not store data of
          * distributed tables.
@@ -837,6 +850,17 @@ do_analyze_rel(Relation				 onerel,
                             InvalidTransactionId,
                             InvalidMultiXactId,
                             in_outer_xact);
+
+#ifdef _SHARDING_
+        /* pages and tuples of each shard, for the planner */
+        if (iscoordinator)
+        {
+            if (RelationGetLocatorType(onerel) == LOCATOR_TYPE_SHARD)
+                coord_collect_shard_stats(onerel);
+        }
+        else if (IS_PGXC_DATANODE)
+            AnalyzeShardStatistic(onerel);
+#endif
     }
 
     /*
@@ -4451,6 +4475,156 @@ coord_collect_extended_stats(Relation onerel, int attr_cnt)
     ExecEndRemoteQuery(node);
 }
 
+#ifdef _SHARDING_
+/*
+ * coord_collect_shard_stats
+ *        Merge the shard statistics of the datanodes into pg_shard_statistic.
+ *
+ * Each datanode reports the shards it owns, so the rows are simply put
+ * together. The entry of the coordinator is kept when no datanode has one.
+ */
+static void
+coord_collect_shard_stats(Relation onerel)
+{
+    char            *nspname;
+    char            *relname;
+    StringInfoData  query;
+    EState            *estate;
+    MemoryContext     oldcontext;
+    RemoteQuery        *step;
+    RemoteQueryState *node;
+    TupleTableSlot *result;
+    float4           *pages;
+    float4           *tuples;
+    int32           *shards;
+    bool           *found;
+    int             nshards = 0;
+    int             nnodes = 0;
+    int             i;
+
+    relname = RelationGetRelationName(onerel);
+    nspname = get_namespace_name(RelationGetNamespace(onerel));
+
+    initStringInfo(&query);
+    appendStringInfo(&query, "SELECT s.stashards, "
+                                    "s.stapages, "
+                                    "s.statuples "
+                             "FROM pg_shard_statistic s JOIN pg_class c "
+                             "ON s.starelid = c.oid "
+                             "JOIN pg_namespace n "
+                             "ON c.relnamespace = n.oid "
+                             "WHERE n.nspname = '%s' "
+                             "AND c.relname = '%s'",
+                     nspname, relname);
+
+    /*
+     * Run within the transaction, the datanodes collected their statistics
+     * in it when the rows were sampled.
+     */
+    step = makeNode(RemoteQuery);
+    step->combine_type = COMBINE_TYPE_NONE;
+    step->exec_nodes = NULL;
+    step->sql_statement = query.data;
+    step->force_autocommit = false;
+    step->exec_type = EXEC_ON_DATANODES;
+
+    step->scan.plan.targetlist = lappend(step->scan.plan.targetlist,
+                                         make_relation_tle(ShardStatisticRelationId,
+                                                           "pg_shard_statistic",
+                                                           "stashards"));
+    step->scan.plan.targetlist = lappend(step->scan.plan.targetlist,
+                                         make_relation_tle(ShardStatisticRelationId,
+                                                           "pg_shard_statistic",
+                                                           "stapages"));
+    step->scan.plan.targetlist = lappend(step->scan.plan.targetlist,
+                                         make_relation_tle(ShardStatisticRelationId,
+                                                           "pg_shard_statistic",
+                                                           "statuples"));
+
+    pages = (float4 *) palloc0(MAX_SHARDS * sizeof(float4));
+    tuples = (float4 *) palloc0(MAX_SHARDS * sizeof(float4));
+    found = (bool *) palloc0(MAX_SHARDS * sizeof(bool));
+
+    estate = CreateExecutorState();
+
+    oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+    estate->es_snapshot = GetActiveSnapshot();
+
+    node = ExecInitRemoteQuery(step, estate, 0);
+    MemoryContextSwitchTo(oldcontext);
+
+    result = ExecRemoteQuery((PlanState *) node);
+    while (result != NULL && !TupIsNull(result))
+    {
+        Datum   values[3];
+        bool    nulls[3];
+        Datum  *elems[3];
+        int     nelems[3];
+
+        for (i = 0; i < 3; i++)
+            values[i] = slot_getattr(result, i + 1, &nulls[i]);
+
+        if (!nulls[0] && !nulls[1] && !nulls[2])
+        {
+            deconstruct_array(DatumGetArrayTypeP(values[0]), INT4OID,
+                              sizeof(int32), true, 'i',
+                              &elems[0], NULL, &nelems[0]);
+            deconstruct_array(DatumGetArrayTypeP(values[1]), FLOAT4OID,
+                              sizeof(float4), FLOAT4PASSBYVAL, 'i',
+                              &elems[1], NULL, &nelems[1]);
+            deconstruct_array(DatumGetArrayTypeP(values[2]), FLOAT4OID,
+                              sizeof(float4), FLOAT4PASSBYVAL, 'i',
+                              &elems[2], NULL, &nelems[2]);
+
+            if (nelems[0] != nelems[1] || nelems[0] != nelems[2])
+                elog(ERROR, "inconsistent shard statistics of \"%s.%s\" on a datanode",
+                            nspname, relname);
+
+            for (i = 0; i < nelems[0]; i++)
+            {
+                int32 sid = DatumGetInt32(elems[0][i]);
+
+                if (sid < 0 || sid >= MAX_SHARDS)
+                    continue;
+
+                found[sid] = true;
+                pages[sid] += DatumGetFloat4(elems[1][i]);
+                tuples[sid] += DatumGetFloat4(elems[2][i]);
+            }
+            nnodes++;
+        }
+
+        /* fetch next */
+        result = ExecRemoteQuery((PlanState *) node);
+    }
+    ExecEndRemoteQuery(node);
+
+    if (nnodes > 0)
+    {
+        /* compact in shard order */
+        shards = (int32 *) palloc(MAX_SHARDS * sizeof(int32));
+        for (i = 0; i < MAX_SHARDS; i++)
+        {
+            if (!found[i])
+                continue;
+            shards[nshards] = i;
+            pages[nshards] = pages[i];
+            tuples[nshards] = tuples[i];
+            nshards++;
+        }
+
+        StoreShardStatistic(RelationGetRelid(onerel), nshards, shards,
+                            pages, tuples);
+        pfree(shards);
+    }
+
+    pfree(pages);
+    pfree(tuples);
+    pfree(found);
+}
+#endif
+
 /*
  * analyze_rel_coordinator
  *        Collect all statistics for a particular relation.
@@ -5096,6 +5270,11 @@ void ExecSample(SampleStmt *stmt, DestReceiver *dest)
 													 rows, stmt->rownum, 
 													 &context->totalnum, 
 													 &context->deadnum);
+#ifdef _SHARDING_
+			/* the coordinator collects them after the samples */
+			if (IS_PGXC_DATANODE)
+				AnalyzeShardStatistic(onerel);
+#endif
 		}
 	}
 
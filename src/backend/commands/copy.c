@@ -2464,7 +2464,12 @@ CopyTo(CopyState cstate)
             
             for(i = 0; i < cstate->nparts; i++)
             {
-                scandesc = heap_beginscan(cstate->partrels[i], GetActiveSnapshot(), 0, NULL);
+                /* read only the extents of the shards wanted */
+                if(cstate->shard_array)
+                    scandesc = heap_beginscan_shards(cstate->partrels[i], GetActiveSnapshot(),
+                                                     cstate->shard_array);
+                else
+                    scandesc = heap_beginscan(cstate->partrels[i], GetActiveSnapshot(), 0, NULL);
                 while ((tuple = heap_getnext(scandesc, ForwardScanDirection)) != NULL)
                 {
                     bool isdeformed = false;
@@ -2579,6 +2584,8 @@ CopyTo(CopyState cstate)
                     /* Format and send the data */
                     CopyOneRowTo(cstate, HeapTupleGetOid(tuple), values, nulls);
                     processed++;
+                    if(cstate->shard_array)
+                        ShardMoveReportCopy(1, tuple->t_len, false);
                 }
                 heap_endscan(scandesc);
                 scandesc = NULL;
@@ -2596,6 +2603,11 @@ CopyTo(CopyState cstate)
         {
 #endif    
 
+#ifdef _SHARDING_
+        if(cstate->shard_array)
+            scandesc = heap_beginscan_shards(cstate->rel, GetActiveSnapshot(), cstate->shard_array);
+        else
+#endif
         scandesc = heap_beginscan(cstate->rel, GetActiveSnapshot(), 0, NULL);
 
         processed = 0;
@@ -2682,12 +2694,20 @@ CopyTo(CopyState cstate)
             /* Format and send the data */
             CopyOneRowTo(cstate, HeapTupleGetOid(tuple), values, nulls);
             processed++;
+#ifdef _SHARDING_
+            if(cstate->shard_array)
+                ShardMoveReportCopy(1, tuple->t_len, false);
+#endif
         }
 
         heap_endscan(scandesc);
 #ifdef __TBASE__
         }
 #endif
+#ifdef _SHARDING_
+        if(cstate->shard_array)
+            ShardMoveReportCopy(0, 0, true);
+#endif
 
         if(error_shards > 0)
             elog(WARNING, "there are %d tuples's shardid which shardis in invalid in relation %s(%d).", 
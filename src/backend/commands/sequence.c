@@ -61,6 +61,18 @@
 #endif
 #endif
 #include "utils/varlena.h"
+#ifdef __TBASE__
+#include "access/xact.h"
+#include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/guc.h"
+#endif
 
 /*
  * We don't want to log each fetching of a value from a sequence,
@@ -112,6 +124,80 @@ typedef SeqTableData *SeqTable;
 
 static HTAB *seqhashtab = NULL; /* hash table for SeqTable items */
 
+#ifdef __TBASE__
+/*
+ * Node-wide cache of sequence ranges.
+ *
+ * With sequence_cache_entries > 0, the backends of a node take the values of
+ * a sequence from ranges kept in shared memory instead of each fetching a
+ * range of its own from GTM. When the values left drop below
+ * sequence_cache_low_watermark percent of the range, the sequence cache
+ * refiller fetches the next range in the background, so that nextval seldom
+ * waits for GTM. Values left in a range are lost when the entry is reset,
+ * as for the backend-local cache.
+ */
+int            SequenceCacheEntries = 0;
+int            SequenceCacheLowWatermark = 50;
+
+/* Enough for the database.schema.sequence name used on GTM */
+#define SEQCACHE_NAME_LEN        (3 * NAMEDATALEN)
+
+/* Entries not used for that many seconds are dropped by the refiller */
+#define SEQCACHE_IDLE_TIMEOUT    300
+
+#define SEQCACHE_NAPTIME_MS      1000
+
+typedef struct SeqCacheKey
+{
+    Oid            dbid;
+    Oid            relid;
+} SeqCacheKey;
+
+typedef struct SeqCacheEntry
+{
+    SeqCacheKey    key;            /* hash key, must be first */
+    slock_t        mutex;          /* protects all the fields below */
+    uint32         generation;     /* bumped when the ranges are reset */
+    Oid            filenode;       /* relfilenode the ranges were fetched for */
+    int64          increment;
+    int64          range;          /* number of values fetched at a time */
+    int64          next;           /* next value of the current range */
+    int64          left;           /* values left in the current range */
+    int64          prefetch_first; /* range fetched by the refiller */
+    int64          prefetch_left;
+    bool           refilling;      /* refiller is asked for the next range */
+    bool           refill_failed;  /* don't ask again until a miss succeeds */
+    TimestampTz    last_used;
+    char           seqname[SEQCACHE_NAME_LEN];
+
+    /* statistics, times in microseconds */
+    int64          hits;
+    int64          misses;
+    int64          miss_time;
+    int64          refills;
+    int64          refill_failures;
+    int64          refill_time;
+    int64          max_refill_time;
+} SeqCacheEntry;
+
+typedef struct SeqCacheShared
+{
+    Latch         *refiller_latch; /* NULL if the refiller is not running */
+} SeqCacheShared;
+
+static SeqCacheShared *SeqCache = NULL;
+static HTAB *SeqCacheHash = NULL;
+
+static volatile sig_atomic_t seqcache_got_sighup = false;
+
+static SeqCacheEntry *SequenceCacheLookup(Relation seqrel, bool create);
+static bool SequenceCacheNextval(Relation seqrel, int64 incby, int64 range,
+                                 int64 *result, bool *cached);
+static void SequenceCacheInstall(Relation seqrel, const char *seqname,
+                                 int64 first, int64 rangemax, int64 elapsed);
+static void SequenceCacheInvalidate(Oid relid);
+#endif
+
 #ifdef PGXC
 /*
  * Arguments for callback of sequence drop on GTM
@@ -537,6 +623,9 @@ ResetSequence(Oid seq_relid)
     /* Clear local cache so that we don't think we have cached numbers */
     /* Note that we do not change the currval() state */
     elm->cached = elm->last;
+#ifdef __TBASE__
+    SequenceCacheInvalidate(seq_relid);
+#endif
 
     relation_close(seq_rel, NoLock);
 }
@@ -702,6 +791,9 @@ AlterSequence(ParseState *pstate, AlterSeqStmt *stmt)
         /* Clear local cache so that we don't think we have cached numbers */
         /* Note that we do not change the currval() state */
         elm->cached = elm->last;
+#ifdef __TBASE__
+        SequenceCacheInvalidate(relid);
+#endif
 
         /* Now okay to update the on-disk tuple */
 #ifdef PGXC
@@ -783,6 +875,9 @@ AlterSequence(ParseState *pstate, AlterSeqStmt *stmt)
         /* Clear local cache so that we don't think we have cached numbers */
         /* Note that we do not change the currval() state */
         elm->cached = elm->last;
+#ifdef __TBASE__
+        SequenceCacheInvalidate(relid);
+#endif
 
         /* Now okay to update the on-disk tuple */
 
@@ -899,6 +994,10 @@ nextval_internal(Oid relid, bool check_permissions)
     int64        incby;
     int64        cache;
     int64        result = 0;
+#ifdef __TBASE__
+    bool        shared_cache = false;
+    TimestampTz    fetch_start = 0;
+#endif
 
     /* open and lock sequence */
     init_sequence(relid, &elm, &seqrel);
@@ -942,6 +1041,25 @@ nextval_internal(Oid relid, bool check_permissions)
     cache = pgsform->seqcache;
     ReleaseSysCache(pgstuple);
 
+#ifdef __TBASE__
+    /* Take the value from the range shared by the backends of the node */
+    if (SequenceCacheEntries > 0 &&
+        seqrel->rd_rel->relpersistence != RELPERSISTENCE_TEMP)
+    {
+        if (SequenceCacheNextval(seqrel, incby, Max(cache, SequenceRangeVal),
+                                 &result, &shared_cache))
+        {
+            elm->last = result;
+            elm->cached = result;
+            elm->last_valid = true;
+            elm->increment = incby;
+            last_used_seq = elm;
+            relation_close(seqrel, NoLock);
+            return result;
+        }
+    }
+#endif
+
     /* lock page' buffer and read tuple */
     seq = read_seq_tuple(seqrel, &buf, &seqdatatuple);
 
@@ -957,6 +1075,15 @@ nextval_internal(Oid relid, bool check_permissions)
          * If the user has set a CACHE parameter, we use that. Else we pass in
          * the SequenceRangeVal value
          */
+#ifdef __TBASE__
+        if (shared_cache)
+        {
+            /* The range is shared, the refiller keeps it filled */
+            range = Max(cache, SequenceRangeVal);
+            fetch_start = GetCurrentTimestamp();
+        }
+        else
+#endif
         if (range == DEFAULT_CACHEVAL && SequenceRangeVal > range)
         {
             TimestampTz curtime = GetCurrentTimestamp();
@@ -1016,6 +1143,15 @@ nextval_internal(Oid relid, bool check_permissions)
         result = (int64) GetNextValGTM(seqname, range, &rangemax);
         elog(DEBUG1, "[nextval_internal] connect gtm. seqname:%s procid:%d get nextval:%lld, range:%lld, rangemax:%lld",  
                     seqname, MyProcPid, (long long int)result, (long long int)range, (long long int)rangemax);
+#ifdef __TBASE__
+        /* Share the rest of the range, don't keep it in the local cache */
+        if (shared_cache)
+        {
+            SequenceCacheInstall(seqrel, seqname, result, rangemax,
+                                 GetCurrentTimestamp() - fetch_start);
+            rangemax = result;
+        }
+#endif
         pfree(seqname);
 
         /* Update the on-disk data */
@@ -1232,6 +1368,9 @@ do_setval(Oid relid, int64 next, bool iscalled)
     }
     /* In any case, forget any future cached numbers */
     elm->cached = elm->last;
+#ifdef __TBASE__
+    SequenceCacheInvalidate(relid);
+#endif
 
     /* check the comment above nextval_internal()'s equivalent call. */
     if (RelationNeedsWAL(seqrel))
@@ -2347,3 +2486,575 @@ void RenameDatabaseSequence(const char* oldname, const char* newname)
     }
 }
 #endif
+
+#ifdef __TBASE__
+/*
+ * Number of values from first to last, or just first if the sequence cycled
+ * in between.
+ */
+static int64
+SequenceCacheCount(int64 first, int64 last, int64 increment)
+{
+    if (increment > 0 ? last < first : last > first)
+        return 1;
+
+    return (last - first) / increment + 1;
+}
+
+/*
+ * Ask the refiller for the next range if the values left are below the low
+ * watermark. Called with the entry mutex held, returns true if the refiller
+ * is to be woken up.
+ */
+static bool
+SequenceCacheNeedRefill(SeqCacheEntry *entry)
+{
+    int64        cached = entry->left + entry->prefetch_left;
+
+    if (entry->refilling || entry->refill_failed ||
+        entry->prefetch_left > 0 || entry->seqname[0] == '\0')
+        return false;
+
+    if (cached * 100 >= entry->range * SequenceCacheLowWatermark)
+        return false;
+
+    entry->refilling = true;
+    return true;
+}
+
+static void
+SequenceCacheWakeRefiller(void)
+{
+    Latch       *latch = SeqCache->refiller_latch;
+
+    if (latch)
+        SetLatch(latch);
+}
+
+/*
+ * Find the cache entry of a sequence, creating it if asked to and if there
+ * is room left. On success, return with SequenceCacheLock held in shared
+ * mode.
+ */
+static SeqCacheEntry *
+SequenceCacheLookup(Relation seqrel, bool create)
+{
+    SeqCacheKey    key;
+    SeqCacheEntry *entry;
+    bool        found;
+
+    key.dbid = MyDatabaseId;
+    key.relid = RelationGetRelid(seqrel);
+
+    LWLockAcquire(SequenceCacheLock, LW_SHARED);
+    entry = (SeqCacheEntry *) hash_search(SeqCacheHash, &key, HASH_FIND, NULL);
+    if (entry || !create)
+    {
+        if (entry == NULL)
+            LWLockRelease(SequenceCacheLock);
+        return entry;
+    }
+    LWLockRelease(SequenceCacheLock);
+
+    LWLockAcquire(SequenceCacheLock, LW_EXCLUSIVE);
+    entry = (SeqCacheEntry *) hash_search(SeqCacheHash, &key, HASH_FIND, NULL);
+    if (entry == NULL && hash_get_num_entries(SeqCacheHash) < SequenceCacheEntries)
+    {
+        entry = (SeqCacheEntry *) hash_search(SeqCacheHash, &key, HASH_ENTER_NULL, &found);
+        if (entry && !found)
+        {
+            memset((char *) entry + sizeof(SeqCacheKey), 0,
+                   sizeof(SeqCacheEntry) - sizeof(SeqCacheKey));
+            SpinLockInit(&entry->mutex);
+            entry->filenode = seqrel->rd_rel->relfilenode;
+            entry->last_used = GetCurrentStatementStartTimestamp();
+        }
+    }
+    LWLockRelease(SequenceCacheLock);
+
+    /* Another backend may drop it meanwhile, look again */
+    if (entry == NULL)
+        return NULL;
+    return SequenceCacheLookup(seqrel, false);
+}
+
+/*
+ * Take the next value of a sequence from the shared cache. Return false if
+ * none is cached, the caller fetches a range from GTM then. *cached tells
+ * whether the sequence has a cache entry, i.e. whether that range is to be
+ * given to SequenceCacheInstall.
+ */
+static bool
+SequenceCacheNextval(Relation seqrel, int64 incby, int64 range,
+                     int64 *result, bool *cached)
+{
+    SeqCacheEntry *entry;
+    bool        found = false;
+    bool        wake;
+
+    *cached = false;
+    if ((entry = SequenceCacheLookup(seqrel, true)) == NULL)
+        return false;
+
+    SpinLockAcquire(&entry->mutex);
+
+    /* The sequence was altered or restarted, forget its values */
+    if (entry->filenode != seqrel->rd_rel->relfilenode ||
+        entry->increment != incby)
+    {
+        entry->generation++;
+        entry->filenode = seqrel->rd_rel->relfilenode;
+        entry->increment = incby;
+        entry->left = 0;
+        entry->prefetch_left = 0;
+        entry->refilling = false;
+    }
+
+    entry->range = range;
+    entry->last_used = GetCurrentStatementStartTimestamp();
+
+    if (entry->left == 0 && entry->prefetch_left > 0)
+    {
+        entry->next = entry->prefetch_first;
+        entry->left = entry->prefetch_left;
+        entry->prefetch_left = 0;
+    }
+
+    if (entry->left > 0)
+    {
+        *result = entry->next;
+        if (--entry->left > 0)
+            entry->next += incby;
+        entry->hits++;
+        found = true;
+    }
+    else
+        entry->misses++;
+
+    wake = SequenceCacheNeedRefill(entry);
+    SpinLockRelease(&entry->mutex);
+    LWLockRelease(SequenceCacheLock);
+
+    if (wake)
+        SequenceCacheWakeRefiller();
+
+    *cached = true;
+    return found;
+}
+
+/*
+ * Share the values after first of a range fetched from GTM on a cache miss.
+ * elapsed is the time the fetch took, in microseconds.
+ */
+static void
+SequenceCacheInstall(Relation seqrel, const char *seqname,
+                     int64 first, int64 rangemax, int64 elapsed)
+{
+    SeqCacheEntry *entry;
+    int64        count;
+    bool        wake;
+
+    if ((entry = SequenceCacheLookup(seqrel, false)) == NULL)
+        return;
+
+    SpinLockAcquire(&entry->mutex);
+    entry->miss_time += elapsed;
+    if (entry->filenode == seqrel->rd_rel->relfilenode)
+    {
+        strlcpy(entry->seqname, seqname, SEQCACHE_NAME_LEN);
+        entry->refill_failed = false;
+
+        count = SequenceCacheCount(first, rangemax, entry->increment) - 1;
+        if (count > 0 && entry->left == 0)
+        {
+            entry->next = first + entry->increment;
+            entry->left = count;
+        }
+        else if (count > 0 && entry->prefetch_left == 0)
+        {
+            entry->prefetch_first = first + entry->increment;
+            entry->prefetch_left = count;
+        }
+    }
+    wake = SequenceCacheNeedRefill(entry);
+    SpinLockRelease(&entry->mutex);
+    LWLockRelease(SequenceCacheLock);
+
+    if (wake)
+        SequenceCacheWakeRefiller();
+}
+
+/*
+ * Forget the cached values of a sequence, after it was altered or set.
+ */
+static void
+SequenceCacheInvalidate(Oid relid)
+{
+    SeqCacheKey    key;
+
+    if (SequenceCacheEntries <= 0)
+        return;
+
+    key.dbid = MyDatabaseId;
+    key.relid = relid;
+
+    LWLockAcquire(SequenceCacheLock, LW_EXCLUSIVE);
+    hash_search(SeqCacheHash, &key, HASH_REMOVE, NULL);
+    LWLockRelease(SequenceCacheLock);
+}
+
+Size
+SequenceCacheShmemSize(void)
+{
+    Size        size = MAXALIGN(sizeof(SeqCacheShared));
+
+    if (SequenceCacheEntries > 0)
+        size = add_size(size, hash_estimate_size(SequenceCacheEntries,
+                                                 sizeof(SeqCacheEntry)));
+    return size;
+}
+
+void
+SequenceCacheShmemInit(void)
+{
+    HASHCTL        info;
+    bool        found;
+
+    SeqCache = (SeqCacheShared *)
+        ShmemInitStruct("Sequence Cache", sizeof(SeqCacheShared), &found);
+    if (!found)
+        SeqCache->refiller_latch = NULL;
+
+    if (SequenceCacheEntries <= 0)
+        return;
+
+    MemSet(&info, 0, sizeof(info));
+    info.keysize = sizeof(SeqCacheKey);
+    info.entrysize = sizeof(SeqCacheEntry);
+    SeqCacheHash = ShmemInitHash("Sequence Cache Hash",
+                                 SequenceCacheEntries, SequenceCacheEntries,
+                                 &info, HASH_ELEM | HASH_BLOBS);
+}
+
+static void
+SequenceCacheRefillerSighup(SIGNAL_ARGS)
+{
+    int            save_errno = errno;
+
+    seqcache_got_sighup = true;
+    SetLatch(MyLatch);
+
+    errno = save_errno;
+}
+
+static void
+SequenceCacheRefillerExit(int code, Datum arg)
+{
+    SeqCache->refiller_latch = NULL;
+}
+
+/*
+ * Fetch the next range of a sequence waiting for it. Return false if none
+ * was waiting.
+ */
+static bool
+SequenceCacheRefillOne(void)
+{
+    HASH_SEQ_STATUS status;
+    SeqCacheEntry *entry;
+    SeqCacheKey    key;
+    char        seqname[SEQCACHE_NAME_LEN];
+    uint32        generation = 0;
+    int64        range = 0;
+    int64        first = 0;
+    GTM_Sequence rangemax = 0;
+    TimestampTz    start;
+    int64        elapsed;
+    bool        found = false;
+    bool        ok = false;
+
+    LWLockAcquire(SequenceCacheLock, LW_SHARED);
+    hash_seq_init(&status, SeqCacheHash);
+    while ((entry = (SeqCacheEntry *) hash_seq_search(&status)) != NULL)
+    {
+        SpinLockAcquire(&entry->mutex);
+        if (entry->refilling && entry->prefetch_left == 0)
+        {
+            key = entry->key;
+            generation = entry->generation;
+            range = entry->range;
+            strlcpy(seqname, entry->seqname, SEQCACHE_NAME_LEN);
+            found = true;
+        }
+        SpinLockRelease(&entry->mutex);
+
+        if (found)
+        {
+            hash_seq_term(&status);
+            break;
+        }
+    }
+    LWLockRelease(SequenceCacheLock);
+
+    if (!found)
+        return false;
+
+    /* An error, e.g. for a sequence renamed on another node, is logged */
+    start = GetCurrentTimestamp();
+    PG_TRY();
+    {
+        StartTransactionCommand();
+        first = (int64) GetNextValGTM(seqname, range, &rangemax);
+        CommitTransactionCommand();
+        ok = true;
+    }
+    PG_CATCH();
+    {
+        HOLD_INTERRUPTS();
+        EmitErrorReport();
+        AbortOutOfAnyTransaction();
+        FlushErrorState();
+        RESUME_INTERRUPTS();
+    }
+    PG_END_TRY();
+    elapsed = GetCurrentTimestamp() - start;
+
+    LWLockAcquire(SequenceCacheLock, LW_SHARED);
+    entry = (SeqCacheEntry *) hash_search(SeqCacheHash, &key, HASH_FIND, NULL);
+    if (entry)
+    {
+        SpinLockAcquire(&entry->mutex);
+        if (entry->generation == generation && entry->refilling)
+        {
+            if (ok)
+            {
+                entry->prefetch_first = first;
+                entry->prefetch_left = SequenceCacheCount(first, rangemax, entry->increment);
+                entry->refills++;
+                entry->refill_time += elapsed;
+                if (elapsed > entry->max_refill_time)
+                    entry->max_refill_time = elapsed;
+            }
+            else
+            {
+                entry->refill_failed = true;
+                entry->refill_failures++;
+            }
+            entry->refilling = false;
+        }
+        SpinLockRelease(&entry->mutex);
+    }
+    LWLockRelease(SequenceCacheLock);
+
+    return true;
+}
+
+/*
+ * Drop the entries not used for SEQCACHE_IDLE_TIMEOUT, e.g. of sequences
+ * dropped meanwhile.
+ */
+static void
+SequenceCacheDropIdle(void)
+{
+    HASH_SEQ_STATUS status;
+    SeqCacheEntry *entry;
+    TimestampTz    now = GetCurrentTimestamp();
+    bool        idle;
+
+    LWLockAcquire(SequenceCacheLock, LW_EXCLUSIVE);
+    hash_seq_init(&status, SeqCacheHash);
+    while ((entry = (SeqCacheEntry *) hash_seq_search(&status)) != NULL)
+    {
+        SpinLockAcquire(&entry->mutex);
+        idle = !entry->refilling &&
+            TimestampDifferenceExceeds(entry->last_used, now,
+                                       SEQCACHE_IDLE_TIMEOUT * 1000);
+        SpinLockRelease(&entry->mutex);
+
+        if (idle)
+            hash_search(SeqCacheHash, &entry->key, HASH_REMOVE, NULL);
+    }
+    LWLockRelease(SequenceCacheLock);
+}
+
+/*
+ * Main loop of the sequence cache refiller: fetch the next ranges asked for
+ * by the backends through SequenceCacheNeedRefill.
+ */
+void
+SequenceCacheRefillerMain(Datum main_arg)
+{
+    HASH_SEQ_STATUS status;
+    SeqCacheEntry *entry;
+    TimestampTz    last_cleanup = GetCurrentTimestamp();
+    int            rc;
+
+    pqsignal(SIGHUP, SequenceCacheRefillerSighup);
+    pqsignal(SIGTERM, die);
+    BackgroundWorkerUnblockSignals();
+
+    /* A connection is needed to look up GTM in pgxc_node */
+    BackgroundWorkerInitializeConnection("postgres", NULL);
+
+    /* Requests of a previous refiller are lost */
+    LWLockAcquire(SequenceCacheLock, LW_SHARED);
+    hash_seq_init(&status, SeqCacheHash);
+    while ((entry = (SeqCacheEntry *) hash_seq_search(&status)) != NULL)
+    {
+        SpinLockAcquire(&entry->mutex);
+        entry->refilling = false;
+        SpinLockRelease(&entry->mutex);
+    }
+    LWLockRelease(SequenceCacheLock);
+
+    on_shmem_exit(SequenceCacheRefillerExit, (Datum) 0);
+    SeqCache->refiller_latch = MyLatch;
+
+    for (;;)
+    {
+        ResetLatch(MyLatch);
+        CHECK_FOR_INTERRUPTS();
+
+        if (seqcache_got_sighup)
+        {
+            seqcache_got_sighup = false;
+            ProcessConfigFile(PGC_SIGHUP);
+        }
+
+        while (SequenceCacheRefillOne())
+            CHECK_FOR_INTERRUPTS();
+
+        if (TimestampDifferenceExceeds(last_cleanup, GetCurrentTimestamp(),
+                                       SEQCACHE_NAPTIME_MS * 60))
+        {
+            SequenceCacheDropIdle();
+            last_cleanup = GetCurrentTimestamp();
+        }
+
+        rc = WaitLatch(MyLatch,
+                       WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+                       SEQCACHE_NAPTIME_MS,
+                       WAIT_EVENT_SEQUENCE_CACHE_MAIN);
+        if (rc & WL_POSTMASTER_DEATH)
+            proc_exit(1);
+    }
+}
+
+/*
+ * Register the sequence cache refiller, if the cache is enabled.
+ */
+void
+SequenceCacheRefillerRegister(void)
+{
+    BackgroundWorker bgw;
+
+    if (SequenceCacheEntries <= 0)
+        return;
+
+    memset(&bgw, 0, sizeof(bgw));
+    bgw.bgw_flags = BGWORKER_SHMEM_ACCESS |
+        BGWORKER_BACKEND_DATABASE_CONNECTION;
+    bgw.bgw_start_time = BgWorkerStart_RecoveryFinished;
+    snprintf(bgw.bgw_library_name, BGW_MAXLEN, "postgres");
+    snprintf(bgw.bgw_function_name, BGW_MAXLEN, "SequenceCacheRefillerMain");
+    snprintf(bgw.bgw_name, BGW_MAXLEN, "sequence cache refiller");
+    bgw.bgw_restart_time = 5;
+    bgw.bgw_notify_pid = 0;
+    bgw.bgw_main_arg = (Datum) 0;
+
+    RegisterBackgroundWorker(&bgw);
+}
+
+/*
+ * pg_stat_get_sequence_cache
+ *        Return the sequences cached on this node and how their values were
+ *        served, used by the pg_stat_sequence_cache view. Times are reported
+ *        in milliseconds.
+ */
+Datum
+pg_stat_get_sequence_cache(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_SEQUENCE_CACHE_COLS 12
+    ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+    TupleDesc    tupdesc;
+    Tuplestorestate *tupstore;
+    MemoryContext per_query_ctx;
+    MemoryContext oldcontext;
+    HASH_SEQ_STATUS status;
+    SeqCacheEntry *entry;
+    SeqCacheEntry copy;
+
+    /* check to see if caller supports us returning a tuplestore */
+    if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("set-valued function called in context that cannot accept a set")));
+    if (!(rsinfo->allowedModes & SFRM_Materialize))
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("materialize mode required, but it is not " \
+                        "allowed in this context")));
+
+    /* Build a tuple descriptor for our result type */
+    if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+        elog(ERROR, "return type must be a row type");
+
+    per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+    oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+    tupstore = tuplestore_begin_heap(true, false, work_mem);
+    rsinfo->returnMode = SFRM_Materialize;
+    rsinfo->setResult = tupstore;
+    rsinfo->setDesc = tupdesc;
+
+    MemoryContextSwitchTo(oldcontext);
+
+    if (SequenceCacheEntries <= 0)
+        return (Datum) 0;
+
+    LWLockAcquire(SequenceCacheLock, LW_SHARED);
+    hash_seq_init(&status, SeqCacheHash);
+    while ((entry = (SeqCacheEntry *) hash_seq_search(&status)) != NULL)
+    {
+        Datum        values[PG_STAT_GET_SEQUENCE_CACHE_COLS];
+        bool        nulls[PG_STAT_GET_SEQUENCE_CACHE_COLS];
+
+        SpinLockAcquire(&entry->mutex);
+        memcpy(&copy, entry, sizeof(SeqCacheEntry));
+        SpinLockRelease(&entry->mutex);
+
+        MemSet(nulls, 0, sizeof(nulls));
+        values[0] = ObjectIdGetDatum(copy.key.dbid);
+        values[1] = ObjectIdGetDatum(copy.key.relid);
+        if (copy.seqname[0] != '\0')
+            values[2] = CStringGetTextDatum(copy.seqname);
+        else
+            nulls[2] = true;
+        values[3] = Int64GetDatum(copy.range);
+        values[4] = Int64GetDatum(copy.left + copy.prefetch_left);
+        values[5] = Int64GetDatum(copy.hits);
+        values[6] = Int64GetDatum(copy.misses);
+        values[7] = Int64GetDatum(copy.refills);
+        values[8] = Int64GetDatum(copy.refill_failures);
+        if (copy.refills > 0)
+        {
+            values[9] = Float8GetDatum(copy.refill_time / 1000.0 / copy.refills);
+            values[10] = Float8GetDatum(copy.max_refill_time / 1000.0);
+        }
+        else
+        {
+            nulls[9] = true;
+            nulls[10] = true;
+        }
+        if (copy.misses > 0)
+            values[11] = Float8GetDatum(copy.miss_time / 1000.0 / copy.misses);
+        else
+            nulls[11] = true;
+
+        tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+    }
+    LWLockRelease(SequenceCacheLock);
+
+    return (Datum) 0;
+}
+#endif
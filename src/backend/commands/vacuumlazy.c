@@ -62,6 +62,7 @@
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
+#include "storage/procarray.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
@@ -2635,6 +2636,207 @@ truncate_extent_tuples(Relation onerel,
     vac_strategy = NULL;
 }
 
+/*
+ * Remove the index entries of the tuples in a set of extents, so that the
+ * extents can be released as a whole.  Unlike truncate_extent_tuples, the
+ * indexes are scanned once for as many extents as the dead tuple space holds,
+ * not once per extent.
+ *
+ * An extent holding a tuple inserted or deleted by a transaction still in
+ * progress is left as is.  So is an extent holding a tuple that is not dead
+ * yet, unless no snapshot older than limit_xmin is left: the shard has been
+ * hidden or barred before limit_xmin, younger snapshots do not read it.
+ * released[i] tells whether eids[i] was cleaned, the number of extents
+ * cleaned is returned.
+ */
+int
+truncate_shard_extents(Relation onerel,
+                            ExtentID *eids,
+                            int neids,
+                            TransactionId limit_xmin,
+                            bool *released,
+                            int *deleted_tuples)
+{// #lizard forgives
+    LVRelStats     *vacrelstats;
+    int nindexes;
+    Relation     *Irel = NULL;
+    IndexBulkDeleteResult **indstats;
+    BufferAccessStrategy trun_strategy;
+    TransactionId OldestXmin;
+    bool        snapshots_gone;
+    BlockNumber nblocks;
+    int nreleased = 0;
+    int i;
+
+    *deleted_tuples = 0;
+
+    vacrelstats = (LVRelStats *) palloc0(sizeof(LVRelStats));
+    vacrelstats->old_rel_pages = onerel->rd_rel->relpages;
+    vacrelstats->old_live_tuples = onerel->rd_rel->reltuples;
+    vacrelstats->latestRemovedXid = InvalidTransactionId;
+
+    vac_open_indexes(onerel, RowExclusiveLock, &nindexes, &Irel);
+    vacrelstats->hasindex = (nindexes > 0);
+    nblocks = RelationGetNumberOfBlocks(onerel);
+    vacrelstats->rel_pages = nblocks;
+
+    lazy_space_alloc(vacrelstats, (BlockNumber) neids * PAGES_PER_EXTENTS);
+
+    indstats = (IndexBulkDeleteResult **)
+        palloc0(nindexes * sizeof(IndexBulkDeleteResult *));
+
+    trun_strategy = GetAccessStrategy(BAS_VACUUM);
+    vac_strategy = trun_strategy;
+
+    OldestXmin = GetOldestXmin(onerel, PROCARRAY_FLAGS_VACUUM);
+    snapshots_gone = TransactionIdIsValid(limit_xmin) &&
+                     TransactionIdFollowsOrEquals(OldestXmin, limit_xmin);
+
+    for(i = 0; i < neids; i++)
+    {
+        BlockNumber from_blk = eids[i] * PAGES_PER_EXTENTS;
+        BlockNumber to_blk = Min(from_blk + PAGES_PER_EXTENTS, nblocks);
+        BlockNumber blkno;
+        int         extent_start;
+        int         extent_tuples;
+        bool        busy = false;
+
+        released[i] = false;
+
+retry:
+        extent_start = vacrelstats->num_dead_tuples;
+        extent_tuples = 0;
+
+        for(blkno = from_blk; blkno < to_blk && !busy; blkno++)
+        {
+            Buffer      buf;
+            Page        page;
+            OffsetNumber offnum,
+                        maxoff;
+
+            vacuum_delay_point();
+
+            if(vacrelstats->hasindex &&
+               vacrelstats->max_dead_tuples - vacrelstats->num_dead_tuples < MaxHeapTuplesPerPage)
+            {
+                int j;
+
+                /*
+                 * Out of space.  Clean the indexes for the extents already
+                 * checked and check this one again, unless it does not fit on
+                 * its own: then its entries are removed as they come, and the
+                 * extent is kept if it turns out to be busy.
+                 */
+                if(extent_start > 0)
+                    vacrelstats->num_dead_tuples = extent_start;
+
+                for (j = 0; j < nindexes; j++)
+                    lazy_vacuum_index(Irel[j], &indstats[j], vacrelstats);
+                vacrelstats->num_dead_tuples = 0;
+
+                if(extent_start > 0)
+                    goto retry;
+            }
+
+            buf = ReadBufferExtended(onerel, MAIN_FORKNUM, blkno,
+                                     RBM_NORMAL, trun_strategy);
+            LockBuffer(buf, BUFFER_LOCK_SHARE);
+            page = BufferGetPage(buf);
+
+            if(PageIsNew(page) || PageIsEmpty(page))
+            {
+                UnlockReleaseBuffer(buf);
+                continue;
+            }
+
+            maxoff = PageGetMaxOffsetNumber(page);
+            for (offnum = FirstOffsetNumber;
+                 offnum <= maxoff;
+                 offnum = OffsetNumberNext(offnum))
+            {
+                ItemId        itemid = PageGetItemId(page, offnum);
+                HeapTupleData tuple;
+
+                if (!ItemIdIsUsed(itemid))
+                    continue;
+
+                ItemPointerSet(&(tuple.t_self), blkno, offnum);
+
+                /* redirect and dead line pointers are still indexed */
+                if (ItemIdIsNormal(itemid))
+                {
+                    tuple.t_data = (HeapTupleHeader) PageGetItem(page, itemid);
+                    tuple.t_len = ItemIdGetLength(itemid);
+                    tuple.t_tableOid = RelationGetRelid(onerel);
+
+                    switch (HeapTupleSatisfiesVacuum(&tuple, OldestXmin, buf))
+                    {
+                        case HEAPTUPLE_DEAD:
+                            break;
+                        case HEAPTUPLE_LIVE:
+                        case HEAPTUPLE_RECENTLY_DEAD:
+                            /* still visible to an older snapshot */
+                            if (!snapshots_gone)
+                                busy = true;
+                            break;
+                        default:
+                            busy = true;
+                            break;
+                    }
+
+                    if (busy)
+                        break;
+
+                    extent_tuples++;
+                    if (HeapTupleHeaderIsHeapOnly(tuple.t_data))
+                        continue;
+                }
+
+                if (vacrelstats->hasindex)
+                    lazy_record_dead_tuple(vacrelstats, &(tuple.t_self));
+            }
+
+            UnlockReleaseBuffer(buf);
+        }
+
+        if(busy)
+        {
+            vacrelstats->num_dead_tuples = extent_start;
+            continue;
+        }
+
+        released[i] = true;
+        nreleased++;
+        *deleted_tuples += extent_tuples;
+    }
+
+    if(vacrelstats->num_dead_tuples > 0)
+    {
+        for (i = 0; i < nindexes; i++)
+            lazy_vacuum_index(Irel[i], &indstats[i], vacrelstats);
+    }
+
+    /* the pages of the released extents are empty now */
+    for(i = 0; i < neids; i++)
+    {
+        BlockNumber from_blk = eids[i] * PAGES_PER_EXTENTS;
+        BlockNumber to_blk = Min(from_blk + PAGES_PER_EXTENTS, nblocks);
+
+        if(!released[i] || from_blk >= to_blk)
+            continue;
+
+        UpdateFreeSpaceMap(onerel, from_blk, to_blk - 1, BLCKSZ - 1);
+        visibilitymap_batch_clear(onerel, from_blk, to_blk - 1);
+    }
+
+    vac_close_indexes(nindexes, Irel, NoLock);
+
+    FreeAccessStrategy(trun_strategy);
+    vac_strategy = NULL;
+
+    return nreleased;
+}
+
 void
 reinit_extent_pages(Relation rel, ExtentID eid)
 {
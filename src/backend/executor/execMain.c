@@ -1170,6 +1170,14 @@ InitPlan(QueryDesc *queryDesc, int eflags)
      * before running ExecInitNode on the main query tree, since
      * ExecInitSubPlan expects to be able to find these entries.
      */
+#ifdef __TBASE__
+    /*
+     * Get connections for all the RemoteSubplan nodes of the plan in one
+     * pooler request before they are initialized.
+     */
+    if (!(eflags & EXEC_FLAG_EXPLAIN_ONLY))
+        pgxc_node_acquire_plan_handles(plannedstmt);
+#endif
     Assert(estate->es_subplanstates == NIL);
     i = 1;                        /* subplan indices count from 1 */
     foreach(l, plannedstmt->subplans)
@@ -2723,6 +2723,13 @@ ExecModifyTable(PlanState *pstate)
     }
 
 END:
+#ifdef __TBASE__
+    /* Rows of remote DML may still be waiting to be sent. */
+    if (IS_PGXC_COORDINATOR && node->mt_remoterels)
+    {
+        ExecFlushRemoteDML(node);
+    }
+#endif
 
     if(enable_distri_debug)
     {
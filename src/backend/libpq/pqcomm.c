@@ -117,6 +117,7 @@
  *        pq_flush        - flush pending output
  *        pq_flush_if_writable - flush pending output if writable without blocking
  *        pq_getbyte_if_available - get a byte if available without blocking
+ *        pq_buffer_has_data - is any buffered data available to read?
  *
  * message-level I/O (and old-style-COPY-OUT cruft):
  *        pq_putmessage    - send a normal message (suppressed in COPY OUT mode)
@@ -1112,6 +1113,18 @@ pq_peekbyte(void)
     return (unsigned char) PqRecvBuffer[PqRecvPointer];
 }
 
+/* --------------------------------
+ *        pq_buffer_has_data - is any buffered data available to read?
+ *
+ * This will *not* attempt to read more data.
+ * --------------------------------
+ */
+bool
+pq_buffer_has_data(void)
+{
+    return (PqRecvPointer < PqRecvLength);
+}
+
 /* --------------------------------
  *        pq_getbyte_if_available - get a single byte from connection,
  *            if available
@@ -105,6 +105,10 @@
 #ifdef __COLD_HOT__
 #include "pgxc/shardmap.h"
 #endif
+#ifdef _SHARDING_
+#include "pgxc/locator.h"
+#include "pgxc/nodemgr.h"
+#endif
 
 
 #define LOG2(x)  (log(x) / 0.693147180559945)
@@ -240,6 +244,47 @@ clamp_row_est(double nrows)
     return nrows;
 }
 
+#ifdef _SHARDING_
+/*
+ * Get the fractions of the pages and tuples of a shard relation held by the
+ * busiest datanode the path scans, as computed from pg_shard_statistic by
+ * get_relation_info. The scan lasts as long as on that datanode, which is not
+ * 1/nodes of the relation when the shards are skewed or only some nodes are
+ * scanned. Returns false if the fractions are not known.
+ */
+static bool
+shard_scan_fractions(RelOptInfo *baserel, Path *path,
+                     double *page_fraction, double *tuple_fraction)
+{
+    Distribution   *distribution = path->distribution;
+    Bitmapset      *nodes;
+    int             nodeidx;
+
+    if (baserel->shard_page_fractions == NULL || distribution == NULL ||
+        !IsA(distribution, Distribution) ||
+        distribution->distributionType != LOCATOR_TYPE_SHARD)
+        return false;
+
+    nodes = bms_is_empty(distribution->restrictNodes) ?
+                distribution->nodes : distribution->restrictNodes;
+    if (bms_is_empty(nodes))
+        return false;
+
+    *page_fraction = 0;
+    *tuple_fraction = 0;
+    nodeidx = -1;
+    while ((nodeidx = bms_next_member(nodes, nodeidx)) >= 0)
+    {
+        if (nodeidx >= NumDataNodes)
+            break;
+        *page_fraction = Max(*page_fraction, baserel->shard_page_fractions[nodeidx]);
+        *tuple_fraction = Max(*tuple_fraction, baserel->shard_tuple_fractions[nodeidx]);
+    }
+
+    return true;
+}
+#endif
+
 /*
  * cost_seqscan
  *      Determines and returns the cost of scanning a relation sequentially.
@@ -258,6 +303,12 @@ cost_seqscan(Path *path, PlannerInfo *root,
     QualCost    qpqual_cost;
     Cost        cpu_per_tuple;
 	double		num_nodes = path_count_datanodes(path);
+	double		dn_pages = PAGES_PER_DN(baserel->pages);
+	double		dn_tuples = TUPLES_PER_DN(baserel->tuples);
+#ifdef _SHARDING_
+	double		page_fraction;
+	double		tuple_fraction;
+#endif
 
     /* Should only be applied to base relations */
     Assert(baserel->relid > 0);
@@ -269,6 +320,15 @@ cost_seqscan(Path *path, PlannerInfo *root,
     else
 		path->rows = ROWS_PER_DN(baserel->rows);
 
+#ifdef _SHARDING_
+	/* scan as much as the busiest datanode when per-shard stats are known */
+	if (shard_scan_fractions(baserel, path, &page_fraction, &tuple_fraction))
+	{
+		dn_pages = ceil(baserel->pages * page_fraction);
+		dn_tuples = clamp_row_est(baserel->tuples * tuple_fraction);
+	}
+#endif
+
     if (!enable_seqscan)
         startup_cost += disable_cost;
 
@@ -280,14 +340,14 @@ cost_seqscan(Path *path, PlannerInfo *root,
     /*
      * disk costs
      */
-	disk_run_cost = spc_seq_page_cost * PAGES_PER_DN(baserel->pages);
+	disk_run_cost = spc_seq_page_cost * dn_pages;
 
     /* CPU costs */
     get_restriction_qual_cost(root, baserel, param_info, &qpqual_cost);
 
     startup_cost += qpqual_cost.startup;
     cpu_per_tuple = cpu_tuple_cost + qpqual_cost.per_tuple;
-	cpu_run_cost = cpu_per_tuple * TUPLES_PER_DN(baserel->tuples);
+	cpu_run_cost = cpu_per_tuple * dn_tuples;
     /* tlist eval costs are paid per output row, not per tuple scanned */
     startup_cost += path->pathtarget->cost.startup;
     cpu_run_cost += path->pathtarget->cost.per_tuple * path->rows;
@@ -55,6 +55,12 @@
 #ifdef __TBASE__
 #include "utils/ruleutils.h"
 #endif
+#ifdef _SHARDING_
+#include "catalog/pg_shard_statistic.h"
+#include "pgxc/locator.h"
+#include "pgxc/nodemgr.h"
+#include "pgxc/shardmap.h"
+#endif
 
 /* GUC parameter */
 int            constraint_exclusion = CONSTRAINT_EXCLUSION_PARTITION;
@@ -79,6 +85,9 @@ static List *get_relation_constraints(PlannerInfo *root,
 static List *build_index_tlist(PlannerInfo *root, IndexOptInfo *index,
                   Relation heapRelation);
 static List *get_relation_statistics(RelOptInfo *rel, Relation relation);
+#ifdef _SHARDING_
+static void get_relation_shard_fractions(RelOptInfo *rel, Relation relation);
+#endif
 static void set_relation_partition_info(PlannerInfo *root, RelOptInfo *rel,
                            Relation relation);
 static PartitionScheme find_partition_scheme(PlannerInfo *root, Relation rel);
@@ -459,6 +468,10 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
     rel->indexlist = indexinfos;
 
     rel->statlist = get_relation_statistics(rel, relation);
+#ifdef _SHARDING_
+    if (!inhparent)
+        get_relation_shard_fractions(rel, relation);
+#endif
 
     /* Grab foreign-table info using the relcache, while we have it */
     if (relation->rd_rel->relkind == RELKIND_FOREIGN_TABLE)
@@ -1503,6 +1516,81 @@ get_relation_statistics(RelOptInfo *rel, Relation relation)
 	return stainfos;
 }
 
+#ifdef _SHARDING_
+/*
+ * get_relation_shard_fractions
+ *        Compute the share of a shard relation held by each datanode.
+ *
+ * The pg_shard_statistic entry of the relation is mapped to the datanodes
+ * once here, so that costing a scan of the relation only has to look at the
+ * nodes it scans.
+ */
+static void
+get_relation_shard_fractions(RelOptInfo *rel, Relation relation)
+{
+    RelationLocInfo *locinfo = relation->rd_locator_info;
+    int32       *shards;
+    float4       *pages;
+    float4       *tuples;
+    double        total_pages = 0;
+    double        total_tuples = 0;
+    int            nshards;
+    int            i;
+
+    rel->shard_page_fractions = NULL;
+    rel->shard_tuple_fractions = NULL;
+
+    if (!IS_PGXC_COORDINATOR || locinfo == NULL ||
+        locinfo->locatorType != LOCATOR_TYPE_SHARD ||
+        !OidIsValid(locinfo->groupId) || NumDataNodes <= 0)
+        return;
+#ifdef __COLD_HOT__
+    /* shards of cold data live in another group */
+    if (OidIsValid(locinfo->coldGroupId))
+        return;
+#endif
+
+    nshards = FetchShardStatistic(RelationGetRelid(relation), &shards, &pages, &tuples);
+    if (nshards <= 0)
+        return;
+
+    rel->shard_page_fractions = (double *) palloc0(NumDataNodes * sizeof(double));
+    rel->shard_tuple_fractions = (double *) palloc0(NumDataNodes * sizeof(double));
+    for (i = 0; i < nshards; i++)
+    {
+        int nodeidx = GetNodeIndexByHashValue(locinfo->groupId, shards[i]);
+
+        total_pages += pages[i];
+        total_tuples += tuples[i];
+        if (nodeidx >= 0 && nodeidx < NumDataNodes)
+        {
+            rel->shard_page_fractions[nodeidx] += pages[i];
+            rel->shard_tuple_fractions[nodeidx] += tuples[i];
+        }
+    }
+
+    pfree(shards);
+    pfree(pages);
+    pfree(tuples);
+
+    if (total_pages <= 0)
+    {
+        pfree(rel->shard_page_fractions);
+        pfree(rel->shard_tuple_fractions);
+        rel->shard_page_fractions = NULL;
+        rel->shard_tuple_fractions = NULL;
+        return;
+    }
+
+    for (i = 0; i < NumDataNodes; i++)
+    {
+        rel->shard_page_fractions[i] /= total_pages;
+        rel->shard_tuple_fractions[i] = total_tuples > 0 ?
+            rel->shard_tuple_fractions[i] / total_tuples : 0;
+    }
+}
+#endif
+
 /*
  * relation_excluded_by_constraints
  *
@@ -93,6 +93,8 @@ List *executed_node_list = NULL;
 #ifdef __TBASE__
 /* GUC parameter */
 int DataRowBufferSize = 0;  /* MBytes */
+int RemoteDMLBatchRows = 0;  /* rows sent to a datanode in one go, 0 disables */
+int RemoteDMLBatchSize = 1024;  /* KBytes */
 
 #define DATA_ROW_BUFFER_SIZE(n) (DataRowBufferSize * 1024 * 1024 * (n))
 #endif
@@ -137,7 +139,15 @@ static bool pgxc_start_command_on_connection(PGXCNodeHandle *connection,
 
 static void pgxc_node_remote_count(int *dnCount, int dnNodeIds[],
         int *coordCount, int coordNodeIds[]);
+#ifdef __TBASE__
+static int pgxc_node_remote_writers(void);
+#endif
 static char *pgxc_node_remote_prepare(char *prepareGID, bool localNode, bool implicit);
+#ifdef __TWO_PHASE_TRANS__
+static bool pgxc_node_remote_prepare_preamble(PGXCNodeHandle **conns, int conn_count,
+                                bool is_coord, GlobalTransactionId startnodeXid,
+                                char *partnodes);
+#endif
 static bool pgxc_node_remote_finish(char *prepareGID, bool commit,
                         char *nodestring, GlobalTransactionId gxid,
                         GlobalTransactionId prepare_gxid);
@@ -312,7 +322,10 @@ InitResponseCombiner(ResponseCombiner *combiner, int node_count,
     combiner->nDataRows      = NULL;
     combiner->tmpslot        = NULL;
     combiner->recv_datarows  = 0;
+    combiner->spill_datarows = 0;
+    combiner->spill_bytes    = 0;
     combiner->prerowBuffers  = NULL;
+    combiner->rowBatches     = NIL;
     combiner->is_abort = false;
 	combiner->recv_instr_htbl = NULL;
 #endif
@@ -1147,6 +1160,178 @@ ValidateAndCloseCombiner(ResponseCombiner *combiner)
     return valid;
 }
 
+#ifdef __TBASE__
+/*
+ * Append a datarow to the ring, the slots are doubled when all of them are in
+ * use. The ring is bounded by the size of the rows, see BufferDataRow.
+ */
+static void
+RowRingPush(RemoteRowRing *ring, RemoteDataRow dataRow)
+{
+    if (ring->count == ring->size)
+    {
+        int            i       = 0;
+        int            newsize = ring->size ? ring->size * 2 : 64;
+        RemoteDataRow *rows    = (RemoteDataRow *) palloc(sizeof(RemoteDataRow) * newsize);
+
+        for (i = 0; i < ring->count; i++)
+        {
+            rows[i] = ring->rows[(ring->head + i) % ring->size];
+        }
+
+        if (ring->rows)
+        {
+            pfree(ring->rows);
+        }
+        ring->rows = rows;
+        ring->size = newsize;
+        ring->head = 0;
+    }
+
+    ring->rows[(ring->head + ring->count) % ring->size] = dataRow;
+    ring->count++;
+    ring->bytes += dataRow->msglen;
+}
+
+/*
+ * Remove the oldest datarow from the ring, NULL if the ring is empty.
+ */
+static RemoteDataRow
+RowRingPop(RemoteRowRing *ring)
+{
+    RemoteDataRow dataRow;
+
+    if (ring->count == 0)
+    {
+        return NULL;
+    }
+
+    dataRow = ring->rows[ring->head];
+    ring->head = (ring->head + 1) % ring->size;
+    ring->count--;
+    ring->bytes -= dataRow->msglen;
+    return dataRow;
+}
+
+static void
+RowRingFree(RemoteRowRing *ring)
+{
+    RemoteDataRow dataRow;
+
+    while ((dataRow = RowRingPop(ring)) != NULL)
+    {
+        pfree(dataRow);
+    }
+
+    if (ring->rows)
+    {
+        pfree(ring->rows);
+        ring->rows = NULL;
+    }
+    ring->size = 0;
+    ring->head = 0;
+}
+
+/*
+ * Move combiner->currentRow to the tuplestore of the tape, memory buffer of
+ * the tape is full as the consumer does not keep up with the producer.
+ */
+static void
+SpillDataRow(ResponseCombiner *combiner, int tape, int maxKBytes)
+{
+    int ntapes = combiner->merge_sort ? combiner->conn_count : 1;
+
+    if (!combiner->dataRowBuffer)
+    {
+        combiner->dataRowBuffer = (Tuplestorestate **) palloc0(sizeof(Tuplestorestate *) * ntapes);
+    }
+
+    /* data row count in tuplestore */
+    if (!combiner->nDataRows)
+    {
+        combiner->nDataRows = (int *) palloc0(sizeof(int) * ntapes);
+    }
+
+    if (!combiner->tmpslot)
+    {
+        TupleDesc desc = CreateTemplateTupleDesc(1, false);
+        combiner->tmpslot = MakeSingleTupleTableSlot(desc);
+    }
+
+    if (!combiner->dataRowBuffer[tape])
+    {
+        combiner->dataRowBuffer[tape] = tuplestore_begin_datarow(false, maxKBytes, NULL);
+
+        if (enable_statistic)
+        {
+            elog(LOG, "tape %d exceed max rowBufferSize %d, need to store datarow in tuplestore.",
+                  tape, DATA_ROW_BUFFER_SIZE(1));
+        }
+    }
+
+    combiner->tmpslot->tts_datarow = combiner->currentRow;
+    tuplestore_puttupleslot(combiner->dataRowBuffer[tape], combiner->tmpslot);
+    combiner->nDataRows[tape]++;
+
+    combiner->spill_datarows++;
+    combiner->spill_bytes += combiner->currentRow->msglen;
+
+    pfree(combiner->currentRow);
+    combiner->currentRow = NULL;
+}
+
+/*
+ * Buffer combiner->currentRow received from the connection with node_index.
+ * With merge sort every connection has its own ring to keep the order of the
+ * tape, otherwise rows of all the connections share the rowBuffer. Up to
+ * DataRowBufferSize of rows not consumed yet are kept in memory, the rest go
+ * to tuplestore after the ones already there.
+ */
+static void
+BufferDataRow(ResponseCombiner *combiner, int node_index, int maxKBytes)
+{
+    RemoteDataRow dataRow = combiner->currentRow;
+
+    if (combiner->merge_sort)
+    {
+        RemoteRowRing *ring = NULL;
+
+        if (!combiner->prerowBuffers)
+        {
+            combiner->prerowBuffers = (RemoteRowRing *) palloc0(sizeof(RemoteRowRing) * combiner->conn_count);
+        }
+        ring = &combiner->prerowBuffers[node_index];
+
+        if ((combiner->dataRowBuffer && combiner->dataRowBuffer[node_index]) ||
+            ring->bytes >= DATA_ROW_BUFFER_SIZE(1))
+        {
+            SpillDataRow(combiner, node_index, maxKBytes);
+            return;
+        }
+
+        RowRingPush(ring, dataRow);
+    }
+    else
+    {
+        if (!combiner->dataRowMemSize)
+        {
+            combiner->dataRowMemSize = (long *) palloc0(sizeof(long));
+        }
+
+        if ((combiner->dataRowBuffer && combiner->dataRowBuffer[0]) ||
+            combiner->dataRowMemSize[0] >= DATA_ROW_BUFFER_SIZE(1))
+        {
+            SpillDataRow(combiner, 0, maxKBytes);
+            return;
+        }
+
+        combiner->rowBuffer = lappend(combiner->rowBuffer, dataRow);
+        combiner->dataRowMemSize[0] += dataRow->msglen;
+    }
+    combiner->currentRow = NULL;
+}
+#endif
+
 /*
  * It is possible if multiple steps share the same Datanode connection, when
  * executor is running multi-step query or client is running multiple queries
@@ -1223,137 +1408,12 @@ BufferConnection(PGXCNodeHandle *conn, bool need_prefetch)
         if (combiner->currentRow)
         {
 #ifdef __TBASE__
-            if (combiner->merge_sort)
-            {
-                int node_index = combiner->current_conn;
-                
-                if (combiner->dataRowBuffer && combiner->dataRowBuffer[node_index])
-                {
-                    combiner->tmpslot->tts_datarow = combiner->currentRow;
-
-                    tuplestore_puttupleslot(combiner->dataRowBuffer[node_index], combiner->tmpslot);
-                    
-                    combiner->nDataRows[node_index]++;
-
-                    pfree(combiner->currentRow);
-                }
-                else
-                {
-                    if (!combiner->prerowBuffers)
-                    {
-                        combiner->prerowBuffers = (List **)palloc0(combiner->conn_count * sizeof(List*));
-                    }
-
-                    if (!combiner->dataRowMemSize)
-                    {
-                        combiner->dataRowMemSize = (long *)palloc0(sizeof(long) * combiner->conn_count);
-                    }
-                            
-                    combiner->prerowBuffers[node_index] = lappend(combiner->prerowBuffers[node_index],
-                                                                    combiner->currentRow);
-
-                    combiner->dataRowMemSize[node_index] += combiner->currentRow->msglen;
-
-                    if (combiner->dataRowMemSize[node_index] >= DATA_ROW_BUFFER_SIZE(1))
-                    {
-                        /* init datarow buffer */
-                        if (!combiner->dataRowBuffer)
-                        {
-                            combiner->dataRowBuffer = (Tuplestorestate **)palloc0(sizeof(Tuplestorestate *) * combiner->conn_count);
-                        }
-
-                        if (!combiner->dataRowBuffer[node_index])
-                        {
-                            combiner->dataRowBuffer[node_index] = tuplestore_begin_datarow(false, work_mem, NULL);
-
-                            if (enable_statistic)
-                            {
-                                elog(LOG, "BufferConnection:connection %d dataRowMemSize %ld exceed max rowBufferSize %d, need to store"
-                                      " datarow in tuplestore.", node_index, combiner->dataRowMemSize[node_index],
-                                      DATA_ROW_BUFFER_SIZE(1));
-                            }
-                        }
-                        
-                        /* data row count in tuplestore */
-                        if (!combiner->nDataRows)
-                        {
-                            combiner->nDataRows = (int *)palloc0(sizeof(int) * combiner->conn_count);
-                        }
-
-                        if (!combiner->tmpslot)
-                        {
-                            TupleDesc desc = CreateTemplateTupleDesc(1, false);
-                            combiner->tmpslot = MakeSingleTupleTableSlot(desc);
-                        }
-                    }
-                }
-            }
-            else
-            {
-#endif        
-                if (combiner->dataRowBuffer && combiner->dataRowBuffer[0])
-                {
-                    /* put into tuplestore */
-                    combiner->tmpslot->tts_datarow = combiner->currentRow;
-
-                    tuplestore_puttupleslot(combiner->dataRowBuffer[0], combiner->tmpslot);
-                    
-                    combiner->nDataRows[0]++;
-
-                    pfree(combiner->currentRow);
-                }
-                else
-                {
-                    /* init datarow size */
-                    if (!combiner->dataRowMemSize)
-                    {
-                        combiner->dataRowMemSize = (long *)palloc(sizeof(long));
-                        combiner->dataRowMemSize[0] = 0;
-                    }
-                    
-                    combiner->rowBuffer = lappend(combiner->rowBuffer,
-                                                  combiner->currentRow);
-
-                    combiner->dataRowMemSize[0] += combiner->currentRow->msglen;
-
-                    if (combiner->dataRowMemSize[0] >= DATA_ROW_BUFFER_SIZE(1))
-                    {
-                                            /* init datarow buffer */
-                        if (!combiner->dataRowBuffer)
-                        {
-                            combiner->dataRowBuffer = (Tuplestorestate **)palloc0(sizeof(Tuplestorestate *));
-                        }
-
-                        if (!combiner->dataRowBuffer[0])
-                        {
-                            combiner->dataRowBuffer[0] = tuplestore_begin_datarow(false, work_mem, NULL);
-
-                            if (enable_statistic)
-                            {
-                                elog(LOG, "BufferConnection:dataRowMemSize %ld exceed max rowBufferSize %d, need to store"
-                                      " datarow in tuplestore.", combiner->dataRowMemSize[0],
-                                      DATA_ROW_BUFFER_SIZE(1));
-                            }
-                        }
-
-                        /* data row count in tuplestore */
-                        if (!combiner->nDataRows)
-                        {
-                            combiner->nDataRows = (int *)palloc(sizeof(int));
-                            combiner->nDataRows[0] = 0;
-                        }
-
-                        if (!combiner->tmpslot)
-                        {
-                            TupleDesc desc = CreateTemplateTupleDesc(1, false);
-                            combiner->tmpslot = MakeSingleTupleTableSlot(desc);
-                        }
-                    }
-                }
-#ifdef __TBASE__
-            }
-#endif
+            BufferDataRow(combiner, combiner->current_conn, work_mem);
+#else
+            combiner->rowBuffer = lappend(combiner->rowBuffer,
+                                          combiner->currentRow);
             combiner->currentRow = NULL;
+#endif
         }
 
         res = handle_response(conn, combiner);
@@ -1623,12 +1683,6 @@ bool PreFetchConnection(PGXCNodeHandle *conn, int32 node_index)
         }
     }
 
-    if (combiner->merge_sort)
-    {
-        if (!combiner->prerowBuffers)
-            combiner->prerowBuffers = (List **)palloc0(combiner->conn_count * sizeof(List*));
-    }
-
     /*
      * Buffer data rows until data node return number of rows specified by the
      * fetch_size parameter of last Execute message (PortalSuspended message)
@@ -1641,131 +1695,7 @@ bool PreFetchConnection(PGXCNodeHandle *conn, int32 node_index)
         /* Move to buffer currentRow (received from the data node) */
         if (combiner->currentRow)
         {
-            int msglen = combiner->currentRow->msglen;
-
-            if (combiner->merge_sort)
-            {
-                if (!combiner->dataRowMemSize)
-                {
-                    combiner->dataRowMemSize = (long *)palloc0(sizeof(long) * combiner->conn_count);
-                }
-
-                if (combiner->dataRowMemSize[node_index] >= DATA_ROW_BUFFER_SIZE(1))
-                {
-                    /* init datarow buffer */
-                    if (!combiner->dataRowBuffer)
-                    {
-                        combiner->dataRowBuffer = (Tuplestorestate **)palloc0(sizeof(Tuplestorestate *) * combiner->conn_count);
-                    }
-
-                    if (!combiner->dataRowBuffer[node_index])
-                    {
-                        combiner->dataRowBuffer[node_index] = tuplestore_begin_datarow(false, work_mem / NumDataNodes, NULL);
-
-                        if (enable_statistic)
-                        {
-                            elog(LOG, "PreFetchConnection:connection %d dataRowMemSize %ld exceed max rowBufferSize %d, need to store"
-                                  " datarow in tuplestore.", node_index, combiner->dataRowMemSize[node_index],
-                                  DATA_ROW_BUFFER_SIZE(1));
-                        }
-                    }
-                    
-                    /* data row count in tuplestore */
-                    if (!combiner->nDataRows)
-                    {
-                        combiner->nDataRows = (int *)palloc0(sizeof(int) * combiner->conn_count);
-                    }
-
-                    if (!combiner->tmpslot)
-                    {
-                        TupleDesc desc = CreateTemplateTupleDesc(1, false);
-                        combiner->tmpslot = MakeSingleTupleTableSlot(desc);
-                    }
-
-                    combiner->tmpslot->tts_datarow = combiner->currentRow;
-
-                    tuplestore_puttupleslot(combiner->dataRowBuffer[node_index], combiner->tmpslot);
-                    
-                    combiner->nDataRows[node_index]++;
-
-                    pfree(combiner->currentRow);
-
-                    combiner->currentRow = NULL;
-                }
-                else
-                {
-                    combiner->prerowBuffers[node_index] = lappend(combiner->prerowBuffers[node_index],
-                                                                    combiner->currentRow);
-
-                    combiner->dataRowMemSize[node_index] += msglen;
-
-                    combiner->currentRow = NULL;
-                }
-            }
-            else
-            {
-                /* init datarow size */
-                if (!combiner->dataRowMemSize)
-                {
-                    combiner->dataRowMemSize = (long *)palloc(sizeof(long));
-                    combiner->dataRowMemSize[0] = 0;
-                }
-
-                /* exceed buffer size, store into tuplestore */
-                if (combiner->dataRowMemSize[0] >= DATA_ROW_BUFFER_SIZE(1))
-                {                
-                    /* init datarow buffer */
-                    if (!combiner->dataRowBuffer)
-                    {
-                        combiner->dataRowBuffer = (Tuplestorestate **)palloc0(sizeof(Tuplestorestate *));
-                    }
-
-                    if (!combiner->dataRowBuffer[0])
-                    {
-                        combiner->dataRowBuffer[0] = tuplestore_begin_datarow(false, work_mem / NumDataNodes, NULL);
-
-                        if (enable_statistic)
-                        {
-                            elog(LOG, "PreFetchConnection:dataRowMemSize %ld exceed max rowBufferSize %d, need to store"
-                                  " datarow in tuplestore.", combiner->dataRowMemSize[0],
-                                  DATA_ROW_BUFFER_SIZE(1));
-                        }
-                    }
-
-                    /* data row count in tuplestore */
-                    if (!combiner->nDataRows)
-                    {
-                        combiner->nDataRows = (int *)palloc(sizeof(int));
-                        combiner->nDataRows[0] = 0;
-                    }
-
-                    if (!combiner->tmpslot)
-                    {
-                        TupleDesc desc = CreateTemplateTupleDesc(1, false);
-                        combiner->tmpslot = MakeSingleTupleTableSlot(desc);
-                    }
-
-                    /* put into tuplestore */
-                    combiner->tmpslot->tts_datarow = combiner->currentRow;
-
-                    tuplestore_puttupleslot(combiner->dataRowBuffer[0], combiner->tmpslot);
-                    
-                    combiner->nDataRows[0]++;
-
-                    pfree(combiner->currentRow);
-
-                    combiner->currentRow = NULL;
-                }
-                else
-                {
-                    combiner->dataRowMemSize[0] += msglen;
-                    
-                    combiner->rowBuffer = lappend(combiner->rowBuffer,
-                                          combiner->currentRow);
-                    
-                    combiner->currentRow = NULL;
-                }
-            }
+            BufferDataRow(combiner, node_index, work_mem / NumDataNodes);
         }
 
         res = handle_response(conn, combiner);
@@ -1968,11 +1898,269 @@ bool PreFetchConnection(PGXCNodeHandle *conn, int32 node_index)
  * copy the datarow from combiner to the given slot, in the slot's memory
  * context
  */
+#ifdef __TBASE__
+/*
+ * Columnar batch of rows received in a DataRow message, see DataPumpBatch in
+ * squeue.c for the format. Rows are handed out one by one in FetchTuple.
+ */
+typedef struct RemoteDataRowBatch
+{
+    RemoteDataRow   datarow;    /* message holding the batch */
+    int             natts;
+    int             nrows;
+    int             next;       /* next row to return */
+    int16          *attlen;
+    char          **bitmap;     /* null bitmap of each column */
+    char          **values;     /* next value of each column */
+} RemoteDataRowBatch;
+
+static bool
+IsDataRowBatch(RemoteDataRow datarow)
+{
+    uint16 n16;
+
+    if (datarow->msglen < 8)
+    {
+        return false;
+    }
+    memcpy(&n16, datarow->msg, 2);
+    return (int16) ntohs(n16) == DATAROW_BATCH_MARKER;
+}
+
+/*
+ * Take over the batch message and check it matches the tuple descriptor.
+ */
+static RemoteDataRowBatch *
+BuildDataRowBatch(RemoteDataRow datarow, TupleDesc tdesc)
+{
+    int                 i;
+    int                 bitmaplen;
+    uint16              n16;
+    uint32              n32;
+    char               *cur = datarow->msg + 2;
+    char               *end = datarow->msg + datarow->msglen;
+    RemoteDataRowBatch *batch;
+
+    batch = (RemoteDataRowBatch *) palloc0(sizeof(RemoteDataRowBatch));
+    batch->datarow = datarow;
+
+    memcpy(&n16, cur, 2);
+    batch->natts = ntohs(n16);
+    cur += 2;
+    memcpy(&n32, cur, 4);
+    batch->nrows = ntohl(n32);
+    cur += 4;
+
+    if (batch->natts != tdesc->natts || batch->nrows <= 0 ||
+        cur + 2 * batch->natts > end)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_DATA_CORRUPTED),
+                 errmsg("invalid columnar batch from node %u, %d columns, %d rows",
+                        datarow->msgnode, batch->natts, batch->nrows)));
+    }
+
+    batch->attlen = (int16 *) palloc(sizeof(int16) * batch->natts);
+    batch->bitmap = (char **) palloc(sizeof(char *) * batch->natts);
+    batch->values = (char **) palloc(sizeof(char *) * batch->natts);
+    for (i = 0; i < batch->natts; i++)
+    {
+        Form_pg_attribute attr = tdesc->attrs[i];
+
+        memcpy(&n16, cur, 2);
+        batch->attlen[i] = (int16) ntohs(n16);
+        cur += 2;
+
+        if (batch->attlen[i] != attr->attlen || !attr->attbyval)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_DATA_CORRUPTED),
+                     errmsg("columnar batch from node %u does not match column %d",
+                            datarow->msgnode, i + 1)));
+        }
+    }
+
+    /* Locate the columns, non-null values follow the bitmap of each column. */
+    bitmaplen = (batch->nrows + 7) / 8;
+    for (i = 0; i < batch->natts; i++)
+    {
+        int row;
+        int notnull = 0;
+
+        if (cur + bitmaplen > end)
+        {
+            break;
+        }
+        batch->bitmap[i] = cur;
+        for (row = 0; row < batch->nrows; row++)
+        {
+            if (!(cur[row >> 3] & (1 << (row & 7))))
+            {
+                notnull++;
+            }
+        }
+        cur += bitmaplen;
+        batch->values[i] = cur;
+        cur += notnull * batch->attlen[i];
+    }
+
+    if (i < batch->natts || cur != end)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_DATA_CORRUPTED),
+                 errmsg("columnar batch from node %u is truncated", datarow->msgnode)));
+    }
+
+    return batch;
+}
+
+/*
+ * Store next row of the batch into the slot, return false if the batch has
+ * been used up.
+ */
+static bool
+NextDataRowBatchRow(RemoteDataRowBatch *batch, TupleTableSlot *slot)
+{
+    int     i;
+    int     row = batch->next;
+
+    if (row >= batch->nrows)
+    {
+        return false;
+    }
+
+    ExecClearTuple(slot);
+    for (i = 0; i < batch->natts; i++)
+    {
+        int16   attlen = batch->attlen[i];
+        char   *value  = batch->values[i];
+
+        if (batch->bitmap[i][row >> 3] & (1 << (row & 7)))
+        {
+            slot->tts_values[i] = (Datum) 0;
+            slot->tts_isnull[i] = true;
+            continue;
+        }
+
+        switch (attlen)
+        {
+            case sizeof(char):
+                slot->tts_values[i] = CharGetDatum(*value);
+                break;
+            case sizeof(int16):
+                {
+                    int16 v;
+                    memcpy(&v, value, sizeof(int16));
+                    slot->tts_values[i] = Int16GetDatum(v);
+                }
+                break;
+            case sizeof(int32):
+                {
+                    int32 v;
+                    memcpy(&v, value, sizeof(int32));
+                    slot->tts_values[i] = Int32GetDatum(v);
+                }
+                break;
+            default:
+                {
+                    Datum v = (Datum) 0;
+                    memcpy(&v, value, attlen);
+                    slot->tts_values[i] = v;
+                }
+                break;
+        }
+        slot->tts_isnull[i] = false;
+        batch->values[i] += attlen;
+    }
+    ExecStoreVirtualTuple(slot);
+    batch->next++;
+
+    return true;
+}
+
+static void
+FreeDataRowBatch(RemoteDataRowBatch *batch)
+{
+    pfree(batch->datarow);
+    pfree(batch->attlen);
+    pfree(batch->bitmap);
+    pfree(batch->values);
+    pfree(batch);
+}
+
+/*
+ * Return next row of the batches received earlier. With merge sort only rows
+ * from the given node can be returned.
+ */
+static bool
+FetchBatchedRow(ResponseCombiner *combiner, TupleTableSlot *slot, Oid nodeOid)
+{
+    ListCell *lc;
+
+    foreach (lc, combiner->rowBatches)
+    {
+        RemoteDataRowBatch *batch = (RemoteDataRowBatch *) lfirst(lc);
+
+        if (combiner->merge_sort && batch->datarow->msgnode != nodeOid)
+        {
+            continue;
+        }
+
+        if (NextDataRowBatchRow(batch, slot))
+        {
+            if (batch->next >= batch->nrows)
+            {
+                combiner->rowBatches = list_delete_ptr(combiner->rowBatches, batch);
+                FreeDataRowBatch(batch);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+static void
+FreeDataRowBatches(ResponseCombiner *combiner)
+{
+    ListCell *lc;
+
+    foreach (lc, combiner->rowBatches)
+    {
+        FreeDataRowBatch((RemoteDataRowBatch *) lfirst(lc));
+    }
+    list_free(combiner->rowBatches);
+    combiner->rowBatches = NIL;
+}
+#endif
+
 static void
 CopyDataRowTupleToSlot(ResponseCombiner *combiner, TupleTableSlot *slot)
 {
     RemoteDataRow     datarow;
     MemoryContext    oldcontext;
+
+#ifdef __TBASE__
+    if (IsDataRowBatch(combiner->currentRow))
+    {
+        RemoteDataRowBatch *batch;
+
+        /* Rows of the batch are returned in later calls, keep it with the combiner. */
+        oldcontext = MemoryContextSwitchTo(GetMemoryChunkContext(combiner));
+        datarow = (RemoteDataRow) palloc(sizeof(RemoteDataRowData) + combiner->currentRow->msglen);
+        datarow->msgnode = combiner->currentRow->msgnode;
+        datarow->msglen = combiner->currentRow->msglen;
+        memcpy(datarow->msg, combiner->currentRow->msg, datarow->msglen);
+        pfree(combiner->currentRow);
+        combiner->currentRow = NULL;
+
+        batch = BuildDataRowBatch(datarow, slot->tts_tupleDescriptor);
+        combiner->rowBatches = lappend(combiner->rowBatches, batch);
+        MemoryContextSwitchTo(oldcontext);
+
+        (void) FetchBatchedRow(combiner, slot, batch->datarow->msgnode);
+        return;
+    }
+#endif
     oldcontext = MemoryContextSwitchTo(slot->tts_mcxt);
     datarow = (RemoteDataRow) palloc(sizeof(RemoteDataRowData) + combiner->currentRow->msglen);
     datarow->msgnode = combiner->currentRow->msgnode;
@@ -1985,6 +2173,81 @@ CopyDataRowTupleToSlot(ResponseCombiner *combiner, TupleTableSlot *slot)
 }
 
 
+#ifdef __TBASE__
+/*
+ * Combiner without merge sort got incomplete message from the current
+ * connection. Instead of waiting for it while other connections are buffered,
+ * make current the next connection in round-robin order which has a complete
+ * message or a suspended portal. If there is none, wait for data from all the
+ * connections in progress.
+ */
+static PGXCNodeHandle *
+FetchReadyConnection(ResponseCombiner *combiner)
+{
+    int             i        = 0;
+    int             index    = 0;
+    int             nwaiting = 0;
+    PGXCNodeHandle *conn     = NULL;
+    int             nready   = 0;
+    PGXCNodeHandle *waiting[combiner->conn_count];
+    PGXCNodeHandle *ready[combiner->conn_count];
+
+    for (;;)
+    {
+        /* Prefer a connection that just got data, no need to look at all. */
+        for (i = 0; i < nready; i++)
+        {
+            if (HAS_MESSAGE_BUFFERED(ready[i]))
+            {
+                for (index = 0; combiner->connections[index] != ready[i]; index++)
+                    ;
+                if (index != combiner->current_conn)
+                {
+                    combiner->current_conn = index;
+                    combiner->current_conn_rows_consumed = 0;
+                }
+                return ready[i];
+            }
+        }
+
+        nwaiting = 0;
+        for (i = 1; i <= combiner->conn_count; i++)
+        {
+            index = (combiner->current_conn + i) % combiner->conn_count;
+            conn  = combiner->connections[index];
+
+            if (conn->state == DN_CONNECTION_STATE_ERROR_FATAL && !HAS_MESSAGE_BUFFERED(conn))
+            {
+                ereport(ERROR,
+                        (errcode(ERRCODE_INTERNAL_ERROR),
+                         errmsg("Unexpected FATAL ERROR on Connection to Datanode %s pid %d",
+                                conn->nodename, conn->backend_pid)));
+            }
+
+            /* Suspended portal is resumed by the caller. */
+            if (HAS_MESSAGE_BUFFERED(conn) ||
+                (combiner->extended_query && conn->state == DN_CONNECTION_STATE_IDLE))
+            {
+                if (index != combiner->current_conn)
+                {
+                    combiner->current_conn = index;
+                    combiner->current_conn_rows_consumed = 0;
+                }
+                return conn;
+            }
+            waiting[nwaiting++] = conn;
+        }
+
+        if (DNStatus_ERR == pgxc_node_receive_ready(nwaiting, waiting, NULL, ready, &nready))
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INTERNAL_ERROR),
+                     errmsg("Failed to receive more data from data nodes")));
+        }
+    }
+}
+#endif
+
 /*
  * FetchTuple
  *
@@ -2092,8 +2355,19 @@ FetchTuple(ResponseCombiner *combiner)
                          combiner->tapenodes[combiner->current_conn];
         Assert(OidIsValid(nodeOid));
     }
-
-READ_ROWBUFFER:
+
+READ_ROWBUFFER:
+#ifdef __TBASE__
+    /* Rows left in the batches received earlier go first. */
+    if (combiner->rowBatches != NIL)
+    {
+        slot = combiner->ss.ps.ps_ResultTupleSlot;
+        if (FetchBatchedRow(combiner, slot, nodeOid))
+        {
+            return slot;
+        }
+    }
+#endif
     /*
      * First look into the row buffer.
      * When we are performing merge sort we need to get from the buffer record
@@ -2173,6 +2447,13 @@ READ_ROWBUFFER:
             dataRow = (RemoteDataRow) linitial(combiner->rowBuffer);
             combiner->currentRow = dataRow;
             combiner->rowBuffer = list_delete_first(combiner->rowBuffer);
+#ifdef __TBASE__
+            /* room for more rows in memory */
+            if (combiner->dataRowMemSize)
+            {
+                combiner->dataRowMemSize[0] -= dataRow->msglen;
+            }
+#endif
         }
     }
 
@@ -2180,18 +2461,9 @@ READ_ROWBUFFER:
     /* fetch datarow from prerowbuffers */
     if (!combiner->currentRow)
     {
-        if (combiner->merge_sort)
+        if (combiner->merge_sort && combiner->prerowBuffers)
         {
-            RemoteDataRow dataRow;
-            int node_index = combiner->current_conn;
-
-            if (combiner->prerowBuffers &&
-                list_length(combiner->prerowBuffers[node_index]) > 0)
-            {
-                dataRow = (RemoteDataRow) linitial(combiner->prerowBuffers[node_index]);
-                combiner->currentRow = dataRow;
-                combiner->prerowBuffers[node_index] = list_delete_first(combiner->prerowBuffers[node_index]);
-            }
+            combiner->currentRow = RowRingPop(&combiner->prerowBuffers[combiner->current_conn]);
         }
     }
 
@@ -2233,7 +2505,6 @@ READ_ROWBUFFER:
                     //tuplestore_set_tupdeleted(combiner->dataRowBuffer[node_index]);
                     tuplestore_end(combiner->dataRowBuffer[node_index]);
                     combiner->dataRowBuffer[node_index] = NULL;
-                    combiner->dataRowMemSize[node_index] = 0;
                 }
             }
         }
@@ -2424,6 +2695,13 @@ READ_ROWBUFFER:
             timeout.tv_sec            = 0;
             timeout.tv_usec           = 1000;    
 
+            /* Rows may come in any order, go on with the connection which has them. */
+            if (!combiner->merge_sort && !combiner->probing_primary)
+            {
+                conn = FetchReadyConnection(combiner);
+                continue;
+            }
+
             save_conn = conn;
             while (1)
             {
@@ -2573,7 +2851,7 @@ READ_ROWBUFFER:
                     combiner->connections[combiner->current_conn] = NULL;
 
                     /* data left in row_buffer, read it */
-                    if ((combiner->prerowBuffers && list_length(combiner->prerowBuffers[combiner->current_conn]) > 0) || 
+                    if ((combiner->prerowBuffers && combiner->prerowBuffers[combiner->current_conn].count > 0) ||
                         (combiner->dataRowBuffer && combiner->dataRowBuffer[combiner->current_conn]))
                     {    
                             elog(DEBUG1, "FetchTuple:data left in rowbuffer while merge_sort.");
@@ -2709,7 +2987,7 @@ READ_ROWBUFFER:
                 combiner->connections[combiner->current_conn] = NULL;
 
                 /* data left in row_buffer, read it */
-                if ((combiner->prerowBuffers && list_length(combiner->prerowBuffers[combiner->current_conn]) > 0) || 
+                if ((combiner->prerowBuffers && combiner->prerowBuffers[combiner->current_conn].count > 0) ||
                     (combiner->dataRowBuffer && combiner->dataRowBuffer[combiner->current_conn]))
                 {    
                         elog(DEBUG1, "FetchTuple:data left in rowbuffer while merge_sort.");
@@ -3402,6 +3680,7 @@ handle_response(PGXCNodeHandle *conn, ResponseCombiner *combiner)
                 {
                     elog(LOG, "ConnectionFetchDatarows: remote_node %s remote_pid %d, datarows %ld", conn->nodename, conn->backend_pid, conn->recv_datarows);
                 }
+                pgxc_node_shm_channel_detach(conn);
 #endif
 
 #ifdef     _PG_REGRESS_
@@ -3454,6 +3733,12 @@ handle_response(PGXCNodeHandle *conn, ResponseCombiner *combiner)
 					HandleRemoteInstr(msg, msg_len, conn->nodeid, combiner);
 				/* just break to return EOF. */
 				break;
+			case 'h': /* Data pump channel of co-located producer */
+				pgxc_node_shm_channel_attach(conn, msg, msg_len);
+				break;
+			case 'z': /* Compressed frame from data pump */
+				pgxc_node_inflate_frame(conn, msg, msg_len);
+				break;
 #endif
             default:
                 /* sync lost? */
@@ -3869,6 +4154,42 @@ pgxc_node_remote_cleanup_all(void)
     pfree_pgxc_all_handles(handles);
 }
 
+#ifdef __TBASE__
+/*
+ * Count the remote nodes written by the current transaction. Runs for every
+ * commit, so look at the transaction handles in place.
+ */
+static int
+pgxc_node_remote_writers(void)
+{
+    int                 i;
+    int                 writers = 0;
+    PGXCNodeAllHandles *handles = current_transaction_handles;
+
+    if (handles == NULL)
+        return 0;
+
+    for (i = 0; i < handles->dn_conn_count; i++)
+    {
+        PGXCNodeHandle *conn = handles->datanode_handles[i];
+
+        if (conn->sock != NO_SOCKET && !conn->read_only &&
+            conn->transaction_status == 'T')
+            writers++;
+    }
+    for (i = 0; i < handles->co_conn_count; i++)
+    {
+        PGXCNodeHandle *conn = handles->coord_handles[i];
+
+        if (conn->sock != NO_SOCKET && !conn->read_only &&
+            conn->transaction_status == 'T')
+            writers++;
+    }
+
+    return writers;
+}
+#endif
+
 /*
  * Count how many coordinators and datanodes are involved in this transaction
  * so that we can save that information in the GID
@@ -3919,6 +4240,109 @@ pgxc_node_remote_count(int *dnCount, int dnNodeIds[],
     pfree_pgxc_all_handles(handles);
 }
 
+#ifdef __TWO_PHASE_TRANS__
+/*
+ * Send the start node, start xid and participants of the two-phase
+ * transaction to the nodes among conns which are going to prepare it, after
+ * reading their pending input. None of this needs the prepare timestamp, so
+ * pgxc_node_remote_prepare does it while GTM is working on the timestamp and
+ * the nodes can process it meanwhile. Nothing is sent if some connection is
+ * in error state, false is returned then and the caller must not go on with
+ * the prepare round.
+ */
+static bool
+pgxc_node_remote_prepare_preamble(PGXCNodeHandle **conns, int conn_count,
+                                bool is_coord, GlobalTransactionId startnodeXid,
+                                char *partnodes)
+{// #lizard forgives
+    int             i;
+    int             twophase_index;
+    ConnTransState *states;
+
+    for (i = 0; i < conn_count; i++)
+    {
+        if (conns[i]->sock != NO_SOCKET && conns[i]->transaction_status == 'E')
+        {
+            ereport(WARNING,
+                    (errcode(ERRCODE_INTERNAL_ERROR),
+                     errmsg("remote node %u is in error state", conns[i]->nodeoid)));
+            return false;
+        }
+    }
+
+    if (is_coord)
+    {
+        states = g_twophase_state.coord_state;
+        twophase_index = g_twophase_state.coord_index;
+    }
+    else
+    {
+        states = g_twophase_state.datanode_state;
+        twophase_index = g_twophase_state.datanode_index;
+    }
+
+    for (i = 0; i < conn_count; i++)
+    {
+        PGXCNodeHandle *conn = conns[i];
+
+        if (conn->sock == NO_SOCKET || conn->transaction_status != 'T')
+            continue;
+
+        /* Read in any pending input */
+        if (!is_coord && conn->state != DN_CONNECTION_STATE_IDLE)
+            BufferConnection(conn, false);
+
+        if (conn->read_only)
+            continue;
+
+        states[twophase_index].is_participant = true;
+        states[twophase_index].handle_idx = i;
+        states[twophase_index].state = g_twophase_state.state;
+
+        if (pgxc_node_send_starter(conn, PGXCNodeName))
+        {
+            /* record connection error */
+            states[twophase_index].conn_state = TWO_PHASE_SEND_STARTER_ERROR;
+            states[twophase_index].state = TWO_PHASE_PREPARE_ERROR;
+            ereport(ERROR,
+                    (errcode(ERRCODE_INTERNAL_ERROR),
+                     errmsg("failed to send startnode for PREPARED command")));
+        }
+        if (pgxc_node_send_startxid(conn, startnodeXid))
+        {
+            /* record connection error */
+            states[twophase_index].conn_state = TWO_PHASE_SEND_STARTXID_ERROR;
+            states[twophase_index].state = TWO_PHASE_PREPARE_ERROR;
+            ereport(ERROR,
+                    (errcode(ERRCODE_INTERNAL_ERROR),
+                     errmsg("failed to send startxid for PREPARED command")));
+        }
+        if (enable_distri_print)
+        {
+            elog(LOG, "twophase trans: %s, partnodes: %s", g_twophase_state.gid, partnodes);
+        }
+        if (pgxc_node_send_partnodes(conn, partnodes))
+        {
+            /* record connection error */
+            states[twophase_index].conn_state = TWO_PHASE_SEND_PARTICIPANTS_ERROR;
+            states[twophase_index].state = TWO_PHASE_PREPARE_ERROR;
+            ereport(ERROR,
+                    (errcode(ERRCODE_INTERNAL_ERROR),
+                     errmsg("failed to send partnodes for PREPARED command")));
+        }
+
+        /*
+         * A failure is noted on the handle and reported when PREPARE
+         * TRANSACTION is sent.
+         */
+        pgxc_node_flush(conn);
+
+        twophase_index++;
+    }
+    return true;
+}
+#endif
+
 /*
  * Prepare nodes which ran write operations during the transaction.
  * Read only remote transactions are committed and connections are released
@@ -3951,11 +4375,16 @@ pgxc_node_remote_prepare(char *prepareGID, bool localNode, bool implicit)
 #ifdef __SUPPORT_DISTRIBUTED_TRANSACTION__
     GlobalTimestamp global_prepare_ts = InvalidGlobalTimestamp;
 #endif
+#ifdef __TBASE__
+    TimestampTz     gts_start = 0;
+    TimestampTz     fanout_start = 0;
+#endif
 #ifdef __TWO_PHASE_TRANS__
     /* conn_state_index record index in g_twophase_state.conn_state or g_twophase_state.datanode_state */
     int             conn_state_index = 0; 
     int             twophase_index = 0;
     StringInfoData  partnodes;
+    bool            preamble_ok = true;
 #endif
     connections = (PGXCNodeHandle**)palloc(sizeof(PGXCNodeHandle*) * (TBASE_MAX_DATANODE_NUMBER + TBASE_MAX_COORDINATOR_NUMBER));
     if (connections == NULL)
@@ -3974,34 +4403,6 @@ pgxc_node_remote_prepare(char *prepareGID, bool localNode, bool implicit)
     twophase_in = IN_REMOTE_PREPARE;
 #endif
 
-#ifdef __SUPPORT_DISTRIBUTED_TRANSACTION__
-	if(implicit)
-	{
-        if(enable_distri_print)
-        {
-			elog(LOG, "prepare remote transaction xid %d gid %s", GetTopTransactionIdIfAny(), prepareGID);
-        }
-        global_prepare_ts = GetGlobalTimestampGTM();
-
-#ifdef __TWO_PHASE_TESTS__
-    if (PART_PREPARE_GET_TIMESTAMP == twophase_exception_case)
-    {
-        global_prepare_ts = 0;
-    }
-#endif
-		if(!GlobalTimestampIsValid(global_prepare_ts)){
-            ereport(ERROR,
-            (errcode(ERRCODE_INTERNAL_ERROR),
-             errmsg("failed to get global timestamp for PREPARED command")));
-        }
-        if(enable_distri_print)
-        {
-			elog(LOG, "prepare phase get global prepare timestamp gid %s, time " INT64_FORMAT, prepareGID, global_prepare_ts);
-        }
-        SetGlobalPrepareTimestamp(global_prepare_ts);
-	}
-#endif
-
 #ifdef __TWO_PHASE_TRANS__
     /* 
      *g_twophase_state is cleared under the following circumstances:
@@ -4062,6 +4463,79 @@ pgxc_node_remote_prepare(char *prepareGID, bool localNode, bool implicit)
     }
 #endif
 
+#ifdef __SUPPORT_DISTRIBUTED_TRANSACTION__
+	if(implicit)
+	{
+        if(enable_distri_print)
+        {
+			elog(LOG, "prepare remote transaction xid %d gid %s", GetTopTransactionIdIfAny(), prepareGID);
+        }
+        /*
+         * Only send the request here, the timestamp is read once the
+         * participants got everything of the PREPARE but the timestamp.
+         */
+        RequestGlobalTimestampGTM();
+	}
+#endif
+
+#ifdef __TWO_PHASE_TRANS__
+    /*
+     * While GTM is working on the prepare timestamp, read pending input of
+     * the connections and send the 2PC info ahead of PREPARE TRANSACTION.
+     */
+    if ('\0' != partnodes.data[0])
+    {
+        preamble_ok = pgxc_node_remote_prepare_preamble(handles->datanode_handles,
+                                                        handles->dn_conn_count, false,
+                                                        startnodeXid, partnodes.data) &&
+                      pgxc_node_remote_prepare_preamble(handles->coord_handles,
+                                                        handles->co_conn_count, true,
+                                                        startnodeXid, partnodes.data);
+    }
+#endif
+
+#ifdef __TBASE__
+    gts_start = GetCurrentTimestamp();
+#endif
+#ifdef __SUPPORT_DISTRIBUTED_TRANSACTION__
+	if(implicit)
+	{
+        global_prepare_ts = ReceiveGlobalTimestampGTM();
+
+#ifdef __TWO_PHASE_TESTS__
+    if (PART_PREPARE_GET_TIMESTAMP == twophase_exception_case)
+    {
+        global_prepare_ts = 0;
+    }
+#endif
+		if(!GlobalTimestampIsValid(global_prepare_ts)){
+            ereport(ERROR,
+            (errcode(ERRCODE_INTERNAL_ERROR),
+             errmsg("failed to get global timestamp for PREPARED command")));
+        }
+        if(enable_distri_print)
+        {
+			elog(LOG, "prepare phase get global prepare timestamp gid %s, time " INT64_FORMAT, prepareGID, global_prepare_ts);
+        }
+        SetGlobalPrepareTimestamp(global_prepare_ts);
+	}
+#endif
+#ifdef __TBASE__
+    fanout_start = GetCurrentTimestamp();
+#endif
+
+#ifdef __TWO_PHASE_TRANS__
+    /*
+     * A node in error state got no 2PC info, do not send PREPARE to any of
+     * them. The prepare timestamp was read above, GTM has nothing pending.
+     */
+    if (!preamble_ok)
+    {
+        isOK = false;
+        goto prepare_err;
+    }
+#endif
+
     for (i = 0; i < handles->dn_conn_count; i++)
     {
         PGXCNodeHandle *conn = handles->datanode_handles[i];
@@ -4163,46 +4637,6 @@ pgxc_node_remote_prepare(char *prepareGID, bool localNode, bool implicit)
                 }
 #endif
 
-#ifdef __TWO_PHASE_TRANS__
-                if (pgxc_node_send_starter(conn, PGXCNodeName))
-                {
-                    /* record connection error */
-                    g_twophase_state.datanode_state[twophase_index].conn_state = 
-                        TWO_PHASE_SEND_STARTER_ERROR;
-                    g_twophase_state.datanode_state[twophase_index].state = 
-                        TWO_PHASE_PREPARE_ERROR;
-                    ereport(ERROR,
-                            (errcode(ERRCODE_INTERNAL_ERROR),
-                             errmsg("failed to send startnode for PREPARED command")));
-                }
-                if (pgxc_node_send_startxid(conn, startnodeXid))
-                {
-                    /* record connection error */
-                    g_twophase_state.datanode_state[twophase_index].conn_state = 
-                        TWO_PHASE_SEND_STARTXID_ERROR;
-                    g_twophase_state.datanode_state[twophase_index].state = 
-                        TWO_PHASE_PREPARE_ERROR;
-                    ereport(ERROR,
-                            (errcode(ERRCODE_INTERNAL_ERROR),
-                             errmsg("failed to send startxid for PREPARED command")));
-                }
-                Assert(0 != partnodes.len);
-                if (enable_distri_print)
-                {
-                    elog(LOG, "twophase trans: %s, partnodes: %s", prepareGID, partnodes.data);
-                }
-                if (pgxc_node_send_partnodes(conn, partnodes.data))
-                {
-                    /* record connection error */
-                    g_twophase_state.datanode_state[twophase_index].conn_state = 
-                        TWO_PHASE_SEND_PARTICIPANTS_ERROR;
-                    g_twophase_state.datanode_state[twophase_index].state = 
-                        TWO_PHASE_PREPARE_ERROR;
-                    ereport(ERROR,
-                            (errcode(ERRCODE_INTERNAL_ERROR),
-                             errmsg("failed to send partnodes for PREPARED command")));
-                }
-#endif 
                 /* Send down prepare command */
                 if (pgxc_node_send_query(conn, prepare_cmd))
                 {
@@ -4349,62 +4783,22 @@ pgxc_node_remote_prepare(char *prepareGID, bool localNode, bool implicit)
                                                         prepareGID, global_prepare_ts);
                     }
                     if (pgxc_node_send_prepare_timestamp(conn, global_prepare_ts))
-                    {
-#ifdef __TWO_PHASE_TRANS__
-                        /* record connection error */
-                        g_twophase_state.coord_state[twophase_index].conn_state = 
-                            TWO_PHASE_SEND_TIMESTAMP_ERROR;
-                        g_twophase_state.coord_state[twophase_index].state = 
-                            TWO_PHASE_PREPARE_ERROR;
-#endif
-                        ereport(ERROR,
-                                (errcode(ERRCODE_INTERNAL_ERROR),
-								 errmsg("failed to send global prepare committs for PREPARED command")));
-					}
-                }
-#endif
-
-#ifdef __TWO_PHASE_TRANS__
-                if (pgxc_node_send_starter(conn, PGXCNodeName))
-                {
-                    /* record connection error */
-                    g_twophase_state.coord_state[twophase_index].conn_state = 
-                        TWO_PHASE_SEND_STARTER_ERROR;
-                    g_twophase_state.coord_state[twophase_index].state = 
-                        TWO_PHASE_PREPARE_ERROR;
-                    ereport(ERROR,
-                            (errcode(ERRCODE_INTERNAL_ERROR),
-                             errmsg("failed to send startnode for PREPARED command")));
-                }
-                if (pgxc_node_send_startxid(conn, startnodeXid))
-                {
-                    /* record connection error */
-                    g_twophase_state.coord_state[twophase_index].conn_state = 
-                        TWO_PHASE_SEND_STARTXID_ERROR;
-                    g_twophase_state.coord_state[twophase_index].state = 
-                        TWO_PHASE_PREPARE_ERROR;
-                    ereport(ERROR,
-                            (errcode(ERRCODE_INTERNAL_ERROR),
-                             errmsg("failed to send startxid for PREPARED command")));
-                }
-                Assert(0 != partnodes.len);
-                if (enable_distri_print)
-                {
-                    elog(LOG, "twophase trans: %s, partnodes: %s", prepareGID, partnodes.data);
-                }
-                if (pgxc_node_send_partnodes(conn, partnodes.data))
-                {
-                    /* record connection error */
-                    g_twophase_state.coord_state[twophase_index].conn_state = 
-                        TWO_PHASE_SEND_PARTICIPANTS_ERROR;
-                    g_twophase_state.coord_state[twophase_index].state = 
-                        TWO_PHASE_PREPARE_ERROR;
-                    ereport(ERROR,
-                            (errcode(ERRCODE_INTERNAL_ERROR),
-                             errmsg("failed to send partnodes for PREPARED command")));
+                    {
+#ifdef __TWO_PHASE_TRANS__
+                        /* record connection error */
+                        g_twophase_state.coord_state[twophase_index].conn_state = 
+                            TWO_PHASE_SEND_TIMESTAMP_ERROR;
+                        g_twophase_state.coord_state[twophase_index].state = 
+                            TWO_PHASE_PREPARE_ERROR;
+#endif
+                        ereport(ERROR,
+                                (errcode(ERRCODE_INTERNAL_ERROR),
+								 errmsg("failed to send global prepare committs for PREPARED command")));
+					}
                 }
 #endif
 
+
                 /* Send down prepare command */
                 if (pgxc_node_send_query(conn, prepare_cmd))
                 {
@@ -4511,6 +4905,11 @@ pgxc_node_remote_prepare(char *prepareGID, bool localNode, bool implicit)
         else
             CloseCombiner(&combiner);
 
+#ifdef __TBASE__
+        TwoPhaseStatsReportRemote(false, fanout_start - gts_start,
+                                  GetCurrentTimestamp() - fanout_start);
+#endif
+
         /* Before exit clean the flag, to avoid unnecessary checks */
         for (i = 0; i < conn_count; i++)
             connections[i]->ck_resp_rollback = false;
@@ -4838,7 +5237,12 @@ pgxc_node_remote_commit(TranscationType txn_type, bool need_release_handle)
 
     stat_transaction(conn_count);
 
-    if (!temp_object_included && !PersistentConnections && need_release_handle)
+    /*
+     * With connection affinity the handles stay with the session until it
+     * has been idle long enough, see pgxc_node_release_idle_handles.
+     */
+    if (!temp_object_included && !PersistentConnections && need_release_handle &&
+        ConnectionAffinityTime == 0)
         {
             /* Clean up remote sessions */
         pgxc_node_remote_cleanup_all();
@@ -7581,6 +7985,13 @@ PreCommit_Remote(char *prepareGID, char *nodestring, bool preparedLocalNode)
                              InvalidGlobalTimestamp);
             is_distri_report = true;
         }
+#ifdef __TBASE__
+        /* A single written node commits with one COMMIT instead of 2PC */
+        if (!nodestring && !isXactWriteLocalNode() && pgxc_node_remote_writers() == 1)
+        {
+            TwoPhaseStatsReportOnePhase();
+        }
+#endif
         pgxc_node_remote_commit(TXN_TYPE_CommitTxn, true);
     }
 
@@ -8539,7 +8950,7 @@ pgxc_node_remote_finish(char *prepareGID, bool commit,
     PGXCNodeHandle **connections = NULL;
     int                    conn_count = 0;
     ResponseCombiner    combiner;
-    PGXCNodeAllHandles *pgxc_handles;
+    PGXCNodeAllHandles *pgxc_handles = NULL;
     bool                prepared_local = false;
     char               *nodename;
     List               *nodelist = NIL;
@@ -8548,6 +8959,10 @@ pgxc_node_remote_finish(char *prepareGID, bool commit,
 #ifdef __SUPPORT_DISTRIBUTED_TRANSACTION__
     GlobalTimestamp    global_committs;
 #endif
+#ifdef __TBASE__
+    TimestampTz        gts_start = 0;
+    TimestampTz        fanout_start = 0;
+#endif
 #ifdef __TWO_PHASE_TRANS__
     /* 
      *any send error in twophase trans will set all_conn_healthy to false 
@@ -8597,24 +9012,8 @@ pgxc_node_remote_finish(char *prepareGID, bool commit,
         pg_usleep(delay_before_acquire_committs);
     }
 
-    global_committs = GetGlobalTimestampGTM();
-    if(!GlobalTimestampIsValid(global_committs)){
-        ereport(ERROR,
-        (errcode(ERRCODE_INTERNAL_ERROR),
-         errmsg("failed to get global timestamp for %s PREPARED command",
-                commit ? "COMMIT" : "ROLLBACK")));
-    }
-    if(enable_distri_print)
-    {
-        elog(LOG, "commit phase get global commit timestamp gid %s, time " INT64_FORMAT, prepareGID, global_committs);
-        //record_2pc_commit_timestamp(prepareGID, global_committs);
-    }
-    
-    if(delay_after_acquire_committs)
-    {
-        pg_usleep(delay_after_acquire_committs);
-    }
-    SetGlobalCommitTimestamp(global_committs);/* Save for local commit */
+    /* Get the handles of the nodes while GTM is working on the timestamp */
+    RequestGlobalTimestampGTM();
 #endif
 
     nodename = strtok(nodestring, ",");
@@ -8646,11 +9045,39 @@ pgxc_node_remote_finish(char *prepareGID, bool commit,
         nodename = strtok(NULL, ",");
     }
 
-    if (nodelist == NIL && coordlist == NIL)
-        return prepared_local;
+    if (nodelist != NIL || coordlist != NIL)
+        pgxc_handles = get_handles(nodelist, coordlist, false, true, true);
+
+#ifdef __TBASE__
+    gts_start = GetCurrentTimestamp();
+#endif
+#ifdef __SUPPORT_DISTRIBUTED_TRANSACTION__
+    global_committs = ReceiveGlobalTimestampGTM();
+    if(!GlobalTimestampIsValid(global_committs)){
+        ereport(ERROR,
+        (errcode(ERRCODE_INTERNAL_ERROR),
+         errmsg("failed to get global timestamp for %s PREPARED command",
+                commit ? "COMMIT" : "ROLLBACK")));
+    }
+    if(enable_distri_print)
+    {
+        elog(LOG, "commit phase get global commit timestamp gid %s, time " INT64_FORMAT, prepareGID, global_committs);
+        //record_2pc_commit_timestamp(prepareGID, global_committs);
+    }
+    
+    if(delay_after_acquire_committs)
+    {
+        pg_usleep(delay_after_acquire_committs);
+    }
+    SetGlobalCommitTimestamp(global_committs);/* Save for local commit */
+#endif
+#ifdef __TBASE__
+    fanout_start = GetCurrentTimestamp();
+#endif
 
+    if (pgxc_handles == NULL)
+        return prepared_local;
 
-	pgxc_handles = get_handles(nodelist, coordlist, false, true, true);
 #ifdef __TWO_PHASE_TRANS__
     SetLocalTwoPhaseStateHandles(pgxc_handles);
 #endif
@@ -8901,7 +9328,13 @@ pgxc_node_remote_finish(char *prepareGID, bool commit,
     }
 #endif    
 
-	if (!temp_object_included && !PersistentConnections)
+#ifdef __TBASE__
+    TwoPhaseStatsReportRemote(true, fanout_start - gts_start,
+                              GetCurrentTimestamp() - fanout_start);
+#endif
+
+	if (!temp_object_included && !PersistentConnections &&
+		ConnectionAffinityTime == 0)
     {
         /* Clean up remote sessions */
 		pgxc_node_remote_cleanup_all();
@@ -9360,6 +9793,18 @@ pgxc_connections_cleanup(ResponseCombiner *combiner)
     list_free_deep(combiner->rowBuffer);
     combiner->rowBuffer = NIL;
 #ifdef __TBASE__
+    FreeDataRowBatches(combiner);
+
+    /* spill counters are always kept, only the report is optional */
+    if (enable_statistic && combiner->spill_datarows)
+    {
+        elog(LOG, "consumer was slow, " UINT64_FORMAT " datarows of " UINT64_FORMAT
+             " bytes were stored in tuplestore.",
+             combiner->spill_datarows, combiner->spill_bytes);
+    }
+    combiner->spill_datarows = 0;
+    combiner->spill_bytes    = 0;
+
     /* clean up tuplestore */
     if (combiner->merge_sort)
     {
@@ -9386,11 +9831,7 @@ pgxc_connections_cleanup(ResponseCombiner *combiner)
 
             for (i = 0; i < combiner->conn_count; i++)
             {
-                if (combiner->prerowBuffers[i])
-                {
-                    list_free_deep(combiner->prerowBuffers[i]);
-                    combiner->prerowBuffers[i] = NULL;
-                }
+                RowRingFree(&combiner->prerowBuffers[i]);
             }
 
             pfree(combiner->prerowBuffers);
@@ -9719,6 +10160,120 @@ RemoteSubplanMakeUnique(Node *plan, int unique, int pid)
     }
 }
 
+#ifdef __TBASE__
+/*
+ * Collect the datanodes the RemoteSubplan nodes of the plan tree are going to
+ * connect to when the executor is started.
+ */
+static List *
+RemoteSubplanCollectNodes(Node *plan, CmdType commandType, List *nodes)
+{
+    if (plan == NULL)
+        return nodes;
+
+    if (IsA(plan, List))
+    {
+        ListCell *lc;
+        foreach(lc, (List *) plan)
+        {
+            nodes = RemoteSubplanCollectNodes(lfirst(lc), commandType, nodes);
+        }
+        return nodes;
+    }
+
+    /*
+     * Connections below the RemoteSubplan are acquired on the datanodes,
+     * no need to look further.
+     */
+    if (IsA(plan, RemoteSubplan))
+    {
+        RemoteSubplan *rsplan = (RemoteSubplan *) plan;
+        ListCell      *lc;
+
+        /* Same rule as ExecFinishInitRemoteSubplan uses */
+        if (!rsplan->scan.plan.parallel_aware &&
+            (commandType != CMD_SELECT || rsplan->execOnAll))
+        {
+            foreach(lc, rsplan->nodeList)
+            {
+                nodes = list_append_unique_int(nodes, lfirst_int(lc));
+            }
+        }
+        return nodes;
+    }
+
+    nodes = RemoteSubplanCollectNodes((Node *) ((Plan *) plan)->lefttree,
+                                      commandType, nodes);
+    nodes = RemoteSubplanCollectNodes((Node *) ((Plan *) plan)->righttree,
+                                      commandType, nodes);
+    switch (nodeTag(plan))
+    {
+        case T_Append:
+            nodes = RemoteSubplanCollectNodes((Node *) ((Append *) plan)->appendplans,
+                                              commandType, nodes);
+            break;
+        case T_MergeAppend:
+            nodes = RemoteSubplanCollectNodes((Node *) ((MergeAppend *) plan)->mergeplans,
+                                              commandType, nodes);
+            break;
+        case T_ModifyTable:
+            nodes = RemoteSubplanCollectNodes((Node *) ((ModifyTable *) plan)->plans,
+                                              commandType, nodes);
+            break;
+        case T_SubqueryScan:
+            nodes = RemoteSubplanCollectNodes((Node *) ((SubqueryScan *) plan)->subplan,
+                                              commandType, nodes);
+            break;
+        default:
+            break;
+    }
+    return nodes;
+}
+
+/*
+ * Acquire connections to all the datanodes the plan is going to query in one
+ * request to the pooler, instead of one request per RemoteSubplan node. The
+ * handles are then found ready when the RemoteSubplan nodes are initialized.
+ */
+void
+pgxc_node_acquire_plan_handles(PlannedStmt *stmt)
+{
+    List               *nodes = NIL;
+    PGXCNodeAllHandles *handles = NULL;
+
+    if (!IS_PGXC_COORDINATOR || IsParallelWorker() || stmt == NULL)
+        return;
+
+    nodes = RemoteSubplanCollectNodes((Node *) stmt->planTree,
+                                      stmt->commandType, nodes);
+    nodes = RemoteSubplanCollectNodes((Node *) stmt->subplans,
+                                      stmt->commandType, nodes);
+
+    /* A single node costs a single request anyway */
+    if (list_length(nodes) > 1)
+    {
+        handles = get_handles(nodes, NIL, false, true, true);
+        pfree_pgxc_all_handles(handles);
+    }
+    list_free(nodes);
+}
+
+/*
+ * Give the connections kept with connection_affinity_time back to the pool
+ * once the session has been idle for that long.
+ */
+void
+pgxc_node_release_idle_handles(void)
+{
+    if (IsTransactionOrTransactionBlock() || PersistentConnections ||
+        temp_object_included || !is_pgxc_handles_held())
+        return;
+
+    pgxc_node_remote_cleanup_all();
+    release_handles(false);
+}
+#endif
+
 static bool
 determine_param_types_walker(Node *node, struct find_params_context *context)
 {// #lizard forgives
@@ -12687,6 +13242,243 @@ is_node_prepared(RemoteQueryState *rstate, int node)
     return BIT_SET(rstate->dml_prepared_mask[wordindex], wordoffset) != 0;
 }
 
+/*
+ * Rows of a plain INSERT buffered for one datanode, sent as Bind/Execute
+ * pairs followed by a single sync once enough of them are collected.
+ */
+typedef struct RemoteDMLBatch
+{
+    PGXCNodeHandle *conn;
+    int             maxrows;
+    int             nrows;
+    int64          *rownos;     /* row number in the statement of each row */
+    StringInfoData  params;     /* length and bind parameters of each row */
+} RemoteDMLBatch;
+
+static void
+remote_dml_batch_error_callback(void *arg)
+{
+    errcontext("pipelined remote INSERT, row %ld of the statement", (long) *(int64 *) arg);
+}
+
+/*
+ * Whether the row may be sent together with the following ones. The result
+ * of the remote INSERT is only known when the batch is flushed, so nothing
+ * may look at it or at the table in between.
+ */
+static bool
+RemoteDMLCanPipeline(ModifyTableState *mtstate, RemoteQuery *step, ResultRelInfo *resultRelInfo)
+{
+    TriggerDesc *trigdesc = resultRelInfo->ri_TrigDesc;
+
+    if (RemoteDMLBatchRows <= 0)
+        return false;
+
+    if (mtstate->operation != CMD_INSERT || mtstate->mt_onconflict != ONCONFLICT_NONE)
+        return false;
+
+    if (trigdesc && (trigdesc->trig_insert_before_row || trigdesc->trig_insert_instead_row))
+        return false;
+
+    if (resultRelInfo->ri_projectReturning || step->cursor)
+        return false;
+
+    return true;
+}
+
+/*
+ * Send the buffered rows of the node, or of all the nodes if nodeid is -1,
+ * and check their results. Rows of all the nodes are sent before waiting
+ * for any of them.
+ */
+static void
+RemoteDMLFlush(RemoteQueryState *node, int nodeid)
+{// #lizard forgives
+    ResponseCombiner *combiner = (ResponseCombiner *) node;
+    RemoteQuery      *step = (RemoteQuery *) combiner->ss.ps.plan;
+    Snapshot          snapshot = GetActiveSnapshot();
+    int               first = nodeid < 0 ? 0 : nodeid;
+    int               last = nodeid < 0 ? MAX_NODES_NUMBER - 1 : nodeid;
+    int               nrows[MAX_NODES_NUMBER];
+    int               i;
+    int               k;
+    int64             rowno = 0;
+    CommandId         cid;
+    ErrorContextCallback errcallback;
+
+    if (node->dml_batches == NULL)
+        return;
+
+    cid = snapshot->curcid;
+    if (cid == InvalidCommandId)
+        cid = GetCurrentCommandId(false);
+
+    for (i = first; i <= last; i++)
+    {
+        RemoteDMLBatch *batch = node->dml_batches[i];
+        PGXCNodeHandle *conn;
+        bool            prepared = false;
+        char            nodetype = PGXC_NODE_DATANODE;
+        int             offset = 0;
+        int             len;
+
+        nrows[i] = 0;
+        if (batch == NULL || batch->nrows == 0)
+            continue;
+
+        conn = batch->conn;
+        CHECK_OWNERSHIP(conn, combiner);
+
+        if (pgxc_node_send_cmd_id(conn, cid) < 0 ||
+            pgxc_node_send_snapshot(conn, snapshot))
+        {
+            pgxc_node_remote_abort(TXN_TYPE_RollbackTxn, true);
+            elog(ERROR, "Failed to send command to datanode in ExecRemoteDML, nodeid:%d.",
+                        conn->nodeid);
+        }
+
+        if (step->statement)
+            prepared = ActivateDatanodeStatementOnNode(step->statement,
+                            PGXCNodeGetNodeId(conn->nodeoid, &nodetype));
+        if (prepared && step->exec_nodes && step->exec_nodes->need_rewrite)
+            prepared = false;
+        if (!prepared &&
+            pgxc_node_send_parse(conn, step->statement, step->sql_statement,
+                                 node->rqs_num_params, node->rqs_param_types))
+        {
+            pgxc_node_remote_abort(TXN_TYPE_RollbackTxn, true);
+            elog(ERROR, "Failed to send command to datanode in ExecRemoteDML, nodeid:%d.",
+                        conn->nodeid);
+        }
+
+        /* No wait between the rows, the datanode skips the rest on error. */
+        for (k = 0; k < batch->nrows; k++)
+        {
+            memcpy(&len, batch->params.data + offset, sizeof(int));
+            offset += sizeof(int);
+            if (pgxc_node_send_bind(conn, NULL, step->statement, len,
+                                    batch->params.data + offset, 0, NULL, NULL) ||
+                ((step->has_row_marks || step->read_only) &&
+                 pgxc_node_send_describe(conn, false, NULL)) ||
+                pgxc_node_send_execute(conn, NULL, 0))
+            {
+                pgxc_node_remote_abort(TXN_TYPE_RollbackTxn, true);
+                elog(ERROR, "Failed to send command to datanode in ExecRemoteDML, nodeid:%d.",
+                            conn->nodeid);
+            }
+            offset += len;
+        }
+
+        if (pgxc_node_send_my_sync(conn))
+        {
+            pgxc_node_remote_abort(TXN_TYPE_RollbackTxn, true);
+            elog(ERROR, "Failed to send command to datanode in ExecRemoteDML, nodeid:%d.",
+                        conn->nodeid);
+        }
+
+        nrows[i] = batch->nrows;
+        batch->nrows = 0;
+        resetStringInfo(&batch->params);
+    }
+    combiner->extended_query = true;
+
+    /* Report errors against the row which caused them. */
+    errcallback.callback = remote_dml_batch_error_callback;
+    errcallback.arg = (void *) &rowno;
+    errcallback.previous = error_context_stack;
+    error_context_stack = &errcallback;
+
+    for (i = first; i <= last; i++)
+    {
+        RemoteDMLBatch *batch = node->dml_batches[i];
+
+        for (k = 0; k < nrows[i]; k++)
+        {
+            PGXCNodeHandle *conn = batch->conn;
+
+            rowno = batch->rownos[k];
+
+            /* One command complete for each row */
+            conn->combiner = combiner;
+            PGXCNodeSetConnectionState(conn, DN_CONNECTION_STATE_QUERY);
+            combiner->connections = &batch->conn;
+            combiner->conn_count = 1;
+            combiner->current_conn = 0;
+            combiner->DML_processed = 0;
+
+            while (FetchTuple(combiner) != NULL)
+                ;
+
+            if (combiner->errorMessage)
+                pgxc_node_report_error(combiner);
+
+            if (combiner->DML_processed != 1)
+                elog(ERROR, "RemoteDML affects %d rows, expected one row.", combiner->DML_processed);
+        }
+    }
+
+    error_context_stack = errcallback.previous;
+}
+
+/*
+ * Buffer the row to be sent to the node later, flush the rows of the node
+ * when there are enough of them.
+ */
+static void
+RemoteDMLBufferRow(RemoteQueryState *node, PGXCNodeHandle *conn, int nodeid)
+{
+    ResponseCombiner *combiner = (ResponseCombiner *) node;
+    RemoteDMLBatch   *batch;
+    MemoryContext     oldcontext;
+
+    if (nodeid < 0 || nodeid >= MAX_NODES_NUMBER)
+    {
+        elog(ERROR, "invalid nodeid:%d is bigger than maximum node number of the cluster", nodeid);
+    }
+
+    oldcontext = MemoryContextSwitchTo(combiner->ss.ps.state->es_query_cxt);
+    if (node->dml_batches == NULL)
+        node->dml_batches = (RemoteDMLBatch **) palloc0(sizeof(RemoteDMLBatch *) * MAX_NODES_NUMBER);
+
+    batch = node->dml_batches[nodeid];
+    if (batch == NULL)
+    {
+        batch = (RemoteDMLBatch *) palloc0(sizeof(RemoteDMLBatch));
+        batch->maxrows = RemoteDMLBatchRows;
+        batch->rownos = (int64 *) palloc(sizeof(int64) * batch->maxrows);
+        initStringInfo(&batch->params);
+        node->dml_batches[nodeid] = batch;
+    }
+
+    batch->conn = conn;
+    batch->rownos[batch->nrows++] = ++node->dml_rows;
+    appendBinaryStringInfo(&batch->params, (char *) &node->paramval_len, sizeof(int));
+    appendBinaryStringInfo(&batch->params, node->paramval_data, node->paramval_len);
+    MemoryContextSwitchTo(oldcontext);
+
+    if (batch->nrows >= batch->maxrows ||
+        batch->params.len >= RemoteDMLBatchSize * 1024L)
+    {
+        RemoteDMLFlush(node, nodeid);
+    }
+}
+
+/*
+ * Send the rows still buffered by ExecRemoteDML, called when the input of
+ * the ModifyTable is exhausted.
+ */
+void
+ExecFlushRemoteDML(ModifyTableState *mtstate)
+{
+    ModifyTable *plan = (ModifyTable *) mtstate->ps.plan;
+    int          i;
+
+    for (i = 0; i < list_length(plan->remote_plans); i++)
+    {
+        RemoteDMLFlush((RemoteQueryState *) mtstate->mt_remoterels[i], -1);
+    }
+}
+
 /*
   *   ExecRemoteDML----execute DML on coordinator
   *   return true if insert/update/delete successfully, else false.
@@ -12774,6 +13566,13 @@ ExecRemoteDML(ModifyTableState *mtstate, ItemPointer tupleid, HeapTuple oldtuple
         remember_prepared_node(node, nodeid);
     }
 
+    /* Plain INSERT, send the row later together with the following ones. */
+    if (RemoteDMLCanPipeline(mtstate, step, resultRelInfo))
+    {
+        RemoteDMLBufferRow(node, connections[i], nodeid);
+        return true;
+    }
+
     /*
       * For update/delete and simple insert, we can send SQL statement  to datanode through
       * parse/bind/execute.
@@ -19,6 +19,9 @@
 
 #include "postgres.h"
 #include <poll.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 
 #ifdef __sun
 #include <sys/filio.h>
@@ -47,6 +50,10 @@
 #include "pgxc/nodemgr.h"
 #include "pgxc/pgxc.h"
 #include "pgxc/poolmgr.h"
+#include "pgxc/squeue.h"
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
 #include "tcop/dest.h"
 #include "storage/lwlock.h"
 #include "utils/builtins.h"
@@ -56,6 +63,7 @@
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 #include "utils/lsyscache.h"
+#include "utils/timestamp.h"
 #include "utils/formatting.h"
 #include "utils/tqual.h"
 #include "../interfaces/libpq/libpq-int.h"
@@ -169,6 +177,20 @@ static void get_current_dn_handles_internal(PGXCNodeAllHandles *result);
 static void get_current_cn_handles_internal(PGXCNodeAllHandles *result);
 static void get_current_txn_dn_handles_internal(PGXCNodeAllHandles *result);
 static void get_current_txn_cn_handles_internal(PGXCNodeAllHandles *result);
+static void pgxc_node_shm_channel_merge(PGXCNodeHandle *conn, int nread);
+static int  pgxc_node_shm_drop_doorbells(PGXCNodeHandle *conn, int nread);
+static bool pgxc_node_receive_shm(const int conn_count, PGXCNodeHandle **connections,
+                                  PGXCNodeHandle **ready, int *nready);
+#ifdef HAVE_SYS_EPOLL_H
+#define PGXC_EPOLL_EVENTS 64
+static int    pgxc_epoll_fd = -1;    /* node sockets of the backend */
+static uint32 pgxc_epoll_gen = 0;    /* bumped by every pgxc_node_receive */
+static void pgxc_node_epoll_register(PGXCNodeHandle *handle);
+static void pgxc_node_epoll_unregister(PGXCNodeHandle *handle);
+static bool pgxc_node_receive_epoll(const int conn_count, PGXCNodeHandle **connections,
+                                    long timeout_ms, PGXCNodeHandle **ready, int *nready,
+                                    int *status);
+#endif
 #endif
 
 /*
@@ -200,6 +222,11 @@ init_pgxc_handle(PGXCNodeHandle *pgxc_handle)
 	pgxc_handle->sock_fatal_occurred = false;
     pgxc_handle->plpgsql_need_begin_sub_txn = false;
     pgxc_handle->plpgsql_need_begin_txn = false;
+    pgxc_handle->shm_channel = NULL;
+    pgxc_handle->shm_doorbells = 0;
+    pgxc_handle->epoll_sock = NO_SOCKET;
+    pgxc_handle->epoll_armed = false;
+    pgxc_handle->epoll_gen = 0;
 #endif
 #ifndef __USE_GLOBAL_SNAPSHOT__
     pgxc_handle->sendGxidVersion = 0;
@@ -618,6 +645,13 @@ PGXCNodeConnected(NODE_CONNECTION *conn)
 static void
 pgxc_node_free(PGXCNodeHandle *handle)
 {
+#ifdef __TBASE__
+    pgxc_node_shm_channel_detach(handle);
+    handle->shm_doorbells = 0;
+#ifdef HAVE_SYS_EPOLL_H
+    pgxc_node_epoll_unregister(handle);
+#endif
+#endif
     if (handle->sock != NO_SOCKET)
     {
         close(handle->sock);
@@ -704,6 +738,11 @@ pgxc_node_init(PGXCNodeHandle *handle, int sock, bool global_session, int pid)
     handle->plpgsql_need_begin_txn = false;
     handle->sendGxidVersion = 0;
 	handle->sock_fatal_occurred = false;
+    pgxc_node_shm_channel_detach(handle);
+    handle->shm_doorbells = 0;
+#ifdef HAVE_SYS_EPOLL_H
+    pgxc_node_epoll_register(handle);
+#endif
 #endif
     /*
      * We got a new connection, set on the remote node the session parameters
@@ -773,7 +812,19 @@ pgxc_node_init(PGXCNodeHandle *handle, int sock, bool global_session, int pid)
 int
 pgxc_node_receive(const int conn_count,
                   PGXCNodeHandle ** connections, struct timeval * timeout)
+{
+    return pgxc_node_receive_ready(conn_count, connections, timeout, NULL, NULL);
+}
 
+/*
+ * pgxc_node_receive which also puts the connections that have a buffered
+ * message or got data into ready, it must have room for conn_count entries.
+ * *nready is the number of them.
+ */
+int
+pgxc_node_receive_ready(const int conn_count,
+                        PGXCNodeHandle ** connections, struct timeval * timeout,
+                        PGXCNodeHandle ** ready, int *nready)
 #else
 bool
 pgxc_node_receive(const int conn_count,
@@ -791,6 +842,45 @@ pgxc_node_receive(const int conn_count,
     bool    is_msg_buffered;
     long     timeout_ms;
     struct    pollfd pool_fd[conn_count];
+#ifdef __TBASE__
+    int     shm_channels = 0;
+    int     ready_count = 0;
+
+    if (nready == NULL)
+    {
+        ready   = NULL;
+        nready  = &ready_count;
+    }
+    *nready = 0;
+
+    /* Data from co-located producers does not wake up poll, look at it first. */
+    if (pgxc_node_receive_shm(conn_count, connections, ready, nready))
+    {
+        return DNStatus_OK;
+    }
+
+    /* do conversion from the select behaviour */
+    if (timeout == NULL)
+    {
+        timeout_ms = -1;
+    }
+    else
+    {
+        timeout_ms = (timeout->tv_sec * (uint64_t) 1000) + (timeout->tv_usec / 1000);
+    }
+
+#ifdef HAVE_SYS_EPOLL_H
+    /* Wait on the persistent epoll set if all the sockets are in it. */
+    {
+        int status;
+
+        if (pgxc_node_receive_epoll(conn_count, connections, timeout_ms, ready, nready, &status))
+        {
+            return status;
+        }
+    }
+#endif
+#endif
 
     /* sockets to be polled index */
     sockets_to_poll = 0;
@@ -802,7 +892,14 @@ pgxc_node_receive(const int conn_count,
         if (HAS_MESSAGE_BUFFERED(connections[i]))
         {
             is_msg_buffered = true;
+#ifdef __TBASE__
+            if (ready)
+            {
+                ready[(*nready)++] = connections[i];
+            }
+#else
             break;
+#endif
         }
     }
 
@@ -823,6 +920,12 @@ pgxc_node_receive(const int conn_count,
             pool_fd[i].fd = connections[i]->sock;
             pool_fd[i].events = POLLIN | POLLPRI | POLLRDNORM | POLLRDBAND;
             sockets_to_poll++;
+#ifdef __TBASE__
+            if (connections[i]->shm_channel)
+            {
+                shm_channels++;
+            }
+#endif
         }
         else
         {
@@ -854,6 +957,7 @@ pgxc_node_receive(const int conn_count,
 #endif
     }
 
+#ifndef __TBASE__
     /* do conversion from the select behaviour */
     if ( timeout == NULL )
     {
@@ -863,6 +967,23 @@ pgxc_node_receive(const int conn_count,
     {
         timeout_ms = (timeout->tv_sec * (uint64_t) 1000) + (timeout->tv_usec / 1000);
     }
+#endif
+
+#ifdef __TBASE__
+    /*
+     * Ask the co-located producers to ring the doorbell on the socket when
+     * they put something into the channel, unless they already did.
+     */
+    for (i = 0; i < conn_count && shm_channels > 0; i++)
+    {
+        if (pool_fd[i].fd != -1 && connections[i]->shm_channel &&
+            DataPumpShmChannelPrepareWait(connections[i]->shm_channel))
+        {
+            pgxc_node_receive_shm(conn_count, connections, ready, nready);
+            return DNStatus_OK;
+        }
+    }
+#endif
 
 retry:
 	CHECK_FOR_INTERRUPTS();
@@ -957,7 +1078,12 @@ retry:
                     return ERROR_OCCURED;
 #endif
                 }
-
+#ifdef __TBASE__
+                if (ready)
+                {
+                    ready[(*nready)++] = conn;
+                }
+#endif
             }
             else if (
                     (pool_fd[i].revents & POLLERR) ||
@@ -1208,6 +1334,27 @@ pgxc_node_read_data(PGXCNodeHandle *conn, bool close_if_error)
         }
     }
 
+#ifdef __TBASE__
+    /* Producer on the same host hands the data over in shared memory. */
+    if (conn->shm_channel)
+    {
+        conn->shm_doorbells += DataPumpShmChannelCancelWait(conn->shm_channel);
+        nread = DataPumpShmChannelRead(conn->shm_channel, conn->inBuffer + conn->inEnd,
+                                       conn->inSize - conn->inEnd);
+        if (nread > 0)
+        {
+            conn->inEnd += nread;
+            return 1;
+        }
+
+        /* Channel is drained, the rest comes from the socket. */
+        if (nread == EOF)
+        {
+            pgxc_node_shm_channel_detach(conn);
+        }
+    }
+#endif
+
 retry:
     nread = recv(conn->sock, conn->inBuffer + conn->inEnd,
                  conn->inSize - conn->inEnd, 0);
@@ -1268,6 +1415,22 @@ retry:
     {
         conn->inEnd += nread;
 
+#ifdef __TBASE__
+        if (conn->shm_doorbells > 0)
+        {
+            nread = pgxc_node_shm_drop_doorbells(conn, nread);
+            if (nread == 0)
+            {
+                goto retry;
+            }
+        }
+
+        if (conn->shm_channel)
+        {
+            pgxc_node_shm_channel_merge(conn, nread);
+        }
+#endif
+
         /*
          * Hack to deal with the fact that some kernels will only give us back
          * 1 packet per recv() call, even if we asked for more and there is
@@ -1299,6 +1462,477 @@ retry:
     return 0;
 }
 
+#ifdef __TBASE__
+/*
+ * Attach to the data pump channel announced by a co-located producer.
+ */
+void
+pgxc_node_shm_channel_attach(PGXCNodeHandle *conn, char *msg, int len)
+{
+    pgxc_node_shm_channel_detach(conn);
+    conn->shm_channel = DataPumpShmChannelAttach(msg, len);
+}
+
+void
+pgxc_node_shm_channel_detach(PGXCNodeHandle *conn)
+{
+    if (conn->shm_channel)
+    {
+        conn->shm_doorbells += DataPumpShmChannelCancelWait(conn->shm_channel);
+        DataPumpShmChannelDetach(conn->shm_channel);
+        conn->shm_channel = NULL;
+    }
+}
+
+/*
+ * Take the doorbells rung by the producer off the socket data just read,
+ * nread bytes at the end of the buffer. The producer sends them before any
+ * other socket data, so they are leading, but they may come after the
+ * channel is gone. Returns the number of bytes left.
+ */
+static int
+pgxc_node_shm_drop_doorbells(PGXCNodeHandle *conn, int nread)
+{
+    size_t  sock_start = conn->inEnd - nread;
+    int     n = 0;
+
+    while (n < nread && conn->shm_doorbells > 0 &&
+           conn->inBuffer[sock_start + n] == DATAPUMP_SHM_DOORBELL)
+    {
+        n++;
+        conn->shm_doorbells--;
+    }
+
+    if (n > 0)
+    {
+        memmove(conn->inBuffer + sock_start, conn->inBuffer + sock_start + n, nread - n);
+        conn->inEnd -= n;
+    }
+    return nread - n;
+}
+
+/*
+ * Socket data arrived while the data pump channel is still attached, the
+ * doorbells are already dropped from it. Producer marks the channel finished before the socket is used again, so in
+ * that case everything left in the channel goes before the socket data.
+ * Otherwise the producer was aborted, drop the channel along with any
+ * incomplete message taken from it.
+ */
+static void
+pgxc_node_shm_channel_merge(PGXCNodeHandle *conn, int nread)
+{
+    size_t  sock_start = conn->inEnd - nread;
+    size_t  pos;
+    uint32  msglen;
+    char   *sock_data;
+    int     n;
+
+    sock_data = (char *) palloc(nread);
+    memcpy(sock_data, conn->inBuffer + sock_start, nread);
+    conn->inEnd = sock_start;
+
+    for (;;)
+    {
+        if (ensure_in_buffer_capacity(conn->inEnd + (size_t) 8192, conn) != 0)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_OUT_OF_MEMORY),
+                     errmsg("out of memory")));
+        }
+
+        n = DataPumpShmChannelRead(conn->shm_channel, conn->inBuffer + conn->inEnd,
+                                   conn->inSize - conn->inEnd);
+        if (n <= 0)
+        {
+            break;
+        }
+        conn->inEnd += n;
+    }
+
+    if (n != EOF)
+    {
+        pos = conn->inStart;
+        while (pos + 5 <= conn->inEnd)
+        {
+            memcpy(&msglen, conn->inBuffer + pos + 1, 4);
+            msglen = ntohl(msglen);
+            if (pos + 1 + msglen > conn->inEnd)
+            {
+                break;
+            }
+            pos += 1 + msglen;
+        }
+        conn->inEnd = pos;
+        elog(LOG, "data pump channel from node:%s pid:%d abandoned",
+             conn->nodename, conn->backend_pid);
+    }
+    pgxc_node_shm_channel_detach(conn);
+
+    if (ensure_in_buffer_capacity(conn->inEnd + (size_t) nread, conn) != 0)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_OUT_OF_MEMORY),
+                 errmsg("out of memory")));
+    }
+    memcpy(conn->inBuffer + conn->inEnd, sock_data, nread);
+    conn->inEnd += nread;
+    pfree(sock_data);
+}
+
+/*
+ * Replace the compressed frame just read from the connection with the data it
+ * carries, so that the following messages are read from there.
+ */
+void
+pgxc_node_inflate_frame(PGXCNodeHandle *conn, char *msg, int len)
+{
+#ifdef HAVE_LIBZ
+    int         ret;
+    uint32      n32;
+    uint32      rawlen;
+    size_t      left;
+    char       *raw;
+    z_stream    stream;
+
+    if (len <= 4)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_PROTOCOL_VIOLATION),
+                 errmsg("invalid compressed frame from node:%s pid:%d", conn->nodename, conn->backend_pid)));
+    }
+
+    memcpy(&n32, msg, 4);
+    rawlen = ntohl(n32);
+    raw = (char *) palloc(rawlen);
+
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit(&stream) != Z_OK)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_OUT_OF_MEMORY),
+                 errmsg("could not initialize decompression: %s", stream.msg ? stream.msg : "unknown error")));
+    }
+    stream.next_in   = (Bytef *) msg + 4;
+    stream.avail_in  = len - 4;
+    stream.next_out  = (Bytef *) raw;
+    stream.avail_out = rawlen;
+    ret = inflate(&stream, Z_FINISH);
+    inflateEnd(&stream);
+    if (ret != Z_STREAM_END || stream.total_out != rawlen)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_DATA_CORRUPTED),
+                 errmsg("could not decompress frame from node:%s pid:%d", conn->nodename, conn->backend_pid)));
+    }
+
+    /* Frame has been consumed, put the data in front of what follows it. */
+    left = conn->inEnd - conn->inCursor;
+    if (ensure_in_buffer_capacity(conn->inEnd + rawlen, conn) != 0)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_OUT_OF_MEMORY),
+                 errmsg("out of memory")));
+    }
+    memmove(conn->inBuffer + conn->inCursor + rawlen, conn->inBuffer + conn->inCursor, left);
+    memcpy(conn->inBuffer + conn->inCursor, raw, rawlen);
+    conn->inEnd += rawlen;
+    pfree(raw);
+#else
+    ereport(ERROR,
+            (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+             errmsg("received compressed frame from node:%s pid:%d, but zlib is not supported by this build",
+                    conn->nodename, conn->backend_pid)));
+#endif
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * Put the socket of a newly acquired handle into the epoll set of the
+ * backend, pgxc_node_receive then only hears from the ready connections.
+ */
+static void
+pgxc_node_epoll_register(PGXCNodeHandle *handle)
+{
+    struct epoll_event event;
+
+    handle->epoll_sock  = NO_SOCKET;
+    handle->epoll_armed = false;
+
+    if (pgxc_epoll_fd < 0)
+    {
+        pgxc_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (pgxc_epoll_fd < 0)
+        {
+            elog(LOG, "could not create epoll set for node connections: %s", strerror(errno));
+            return;
+        }
+    }
+
+    event.events   = EPOLLIN;
+    event.data.ptr = handle;
+    if (epoll_ctl(pgxc_epoll_fd, EPOLL_CTL_ADD, handle->sock, &event) < 0 &&
+        (errno != EEXIST || epoll_ctl(pgxc_epoll_fd, EPOLL_CTL_MOD, handle->sock, &event) < 0))
+    {
+        elog(DEBUG1, "could not add node:%s pid:%d to epoll set: %s",
+             handle->nodename, handle->backend_pid, strerror(errno));
+        return;
+    }
+    handle->epoll_sock  = handle->sock;
+    handle->epoll_armed = true;
+}
+
+static void
+pgxc_node_epoll_unregister(PGXCNodeHandle *handle)
+{
+    struct epoll_event event;
+
+    /* Closing the socket removes it as well, unless it is shared. */
+    if (handle->epoll_sock == handle->sock && handle->sock != NO_SOCKET)
+    {
+        epoll_ctl(pgxc_epoll_fd, EPOLL_CTL_DEL, handle->sock, &event);
+    }
+    handle->epoll_sock  = NO_SOCKET;
+    handle->epoll_armed = false;
+}
+
+/*
+ * pgxc_node_receive using the epoll set of the backend. Sockets stay in the
+ * set as long as the handle lives; a socket that gets ready while nobody waits
+ * on it is only disabled, and enabled again the next time it is waited on.
+ * Return false if some of the connections are not in the set, the caller polls
+ * them then, otherwise *status is the result.
+ */
+static bool
+pgxc_node_receive_epoll(const int conn_count, PGXCNodeHandle **connections,
+                        long timeout_ms, PGXCNodeHandle **ready, int *nready,
+                        int *status)
+{// #lizard forgives
+    int     i;
+    int     nevents;
+    int     nwaiting = 0;
+    int     ngot     = 0;
+    bool    buffered = false;
+    bool    shm_ready = false;
+    long    wait_ms  = timeout_ms;
+    TimestampTz deadline = 0;
+    struct epoll_event event;
+    struct epoll_event events[PGXC_EPOLL_EVENTS];
+
+    if (pgxc_epoll_fd < 0)
+    {
+        return false;
+    }
+
+    /* Mark the connections waited on by this call, enable the disabled ones. */
+    pgxc_epoll_gen++;
+    for (i = 0; i < conn_count; i++)
+    {
+        PGXCNodeHandle *conn = connections[i];
+
+        if (HAS_MESSAGE_BUFFERED(conn))
+        {
+            buffered = true;
+            continue;
+        }
+
+        if (conn->state == DN_CONNECTION_STATE_IDLE)
+        {
+            continue;
+        }
+
+        if (conn->sock <= 0 || conn->epoll_sock != conn->sock)
+        {
+            return false;
+        }
+
+        if (!conn->epoll_armed)
+        {
+            event.events   = EPOLLIN;
+            event.data.ptr = conn;
+            if (epoll_ctl(pgxc_epoll_fd, EPOLL_CTL_MOD, conn->sock, &event) < 0)
+            {
+                return false;
+            }
+            conn->epoll_armed = true;
+        }
+        conn->epoll_gen = pgxc_epoll_gen;
+        nwaiting++;
+
+        if (conn->shm_channel && !shm_ready)
+        {
+            shm_ready = DataPumpShmChannelPrepareWait(conn->shm_channel);
+        }
+    }
+
+    for (i = 0; i < conn_count && ready && buffered; i++)
+    {
+        if (HAS_MESSAGE_BUFFERED(connections[i]))
+        {
+            ready[(*nready)++] = connections[i];
+        }
+    }
+
+    if (shm_ready)
+    {
+        pgxc_node_receive_shm(conn_count, connections, ready, nready);
+        *status = DNStatus_OK;
+        return true;
+    }
+
+    if (nwaiting == 0)
+    {
+        if (!buffered)
+        {
+            elog(DEBUG1, "no message in buffer");
+        }
+        *status = buffered ? DNStatus_OK : DNStatus_ERR;
+        return true;
+    }
+
+    /* Only pick up what is there if some messages are buffered already. */
+    if (buffered)
+    {
+        wait_ms = 0;
+    }
+    else if (timeout_ms > 0)
+    {
+        deadline = TimestampTzPlusMilliseconds(GetCurrentTimestamp(), timeout_ms);
+    }
+
+retry:
+    CHECK_FOR_INTERRUPTS();
+    nevents = epoll_wait(pgxc_epoll_fd, events, PGXC_EPOLL_EVENTS, wait_ms);
+    if (nevents < 0)
+    {
+        if (errno == EINTR)
+        {
+            goto next;
+        }
+
+        elog(LOG, "epoll_wait() failed for error: %d, %s", errno, strerror(errno));
+        *status = DNStatus_ERR;
+        return true;
+    }
+
+    for (i = 0; i < nevents; i++)
+    {
+        PGXCNodeHandle *conn = (PGXCNodeHandle *) events[i].data.ptr;
+
+        /*
+         * Nobody waits on the connection now, disable it until it is waited
+         * on again, so that it does not wake us up for nothing.
+         */
+        if (conn->epoll_gen != pgxc_epoll_gen)
+        {
+            events[i].events = 0;
+            epoll_ctl(pgxc_epoll_fd, EPOLL_CTL_MOD, conn->sock, &events[i]);
+            conn->epoll_armed = false;
+            continue;
+        }
+
+        if (events[i].events & EPOLLIN)
+        {
+            int    read_status = pgxc_node_read_data(conn, true);
+            if (read_status == EOF || read_status < 0)
+            {
+                /* Can not read - no more actions, just discard connection */
+                PGXCNodeSetConnectionState(conn,
+                        DN_CONNECTION_STATE_ERROR_FATAL);
+                add_error_message(conn, "unexpected EOF on datanode connection.");
+                elog(LOG, "unexpected EOF on node:%s pid:%d, read_status:%d, EOF:%d", conn->nodename, conn->backend_pid, read_status, EOF);
+                *status = DNStatus_ERR;
+                return true;
+            }
+        }
+        else if (events[i].events & (EPOLLERR | EPOLLHUP))
+        {
+            PGXCNodeSetConnectionState(conn,
+                    DN_CONNECTION_STATE_ERROR_FATAL);
+            add_error_message(conn, "unexpected network error on datanode connection");
+            elog(LOG, "unexpected EOF on datanode:%s pid:%d with event %d", conn->nodename, conn->backend_pid, events[i].events);
+            *status = DNStatus_ERR;
+            return true;
+        }
+
+        ngot++;
+        if (ready)
+        {
+            ready[(*nready)++] = conn;
+        }
+    }
+
+    if (ngot == 0 && !buffered)
+    {
+        /* Only connections nobody waits on were ready, they are out now. */
+        if (nevents != 0)
+        {
+            goto next;
+        }
+
+        elog(DEBUG1, "timeout %ld while waiting for any response from %d connections", timeout_ms, conn_count);
+        *status = DNStatus_EXPIRED;
+        return true;
+    }
+
+    *status = DNStatus_OK;
+    return true;
+
+next:
+    /* Wait for what is left of the timeout. */
+    if (timeout_ms > 0 && !buffered)
+    {
+        long    secs;
+        int     usecs;
+
+        TimestampDifference(GetCurrentTimestamp(), deadline, &secs, &usecs);
+        wait_ms = secs * 1000 + usecs / 1000;
+        if (secs == 0 && usecs == 0)
+        {
+            elog(DEBUG1, "timeout %ld while waiting for any response from %d connections", timeout_ms, conn_count);
+            *status = DNStatus_EXPIRED;
+            return true;
+        }
+    }
+    goto retry;
+}
+#endif
+
+/*
+ * Read from the data pump channels which have something for us, return true
+ * if any data was read.
+ */
+static bool
+pgxc_node_receive_shm(const int conn_count, PGXCNodeHandle **connections,
+                      PGXCNodeHandle **ready, int *nready)
+{
+    int     i;
+    bool    got_data = false;
+
+    for (i = 0; i < conn_count; i++)
+    {
+        PGXCNodeHandle *conn = connections[i];
+
+        if (conn->shm_channel)
+        {
+            conn->shm_doorbells += DataPumpShmChannelCancelWait(conn->shm_channel);
+        }
+
+        if (conn->shm_channel && DataPumpShmChannelReady(conn->shm_channel))
+        {
+            if (pgxc_node_read_data(conn, true) > 0)
+            {
+                got_data = true;
+                if (ready)
+                {
+                    ready[(*nready)++] = conn;
+                }
+            }
+        }
+    }
+    return got_data;
+}
+#endif
+
 
 /*
  * Get one character from the connection buffer and advance cursor
@@ -6099,6 +6733,15 @@ is_pgxc_handles_init()
 	return (dn_handles != NULL && co_handles != NULL);
 }
 
+/*
+ * Return whether the session holds connections acquired from pool.
+ */
+bool
+is_pgxc_handles_held(void)
+{
+	return (datanode_count > 0 || coord_count > 0 || slavedatanode_count > 0);
+}
+
 /*
  * Remove leader_cn_handle from pgxc_connections
  */
@@ -93,6 +93,9 @@ int         PoolCheckSlotTimeout   = -1;   /* Pooler check slot. One slot can on
 int         PoolPrintStatTimeout   = -1;
     
 bool        PersistentConnections    = false;
+#ifdef __TBASE__
+int         ConnectionAffinityTime   = 0;    /* ms to keep connections of an idle session */
+#endif
 char        *g_PoolerWarmBufferInfo  = "postgres:postgres";
 
 char        *g_unpooled_database     = "template1";
@@ -166,6 +169,12 @@ unsigned char g_pooler_cmd[POOLER_CMD_COUNT] =
     'z'                     /* Get connection statistics */
 };
 
+/* upper bounds in ms of the buckets of command time histogram */
+const uint64 g_pooler_cmd_hist_bound[POOLER_CMD_HIST_BUCKETS - 1] =
+{
+    1, 2, 5, 10, 20, 50, 100, 200, 500, 1000
+};
+
 /* a map used to change msgtype to id */
 uint8 g_qtype2id[256];
 
@@ -11468,6 +11477,7 @@ init_pooler_cmd_statistics(void)
         g_pooler_cmd_stat[i].total_costtime = 0;
         g_pooler_cmd_stat[i].max_costtime = 0;
         g_pooler_cmd_stat[i].min_costtime = MAX_UINT64;
+        memset(g_pooler_cmd_stat[i].costtime_hist, 0, sizeof(g_pooler_cmd_stat[i].costtime_hist));
     }
 }
 
@@ -11485,6 +11495,7 @@ reset_pooler_cmd_statistics(void)
         g_pooler_cmd_stat[i].total_costtime = 0;
         g_pooler_cmd_stat[i].max_costtime = 0;
         g_pooler_cmd_stat[i].min_costtime = MAX_UINT64;
+        memset(g_pooler_cmd_stat[i].costtime_hist, 0, sizeof(g_pooler_cmd_stat[i].costtime_hist));
     }
 }
 
@@ -11494,7 +11505,9 @@ reset_pooler_cmd_statistics(void)
 static void
 update_pooler_cmd_statistics(unsigned char qtype, uint64 costtime)
 {
-    uint8 id = g_qtype2id[qtype];
+    uint8 id     = g_qtype2id[qtype];
+    int   bucket = 0;
+
     if (id == MAX_UINT8)
     {
         return;
@@ -11512,6 +11525,15 @@ update_pooler_cmd_statistics(unsigned char qtype, uint64 costtime)
     {
         g_pooler_cmd_stat[id].min_costtime = costtime;
     }
+
+    for (bucket = 0; bucket < POOLER_CMD_HIST_BUCKETS - 1; bucket++)
+    {
+        if (costtime < g_pooler_cmd_hist_bound[bucket])
+        {
+            break;
+        }
+    }
+    g_pooler_cmd_stat[id].costtime_hist[bucket]++;
 }
 
 /*
@@ -11521,6 +11543,7 @@ static void
 handle_get_cmd_statistics(PoolAgent *agent)
 {
     int    i = 0;
+    int    j = 0;
     uint64 n64 = 0;
     char   msgtype = 'x';
 
@@ -11541,6 +11564,12 @@ handle_get_cmd_statistics(PoolAgent *agent)
 
         n64 = htobe64(g_pooler_cmd_stat[i].min_costtime);
         pool_putbytes(&agent->port, (char *) &n64, sizeof(n64));
+
+        for (j = 0; j < POOLER_CMD_HIST_BUCKETS; j++)
+        {
+            n64 = htobe64(g_pooler_cmd_stat[i].costtime_hist[j]);
+            pool_putbytes(&agent->port, (char *) &n64, sizeof(n64));
+        }
     }
 
     pool_flush(&agent->port);
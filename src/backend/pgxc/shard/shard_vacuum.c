@@ -69,6 +69,7 @@
 #include "utils/snapmgr.h"
 #include "utils/lsyscache.h"
 #include "pgxc/shard_vacuum.h"
+#include "pgxc/shardmap.h"
 #include "pgxc/pgxc.h"
 #include "access/heapam.h"
 #include "access/htup.h"
@@ -435,7 +436,24 @@ int64 vacuum_shard_internal(Relation rel, Bitmapset *to_vacuum, Snapshot vacuum_
         }
     }    
 
-    scan = heap_beginscan(rel, vacuum_snapshot, 0, NULL);
+    /*
+     * Release the extents of the shards as a whole, only the tuples left in
+     * extents still written by transactions in progress are deleted one by
+     * one below.
+     */
+    if(to_delete && to_vacuum && RelationHasExtent(rel))
+    {
+        int sid = -1;
+
+        while((sid = bms_next_member(to_vacuum, sid)) >= 0)
+            (void) ReleaseShardExtents(rel, sid, sleep_interval, &n);
+    }
+
+    /* only read the extents of the shards to vacuum */
+    if(to_vacuum)
+        scan = heap_beginscan_shards(rel, vacuum_snapshot, to_vacuum);
+    else
+        scan = heap_beginscan(rel, vacuum_snapshot, 0, NULL);
     tup = heap_getnext(scan,ForwardScanDirection);
     
     while(HeapTupleIsValid(tup))
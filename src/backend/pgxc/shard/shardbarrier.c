@@ -61,18 +61,34 @@
 #include "postgres.h"
 
 #include "funcapi.h"
+#include "miscadmin.h"
+#include "pgstat.h"
 #include "access/htup_details.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "access/xlog.h"
 #include "catalog/pg_type.h"
+#include "port/atomics.h"
+#include "storage/condition_variable.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/procarray.h"
 #include "storage/shmem.h"
+#include "storage/standby.h"
 #include "storage/relfilenode.h"
 #include "storage/spin.h"
 #include "storage/lwlock.h"
+#include "storage/lmgr.h"
 #include "storage/lockdefs.h"
+#include "storage/proc.h"
 #include "utils/hsearch.h"
 #include "utils/timestamp.h"
 #include "utils/builtins.h"
+#include "pgxc/pgxc.h"
 #include "pgxc/shardmap.h"
+#include "pgxc/shard_vacuum.h"
 #include "utils/fmgroids.h"
+#include "utils/pg_lsn.h"
 
 #define MAX_BARRIER_SHARDS    256
 
@@ -382,3 +398,513 @@ Datum pg_stat_barrier_shards(PG_FUNCTION_ARGS)
     result = HeapTupleGetDatum(tuple);
     SRF_RETURN_NEXT(funcctx, result);
 }
+
+/*
+ * Shard move fence.
+ *
+ * While shards are moved online, the target datanode copies them and then
+ * follows the source through logical decoding filtered by shard.  To switch
+ * over, the source fences the shards: new writes to them wait, the
+ * transactions already running are waited for, and the returned LSN is the
+ * point the target has to reach before the shardmap is flipped.  Unlike the
+ * vacuum barrier above, the fence covers every relation.  It belongs to the
+ * backend that set it: only that backend can release it, and it is released
+ * when the backend exits, so the mover keeps its session open until the
+ * shardmap is flipped.
+ */
+#define SHARD_MOVE_REPORT_TUPLES    1000
+
+int shard_move_fence_timeout = 1000;
+
+typedef struct ShardMoveState
+{
+    slock_t     mutex;
+    bool        fenced;
+    bool        moved;          /* how the last fence ended */
+    uint32      generation;     /* bumped each time a fence ends */
+    int         pid;            /* backend that set the fence */
+    TimestampTz fence_start;
+    XLogRecPtr  fence_lsn;
+    TimestampTz copy_start;
+    TimestampTz copy_last;
+    uint32      shards[MAX_SHARDS / 32];
+
+    pg_atomic_uint32 active;    /* lock-free hint for writers */
+    ConditionVariable cv;       /* writers waiting for the fence to end */
+    pg_atomic_uint64 fence_waits;
+    pg_atomic_uint64 fence_wait_us;
+    pg_atomic_uint64 fence_timeouts;
+    pg_atomic_uint64 copy_tuples;
+    pg_atomic_uint64 copy_bytes;
+} ShardMoveState;
+
+static ShardMoveState *g_shard_move = NULL;
+
+/* copy progress not yet added to shared memory */
+static int64 pending_copy_tuples = 0;
+static int64 pending_copy_bytes = 0;
+
+static bool shard_move_exit_registered = false;
+
+#define SHARD_MOVE_IS_FENCED(state, sid) \
+    ((state)->fenced && ((state)->shards[(sid) / 32] & (1U << ((sid) % 32))) != 0)
+
+Size ShardMoveShmemSize(void)
+{
+    return MAXALIGN64(sizeof(ShardMoveState));
+}
+
+void ShardMoveShmemInit(void)
+{
+    bool found;
+
+    g_shard_move = (ShardMoveState *)ShmemInitStruct("ShardMoveState",
+                                                sizeof(ShardMoveState),
+                                                &found);
+    if(!found)
+    {
+        memset(g_shard_move, 0, sizeof(ShardMoveState));
+        SpinLockInit(&g_shard_move->mutex);
+        pg_atomic_init_u32(&g_shard_move->active, 0);
+        ConditionVariableInit(&g_shard_move->cv);
+        pg_atomic_init_u64(&g_shard_move->fence_waits, 0);
+        pg_atomic_init_u64(&g_shard_move->fence_wait_us, 0);
+        pg_atomic_init_u64(&g_shard_move->fence_timeouts, 0);
+        pg_atomic_init_u64(&g_shard_move->copy_tuples, 0);
+        pg_atomic_init_u64(&g_shard_move->copy_bytes, 0);
+    }
+}
+
+/*
+ * End the fence, caller must hold the mutex and wake up the writers once it
+ * is released.
+ */
+static void
+shard_move_unfence_locked(bool moved)
+{
+    g_shard_move->fenced = false;
+    g_shard_move->moved = moved;
+    g_shard_move->generation++;
+    memset(g_shard_move->shards, 0, sizeof(g_shard_move->shards));
+    pg_atomic_write_u32(&g_shard_move->active, 0);
+}
+
+/*
+ * Release the fence of a backend that exits.  Whether the shardmap was
+ * flipped is not known here, so the waiting writers fail as if the shards
+ * were moved: retrying is right either way, going on is not.
+ */
+static void
+shard_move_fence_atexit(int code, Datum arg)
+{
+    bool released = false;
+
+    SpinLockAcquire(&g_shard_move->mutex);
+    if(g_shard_move->fenced && g_shard_move->pid == MyProcPid)
+    {
+        shard_move_unfence_locked(true);
+        released = true;
+    }
+    SpinLockRelease(&g_shard_move->mutex);
+
+    if(released)
+        ConditionVariableBroadcast(&g_shard_move->cv);
+}
+
+bool ShardMoveFenceIsActive(void)
+{
+    return pg_atomic_read_u32(&g_shard_move->active) != 0;
+}
+
+/*
+ * Is the shard fenced?
+ */
+static bool
+shard_move_check_fence(ShardID sid, uint32 *generation, bool *moved)
+{
+    bool fenced;
+
+    SpinLockAcquire(&g_shard_move->mutex);
+    fenced = SHARD_MOVE_IS_FENCED(g_shard_move, sid);
+    if(generation && *generation != g_shard_move->generation)
+    {
+        /* the fence we were waiting for is over */
+        fenced = false;
+        *moved = g_shard_move->moved;
+    }
+    else if(generation)
+    {
+        *moved = false;
+    }
+    SpinLockRelease(&g_shard_move->mutex);
+
+    return fenced;
+}
+
+/*
+ * Called before a tuple of the shard is written.  The transaction id of the
+ * writer is assigned before, and taking XidGenLock for it is a barrier, so
+ * either the writer sees the fence here or the fencing backend sees its xid
+ * and waits for it.
+ */
+void WaitForShardMoveFence(ShardID sid)
+{
+    uint32      generation;
+    bool        moved = false;
+    TimestampTz start;
+    long        secs;
+    int         usecs;
+
+    if(pg_atomic_read_u32(&g_shard_move->active) == 0 || !ShardIDIsValid(sid))
+        return;
+
+    SpinLockAcquire(&g_shard_move->mutex);
+    generation = g_shard_move->generation;
+    SpinLockRelease(&g_shard_move->mutex);
+
+    if(!shard_move_check_fence(sid, NULL, NULL))
+        return;
+
+    start = GetCurrentTimestamp();
+    pg_atomic_fetch_add_u64(&g_shard_move->fence_waits, 1);
+
+    /*
+     * ConditionVariableSleep has no timeout, so wait on the latch directly
+     * and queue up on the condition variable again after each wakeup.
+     */
+    ConditionVariablePrepareToSleep(&g_shard_move->cv);
+    while(shard_move_check_fence(sid, &generation, &moved))
+    {
+        TimestampTz now = GetCurrentTimestamp();
+        int         rc;
+
+        if(TimestampDifferenceExceeds(start, now, shard_move_fence_timeout))
+        {
+            ConditionVariableCancelSleep();
+            pg_atomic_fetch_add_u64(&g_shard_move->fence_timeouts, 1);
+            ereport(ERROR,
+                    (errcode(ERRCODE_LOCK_NOT_AVAILABLE),
+                     errmsg("shard %d is being moved, it can not be written right now", sid),
+                     errhint("Retry the transaction.")));
+        }
+
+        TimestampDifference(now, TimestampTzPlusMilliseconds(start, shard_move_fence_timeout),
+                            &secs, &usecs);
+        rc = WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+                       secs * 1000 + usecs / 1000 + 1, WAIT_EVENT_SHARD_MOVE_FENCE);
+        if(rc & WL_POSTMASTER_DEATH)
+            proc_exit(1);
+
+        CHECK_FOR_INTERRUPTS();
+        ConditionVariableCancelSleep();
+        ConditionVariablePrepareToSleep(&g_shard_move->cv);
+    }
+    ConditionVariableCancelSleep();
+
+    TimestampDifference(start, GetCurrentTimestamp(), &secs, &usecs);
+    pg_atomic_fetch_add_u64(&g_shard_move->fence_wait_us, secs * 1000000 + usecs);
+
+    if(moved)
+        ereport(ERROR,
+                (errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+                 errmsg("shard %d has been moved to another datanode", sid),
+                 errhint("Retry the transaction.")));
+}
+
+/*
+ * Account tuples exported for a shard move, the shared counters are updated
+ * every SHARD_MOVE_REPORT_TUPLES tuples and when the copy is done.
+ */
+void ShardMoveReportCopy(int64 tuples, int64 bytes, bool flush)
+{
+    TimestampTz now;
+
+    pending_copy_tuples += tuples;
+    pending_copy_bytes += bytes;
+
+    if(!flush && pending_copy_tuples < SHARD_MOVE_REPORT_TUPLES)
+        return;
+    if(pending_copy_tuples == 0)
+        return;
+
+    now = GetCurrentTimestamp();
+    SpinLockAcquire(&g_shard_move->mutex);
+    if(g_shard_move->copy_start == 0)
+        g_shard_move->copy_start = now;
+    g_shard_move->copy_last = now;
+    SpinLockRelease(&g_shard_move->mutex);
+
+    pg_atomic_fetch_add_u64(&g_shard_move->copy_tuples, pending_copy_tuples);
+    pg_atomic_fetch_add_u64(&g_shard_move->copy_bytes, pending_copy_bytes);
+    pending_copy_tuples = 0;
+    pending_copy_bytes = 0;
+}
+
+/*
+ * Wait for the transaction xid to end on its transaction lock, for at most
+ * timeout ms.  Returns false on timeout.
+ */
+static bool
+shard_move_wait_xact(TransactionId xid, int timeout)
+{
+    int         save_lock_timeout = LockTimeout;
+    MemoryContext oldcontext = CurrentMemoryContext;
+    bool        done = true;
+
+    LockTimeout = timeout;
+    PG_TRY();
+    {
+        XactLockTableWait(xid, NULL, NULL, XLTW_None);
+    }
+    PG_CATCH();
+    {
+        ErrorData  *edata;
+
+        LockTimeout = save_lock_timeout;
+        MemoryContextSwitchTo(oldcontext);
+        edata = CopyErrorData();
+        if(edata->sqlerrcode != ERRCODE_LOCK_NOT_AVAILABLE)
+            PG_RE_THROW();
+        FlushErrorState();
+        FreeErrorData(edata);
+        done = false;
+    }
+    PG_END_TRY();
+    LockTimeout = save_lock_timeout;
+
+    return done;
+}
+
+/*
+ * Wait until the transactions running now are over, ERROR on timeout.  Each
+ * one is waited for on its transaction lock, with lock_timeout set to what is
+ * left of the wait.
+ */
+static void
+shard_move_wait_running_xacts(void)
+{
+    RunningTransactions running;
+    TransactionId *xids;
+    TransactionId myxid = GetTopTransactionIdIfAny();
+    TimestampTz start = GetCurrentTimestamp();
+    int         nxids;
+    int         i;
+
+    running = GetRunningTransactionData();
+    nxids = running->xcnt;
+    xids = (TransactionId *) palloc(Max(nxids, 1) * sizeof(TransactionId));
+    memcpy(xids, running->xids, nxids * sizeof(TransactionId));
+    LWLockRelease(ProcArrayLock);
+    LWLockRelease(XidGenLock);
+
+    for(i = 0; i < nxids; i++)
+    {
+        long        secs;
+        int         usecs;
+        int         remaining;
+
+        if(TransactionIdEquals(xids[i], myxid) ||
+           !TransactionIdIsInProgress(xids[i]))
+            continue;
+
+        /*
+         * Writers stuck on the fence give up after shard_move_fence_timeout,
+         * wait longer than that so that they can not hold off the fence.
+         */
+        TimestampDifference(start, GetCurrentTimestamp(), &secs, &usecs);
+        remaining = 2 * shard_move_fence_timeout - (int) (secs * 1000 + usecs / 1000);
+        if(remaining <= 0 || !shard_move_wait_xact(xids[i], remaining))
+            ereport(ERROR,
+                    (errcode(ERRCODE_LOCK_NOT_AVAILABLE),
+                     errmsg("could not fence shards, transaction %u is still running", xids[i])));
+    }
+
+    pfree(xids);
+}
+
+Datum pg_shard_move_fence(PG_FUNCTION_ARGS)
+{
+    char       *shards_str = text_to_cstring(PG_GETARG_TEXT_P(0));
+    List       *shards;
+    ListCell   *lc;
+    uint32      bits[MAX_SHARDS / 32];
+    XLogRecPtr  lsn;
+
+    if(!superuser())
+        ereport(ERROR,
+                (errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+                 errmsg("must be superuser to fence shards")));
+
+    if(!IS_PGXC_DATANODE)
+        elog(ERROR, "shards can only be fenced on datanode.");
+
+    memset(bits, 0, sizeof(bits));
+    shards = string_to_shard_list(shards_str);
+    foreach(lc, shards)
+    {
+        int sid = lfirst_int(lc);
+
+        if(!ShardIDIsValid(sid))
+            elog(ERROR, "shard %d is invalid.", sid);
+        bits[sid / 32] |= 1U << (sid % 32);
+    }
+
+    if(shards == NIL)
+        elog(ERROR, "no shard to fence.");
+
+    SpinLockAcquire(&g_shard_move->mutex);
+    if(g_shard_move->fenced)
+    {
+        int pid = g_shard_move->pid;
+
+        SpinLockRelease(&g_shard_move->mutex);
+        elog(ERROR, "shards are already fenced by process %d.", pid);
+    }
+    g_shard_move->fenced = true;
+    g_shard_move->pid = MyProcPid;
+    g_shard_move->fence_start = GetCurrentTimestamp();
+    g_shard_move->fence_lsn = InvalidXLogRecPtr;
+    memcpy(g_shard_move->shards, bits, sizeof(bits));
+    SpinLockRelease(&g_shard_move->mutex);
+    pg_atomic_write_u32(&g_shard_move->active, 1);
+
+    if(!shard_move_exit_registered)
+    {
+        before_shmem_exit(shard_move_fence_atexit, 0);
+        shard_move_exit_registered = true;
+    }
+
+    PG_TRY();
+    {
+        shard_move_wait_running_xacts();
+    }
+    PG_CATCH();
+    {
+        SpinLockAcquire(&g_shard_move->mutex);
+        shard_move_unfence_locked(false);
+        SpinLockRelease(&g_shard_move->mutex);
+        ConditionVariableBroadcast(&g_shard_move->cv);
+        PG_RE_THROW();
+    }
+    PG_END_TRY();
+
+    lsn = GetXLogInsertRecPtr();
+
+    SpinLockAcquire(&g_shard_move->mutex);
+    g_shard_move->fence_lsn = lsn;
+    SpinLockRelease(&g_shard_move->mutex);
+
+    list_free(shards);
+    PG_RETURN_LSN(lsn);
+}
+
+/*
+ * End the fence set by this backend.  If the shards were moved, the writers
+ * waiting on it fail and are routed to the new datanode when they retry,
+ * otherwise they go on.  Returns false if this backend holds no fence, the
+ * mover must not flip the shardmap then.
+ */
+Datum pg_shard_move_unfence(PG_FUNCTION_ARGS)
+{
+    bool moved = PG_GETARG_BOOL(0);
+    bool fenced;
+    int  pid;
+
+    if(!superuser())
+        ereport(ERROR,
+                (errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+                 errmsg("must be superuser to unfence shards")));
+
+    SpinLockAcquire(&g_shard_move->mutex);
+    fenced = g_shard_move->fenced;
+    pid = g_shard_move->pid;
+    if(fenced && pid != MyProcPid)
+    {
+        SpinLockRelease(&g_shard_move->mutex);
+        elog(ERROR, "shards are fenced by process %d.", pid);
+    }
+    if(fenced)
+        shard_move_unfence_locked(moved);
+    if(moved)
+        g_shard_move->copy_start = g_shard_move->copy_last = 0;
+    SpinLockRelease(&g_shard_move->mutex);
+
+    if(fenced)
+        ConditionVariableBroadcast(&g_shard_move->cv);
+
+    /* the copy counters are per move */
+    if(moved)
+    {
+        pg_atomic_write_u64(&g_shard_move->copy_tuples, 0);
+        pg_atomic_write_u64(&g_shard_move->copy_bytes, 0);
+    }
+
+    PG_RETURN_BOOL(fenced);
+}
+
+#define SHARD_MOVE_COLUMN_NUM 11
+Datum pg_stat_shard_move(PG_FUNCTION_ARGS)
+{
+    TupleDesc   tupdesc;
+    Datum       values[SHARD_MOVE_COLUMN_NUM];
+    bool        nulls[SHARD_MOVE_COLUMN_NUM];
+    ShardMoveState state;
+    StringInfoData shards;
+    uint64      copy_tuples;
+    uint64      copy_bytes;
+    double      copy_secs;
+    long        secs;
+    int         usecs;
+    int         sid;
+
+    if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+        elog(ERROR, "return type must be a row type");
+
+    SpinLockAcquire(&g_shard_move->mutex);
+    memcpy(&state, g_shard_move, offsetof(ShardMoveState, active));
+    SpinLockRelease(&g_shard_move->mutex);
+    copy_tuples = pg_atomic_read_u64(&g_shard_move->copy_tuples);
+    copy_bytes = pg_atomic_read_u64(&g_shard_move->copy_bytes);
+
+    MemSet(values, 0, sizeof(values));
+    MemSet(nulls,  0, sizeof(nulls));
+
+    if(state.fenced)
+    {
+        initStringInfo(&shards);
+        for(sid = 0; sid < MAX_SHARDS; sid++)
+        {
+            if(SHARD_MOVE_IS_FENCED(&state, sid))
+                appendStringInfo(&shards, "%s%d", shards.len > 0 ? "," : "", sid);
+        }
+        values[0] = CStringGetTextDatum(shards.data);
+        values[1] = Int32GetDatum(state.pid);
+        values[2] = TimestampTzGetDatum(state.fence_start);
+        values[3] = LSNGetDatum(state.fence_lsn);
+        nulls[3] = XLogRecPtrIsInvalid(state.fence_lsn);
+    }
+    else
+    {
+        nulls[0] = nulls[1] = nulls[2] = nulls[3] = true;
+    }
+
+    values[4] = Int64GetDatum((int64) pg_atomic_read_u64(&g_shard_move->fence_waits));
+    values[5] = Float8GetDatum(pg_atomic_read_u64(&g_shard_move->fence_wait_us) / 1000.0);
+    values[6] = Int64GetDatum((int64) pg_atomic_read_u64(&g_shard_move->fence_timeouts));
+    values[7] = Int64GetDatum((int64) copy_tuples);
+    values[8] = Int64GetDatum((int64) copy_bytes);
+
+    if(state.copy_start != 0)
+    {
+        TimestampDifference(state.copy_start, state.copy_last, &secs, &usecs);
+        copy_secs = secs + usecs / 1000000.0;
+        values[9] = TimestampTzGetDatum(state.copy_start);
+        values[10] = Float8GetDatum(copy_secs > 0 ? copy_bytes / copy_secs : 0);
+    }
+    else
+    {
+        nulls[9] = nulls[10] = true;
+    }
+
+    PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
@@ -66,12 +66,17 @@
 #include "storage/spin.h"
 #include "storage/lwlock.h"
 #include "storage/lockdefs.h"
+#include "storage/lmgr.h"
 #include "storage/proc.h"
+#include "storage/procarray.h"
 #include "utils/hsearch.h"
 #include "utils/lsyscache.h"
 #include "utils/fmgroids.h"
 #include "utils/rel.h"
 #include "utils/inval.h"
+#include "utils/tqual.h"
+#include "utils/snapmgr.h"
+#include "storage/bufmgr.h"
 #include "pgxc/shardmap.h"
 #include "pgxc/pgxc.h"
 #include "pgxc/pgxcnode.h"
@@ -90,6 +95,7 @@
 #include "access/genam.h"
 #include "access/hash.h"
 #include "catalog/pgxc_shard_map.h"
+#include "catalog/pg_shard_statistic.h"
 #include "catalog/pgxc_group.h"
 #include "catalog/indexing.h"
 #include "catalog/pgxc_class.h"
@@ -2223,11 +2229,176 @@ int32 EvaluateShardId(Oid type, bool isNull, Datum dvalue,
     return abs(hashvalue + sechashvalue) % MAX_SHARDS;
 }
 
+/* extents whose index entries are removed in one pass */
+#define SHARD_RELEASE_BATCH        64
+/* wait for the writes in progress to a shard being truncated, in us */
+#define SHARD_RELEASE_BUSY_WAIT    100000L
+/* then give up and delete the tuples left one by one */
+#define SHARD_RELEASE_MAX_RETRIES  50
+/* tries at the AccessExclusiveLock to release a batch of a hidden shard */
+#define SHARD_RELEASE_LOCK_RETRIES 10
+#define SHARD_RELEASE_LOCK_WAIT    10000L
+/* pages read per extent to estimate the size of a shard */
+#define SHARD_STAT_SAMPLE_PAGES    4
+
+/*
+ * Collect up to max extents on the scan list of the shard, except those in
+ * skip.
+ */
+static int
+collect_shard_extents(Relation rel, ShardID sid, List *skip, ExtentID *eids, int max)
+{
+    ExtentID eid;
+    int n = 0;
+
+    LockShard(rel, sid, AccessShareLock);
+    eid = GetShardScanHead(rel, sid);
+    while(ExtentIdIsValid(eid) && n < max)
+    {
+        if(!list_member_int(skip, eid))
+            eids[n++] = eid;
+        eid = ema_next_scan(rel, eid, false, NULL, NULL, NULL, NULL);
+    }
+    UnlockShard(rel, sid, AccessShareLock);
+
+    return n;
+}
+
+/*
+ * Give the storage of an extent back and detach it from its shard, the index
+ * entries of its tuples must be gone already.
+ */
+static void
+release_extent(Relation rel, ExtentID eid)
+{
+    RelationOpenSmgr(rel);
+#ifndef DISABLE_FALLOCATE
+    log_smgrdealloc(&rel->rd_node, eid, SMGR_DEALLOC_FREESTORAGE);
+    smgrdealloc(rel->rd_smgr, MAIN_FORKNUM, eid * PAGES_PER_EXTENTS);
+    if(trace_extent)
+    {
+        ereport(LOG,
+            (errmsg("[trace extent]Dealloc:[rel:%d/%d/%d]"
+                    "[eid:%d, flags=FREESTORAGE]",
+                    rel->rd_node.dbNode, rel->rd_node.spcNode, rel->rd_node.relNode,
+                    eid)));
+    }
+#else
+    log_smgrdealloc(&rel->rd_node, eid, SMGR_DEALLOC_REINIT);
+    reinit_extent_pages(rel, eid);
+
+    if(trace_extent)
+    {
+        ereport(LOG,
+            (errmsg("[trace extent]Dealloc:[rel:%d/%d/%d]"
+                    "[eid:%d, flags=REINIT_PAGE]",
+                    rel->rd_node.dbNode, rel->rd_node.spcNode, rel->rd_node.relNode,
+                    eid)));
+    }
+#endif        
+    /* 
+     * detach extent
+     */
+    FreeExtent(rel, eid);
+}
+
+/*
+ * Release the extents cleaned by truncate_shard_extents, the caller must hold
+ * AccessExclusiveLock on the relation.  Returns the number released.
+ */
+static int
+release_extents(Relation rel, ExtentID *eids, bool *released, int neids)
+{
+    ExtentID dropped[SHARD_RELEASE_BATCH];
+    int      ndropped = 0;
+    int      i;
+
+    for(i = 0; i < neids; i++)
+    {
+        if(!released[i])
+            continue;
+
+        release_extent(rel, eids[i]);
+        dropped[ndropped++] = eids[i];
+    }
+
+#ifndef DISABLE_FALLOCATE
+    /* as on redo, pages read before the storage was freed are stale now */
+    DropRelfileNodeExtentsBuffers(rel->rd_node, dropped, ndropped);
+#endif
+
+    return ndropped;
+}
+
+/*
+ * Wait for the transactions whose snapshots are older than limit_xmin, as
+ * CREATE INDEX CONCURRENTLY does before marking the index valid.
+ */
+static void
+wait_for_older_snapshots(TransactionId limit_xmin)
+{
+    VirtualTransactionId *old_snapshots;
+    int         n_old_snapshots;
+    int         i;
+
+    old_snapshots = GetCurrentVirtualXIDs(limit_xmin, true, false,
+                                          PROC_IS_AUTOVACUUM | PROC_IN_VACUUM,
+                                          &n_old_snapshots);
+
+    for(i = 0; i < n_old_snapshots; i++)
+    {
+        if(VirtualTransactionIdIsValid(old_snapshots[i]))
+            VirtualXactLock(old_snapshots[i], true);
+    }
+
+    pfree(old_snapshots);
+}
+
+/*
+ * Delete the tuples of the shard left in extents that could not be released.
+ */
+static int
+delete_shard_tuples(Oid reloid, ShardID sid, int pausetime)
+{
+    Relation     rel;
+    HeapScanDesc scan;
+    HeapTuple    tup;
+    Bitmapset   *shards = bms_make_singleton(sid);
+    int          tuples = 0;
+
+    StartTransactionCommand();
+    PushActiveSnapshot(GetTransactionSnapshot());
+
+    rel = heap_open(reloid, RowExclusiveLock);
+    scan = heap_beginscan_shards(rel, GetActiveSnapshot(), shards);
+    while((tup = heap_getnext(scan, ForwardScanDirection)) != NULL)
+    {
+        if(HeapTupleGetShardId(tup) != sid)
+            continue;
+
+        simple_heap_delete(rel, &tup->t_self);
+        if(++tuples % 2000 == 0 && pausetime > 0)
+            pg_usleep(pausetime);
+    }
+    heap_endscan(scan);
+    heap_close(rel, RowExclusiveLock);
+
+    PopActiveSnapshot();
+    CommitTransactionCommand();
+
+    bms_free(shards);
+    return tuples;
+}
+
 int
 TruncateShard(Oid reloid, ShardID sid, int pausetime)
 {
-    ExtentID eid = InvalidExtentID;
+    ExtentID eids[SHARD_RELEASE_BATCH];
+    bool     released[SHARD_RELEASE_BATCH];
     int    tuples = 0;
+    int    retries = 0;
+    bool   left = false;
+    TransactionId limit_xmin;
     Relation rel = NULL;
     Oid        toastoid = InvalidOid;
 
@@ -2253,96 +2424,107 @@ TruncateShard(Oid reloid, ShardID sid, int pausetime)
     RequestCheckpoint(CHECKPOINT_IMMEDIATE | CHECKPOINT_FORCE | CHECKPOINT_WAIT);
 
     /*
-     * step 3: start remove index items and recycle storage space
+     * step 3: wait for the snapshots taken before the barrier, they may still
+     * read the shard
      */
     StartTransactionCommand();
-    eid = RelOidGetShardScanHead(reloid, sid);
-    
-    while(ExtentIdIsValid(eid))
+    limit_xmin = GetTransactionSnapshot()->xmin;
+    wait_for_older_snapshots(limit_xmin);
+    CommitTransactionCommand();
+
+    /*
+     * step 4: remove index items and recycle storage space, a batch of
+     * extents at a time
+     */
+    for(;;)
     {
+        int neids;
+        int nreleased;
         int deleted_tuples = 0;
 
+        StartTransactionCommand();
         rel = heap_open(reloid, RowExclusiveLock);
+
+        neids = collect_shard_extents(rel, sid, NIL, eids, SHARD_RELEASE_BATCH);
+        if(neids == 0)
+        {
+            heap_close(rel, RowExclusiveLock);
+            CommitTransactionCommand();
+            break;
+        }
+
         /*
-         * delete this extent's tuples and their index entries
+         * delete the index entries of the extents' tuples
          */
-        truncate_extent_tuples(rel, 
-                                eid * PAGES_PER_EXTENTS, 
-                                (eid+1) * PAGES_PER_EXTENTS, 
-                                false, 
-                                &deleted_tuples);
+        nreleased = truncate_shard_extents(rel, eids, neids, limit_xmin,
+                                           released, &deleted_tuples);
         tuples += deleted_tuples;
 
-        /*
-         * end transaction 
-         */
         heap_close(rel, RowExclusiveLock);
         rel = NULL;
         CommitTransactionCommand();
 
-        /*
-         * start another transaction
-         */
-        StartTransactionCommand();
-
-        rel = heap_open(reloid, AccessExclusiveLock);
-
-        RelationOpenSmgr(rel);
-#ifndef DISABLE_FALLOCATE
-        log_smgrdealloc(&rel->rd_node, eid, SMGR_DEALLOC_FREESTORAGE);
-        smgrdealloc(rel->rd_smgr, MAIN_FORKNUM, eid * PAGES_PER_EXTENTS);
-        if(trace_extent)
+        if(nreleased == 0)
         {
-            ereport(LOG,
-                (errmsg("[trace extent]Dealloc:[rel:%d/%d/%d]"
-                        "[eid:%d, flags=FREESTORAGE]",
-                        rel->rd_node.dbNode, rel->rd_node.spcNode, rel->rd_node.relNode,
-                        eid)));
+            /*
+             * writes are barred, wait for the ones in progress to end, but
+             * not forever
+             */
+            if(++retries > SHARD_RELEASE_MAX_RETRIES)
+            {
+                left = true;
+                break;
+            }
+            CHECK_FOR_INTERRUPTS();
+            pg_usleep(SHARD_RELEASE_BUSY_WAIT);
+            continue;
         }
-#else
-        log_smgrdealloc(&rel->rd_node, eid, SMGR_DEALLOC_REINIT);
-        reinit_extent_pages(rel, eid);
+        retries = 0;
 
-        if(trace_extent)
-        {
-            ereport(LOG,
-                (errmsg("[trace extent]Dealloc:[rel:%d/%d/%d]"
-                        "[eid:%d, flags=REINIT_PAGE]",
-                        rel->rd_node.dbNode, rel->rd_node.spcNode, rel->rd_node.relNode,
-                        eid)));
-        }
-#endif        
-        /* 
-         * detach extent
+        /*
+         * release the extents in another transaction
          */
-        FreeExtent(rel, eid);
+        StartTransactionCommand();
+        rel = heap_open(reloid, AccessExclusiveLock);
+        (void) release_extents(rel, eids, released, neids);
         heap_close(rel, AccessExclusiveLock);
         rel = NULL;
-        
-        eid = RelOidGetShardScanHead(reloid, sid);
+        CommitTransactionCommand();
 
-        if(ExtentIdIsValid(eid) && pausetime > 0)
+        if(pausetime > 0)
             pg_usleep(pausetime);
     }
-    CommitTransactionCommand();
 
     StartTransactionCommand();
 
     /*
-     * step 4: invalidate buf page.
+     * step 5: invalidate buf page, unless extents of the shard are left:
+     * their pages may be dirty.
      */
 #ifndef DISABLE_FALLOCATE
-    rel = heap_open(reloid, AccessShareLock);    
-    DropRelfileNodeShardBuffers(rel->rd_node, sid);
-    heap_close(rel, AccessShareLock);
+    if(!left)
+    {
+        rel = heap_open(reloid, AccessExclusiveLock);
+        DropRelfileNodeShardBuffers(rel->rd_node, sid);
+        heap_close(rel, AccessExclusiveLock);
+    }
 #endif
 
     /*
-     * step 5: release barrier
+     * step 6: release barrier
      */
     RemoveShardBarrier();
     CommitTransactionCommand();
-    
+
+    /*
+     * step 7: delete the tuples left, their TOAST values go with them
+     */
+    if(left)
+    {
+        tuples += delete_shard_tuples(reloid, sid, pausetime);
+        return tuples;
+    }
+
     if(OidIsValid(toastoid))
     {
         TruncateShard(toastoid, sid, pausetime);
@@ -2350,6 +2532,256 @@ TruncateShard(Oid reloid, ShardID sid, int pausetime)
     
     return tuples;
 }
+
+/*
+ * Release the extents of a hidden shard within the current transaction,
+ * without deleting its tuples one by one.  Writes to the shard are barred
+ * meanwhile, extents still holding tuples of transactions in progress or
+ * tuples visible to snapshots older than ours are kept.  The TOAST relation is
+ * done too once no extent of the shard is left.
+ *
+ * The buffers of the extents are dropped under AccessExclusiveLock.  The
+ * caller holds a weaker lock already, and waiting for the upgrade could
+ * deadlock with another session doing the same, so the lock is only tried:
+ * when readers keep it from us, the batch is left to the caller too.
+ * Returns the number of extents left.
+ */
+int
+ReleaseShardExtents(Relation rel, ShardID sid, int pausetime, int64 *tuples)
+{
+    ExtentID eids[SHARD_RELEASE_BATCH];
+    bool     released[SHARD_RELEASE_BATCH];
+    List    *busy = NIL;
+    int      nbusy;
+    int      neids;
+    int      i;
+
+    if(!RelationHasExtent(rel))
+        return 0;
+
+    /* no VACUUM or DDL on the relation meanwhile */
+    LockRelation(rel, ShareUpdateExclusiveLock);
+
+    AddShardBarrier(rel->rd_node, sid, MyProcPid);
+
+    while((neids = collect_shard_extents(rel, sid, busy, eids, SHARD_RELEASE_BATCH)) > 0)
+    {
+        int deleted_tuples = 0;
+        int nreleased;
+        int retries = 0;
+
+        /* nobody may read the relation while its buffers are dropped */
+        while(!ConditionalLockRelation(rel, AccessExclusiveLock))
+        {
+            if(++retries > SHARD_RELEASE_LOCK_RETRIES)
+                break;
+            CHECK_FOR_INTERRUPTS();
+            pg_usleep(SHARD_RELEASE_LOCK_WAIT);
+        }
+
+        if(retries > SHARD_RELEASE_LOCK_RETRIES)
+        {
+            memset(released, 0, sizeof(released));
+        }
+        else
+        {
+            /*
+             * The shard was hidden before our snapshot was taken, extents
+             * whose tuples an older snapshot may still read are left to the
+             * caller.
+             */
+            nreleased = truncate_shard_extents(rel, eids, neids, TransactionXmin,
+                                               released, &deleted_tuples);
+            *tuples += deleted_tuples;
+
+            if(nreleased > 0)
+                (void) release_extents(rel, eids, released, neids);
+            UnlockRelation(rel, AccessExclusiveLock);
+        }
+
+        for(i = 0; i < neids; i++)
+        {
+            if(!released[i])
+                busy = lappend_int(busy, eids[i]);
+        }
+
+        if(pausetime > 0)
+            pg_usleep(pausetime * 1000L);
+    }
+
+    RemoveShardBarrier();
+
+    nbusy = list_length(busy);
+    list_free(busy);
+
+    if(nbusy == 0 && OidIsValid(rel->rd_rel->reltoastrelid))
+    {
+        Relation toastrel = heap_open(rel->rd_rel->reltoastrelid, RowExclusiveLock);
+
+        nbusy = ReleaseShardExtents(toastrel, sid, pausetime, tuples);
+        heap_close(toastrel, RowExclusiveLock);
+    }
+
+    return nbusy;
+}
+
+/*
+ * Estimate the pages and live tuples of an extent from a few of its pages,
+ * spread evenly over it.
+ */
+static void
+sample_shard_extent(Relation rel, ExtentID eid, BlockNumber nblocks,
+                    TransactionId OldestXmin, BufferAccessStrategy bstrategy,
+                    double *pages, double *tuples)
+{
+    BlockNumber from_blk = eid * PAGES_PER_EXTENTS;
+    BlockNumber extent_pages = Min(PAGES_PER_EXTENTS, nblocks - from_blk);
+    int         sampled = 0;
+    int         used = 0;
+    double      live = 0;
+    BlockNumber prev_blk = InvalidBlockNumber;
+    int         i;
+
+    for (i = 0; i < SHARD_STAT_SAMPLE_PAGES; i++)
+    {
+        BlockNumber blkno = from_blk +
+            (2 * i + 1) * extent_pages / (2 * SHARD_STAT_SAMPLE_PAGES);
+        Buffer      buf;
+        Page        page;
+        OffsetNumber offnum,
+                    maxoff;
+
+        /* the last extent of the relation may be shorter than the sample */
+        if (blkno == prev_blk)
+            continue;
+        prev_blk = blkno;
+
+        vacuum_delay_point();
+
+        buf = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL, bstrategy);
+        LockBuffer(buf, BUFFER_LOCK_SHARE);
+        page = BufferGetPage(buf);
+        sampled++;
+
+        if (PageIsNew(page) || PageIsEmpty(page))
+        {
+            UnlockReleaseBuffer(buf);
+            continue;
+        }
+
+        used++;
+        maxoff = PageGetMaxOffsetNumber(page);
+        for (offnum = FirstOffsetNumber;
+             offnum <= maxoff;
+             offnum = OffsetNumberNext(offnum))
+        {
+            ItemId        itemid = PageGetItemId(page, offnum);
+            HeapTupleData tuple;
+
+            if (!ItemIdIsNormal(itemid))
+                continue;
+
+            ItemPointerSet(&(tuple.t_self), blkno, offnum);
+            tuple.t_data = (HeapTupleHeader) PageGetItem(page, itemid);
+            tuple.t_len = ItemIdGetLength(itemid);
+            tuple.t_tableOid = RelationGetRelid(rel);
+
+            switch (HeapTupleSatisfiesVacuum(&tuple, OldestXmin, buf))
+            {
+                case HEAPTUPLE_LIVE:
+                case HEAPTUPLE_DELETE_IN_PROGRESS:
+                    live += 1;
+                    break;
+                default:
+                    break;
+            }
+        }
+        UnlockReleaseBuffer(buf);
+    }
+
+    if (sampled == 0 || used == 0)
+        return;
+
+    *pages += (double) extent_pages * used / sampled;
+    *tuples += (double) extent_pages * live / sampled;
+}
+
+/*
+ * Collect the pages and live tuples of each shard of this datanode for the
+ * planner: the extents of a shard are walked and each of them is sampled,
+ * which costs a few page reads per extent whatever the size of the shard.
+ * The result replaces the pg_shard_statistic entry of the relation.
+ */
+void
+AnalyzeShardStatistic(Relation rel)
+{
+    Bitmapset  *shards;
+    BufferAccessStrategy bstrategy;
+    TransactionId OldestXmin;
+    BlockNumber nblocks;
+    int32      *sids;
+    float4     *pages;
+    float4     *tuples;
+    int         nshards = 0;
+    int         sid = -1;
+
+    if (!RelationHasExtent(rel))
+        return;
+
+    /* only the shards this node owns, the others are not visible here */
+    shards = (Bitmapset *) palloc0(SHARD_TABLE_BITMAP_SIZE);
+    if (CopyShardGroups_DN(shards) == NULL)
+    {
+        pfree(shards);
+        return;
+    }
+
+    sids = (int32 *) palloc(MAX_SHARDS * sizeof(int32));
+    pages = (float4 *) palloc(MAX_SHARDS * sizeof(float4));
+    tuples = (float4 *) palloc(MAX_SHARDS * sizeof(float4));
+
+    bstrategy = GetAccessStrategy(BAS_BULKREAD);
+    OldestXmin = GetOldestXmin(rel, PROCARRAY_FLAGS_VACUUM);
+    nblocks = RelationGetNumberOfBlocks(rel);
+
+    while ((sid = bms_next_member(shards, sid)) >= 0)
+    {
+        ExtentID    eid;
+        double      shard_pages = 0;
+        double      shard_tuples = 0;
+        bool        hasextent = false;
+
+        LockShard(rel, sid, AccessShareLock);
+        eid = GetShardScanHead(rel, sid);
+        while (ExtentIdIsValid(eid))
+        {
+            /* extents are allocated before the relation is extended */
+            if (eid * PAGES_PER_EXTENTS < nblocks)
+                sample_shard_extent(rel, eid, nblocks, OldestXmin, bstrategy,
+                                    &shard_pages, &shard_tuples);
+            hasextent = true;
+            eid = ema_next_scan(rel, eid, false, NULL, NULL, NULL, NULL);
+        }
+        UnlockShard(rel, sid, AccessShareLock);
+
+        if (!hasextent)
+            continue;
+
+        sids[nshards] = sid;
+        pages[nshards] = (float4) shard_pages;
+        tuples[nshards] = (float4) shard_tuples;
+        nshards++;
+    }
+
+    StoreShardStatistic(RelationGetRelid(rel), nshards, sids, pages, tuples);
+
+    FreeAccessStrategy(bstrategy);
+    pfree(sids);
+    pfree(pages);
+    pfree(tuples);
+    pfree(shards);
+}
+
 void StatShardRelation(Oid relid, ShardStat *shardstat, int32 shardnumber)
 {
     int32        shardid;
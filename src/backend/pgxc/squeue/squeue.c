@@ -32,21 +32,34 @@
 #include "pgxc/pgxc.h"
 #include "pgxc/pgxcnode.h"
 #include "pgxc/squeue.h"
+#include "storage/ipc.h"
 #include "storage/latch.h"
 #include "storage/lwlock.h"
+#include "storage/proc.h"
 #include "storage/shmem.h"
 #include "utils/hsearch.h"
 #include "utils/resowner.h"
 #include "pgstat.h"
 #ifdef __TBASE__
 #include <pthread.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include "port/atomics.h"
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
 #include "storage/spin.h"
 #include "storage/s_lock.h"
 #include "miscadmin.h"
 #include "libpq/libpq-be.h"
 #include "utils/lsyscache.h"
+#include "utils/builtins.h"
+#include "funcapi.h"
 #include "storage/fd.h"
 #include "storage/shm_toc.h"
 #include "access/parallel.h"
@@ -73,6 +86,10 @@ int32 g_SndThreadBufferSize = 16;   /* in Kilo bytes. */
 int32 g_SndBatchSize        = 8;    /* in Kilo bytes. */
 int   consumer_connect_timeout = 128; /* in seconds */
 int   g_DisConsumer_timeout = 60; /* in minutes */
+bool  g_DataPumpShmChannel  = false;/* use shared memory for co-located consumers */
+int32 g_DataPumpShmChannelSize = 1024; /* in Kilo bytes. */
+int32 g_DataPumpBatchRows = 0;  /* max rows of a columnar batch, 0 to disable */
+int32 g_DataPumpCompressThreshold = -1; /* in bytes, -1 to disable */
 
 #define MAX_CURSOR_LEN      64 
 #define DATA_PUMP_SOCKET_DIR  "pg_datapump"   /* socket dir for data pump */
@@ -320,6 +337,91 @@ typedef struct
     volatile uint32    m_Border;     /* end of last tuple, so that we can send a complete tuple */
     volatile uint32    m_WrapAround; /* wrap around of the queue , for read only */
 }DataPumpBuf;
+
+/*
+ * Shared memory ring used in place of the socket when the consumer node runs
+ * on the same host as the producer. The producer announces the segment to the
+ * consumer with a 'h' message on the socket, afterwards the very same byte
+ * stream that would have been sent is put into the ring. Positions are
+ * monotonic byte counters, there is exactly one writer (sender thread) and
+ * one reader (remote backend), so barriers are enough to synchronize them.
+ *
+ * A consumer about to sleep on the socket sets consumer_waiting, the producer
+ * then rings the doorbell: a single 'w' byte on the otherwise idle socket.
+ * The consumer counts the doorbells it was rung, so that it can take exactly
+ * that many 'w' bytes off the socket, even after the channel is gone.
+ *
+ * A backend has at most DATAPUMP_SHM_MAX_CHANNELS channels at a time, named
+ * after the port and the PGPROC slot of the producer and the channel slot.
+ * The names of all backends of a server are known this way, so the ones left
+ * behind by a crashed backend are removed on restart without looking at how
+ * the system lays out the shm_open namespace. The pid and sequence number of
+ * the producer are put both into the 'h' message and into the segment, a
+ * consumer late to attach can not mistake a reused name for its channel.
+ */
+#define  DATAPUMP_SHM_MAGIC        0x44505348    /* "DPSH" */
+#define  DATAPUMP_SHM_NAME_LEN     64
+#define  DATAPUMP_SHM_PREFIX       "tbase_dp"
+#define  DATAPUMP_SHM_MAX_CHANNELS 64
+typedef struct
+{
+    uint32             magic;
+    uint32             size;         /* size of data area */
+    int32              pid;          /* producer */
+    uint32             seq;          /* channel number within the producer */
+    pg_atomic_uint64   write_pos;    /* total bytes written by producer */
+    pg_atomic_uint64   read_pos;     /* total bytes read by consumer */
+    pg_atomic_uint32   finished;     /* producer has put all the data */
+    pg_atomic_uint32   consumer_waiting; /* consumer sleeps on the socket */
+    char               data[FLEXIBLE_ARRAY_MEMBER];
+}DataPumpShmRing;
+
+struct DataPumpShmChannel
+{
+    char               name[DATAPUMP_SHM_NAME_LEN];
+    int                sock;         /* producer rings the doorbell here */
+    int                slot;         /* producer's channel slot */
+    bool               waiting;      /* consumer has set consumer_waiting */
+    uint32             doorbells;    /* doorbells rung, not yet reported */
+    Size               mapped_size;
+    DataPumpShmRing   *ring;
+};
+
+/* Channel slots of this backend in use, bit per slot. */
+static pg_atomic_uint64 DataPumpShmSlots;
+static pg_atomic_uint32 DataPumpShmSeq;
+static int              DataPumpShmProcNo = -1;
+
+/*
+ * Compression state of a node. All complete tuples in the buffer are deflated
+ * into one 'z' frame: int32 length, int32 length of the raw data, deflated
+ * data. The consumer puts the raw data back in place of the frame. Used by
+ * sender thread only, so malloc and no elog here.
+ */
+#define  DATAPUMP_FRAME_HEADER    9
+
+/* One more sender thread is started for every so many connected consumers. */
+#define  DATAPUMP_NODES_PER_THREAD  8
+/* Max time in ms to wait for a stalled consumer socket to become writable. */
+#define  DATAPUMP_POLL_TIMEOUT      10
+#define  DATAPUMP_POLL_EVENTS       64
+typedef struct
+{
+#ifdef HAVE_LIBZ
+    z_stream           stream;
+#endif
+    char              *frame;            /* frame being sent */
+    uint32             frame_size;       /* allocated size of frame */
+    uint32             frame_len;        /* length of frame, 0 if none */
+    uint32             frame_off;        /* bytes of frame already sent */
+    uint32             frame_raw;        /* buffer bytes covered by frame */
+    uint32             raw_left;         /* buffer bytes to send as they are */
+
+    size_t             raw_bytes;        /* bytes put into frames */
+    size_t             compressed_bytes; /* bytes of frames */
+    int64              compress_time;    /* in micro seconds */
+}DataPumpCompress;
+
 /*
 typedef enum  
 { 
@@ -349,10 +451,22 @@ typedef struct
     int32              errorno;   /* error number of system call */
     
     DataPumpBuf        *buffer;      /* buffer used to send data */
+    DataPumpShmChannel *shm_channel; /* not NULL if consumer is co-located */
+    struct DataPumpBatch *batch;     /* rows waiting to be sent as a columnar batch */
+    int32               compress_threshold; /* min bytes to compress, -1 if not compressed */
+    DataPumpCompress   *compress;        /* compression state, created by sender thread */
     
     uint32              last_offset;/* used for fast send */
     uint32              remaining_length;
 
+    bool                claimed;     /* served by a sender thread, protected by lock */
+    bool                stalled;     /* socket is full, protected by lock */
+    bool                polled;      /* socket is in the epoll set of the sender */
+    uint32              max_depth;   /* max pending bytes seen by sender threads */
+    TimestampTz         stall_begin; /* when the socket got full, 0 if not stalled */
+    size_t              stall_count; /* number of times the socket got full */
+    int64               stall_time;  /* in micro seconds */
+
     
     size_t                ntuples;     /* counter for tuple */
     size_t              ntuples_put; /* number of tuples put into tuplestore */
@@ -362,23 +476,40 @@ typedef struct
     size_t                sleep_count; /* counter sleep */
 }DataPumpNodeControl;
 
+/*
+ * Counters of the sender controls that served a consumer node, summed up when
+ * the controls are destroyed. Indexed by node index, shown by the
+ * pg_stat_datapump view.
+ */
 typedef struct
 {
-    /* Nodes control of the cursor. */
-    DataPumpNodeControl   *nodes;
-    
-    /* Nodes range of this thread. */
-    int32                node_base; /* include */        
-    int32              node_end;  /* exclude */
-    int32              node_num;  /* total node number */
-    
+    uint64             senders;          /* sender controls that served the node */
+    uint64             max_depth;        /* max pending bytes seen by sender threads */
+    uint64             stall_count;      /* number of times the socket got full */
+    uint64             stall_time;       /* in micro seconds */
+    uint64             raw_bytes;        /* bytes put into compressed frames */
+    uint64             compressed_bytes; /* bytes of compressed frames */
+    uint64             compress_time;    /* in micro seconds */
+}DataPumpNodeStat;
+
+typedef struct
+{
+    slock_t            mutex;
+    DataPumpNodeStat   nodes[TBASE_MAX_DATANODE_NUMBER];
+}DataPumpStatShmem;
+
+static DataPumpStatShmem *DataPumpStats = NULL;
+
+typedef struct
+{
+    /* Sender control of the cursor, nodes are shared by all the threads. */
+    struct DataPumpSenderControl *sender;
     
     bool               thread_need_quit; /* quit flag */
     bool               error;
     bool               quit_status;         /* succeessful quit or not */
     
     bool               thread_running;     /* running flag */
-    ThreadSema         send_sem;         /* used to wait for data */
     ThreadSema         quit_sem;         /* used to wait for thread quit */
 }DataPumpThreadControl;
 
@@ -402,15 +533,47 @@ typedef struct DataPumpSenderControl
     int32                 node_num;       /* number of node to send data */
     DataPumpNodeControl   *nodes;         /* sending status for nodes of this cursor */
 
-    int32                 thread_num;     /* number of thread to send data */
+    int32                 thread_num;     /* max number of thread to send data */
+    int32                 thread_started; /* number of threads started */
     DataPumpThreadControl *thread_control;/* thread control of the sending threads */
+    ThreadSema            send_sem;       /* sender threads wait here for data */
+    pg_atomic_uint32      active_nodes;   /* number of consumers connected */
+    int                   epoll_fd;       /* sockets of stalled nodes */
 
     ConvertControl        convert_control;/* control info of thread convert */
 
     TupleTableSlot        *temp_slot;     /* temp slot used to put_tuplestore */
     int32                  tuple_len;      /* MAX tuplelen of sent tuple */
+    int32                  batch_rows;     /* max rows of a columnar batch, 0 if not usable, -1 unknown */
 }DataPumpSenderControl;
 
+/*
+ * Columnar batch of rows for one consumer. Used when all the columns are of
+ * fixed width and passed by value, so the values can be copied as they are
+ * instead of going through the type output and input functions. The batch is
+ * sent as the body of a 'D' message, so the consumer buffers it like any
+ * other data row; it is told apart by a negative column count:
+ *
+ *   int16  DATAROW_BATCH_MARKER
+ *   int16  number of columns
+ *   int32  number of rows
+ *   int16  attlen of each column
+ *   for each column: null bitmap of all rows, then the non-null values
+ *
+ * Counts and lengths are in network byte order, values are in the native
+ * format, the nodes of a cluster share the same architecture.
+ */
+typedef struct DataPumpBatch
+{
+    int32          natts;
+    int32          nrows;
+    int32          maxrows;
+    int16         *attlen;
+    Datum         *values;      /* maxrows * natts, row by row */
+    bool          *isnull;
+    StringInfoData buf;         /* encoded message body */
+}DataPumpBatch;
+
 /*
   *
   * This part is used for parallel workers to send tuples directly without gather/gatherMerge.
@@ -464,6 +627,7 @@ typedef struct ParallelSendNodeControl
 
     int32                   current_buffer;     /* which buffer to be sent */
     ParallelSendDataQueue   **buffer;            /* buffer used to send data */
+    DataPumpShmChannel      *shm_channel;       /* not NULL if consumer is co-located */
     
     uint32                  last_offset;        /* used for fast send */
     uint32                  remaining_length;
@@ -599,11 +763,24 @@ static void  PutData(DataPumpBuf *buf, char *data, uint32 len);
 static DataPumpBuf *BuildDataPumpBuf(void);
 static void InitDataPumpNodeControl(int32 nodeindex, DataPumpNodeControl *control);
 static void DataPumpCleanThread(DataPumpSenderControl *sender);
-static bool DataPumpFlushAllData(DataPumpNodeControl  *nodes, DataPumpThreadControl* control);
-static void DataPumpSendLoop(DataPumpNodeControl  *nodes, DataPumpThreadControl* control);
+static bool DataPumpFlushAllData(DataPumpSenderControl *sender, DataPumpThreadControl* control);
+static void DataPumpSendLoop(DataPumpSenderControl *sender, DataPumpThreadControl* control);
+static DataPumpNodeControl *DataPumpClaimNode(DataPumpSenderControl *sender, bool flush, int32 *stalled);
+static void DataPumpReleaseNode(DataPumpNodeControl *node);
+static bool DataPumpSendNode(DataPumpSenderControl *sender, DataPumpNodeControl *node, bool flush);
+static void DataPumpNodeStalled(DataPumpSenderControl *sender, DataPumpNodeControl *node);
+static int  DataPumpPollStalled(DataPumpSenderControl *sender, int timeout);
+static char *DataPumpGetSendData(DataPumpNodeControl *node, uint32 *len);
+static void DataPumpSendDataDone(DataPumpNodeControl *node, uint32 len);
+#ifdef HAVE_LIBZ
+static DataPumpCompress *DataPumpCompressCreate(void);
+static void DataPumpCompressDestroy(DataPumpCompress *compress);
+static bool DataPumpCompressFrame(DataPumpCompress *compress, char *data1, uint32 len1, char *data2, uint32 len2);
+#endif
 static void DestoryDataPumpBuf(DataPumpBuf *buffer);
-static void InitDataPumpThreadControl(DataPumpThreadControl *control, DataPumpNodeControl *nodes, int32 base, int32 end, int32 total);
+static void InitDataPumpThreadControl(DataPumpThreadControl *control, DataPumpSenderControl *sender);
 static bool CreateSenderThread(DataPumpSenderControl *sender);
+static bool StartSenderThread(DataPumpSenderControl *sender);
 #define DATA_PUMP_PREFIX "DataPump "
 
 static int convert_connect(char *sqname);
@@ -615,10 +792,25 @@ static void *ConvertThreadMain(void *arg);
 static bool ConvertDone(ConvertControl *convert);
 static int32 DataPumpNodeReadyForSend(void *sndctl, int32 nodeindex, int32 nodeId);
 static int32 DataPumpSendToNode(void *sndctl, char *data, size_t len, int32 nodeindex);
+static int32 DataPumpBatchRows(DataPumpSenderControl *sender, TupleDesc tdesc);
+static bool DataPumpBatchAppend(DataPumpSenderControl *sender, int32 nodeindex, TupleTableSlot *slot, int32 maxrows);
+static void DataPumpBatchEncode(DataPumpBatch *batch);
+static void DataPumpBatchFlush(SharedQueue squeue, int32 consumerIdx, TupleDesc tdesc, Tuplestorestate **tuplestore, MemoryContext tmpcxt);
+static void DataPumpCreateTupleStore(SharedQueue squeue, int32 consumerIdx, Tuplestorestate **tuplestore, MemoryContext tmpcxt);
 static bool DataPumpTupleStoreDump(void *sndctl, int32 nodeindex, int32 nodeId,
                                              TupleTableSlot *tmpslot, 
                                              Tuplestorestate *tuplestore);
 static bool socket_set_nonblocking(int fd, bool non_block);
+static bool DataPumpSocketIsLocal(int sock);
+static DataPumpShmChannel *DataPumpShmChannelCreate(int sock);
+static int  DataPumpShmChannelWrite(DataPumpShmChannel *channel, char *data, int32 len);
+static void DataPumpShmChannelFinish(DataPumpShmChannel *channel);
+static void DataPumpShmChannelDestroy(DataPumpShmChannel *channel);
+static void DataPumpShmChannelKick(DataPumpShmChannel *channel);
+static void DataPumpShmChannelName(char *name, int procno, int slot);
+static void DataPumpStatAccum(DataPumpNodeControl *node);
+static void DataPumpShmChannelAtExit(int code, Datum arg);
+static void DataPumpShmChannelRegisterExit(void);
 static void DataPumpWakeupSender(void *sndctl, int32 nodeindex);
 static bool ExecFastSendDatarow(TupleTableSlot *slot, void *sndctl, int32 nodeindex, MemoryContext tmpcxt);
 static int  ReturnSpace(DataPumpBuf *buf, uint32 offset);
@@ -711,6 +903,14 @@ SharedQueuesInit(void)
 
         DisConsumerHash = ShmemInitHash("Disconnect Consumers", NUM_SQUEUES,
                              NUM_SQUEUES, &ctl, flags);
+
+        DataPumpStats = ShmemInitStruct("Data Pump Statistics",
+                                        sizeof(DataPumpStatShmem), &found);
+        if (!found)
+        {
+            SpinLockInit(&DataPumpStats->mutex);
+            MemSet(DataPumpStats->nodes, 0, sizeof(DataPumpStats->nodes));
+        }
     }
 #endif
 
@@ -782,6 +982,8 @@ SharedQueueShmemSize(void)
     {
 	    /* Disconnect Consumers */
         sqs_size = add_size(sqs_size, hash_estimate_size(NUM_SQUEUES, sizeof(DisConsumer)));
+        /* Data Pump Statistics */
+        sqs_size = add_size(sqs_size, sizeof(DataPumpStatShmem));
     }
 #endif
 
@@ -2660,6 +2862,13 @@ SharedQueueFinish(SharedQueue squeue, TupleDesc tupDesc,
 SEND_DATA:
             {
                 DataPumpSenderControl *sender   = (DataPumpSenderControl*)squeue->sender;
+
+                /* Send out the rows left in columnar batches. */
+                for (i = 0; i < squeue->sq_nconsumers; i++)
+                {
+                    DataPumpBatchFlush(squeue, i, tupDesc, &tuplestore[i], NULL);
+                }
+
                 do
                 {
                     unfinish_tuplestore = 0;
@@ -4002,44 +4211,62 @@ void InitDataPumpNodeControl(int32 nodeindex, DataPumpNodeControl *control)
     control->status         = DataPumpSndStatus_no_socket;
     spinlock_init(&control->lock);
     control->buffer      = BuildDataPumpBuf();
+    control->shm_channel = NULL;
+    control->compress_threshold = g_DataPumpCompressThreshold;
+    DataPumpShmChannelRegisterExit();
+    control->compress    = NULL;
     control->ntuples_get = 0;
     control->ntuples_put = 0;
+    control->claimed     = false;
+    control->stalled     = false;
+    control->polled      = false;
+    control->max_depth   = 0;
+    control->stall_begin = 0;
+    control->stall_count = 0;
+    control->stall_time  = 0;
 }
 /*
  * Build data pump thread control.
  */
-void InitDataPumpThreadControl(DataPumpThreadControl *control, DataPumpNodeControl *nodes, int32 base, int32 end, int32 total)
+void InitDataPumpThreadControl(DataPumpThreadControl *control, DataPumpSenderControl *sender)
 {
-    control->nodes               = nodes;
-    control->node_base         = base;
-    control->node_end          = end;
-    control->node_num          = total;  
+    control->sender            = sender;
 
     control->thread_need_quit  = false;
     control->thread_running    = false;
-    ThreadSemaInit(&control->send_sem, 0);
     ThreadSemaInit(&control->quit_sem, 0);
 }
 /*
- * Create data pump sender thread.
+ * Start one more sender thread, the threads pick nodes to serve by themselves.
+ */
+bool StartSenderThread(DataPumpSenderControl *sender)
+{
+    DataPumpThreadControl *thread = NULL;
+
+    if (sender->thread_started >= sender->thread_num)
+    {
+        return false;
+    }
+
+    thread = &sender->thread_control[sender->thread_started];
+    if (CreateThread(DataPumpSenderThread, (void *)thread, MT_THR_DETACHED))
+    {
+        return false;
+    }
+    /* Set running status for the thread. */
+    thread->thread_running = true;
+    sender->thread_started++;
+    return true;
+}
+/*
+ * Create data pump sender thread, more are started as consumers connect.
  */
 bool CreateSenderThread(DataPumpSenderControl *sender)
 {
     bool succeed = true;
-    int  i       = 0;
     int  ret     = 0;
     
-    for (i = 0; i < sender->thread_num; i++)
-    {        
-        ret = CreateThread(DataPumpSenderThread, (void *)&sender->thread_control[i], MT_THR_DETACHED);
-        if (ret)
-        {
-            succeed = false;
-            break;
-        }
-        /* Set running status for the thread. */
-        sender->thread_control[i].thread_running = true;
-    }
+    succeed = StartSenderThread(sender);
 
     if (succeed)
     {
@@ -4065,12 +4292,10 @@ DataPumpSender BuildDataPumpSenderControl(SharedQueue sq)
 {
     bool      succeed = false;
     int       i    = 0;
-    int32     base = 0;
-    int32     step = 0;    
-    int32     end  = 0;    
     DataPumpSenderControl *sender_control = NULL;
 
     sender_control = palloc0(sizeof(DataPumpSenderControl));
+    sender_control->batch_rows = -1;
     sender_control->node_num = sq->sq_nconsumers;
     sender_control->nodes    = (DataPumpNodeControl*)palloc0(sizeof(DataPumpNodeControl) * sender_control->node_num);
 
@@ -4081,26 +4306,22 @@ DataPumpSender BuildDataPumpSenderControl(SharedQueue sq)
         InitDataPumpNodeControl(cstate->cs_node, &sender_control->nodes[i]);
     }
 
-    /* Use the minimal one as thread number. */
+    /* Use the minimal one as max thread number. */
     sender_control->thread_num = g_SndThreadNum > sq->sq_nconsumers ? sq->sq_nconsumers : g_SndThreadNum;
     sender_control->thread_control = (DataPumpThreadControl*)palloc0(sizeof(DataPumpThreadControl) * sender_control->thread_num);
-
-    base = 0;
-    end  = 0;
-    step = DIVIDE_UP(sender_control->node_num, sender_control->thread_num);
     for (i = 0; i < sender_control->thread_num; i++)
     {
-        if (i < sender_control->thread_num  - 1)
-        {
-            base = end;
-            end  = base + step;
-        }
-        else
-        {
-            base = end;
-            end = sender_control->node_num;
-        }
-        InitDataPumpThreadControl(&sender_control->thread_control[i], sender_control->nodes, base, end, sender_control->node_num);
+        InitDataPumpThreadControl(&sender_control->thread_control[i], sender_control);
+    }
+    sender_control->thread_started = 0;
+    ThreadSemaInit(&sender_control->send_sem, 0);
+    pg_atomic_init_u32(&sender_control->active_nodes, 0);
+
+    /* Without epoll, stalled nodes are simply retried. */
+    sender_control->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (sender_control->epoll_fd < 0)
+    {
+        elog(LOG, DATA_PUMP_PREFIX"could not create epoll set, errmsg:%s", strerror(errno));
     }
 
     /* set sqname and max connection */
@@ -4119,11 +4340,42 @@ DataPumpSender BuildDataPumpSenderControl(SharedQueue sq)
     
     sq->sender = sender_control;
 
-    elog(DEBUG1, "Squeue:%s(Pid:%d), create %d sender, 1 convert.", sq->sq_key, MyProcPid, sender_control->thread_num);
+    elog(DEBUG1, "Squeue:%s(Pid:%d), create %d sender, 1 convert.", sq->sq_key, MyProcPid, sender_control->thread_started);
     
     return sender_control;
 }
 
+/*
+ * Add the counters of a consumer node to the ones shown by pg_stat_datapump.
+ */
+static void
+DataPumpStatAccum(DataPumpNodeControl *node)
+{
+    DataPumpNodeStat *stat;
+
+    if (NULL == DataPumpStats || node->nodeindex < 0 ||
+        node->nodeindex >= TBASE_MAX_DATANODE_NUMBER || 0 == node->max_depth)
+    {
+        return;
+    }
+
+    stat = &DataPumpStats->nodes[node->nodeindex];
+    SpinLockAcquire(&DataPumpStats->mutex);
+    stat->senders++;
+    stat->max_depth    = Max(stat->max_depth, node->max_depth);
+    stat->stall_count += node->stall_count;
+    stat->stall_time  += node->stall_time;
+#ifdef HAVE_LIBZ
+    if (node->compress)
+    {
+        stat->raw_bytes        += node->compress->raw_bytes;
+        stat->compressed_bytes += node->compress->compressed_bytes;
+        stat->compress_time    += node->compress->compress_time;
+    }
+#endif
+    SpinLockRelease(&DataPumpStats->mutex);
+}
+
 void DestoryDataPumpSenderControl (void* sndctl, int nodeid)
 {
     int  i         = 0;
@@ -4140,12 +4392,64 @@ void DestoryDataPumpSenderControl (void* sndctl, int nodeid)
         sender->thread_control = NULL;
     }
 
+    if (sender->epoll_fd >= 0)
+    {
+        close(sender->epoll_fd);
+        sender->epoll_fd = -1;
+    }
+
     if (sender->nodes)
     {
         for (i = 0; i < sender->node_num; i++)
         {        
+            DataPumpStatAccum(&sender->nodes[i]);
+
+            if (enable_statistic && sender->nodes[i].max_depth)
+            {
+                elog(LOG, "Squeue %s node %d: max queue depth %u bytes, stalled %zu times for %ld us",
+                          sender->convert_control.sqname, sender->nodes[i].nodeindex,
+                          sender->nodes[i].max_depth, sender->nodes[i].stall_count,
+                          (long) sender->nodes[i].stall_time);
+            }
+
             DestoryDataPumpBuf(sender->nodes[i].buffer);
 
+            if (sender->nodes[i].shm_channel)
+            {
+                DataPumpShmChannelDestroy(sender->nodes[i].shm_channel);
+                sender->nodes[i].shm_channel = NULL;
+            }
+
+#ifdef HAVE_LIBZ
+            if (sender->nodes[i].compress)
+            {
+                DataPumpCompress *compress = sender->nodes[i].compress;
+
+                if (enable_statistic && compress->compressed_bytes)
+                {
+                    elog(LOG, "Squeue %s node %d: compressed %zu bytes into %zu bytes, ratio %.2f, compress time %ld us",
+                              sender->convert_control.sqname, sender->nodes[i].nodeindex,
+                              compress->raw_bytes, compress->compressed_bytes,
+                              (double) compress->raw_bytes / compress->compressed_bytes,
+                              (long) compress->compress_time);
+                }
+                DataPumpCompressDestroy(compress);
+                sender->nodes[i].compress = NULL;
+            }
+#endif
+
+            if (sender->nodes[i].batch)
+            {
+                DataPumpBatch *batch = sender->nodes[i].batch;
+
+                pfree(batch->attlen);
+                pfree(batch->values);
+                pfree(batch->isnull);
+                pfree(batch->buf.data);
+                pfree(batch);
+                sender->nodes[i].batch = NULL;
+            }
+
             if (sender->nodes[i].sock != NO_SOCKET && sender->nodes[i].nodeindex != nodeid)
             {
                 close(sender->nodes[i].sock);
@@ -4165,270 +4469,1204 @@ void DestoryDataPumpBuf(DataPumpBuf *buffer)
     pfree(buffer->m_buf);
 }
 
-void DataPumpSendLoop(DataPumpNodeControl  *nodes, DataPumpThreadControl* control)
-{// #lizard forgives
-    int32  stuck_nodes = 0;
-    int32  reason      = 0;
-    int32  status      = 0;
-    int32  nodeindex   = 0;
-    int    ret         = 0;
-    uint32 len         = 0;
-    char   *data       = NULL;
-    
-    /* Loop to send data. */
-    do 
+#ifdef HAVE_LIBZ
+/* Create compression state of the node, NULL if out of memory. */
+static DataPumpCompress *
+DataPumpCompressCreate(void)
+{
+    DataPumpCompress *compress = (DataPumpCompress *) malloc(sizeof(DataPumpCompress));
+
+    if (NULL == compress)
     {
-        stuck_nodes = 0;
-        for (nodeindex = control->node_base; nodeindex < control->node_end && nodeindex < control->node_num; nodeindex++)
-        {
-            spinlock_lock(&nodes[nodeindex].lock);
-            status = nodes[nodeindex].status;
-            spinlock_unlock(&nodes[nodeindex].lock);
-            
-            /* status is valid */
-            if (status >= DataPumpSndStatus_set_socket && status  <= DataPumpSndStatus_data_sending)
-            {
-                do 
-                {
-                    data = GetData(nodes[nodeindex].buffer, &len);
-                    if (data)
-                    {
-                        ret = DataPumpRawSendData(&nodes[nodeindex], nodes[nodeindex].sock, data, len, &reason);                
-                        if (EOF == ret)
-                        {
-                            /* We got error. */
-                            spinlock_lock(&nodes[nodeindex].lock);
-                            nodes[nodeindex].status  = DataPumpSndStatus_error;
-                            nodes[nodeindex].errorno = errno;
-                            spinlock_unlock(&nodes[nodeindex].lock);
-                            break;
-                        }                    
-                        
-                        /* increase data offset */
-                        IncDataOff(nodes[nodeindex].buffer, ret);    
-                        
-                        /* Socket got stuck. */
-                        if (reason == EAGAIN || reason == EWOULDBLOCK)
-                        {
-                            len = DataSize(nodes[nodeindex].buffer);
-                            if (len > 0)
-                            {
-                                /* Break sending to the node, switch to the next one. */
-                                stuck_nodes++;
-                                break;
-                            }
-                        }
-                    }
-                    else
-                    {
-                        /* No more complete tuples. */
-                        break;
-                    }
-                    len = DataSize(nodes[nodeindex].buffer);
+        return NULL;
+    }
 
-                    /* Get status. */
-                    spinlock_lock(&nodes[nodeindex].lock);
-                    status = nodes[nodeindex].status;
-                    spinlock_unlock(&nodes[nodeindex].lock);
-                }while ((status >= DataPumpSndStatus_set_socket && status  <= DataPumpSndStatus_data_sending) && len);
-            }
-        }
-    }while(stuck_nodes);
+    memset(compress, 0, sizeof(DataPumpCompress));
+    if (deflateInit(&compress->stream, Z_BEST_SPEED) != Z_OK)
+    {
+        free(compress);
+        return NULL;
+    }
+    return compress;
+}
+
+static void
+DataPumpCompressDestroy(DataPumpCompress *compress)
+{
+    deflateEnd(&compress->stream);
+    if (compress->frame)
+    {
+        free(compress->frame);
+    }
+    free(compress);
 }
+
 /*
- * Ensure all data flush out when cursor is done.
+ * Deflate the data, which may be split by the wrap around of the buffer, into
+ * a frame. Return false if the data should better go out as it is.
  */
-bool DataPumpFlushAllData(DataPumpNodeControl  *nodes, DataPumpThreadControl* control)
-{// #lizard forgives
-    int32  stuck_nodes = 0;
-    int32  reason      = 0;
-    int32  status    = 0;
-    bool   succeed   = true;
-    int32  nodeindex = 0;
-    int    ret       = 0;
-    uint32 len       = 0;
-    char   *data     = NULL;
-    
-    /* Loop to send data. */
-    do
+static bool
+DataPumpCompressFrame(DataPumpCompress *compress, char *data1, uint32 len1, char *data2, uint32 len2)
+{
+    int         ret;
+    uint32      n32;
+    uint32      clen;
+    uint32      total = len1 + len2;
+    uLong       bound;
+    TimestampTz begin = GetCurrentTimestamp();
+
+    bound = deflateBound(&compress->stream, total) + DATAPUMP_FRAME_HEADER;
+    if (bound > compress->frame_size)
     {
-        stuck_nodes = 0;
-        for (nodeindex = control->node_base; nodeindex < control->node_end && nodeindex < control->node_num; nodeindex++)
+        char *frame = (char *) realloc(compress->frame, bound);
+
+        if (NULL == frame)
         {
-            spinlock_lock(&nodes[nodeindex].lock);
-            status = nodes[nodeindex].status;
-            spinlock_unlock(&nodes[nodeindex].lock);
-            
-            /* status is valid */
-            if (status >= DataPumpSndStatus_set_socket && status  <= DataPumpSndStatus_data_sending)
-            {
-                do 
-                {
-                    /* Data left in buffer, send them all. */
-                    if (nodes[nodeindex].buffer->m_Tail != nodes[nodeindex].buffer->m_Head)
-                    {
-                        nodes[nodeindex].buffer->m_Border = nodes[nodeindex].buffer->m_Head;
-                    }
-                    
-                    data = GetData(nodes[nodeindex].buffer, &len);
-                    if (data)
-                    {
-                        ret = DataPumpRawSendData(&nodes[nodeindex], nodes[nodeindex].sock, data, len, &reason);                
-                        if (EOF == ret)
-                        {
-                            /* We got error. */
-                            spinlock_lock(&nodes[nodeindex].lock);
-                            nodes[nodeindex].status  = DataPumpSndStatus_error;
-                            nodes[nodeindex].errorno = errno;
-                            spinlock_unlock(&nodes[nodeindex].lock);
-                            succeed = false;
-                            break;
-                        }
-                        
-                        /* increase data offset */
-                        IncDataOff(nodes[nodeindex].buffer, ret);
+            return false;
+        }
+        compress->frame      = frame;
+        compress->frame_size = bound;
+    }
 
-                        /* Socket got stuck. */
-                        if (reason == EAGAIN || reason == EWOULDBLOCK)
-                        {
-                            len = DataSize(nodes[nodeindex].buffer);
-                            if (len > 0)
-                            {
-                                /* Break sending to the node, switch to the next one. */
-                                stuck_nodes++;
-                                break;
-                            }
-                        }
-                    }
-                    else
-                    {
-                        /* No more complete tuples, it is vary wired situation to get into the branch. */
-                        if (DataSize(nodes[nodeindex].buffer))
-                        {
-                            spinlock_lock(&nodes[nodeindex].lock);
-                            nodes[nodeindex].status  = DataPumpSndStatus_incomplete_data;
-                            nodes[nodeindex].errorno = errno;
-                            spinlock_unlock(&nodes[nodeindex].lock);
-                            succeed = false;
-                        }    
-                        else
-                        {
-                            /* Job done, set status. */
-                            spinlock_lock(&nodes[nodeindex].lock);
-                            nodes[nodeindex].status  = DataPumpSndStatus_done;
-                            spinlock_unlock(&nodes[nodeindex].lock);
-                        }
-                        break;
-                    }
-                    
-                    /* Get status. */
-                    spinlock_lock(&nodes[nodeindex].lock);
-                    status = nodes[nodeindex].status;
-                    spinlock_unlock(&nodes[nodeindex].lock);
-                }while ((status >= DataPumpSndStatus_set_socket && status  <= DataPumpSndStatus_data_sending));
-            }
+    deflateReset(&compress->stream);
+    compress->stream.next_out  = (Bytef *) compress->frame + DATAPUMP_FRAME_HEADER;
+    compress->stream.avail_out = compress->frame_size - DATAPUMP_FRAME_HEADER;
+    compress->stream.next_in   = (Bytef *) data1;
+    compress->stream.avail_in  = len1;
+    if (len2)
+    {
+        ret = deflate(&compress->stream, Z_NO_FLUSH);
+        if (ret != Z_OK)
+        {
+            return false;
         }
-    }while(stuck_nodes);
-    return succeed;
+        compress->stream.next_in  = (Bytef *) data2;
+        compress->stream.avail_in = len2;
+    }
+    ret = deflate(&compress->stream, Z_FINISH);
+    compress->compress_time += GetCurrentTimestamp() - begin;
+    if (ret != Z_STREAM_END)
+    {
+        return false;
+    }
+
+    /* Not worth it. */
+    clen = compress->stream.total_out;
+    if (clen + DATAPUMP_FRAME_HEADER >= total)
+    {
+        return false;
+    }
+
+    compress->frame[0] = 'z';
+    n32 = htonl(clen + 8);
+    memcpy(compress->frame + 1, &n32, 4);
+    n32 = htonl(total);
+    memcpy(compress->frame + 5, &n32, 4);
+
+    compress->frame_len  = clen + DATAPUMP_FRAME_HEADER;
+    compress->frame_off  = 0;
+    compress->frame_raw  = total;
+    compress->raw_bytes        += total;
+    compress->compressed_bytes += compress->frame_len;
+    return true;
 }
+#endif
+
 /*
- * Datapump sender thread.
+ * Get data to send to the node. When compression is used for the node, all
+ * complete tuples in the buffer are deflated into one frame which is returned
+ * instead, unless they are below the threshold.
  */
-void *DataPumpSenderThread(void *arg)
+static char *
+DataPumpGetSendData(DataPumpNodeControl *node, uint32 *len)
 {
-    DataPumpNodeControl  * nodes   = NULL;
-    DataPumpThreadControl* thread  = NULL;
+#ifdef HAVE_LIBZ
+    uint32            border   = 0;
+    uint32            tail     = 0;
+    uint32            len1     = 0;
+    uint32            len2     = 0;
+    DataPumpBuf      *buf      = node->buffer;
+    DataPumpCompress *compress = node->compress;
 
-    thread = (DataPumpThreadControl*)arg;
-    nodes  =  thread->nodes;
-    ThreadSigmask();
-    thread->thread_running = true;
-    while (1)
+    if (node->compress_threshold < 0 || node->shm_channel)
     {
-        /* Waiting for orders. */
-        ThreadSemaDown(&thread->send_sem);
+        return GetData(buf, len);
+    }
 
-        /* error, quit directly */
-        if (thread->error)
-            break;
-        /* We have been told to quit. */
-        if (thread->thread_need_quit)
+    if (NULL == compress)
+    {
+        compress = DataPumpCompressCreate();
+        if (NULL == compress)
         {
-            thread->quit_status = DataPumpFlushAllData(nodes, thread);
-            break;
+            node->compress_threshold = -1;
+            return GetData(buf, len);
         }
-        
-        /* Loop to send data. */
-        DataPumpSendLoop(nodes, thread);
-        
+        node->compress = compress;
     }
-    thread->thread_running = false;
-    /* Tell main thread quit is done. */
-    ThreadSemaUp(&thread->quit_sem);
-    return NULL;
-}
 
-/* check node status and report error if node is abnormal */
-static bool DataPumpNodeCheck(void *sndctl, int32 nodeindex)
-{
-    DataPumpSenderControl *sender   = NULL;
-    DataPumpNodeControl   *node     = NULL;
+    /* Rest of the frame. */
+    if (compress->frame_len)
+    {
+        *len = compress->frame_len - compress->frame_off;
+        return compress->frame + compress->frame_off;
+    }
 
-    sender = (DataPumpSenderControl*)sndctl;
-    
-    node = &sender->nodes[nodeindex];
+    spinlock_lock(&(buf->pointerlock));
+    border = buf->m_Border;
+    tail   = buf->m_Tail;
+    spinlock_unlock(&(buf->pointerlock));
+
+    if (INVALID_BORDER == border)
+    {
+        *len = 0;
+        return NULL;
+    }
+
+    /* Rest of the data going out uncompressed. */
+    if (compress->raw_left)
+    {
+        *len = Min(compress->raw_left, buf->m_Length - tail);
+        return buf->m_buf + tail;
+    }
+
+    if (border >= tail)
+    {
+        len1 = border - tail;
+    }
+    else
+    {
+        len1 = buf->m_Length - tail;
+        len2 = border;
+    }
+
+    if (0 == len1 + len2)
+    {
+        /* No more complete tuples. */
+        spinlock_lock(&(buf->pointerlock));
+        if (border == buf->m_Border)
+        {
+            buf->m_Border = INVALID_BORDER;
+        }
+        spinlock_unlock(&(buf->pointerlock));
+        *len = 0;
+        return NULL;
+    }
+
+    if (len1 + len2 < (uint32) node->compress_threshold ||
+        !DataPumpCompressFrame(compress, buf->m_buf + tail, len1, buf->m_buf, len2))
+    {
+        compress->raw_left = len1 + len2;
+        *len = len1;
+        return buf->m_buf + tail;
+    }
+
+    *len = compress->frame_len;
+    return compress->frame;
+#else
+    return GetData(node->buffer, len);
+#endif
+}
+
+/* Account data returned by DataPumpGetSendData as sent. */
+static void
+DataPumpSendDataDone(DataPumpNodeControl *node, uint32 len)
+{
+#ifdef HAVE_LIBZ
+    DataPumpCompress *compress = node->compress;
+
+    if (compress)
+    {
+        if (compress->frame_len)
+        {
+            compress->frame_off += len;
+            if (compress->frame_off == compress->frame_len)
+            {
+                IncDataOff(node->buffer, compress->frame_raw);
+                compress->frame_len = 0;
+                compress->frame_off = 0;
+                compress->frame_raw = 0;
+            }
+            return;
+        }
+
+        if (compress->raw_left)
+        {
+            compress->raw_left -= len;
+        }
+    }
+#endif
+    IncDataOff(node->buffer, len);
+}
+
+/*
+ * Pick the node with the most pending data which is neither served by another
+ * sender thread nor waiting for its socket, and claim it for the caller. When
+ * flushing, nodes without data are picked as well so that they can be marked
+ * as done. *stalled returns the number of nodes skipped as they are stalled.
+ */
+static DataPumpNodeControl *
+DataPumpClaimNode(DataPumpSenderControl *sender, bool flush, int32 *stalled)
+{
+    int32                nodeindex = 0;
+    int32                status    = 0;
+    uint32               size      = 0;
+    uint32               max_size  = 0;
+    bool                 skip      = false;
+    DataPumpNodeControl *node      = NULL;
+    DataPumpNodeControl *best      = NULL;
+
+    for (;;)
+    {
+        best      = NULL;
+        max_size  = 0;
+        *stalled  = 0;
+        for (nodeindex = 0; nodeindex < sender->node_num; nodeindex++)
+        {
+            node = &sender->nodes[nodeindex];
+
+            spinlock_lock(&node->lock);
+            status = node->status;
+            skip   = node->claimed;
+            if (!skip && node->stalled)
+            {
+                (*stalled)++;
+                skip = true;
+            }
+            spinlock_unlock(&node->lock);
+
+            /* status is valid */
+            if (skip || status < DataPumpSndStatus_set_socket || status > DataPumpSndStatus_data_sending)
+            {
+                continue;
+            }
+
+            size = DataSize(node->buffer);
+            if ((size || flush) && (NULL == best || size > max_size))
+            {
+                best     = node;
+                max_size = size;
+            }
+        }
+
+        if (NULL == best)
+        {
+            return NULL;
+        }
+
+        /* Another thread may have taken it meanwhile, look again. */
+        spinlock_lock(&best->lock);
+        if (!best->claimed && !best->stalled)
+        {
+            best->claimed = true;
+            spinlock_unlock(&best->lock);
+            break;
+        }
+        spinlock_unlock(&best->lock);
+    }
+
+    /* Only the thread holding the node touches its statistics. */
+    if (max_size > best->max_depth)
+    {
+        best->max_depth = max_size;
+    }
+    if (best->stall_begin)
+    {
+        best->stall_time += GetCurrentTimestamp() - best->stall_begin;
+        best->stall_begin = 0;
+    }
+    return best;
+}
+
+static void
+DataPumpReleaseNode(DataPumpNodeControl *node)
+{
+    spinlock_lock(&node->lock);
+    node->claimed = false;
+    spinlock_unlock(&node->lock);
+}
+
+/*
+ * The socket of the node is full, leave the node alone until it is writable.
+ */
+static void
+DataPumpNodeStalled(DataPumpSenderControl *sender, DataPumpNodeControl *node)
+{
+    struct epoll_event event;
+
+    node->stall_count++;
+    node->stall_begin = GetCurrentTimestamp();
+
+    /* Nothing to wait on for the shared memory channel, it is retried. */
+    if (node->shm_channel || sender->epoll_fd < 0)
+    {
+        return;
+    }
+
+    spinlock_lock(&node->lock);
+    node->stalled = true;
+    spinlock_unlock(&node->lock);
+
+    event.events   = EPOLLOUT | EPOLLONESHOT;
+    event.data.ptr = node;
+    if (epoll_ctl(sender->epoll_fd, node->polled ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, node->sock, &event) == 0)
+    {
+        node->polled = true;
+    }
+    else
+    {
+        spinlock_lock(&node->lock);
+        node->stalled = false;
+        spinlock_unlock(&node->lock);
+    }
+}
+
+/*
+ * Wait at most timeout ms for stalled sockets to become writable, and make
+ * their nodes available again. Return the number of such nodes.
+ */
+static int
+DataPumpPollStalled(DataPumpSenderControl *sender, int timeout)
+{
+    int                  i      = 0;
+    int                  nevents = 0;
+    DataPumpNodeControl *node   = NULL;
+    struct epoll_event   events[DATAPUMP_POLL_EVENTS];
+
+    if (sender->epoll_fd < 0)
+    {
+        if (timeout)
+        {
+            pg_usleep(timeout * 1000L);
+        }
+        return 0;
+    }
+
+    nevents = epoll_wait(sender->epoll_fd, events, DATAPUMP_POLL_EVENTS, timeout);
+    for (i = 0; i < nevents; i++)
+    {
+        node = (DataPumpNodeControl *) events[i].data.ptr;
+        spinlock_lock(&node->lock);
+        node->stalled = false;
+        spinlock_unlock(&node->lock);
+    }
+    return nevents > 0 ? nevents : 0;
+}
+
+/*
+ * Send data of a claimed node until it is drained or its socket gets full.
+ * When flushing, incomplete data is sent as well and the node is marked done
+ * once empty. Return false if the node failed.
+ */
+static bool
+DataPumpSendNode(DataPumpSenderControl *sender, DataPumpNodeControl *node, bool flush)
+{// #lizard forgives
+    int32  reason = 0;
+    int32  status = 0;
+    int    ret    = 0;
+    uint32 len    = 0;
+    char   *data  = NULL;
+
+    do
+    {
+        /* Data left in buffer, send them all. */
+        if (flush && node->buffer->m_Tail != node->buffer->m_Head)
+        {
+            node->buffer->m_Border = node->buffer->m_Head;
+        }
+
+        data = DataPumpGetSendData(node, &len);
+        if (data)
+        {
+            reason = 0;
+            ret = DataPumpRawSendData(node, node->sock, data, len, &reason);
+            if (EOF == ret)
+            {
+                /* We got error. */
+                spinlock_lock(&node->lock);
+                node->status  = DataPumpSndStatus_error;
+                node->errorno = errno;
+                spinlock_unlock(&node->lock);
+                return false;
+            }
+
+            /* increase data offset */
+            DataPumpSendDataDone(node, ret);
+
+            /* Socket got stuck, serve other nodes meanwhile. */
+            if (reason == EAGAIN || reason == EWOULDBLOCK)
+            {
+                if (DataSize(node->buffer) > 0)
+                {
+                    DataPumpNodeStalled(sender, node);
+                    return true;
+                }
+            }
+        }
+        else
+        {
+            if (!flush)
+            {
+                /* No more complete tuples. */
+                return true;
+            }
+
+            /* No more complete tuples, it is vary wired situation to get into the branch. */
+            if (DataSize(node->buffer))
+            {
+                spinlock_lock(&node->lock);
+                node->status  = DataPumpSndStatus_incomplete_data;
+                node->errorno = errno;
+                spinlock_unlock(&node->lock);
+                return false;
+            }
+
+            /* All data is in the channel, let consumer switch back to socket. */
+            if (node->shm_channel)
+            {
+                DataPumpShmChannelFinish(node->shm_channel);
+            }
+
+            /* Job done, set status. */
+            spinlock_lock(&node->lock);
+            node->status  = DataPumpSndStatus_done;
+            spinlock_unlock(&node->lock);
+            return true;
+        }
+
+        /* Get status. */
+        spinlock_lock(&node->lock);
+        status = node->status;
+        spinlock_unlock(&node->lock);
+    }while ((status >= DataPumpSndStatus_set_socket && status <= DataPumpSndStatus_data_sending) &&
+            (flush || DataSize(node->buffer)));
+    return true;
+}
+
+void DataPumpSendLoop(DataPumpSenderControl *sender, DataPumpThreadControl* control)
+{
+    int32                stalled = 0;
+    DataPumpNodeControl *node    = NULL;
+
+    /* Loop to send data, busiest node first. */
+    while (!control->thread_need_quit)
+    {
+        DataPumpPollStalled(sender, 0);
+
+        node = DataPumpClaimNode(sender, false, &stalled);
+        if (node)
+        {
+            DataPumpSendNode(sender, node, false);
+            DataPumpReleaseNode(node);
+            continue;
+        }
+
+        /* Nothing left to send. */
+        if (0 == stalled)
+        {
+            break;
+        }
+
+        /* All the pending data waits for slow consumers. */
+        DataPumpPollStalled(sender, DATAPUMP_POLL_TIMEOUT);
+    }
+}
+/*
+ * Ensure all data flush out when cursor is done.
+ */
+bool DataPumpFlushAllData(DataPumpSenderControl *sender, DataPumpThreadControl* control)
+{
+    int32                stalled = 0;
+    bool                 succeed = true;
+    DataPumpNodeControl *node    = NULL;
+
+    /* Loop until every node is done or served by other threads. */
+    for (;;)
+    {
+        DataPumpPollStalled(sender, 0);
+
+        node = DataPumpClaimNode(sender, true, &stalled);
+        if (node)
+        {
+            if (!DataPumpSendNode(sender, node, true))
+            {
+                succeed = false;
+            }
+            DataPumpReleaseNode(node);
+            continue;
+        }
+
+        if (0 == stalled)
+        {
+            break;
+        }
+
+        DataPumpPollStalled(sender, DATAPUMP_POLL_TIMEOUT);
+    }
+    return succeed;
+}
+/*
+ * Datapump sender thread.
+ */
+void *DataPumpSenderThread(void *arg)
+{
+    DataPumpSenderControl *sender  = NULL;
+    DataPumpThreadControl* thread  = NULL;
+
+    thread = (DataPumpThreadControl*)arg;
+    sender = thread->sender;
+    ThreadSigmask();
+    thread->thread_running = true;
+    while (1)
+    {
+        /* Waiting for orders. */
+        ThreadSemaDown(&sender->send_sem);
+
+        /* error, quit directly */
+        if (thread->error)
+            break;
+        /* We have been told to quit. */
+        if (thread->thread_need_quit)
+        {
+            thread->quit_status = DataPumpFlushAllData(sender, thread);
+            break;
+        }
+        
+        /* Loop to send data. */
+        DataPumpSendLoop(sender, thread);
+        
+    }
+    thread->thread_running = false;
+    /* Tell main thread quit is done. */
+    ThreadSemaUp(&thread->quit_sem);
+    return NULL;
+}
+
+/* check node status and report error if node is abnormal */
+static bool DataPumpNodeCheck(void *sndctl, int32 nodeindex)
+{
+    DataPumpSenderControl *sender   = NULL;
+    DataPumpNodeControl   *node     = NULL;
+
+    sender = (DataPumpSenderControl*)sndctl;
+    
+    node = &sender->nodes[nodeindex];
+
+    if (node->status == DataPumpSndStatus_incomplete_data ||
+        node->status == DataPumpSndStatus_error)
+    {
+        elog(LOG, "node %d status abnormal.errmsg:%s.", nodeindex, strerror(node->errorno));
+        return false;
+    }
+
+    if (sender->convert_control.cstatus != ConvertRunning)
+    {
+        elog(LOG, "convert status abnormal.errmsg:%s.", strerror(sender->convert_control.errNO));
+        return false;
+    }
+
+    return true;
+}
+
+/* Return data write to the socket. */
+static int DataPumpRawSendData(DataPumpNodeControl *node, int32 sock, char *data, int32 len, int32 *reason)
+{
+    int32  offset       = 0;
+    int32  nbytes_write = 0;
+
+    if (node->shm_channel)
+    {
+        offset = DataPumpShmChannelWrite(node->shm_channel, data, len);
+        if (offset < len)
+        {
+            /* Ring is full, behave like a stuck socket. */
+            pg_usleep(1000L);
+            node->sleep_count++;
+            *reason = EAGAIN;
+        }
+        return offset;
+    }
+
+    while (offset < len)
+    {
+        nbytes_write = send(sock, data + offset, len - offset, 0);
+        if (nbytes_write <= 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;        /* Ok if we were interrupted */
+            }
+
+            /*
+             * Ok if no data writable without blocking, and the socket is in
+             * non-blocking mode.
+             */
+            if (errno == EAGAIN ||
+                errno == EWOULDBLOCK)
+            {                
+                pg_usleep(1000L);
+                node->sleep_count++;
+                *reason = errno;
+                return offset;
+            }
+            *reason = errno;
+            return EOF;
+        }
+        offset += nbytes_write;
+    }
+    
+    return offset;
+}
+
+/*
+ * Check whether the peer of the socket runs on this host, in which case the
+ * data can be handed over through shared memory instead of the network stack.
+ */
+static bool
+DataPumpSocketIsLocal(int sock)
+{
+    struct sockaddr_storage local_addr;
+    struct sockaddr_storage peer_addr;
+    socklen_t               local_len = sizeof(local_addr);
+    socklen_t               peer_len  = sizeof(peer_addr);
+
+    if (getsockname(sock, (struct sockaddr *) &local_addr, &local_len) < 0 ||
+        getpeername(sock, (struct sockaddr *) &peer_addr, &peer_len) < 0)
+    {
+        return false;
+    }
+
+    if (peer_addr.ss_family == AF_UNIX)
+    {
+        return true;
+    }
+
+    if (peer_addr.ss_family != local_addr.ss_family)
+    {
+        return false;
+    }
+
+    if (peer_addr.ss_family == AF_INET)
+    {
+        return memcmp(&((struct sockaddr_in *) &local_addr)->sin_addr,
+                      &((struct sockaddr_in *) &peer_addr)->sin_addr,
+                      sizeof(struct in_addr)) == 0;
+    }
+#ifdef HAVE_IPV6
+    if (peer_addr.ss_family == AF_INET6)
+    {
+        return memcmp(&((struct sockaddr_in6 *) &local_addr)->sin6_addr,
+                      &((struct sockaddr_in6 *) &peer_addr)->sin6_addr,
+                      sizeof(struct in6_addr)) == 0;
+    }
+#endif
+    return false;
+}
+
+/*
+ * Create the shared memory channel for a co-located consumer and announce it
+ * with a 'h' message on the socket. Called by convert thread, so no palloc or
+ * elog here. Returns NULL if the data should go through the socket as usual.
+ */
+static DataPumpShmChannel *
+DataPumpShmChannelCreate(int sock)
+{
+    int                 fd;
+    int                 ret;
+    int                 slot;
+    int                 retry   = 0;
+    int                 offset  = 0;
+    int                 namelen = 0;
+    int                 msglen  = 0;
+    uint32              n32;
+    uint64              slots;
+    Size                size;
+    char                msg[1 + 4 + 4 + 4 + 4 + DATAPUMP_SHM_NAME_LEN];
+    DataPumpShmRing    *ring    = NULL;
+    DataPumpShmChannel *channel = NULL;
+
+    if (DataPumpShmProcNo < 0 || !DataPumpSocketIsLocal(sock))
+    {
+        return NULL;
+    }
+
+    /* Take a free slot, too many channels go through the socket. */
+    slots = pg_atomic_read_u64(&DataPumpShmSlots);
+    for (slot = 0; slot < DATAPUMP_SHM_MAX_CHANNELS; slot++)
+    {
+        if (slots & (UINT64CONST(1) << slot))
+        {
+            continue;
+        }
+
+        if (pg_atomic_compare_exchange_u64(&DataPumpShmSlots, &slots, slots | (UINT64CONST(1) << slot)))
+        {
+            break;
+        }
+        /* slots was reloaded, start over */
+        slot = -1;
+    }
+
+    if (slot >= DATAPUMP_SHM_MAX_CHANNELS)
+    {
+        return NULL;
+    }
+
+    channel = (DataPumpShmChannel *) malloc(sizeof(DataPumpShmChannel));
+    if (NULL == channel)
+    {
+        pg_atomic_fetch_and_u64(&DataPumpShmSlots, ~(UINT64CONST(1) << slot));
+        return NULL;
+    }
+    channel->slot = slot;
+    DataPumpShmChannelName(channel->name, DataPumpShmProcNo, slot);
+
+    size = offsetof(DataPumpShmRing, data) + (Size) g_DataPumpShmChannelSize * 1024;
+    fd = shm_open(channel->name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (fd < 0 && errno == EEXIST)
+    {
+        /* Left by a crashed holder of the slot, nobody can use it any more. */
+        shm_unlink(channel->name);
+        fd = shm_open(channel->name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    }
+    if (fd < 0)
+    {
+        pg_atomic_fetch_and_u64(&DataPumpShmSlots, ~(UINT64CONST(1) << slot));
+        free(channel);
+        return NULL;
+    }
+
+    if (ftruncate(fd, size) < 0)
+    {
+        close(fd);
+        shm_unlink(channel->name);
+        pg_atomic_fetch_and_u64(&DataPumpShmSlots, ~(UINT64CONST(1) << slot));
+        free(channel);
+        return NULL;
+    }
+
+    ring = (DataPumpShmRing *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == (void *) ring)
+    {
+        shm_unlink(channel->name);
+        pg_atomic_fetch_and_u64(&DataPumpShmSlots, ~(UINT64CONST(1) << slot));
+        free(channel);
+        return NULL;
+    }
+
+    ring->magic = DATAPUMP_SHM_MAGIC;
+    ring->size  = (uint32) g_DataPumpShmChannelSize * 1024;
+    ring->pid   = MyProcPid;
+    ring->seq   = pg_atomic_fetch_add_u32(&DataPumpShmSeq, 1);
+    pg_atomic_init_u64(&ring->write_pos, 0);
+    pg_atomic_init_u64(&ring->read_pos, 0);
+    pg_atomic_init_u32(&ring->finished, 0);
+    pg_atomic_init_u32(&ring->consumer_waiting, 0);
+
+    channel->sock        = sock;
+    channel->waiting     = false;
+    channel->doorbells   = 0;
+    channel->ring        = ring;
+    channel->mapped_size = size;
+
+    /* 'h' message: size of the ring, pid and sequence number, segment name. */
+    namelen = strlen(channel->name) + 1;
+    msglen  = 4 + 4 + 4 + 4 + namelen;
+    msg[0]  = 'h';
+    n32 = htonl((uint32) msglen);
+    memcpy(msg + 1, &n32, 4);
+    n32 = htonl(ring->size);
+    memcpy(msg + 5, &n32, 4);
+    n32 = htonl((uint32) ring->pid);
+    memcpy(msg + 9, &n32, 4);
+    n32 = htonl(ring->seq);
+    memcpy(msg + 13, &n32, 4);
+    memcpy(msg + 17, channel->name, namelen);
+
+    /* Socket is idle and the message is tiny, it should go out at once. */
+    while (offset < msglen + 1)
+    {
+        ret = send(sock, msg + offset, msglen + 1 - offset, 0);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && retry++ < 1000)
+            {
+                pg_usleep(1000L);
+                continue;
+            }
+            break;
+        }
+        offset += ret;
+    }
+
+    if (offset < msglen + 1)
+    {
+        DataPumpShmChannelDestroy(channel);
+        return NULL;
+    }
+    return channel;
+}
+
+/* Put data into the channel, return number of bytes written. */
+static int
+DataPumpShmChannelWrite(DataPumpShmChannel *channel, char *data, int32 len)
+{
+    DataPumpShmRing *ring      = channel->ring;
+    uint64           write_pos = pg_atomic_read_u64(&ring->write_pos);
+    uint64           read_pos  = pg_atomic_read_u64(&ring->read_pos);
+    uint32           nbytes    = 0;
+    uint32           offset    = 0;
+    uint32           part      = 0;
+
+    /* Consumer must be done with the space before we overwrite it. */
+    pg_memory_barrier();
+
+    nbytes = Min((uint32) len, ring->size - (uint32) (write_pos - read_pos));
+    if (0 == nbytes)
+    {
+        return 0;
+    }
+
+    offset = (uint32) (write_pos % ring->size);
+    part   = Min(nbytes, ring->size - offset);
+    memcpy(ring->data + offset, data, part);
+    if (part < nbytes)
+    {
+        memcpy(ring->data, data + part, nbytes - part);
+    }
+
+    /* Data must be visible before the position moves. */
+    pg_write_barrier();
+    pg_atomic_write_u64(&ring->write_pos, write_pos + nbytes);
+    DataPumpShmChannelKick(channel);
+    return nbytes;
+}
+
+/* Tell consumer no more data will be put into the channel. */
+static void
+DataPumpShmChannelFinish(DataPumpShmChannel *channel)
+{
+    pg_write_barrier();
+    pg_atomic_write_u32(&channel->ring->finished, 1);
+    DataPumpShmChannelKick(channel);
+}
+
+/*
+ * Wake up the consumer if it sleeps on the socket. The position or finish flag
+ * has been stored before, the consumer sets the flag before it looks at them,
+ * so one of us always sees the other.
+ *
+ * Once the flag is taken the consumer counts on the doorbell, so it has to go
+ * out. The socket carries nothing else meanwhile and a full send buffer is
+ * hardly possible, but wait for it to drain if so. Only a broken connection
+ * stops us, the consumer is gone then.
+ */
+static void
+DataPumpShmChannelKick(DataPumpShmChannel *channel)
+{
+    uint32          expected = 1;
+    char            doorbell = DATAPUMP_SHM_DOORBELL;
+    struct pollfd   pfd;
+
+    pg_memory_barrier();
+    if (0 == pg_atomic_read_u32(&channel->ring->consumer_waiting))
+    {
+        return;
+    }
+
+    if (!pg_atomic_compare_exchange_u32(&channel->ring->consumer_waiting, &expected, 0))
+    {
+        return;
+    }
+
+    while (send(channel->sock, &doorbell, 1, 0) < 0)
+    {
+        if (errno == EINTR)
+        {
+            continue;
+        }
+
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            break;
+        }
+
+        pfd.fd      = channel->sock;
+        pfd.events  = POLLOUT;
+        pfd.revents = 0;
+        (void) poll(&pfd, 1, 1000);
+    }
+}
+
+/* Release producer side of the channel. */
+static void
+DataPumpShmChannelDestroy(DataPumpShmChannel *channel)
+{
+    munmap(channel->ring, channel->mapped_size);
+    /* Consumer unlinks the segment once attached, ignore ENOENT. */
+    shm_unlink(channel->name);
+    pg_atomic_fetch_and_u64(&DataPumpShmSlots, ~(UINT64CONST(1) << channel->slot));
+    free(channel);
+}
+
+/*
+ * Consumer side, attach to the channel announced by a 'h' message.
+ */
+DataPumpShmChannel *
+DataPumpShmChannelAttach(char *msg, int len)
+{
+    int                 fd;
+    int                 save_errno;
+    uint32              n32;
+    uint32              ring_size;
+    int32               pid;
+    uint32              seq;
+    Size                size;
+    char               *name;
+    DataPumpShmRing    *ring;
+    DataPumpShmChannel *channel;
+
+    if (len <= 12 || msg[len - 1] != '\0' || len - 12 > DATAPUMP_SHM_NAME_LEN)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_PROTOCOL_VIOLATION),
+                 errmsg("invalid data pump channel message")));
+    }
+
+    memcpy(&n32, msg, 4);
+    ring_size = ntohl(n32);
+    memcpy(&n32, msg + 4, 4);
+    pid = (int32) ntohl(n32);
+    memcpy(&n32, msg + 8, 4);
+    seq = ntohl(n32);
+    name = msg + 12;
+    size = offsetof(DataPumpShmRing, data) + (Size) ring_size;
+
+    fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+    {
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not open data pump channel \"%s\": %m", name)));
+    }
+
+    ring = (DataPumpShmRing *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    save_errno = errno;
+    close(fd);
+
+    if (MAP_FAILED == (void *) ring)
+    {
+        errno = save_errno;
+        ereport(ERROR,
+                (errcode(ERRCODE_OUT_OF_MEMORY),
+                 errmsg("could not map data pump channel \"%s\": %m", name)));
+    }
+
+    /* The name may have been reused by a later channel of the producer. */
+    if (ring->magic != DATAPUMP_SHM_MAGIC || ring->size != ring_size ||
+        ring->pid != pid || ring->seq != seq)
+    {
+        munmap(ring, size);
+        ereport(ERROR,
+                (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+                 errmsg("data pump channel \"%s\" of pid %d is gone", name, pid)));
+    }
+
+    /* Nobody else needs to find the segment, it lives until both sides unmap it. */
+    shm_unlink(name);
+
+    channel = (DataPumpShmChannel *) MemoryContextAlloc(TopMemoryContext, sizeof(DataPumpShmChannel));
+    strlcpy(channel->name, name, DATAPUMP_SHM_NAME_LEN);
+    channel->sock        = NO_SOCKET;
+    channel->slot        = -1;
+    channel->waiting     = false;
+    channel->doorbells   = 0;
+    channel->ring        = ring;
+    channel->mapped_size = size;
+
+    if (g_DataPumpDebug)
+    {
+        elog(LOG, "attached to data pump channel %s, size %u, pid %d.", name, ring_size, MyProcPid);
+    }
+    return channel;
+}
+
+/*
+ * Read data from the channel. Returns number of bytes read, 0 if the channel
+ * is empty for now, EOF if producer has finished and everything was read.
+ */
+int
+DataPumpShmChannelRead(DataPumpShmChannel *channel, char *buf, int len)
+{
+    DataPumpShmRing *ring      = channel->ring;
+    uint32           finished  = 0;
+    uint64           write_pos = 0;
+    uint64           read_pos  = 0;
+    uint32           nbytes    = 0;
+    uint32           offset    = 0;
+    uint32           part      = 0;
+
+    /* Check finish flag first, all the data was put before it was set. */
+    finished = pg_atomic_read_u32(&ring->finished);
+    pg_read_barrier();
+    write_pos = pg_atomic_read_u64(&ring->write_pos);
+    read_pos  = pg_atomic_read_u64(&ring->read_pos);
+
+    if (write_pos == read_pos)
+    {
+        return finished ? EOF : 0;
+    }
+
+    pg_read_barrier();
+    nbytes = Min((uint32) len, (uint32) (write_pos - read_pos));
+    offset = (uint32) (read_pos % ring->size);
+    part   = Min(nbytes, ring->size - offset);
+    memcpy(buf, ring->data + offset, part);
+    if (part < nbytes)
+    {
+        memcpy(buf + part, ring->data, nbytes - part);
+    }
+
+    /* Done with the space before producer may reuse it. */
+    pg_memory_barrier();
+    pg_atomic_write_u64(&ring->read_pos, read_pos + nbytes);
+    return nbytes;
+}
+
+/* Does the channel have something to report, data or end of data? */
+bool
+DataPumpShmChannelReady(DataPumpShmChannel *channel)
+{
+    DataPumpShmRing *ring = channel->ring;
+
+    return pg_atomic_read_u32(&ring->finished) != 0 ||
+           pg_atomic_read_u64(&ring->write_pos) != pg_atomic_read_u64(&ring->read_pos);
+}
+
+/*
+ * Consumer is going to sleep on the socket. Returns true if the channel became
+ * ready meanwhile, the caller must not sleep then.
+ */
+bool
+DataPumpShmChannelPrepareWait(DataPumpShmChannel *channel)
+{
+    /* Flag cleared since the last call means the producer rang. */
+    if (0 == pg_atomic_exchange_u32(&channel->ring->consumer_waiting, 1) && channel->waiting)
+    {
+        channel->doorbells++;
+    }
+    channel->waiting = true;
+    pg_memory_barrier();
+    return DataPumpShmChannelReady(channel);
+}
+
+/*
+ * Consumer is awake, no need for the doorbell. Returns the number of doorbells
+ * rung since the last call, the caller has to take them off the socket.
+ */
+uint32
+DataPumpShmChannelCancelWait(DataPumpShmChannel *channel)
+{
+    uint32  doorbells;
+
+    if (channel->waiting)
+    {
+        if (0 == pg_atomic_exchange_u32(&channel->ring->consumer_waiting, 0))
+        {
+            channel->doorbells++;
+        }
+        channel->waiting = false;
+    }
+
+    doorbells = channel->doorbells;
+    channel->doorbells = 0;
+    return doorbells;
+}
+
+/* Release consumer side of the channel. */
+void
+DataPumpShmChannelDetach(DataPumpShmChannel *channel)
+{
+    munmap(channel->ring, channel->mapped_size);
+    pfree(channel);
+}
+
+static void
+DataPumpShmChannelName(char *name, int procno, int slot)
+{
+    snprintf(name, DATAPUMP_SHM_NAME_LEN, "/%s.%d.%d.%d", DATAPUMP_SHM_PREFIX,
+             PostPortNumber, procno, slot);
+}
 
-    if (node->status == DataPumpSndStatus_incomplete_data ||
-        node->status == DataPumpSndStatus_error)
+/*
+ * Remove the segments of the backend in the given PGPROC slot, or of all the
+ * backends of this server if procno is negative. Segments of a dead producer
+ * are never attached and so never unlinked by the consumer.
+ */
+void
+DataPumpShmChannelCleanup(int procno)
+{
+    int     first = procno;
+    int     last  = procno;
+    int     slot;
+    char    name[DATAPUMP_SHM_NAME_LEN];
+
+    if (procno < 0)
     {
-        elog(LOG, "node %d status abnormal.errmsg:%s.", nodeindex, strerror(node->errorno));
-        return false;
+        first = 0;
+        last  = MaxBackends - 1;
     }
 
-    if (sender->convert_control.cstatus != ConvertRunning)
+    for (procno = first; procno <= last; procno++)
     {
-        elog(LOG, "convert status abnormal.errmsg:%s.", strerror(sender->convert_control.errNO));
-        return false;
+        for (slot = 0; slot < DATAPUMP_SHM_MAX_CHANNELS; slot++)
+        {
+            DataPumpShmChannelName(name, procno, slot);
+            if (shm_unlink(name) == 0 && g_DataPumpDebug)
+            {
+                elog(LOG, "removed data pump channel %s", name);
+            }
+        }
     }
-
-    return true;
 }
 
-/* Return data write to the socket. */
-static int DataPumpRawSendData(DataPumpNodeControl *node, int32 sock, char *data, int32 len, int32 *reason)
+/* Remove the channels the backend did not get to destroy. */
+static void
+DataPumpShmChannelAtExit(int code, Datum arg)
 {
-    int32  offset       = 0;
-    int32  nbytes_write = 0;
+    int     slot;
+    uint64  slots = pg_atomic_read_u64(&DataPumpShmSlots);
+    char    name[DATAPUMP_SHM_NAME_LEN];
 
-    while (offset < len)
+    for (slot = 0; slot < DATAPUMP_SHM_MAX_CHANNELS; slot++)
     {
-        nbytes_write = send(sock, data + offset, len - offset, 0);
-        if (nbytes_write <= 0)
+        if (slots & (UINT64CONST(1) << slot))
         {
-            if (errno == EINTR)
-            {
-                continue;        /* Ok if we were interrupted */
-            }
-
-            /*
-             * Ok if no data writable without blocking, and the socket is in
-             * non-blocking mode.
-             */
-            if (errno == EAGAIN ||
-                errno == EWOULDBLOCK)
-            {                
-                pg_usleep(1000L);
-                node->sleep_count++;
-                *reason = errno;
-                return offset;
-            }
-            *reason = errno;
-            return EOF;
+            DataPumpShmChannelName(name, DataPumpShmProcNo, slot);
+            shm_unlink(name);
         }
-        offset += nbytes_write;
     }
-    
-    return offset;
+}
+
+/* Called by the main thread before any channel of the backend is created. */
+static void
+DataPumpShmChannelRegisterExit(void)
+{
+    static bool registered = false;
+
+    if (g_DataPumpShmChannel && !registered && MyProc != NULL)
+    {
+        pg_atomic_init_u64(&DataPumpShmSlots, 0);
+        pg_atomic_init_u32(&DataPumpShmSeq, 0);
+        DataPumpShmProcNo = MyProc->pgprocno;
+        on_proc_exit(DataPumpShmChannelAtExit, (Datum) 0);
+        registered = true;
+    }
 }
 
 bool
@@ -4767,19 +6005,26 @@ bool DataPumpWaitSenderDone(void *sndctl, bool error)
         for (threadid = 0; threadid < sender->thread_num; threadid ++)
         {
             thread = &sender->thread_control[threadid];
-            /* Set quit flag and tell sender to quit. */
+            /* Set quit flag, threads share the semaphore so wake them after. */
             if (thread->thread_running)
             {
                 thread->thread_need_quit = true;
 
                 thread->error = error;
-                
-                ThreadSemaUp(&thread->send_sem);    
 
                 send_quit[threadid] = true;
             }
         }
 
+        /* Tell senders to quit. */
+        for (threadid = 0; threadid < sender->thread_num; threadid ++)
+        {
+            if (send_quit[threadid])
+            {
+                ThreadSemaUp(&sender->send_sem);
+            }
+        }
+
         for (threadid = 0; threadid < sender->thread_num; threadid ++)
         {
             if (send_quit[threadid])
@@ -4790,9 +6035,9 @@ bool DataPumpWaitSenderDone(void *sndctl, bool error)
                 if (!thread->quit_status)
                 {
                     elog(DEBUG1, DATA_PUMP_PREFIX"thread:%d send data finish with error", threadid);    
-                    for (nodeindex = thread->node_base; nodeindex < thread->node_end && nodeindex< thread->node_num; nodeindex++)
+                    for (nodeindex = 0; nodeindex < sender->node_num; nodeindex++)
                     {
-                        node = &thread->nodes[nodeindex];
+                        node = &sender->nodes[nodeindex];
                         if (node->status != DataPumpSndStatus_done)
                         {
                             elog(DEBUG1, DATA_PUMP_PREFIX"thread:%d node:%d remaining datasize:%u failed for %s, errno:%d", threadid, node->nodeindex, DataSize(node->buffer), strerror(node->errorno), node->errorno);
@@ -4817,7 +6062,7 @@ bool DataPumpWaitSenderDone(void *sndctl, bool error)
     if (succeed)
         succeed = ret;
 
-    elog(DEBUG1, "Squeue:%s(Pid:%d), destroy %d sender, 1 convert.", sender->convert_control.sqname, MyProcPid, sender->thread_num);
+    elog(DEBUG1, "Squeue:%s(Pid:%d), destroy %d sender, 1 convert.", sender->convert_control.sqname, MyProcPid, sender->thread_started);
     
     return succeed;
 }
@@ -4838,11 +6083,18 @@ void DataPumpCleanThread(DataPumpSenderControl *sender)
         if (thread->thread_running)
         {
             thread->thread_need_quit = true;
-            ThreadSemaUp(&thread->send_sem);        
             send_quit[threadid] = true;
         }
     }
 
+    for (threadid = 0; threadid < sender->thread_num; threadid ++)
+    {
+        if (send_quit[threadid])
+        {
+            ThreadSemaUp(&sender->send_sem);
+        }
+    }
+
     for (threadid = 0; threadid < sender->thread_num; threadid ++)
     {
 	    if (send_quit[threadid])
@@ -4876,6 +6128,12 @@ int32  DataPumpSetNodeSocket(void *sndctl, int32 nodeindex, int32 nodeId,  int32
         return DataPumpSndError_node_error;
     }
 
+    /* Announce the shared memory channel before any data goes out. */
+    if (g_DataPumpShmChannel && NO_SOCKET == node->sock && DataPumpSndStatus_no_socket == node->status)
+    {
+        node->shm_channel = DataPumpShmChannelCreate(socket);
+    }
+
     /* Use lock to check status and socket */
     socket_set_nonblocking(socket, true);
     spinlock_lock(&node->lock);
@@ -4884,6 +6142,7 @@ int32  DataPumpSetNodeSocket(void *sndctl, int32 nodeindex, int32 nodeId,  int32
         node->sock   = socket;
         node->status = DataPumpSndStatus_set_socket;
         spinlock_unlock(&node->lock);
+        pg_atomic_fetch_add_u32(&sender->active_nodes, 1);
         return DataPumpOK;
     }
     else
@@ -5400,6 +6659,251 @@ RETRY:
     return succeed;
 }
 
+/*
+ * Max number of rows of a columnar batch for the tuples, 0 if the tuples can
+ * not be sent in batch. Batch is kept below half of the send buffer so that
+ * it never takes the long tuple path.
+ */
+static int32
+DataPumpBatchRows(DataPumpSenderControl *sender, TupleDesc tdesc)
+{
+    int     i;
+    int32   natts;
+    int32   width = 0;
+    int32   limit;
+    int32   maxrows;
+
+    if (sender->batch_rows >= 0)
+    {
+        return sender->batch_rows;
+    }
+
+    sender->batch_rows = 0;
+    natts = tdesc->natts;
+    if (natts <= 0 || natts > PG_INT16_MAX || g_DataPumpBatchRows <= 1)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < natts; i++)
+    {
+        Form_pg_attribute attr = tdesc->attrs[i];
+
+        if (!attr->attbyval || attr->attlen <= 0 || attr->attlen > sizeof(Datum))
+        {
+            return 0;
+        }
+        width += attr->attlen;
+    }
+
+    limit = (int32) (g_SndThreadBufferSize * 1024) / 2 - 5;
+    limit -= 8 + 3 * natts;
+    if (limit <= 0)
+    {
+        return 0;
+    }
+
+    maxrows = (int32) (((int64) limit * 8) / ((int64) width * 8 + natts));
+    maxrows = Min(maxrows, g_DataPumpBatchRows);
+    if (maxrows > 1)
+    {
+        sender->batch_rows = maxrows;
+    }
+    return sender->batch_rows;
+}
+
+/*
+ * Put the tuple into the batch of the node, return true if the batch is full.
+ */
+static bool
+DataPumpBatchAppend(DataPumpSenderControl *sender, int32 nodeindex, TupleTableSlot *slot, int32 maxrows)
+{
+    int             i;
+    DataPumpBatch  *batch = sender->nodes[nodeindex].batch;
+    TupleDesc       tdesc = slot->tts_tupleDescriptor;
+
+    if (NULL == batch)
+    {
+        MemoryContext oldcxt = MemoryContextSwitchTo(GetMemoryChunkContext(sender));
+
+        batch = (DataPumpBatch *) palloc0(sizeof(DataPumpBatch));
+        batch->natts   = tdesc->natts;
+        batch->maxrows = maxrows;
+        batch->attlen  = (int16 *) palloc(sizeof(int16) * batch->natts);
+        batch->values  = (Datum *) palloc(sizeof(Datum) * batch->natts * maxrows);
+        batch->isnull  = (bool *) palloc(sizeof(bool) * batch->natts * maxrows);
+        for (i = 0; i < batch->natts; i++)
+        {
+            batch->attlen[i] = tdesc->attrs[i]->attlen;
+        }
+        initStringInfo(&batch->buf);
+        MemoryContextSwitchTo(oldcxt);
+
+        sender->nodes[nodeindex].batch = batch;
+    }
+
+    slot_getallattrs(slot);
+    memcpy(batch->values + batch->nrows * batch->natts, slot->tts_values, sizeof(Datum) * batch->natts);
+    memcpy(batch->isnull + batch->nrows * batch->natts, slot->tts_isnull, sizeof(bool) * batch->natts);
+    batch->nrows++;
+
+    return batch->nrows >= batch->maxrows;
+}
+
+/* Encode the batch into its message body. */
+static void
+DataPumpBatchEncode(DataPumpBatch *batch)
+{
+    int         i;
+    int         row;
+    int         bitmaplen = (batch->nrows + 7) / 8;
+    uint16      n16;
+    uint32      n32;
+    StringInfo  buf = &batch->buf;
+
+    resetStringInfo(buf);
+
+    n16 = htons((uint16) DATAROW_BATCH_MARKER);
+    appendBinaryStringInfo(buf, (char *) &n16, 2);
+    n16 = htons((uint16) batch->natts);
+    appendBinaryStringInfo(buf, (char *) &n16, 2);
+    n32 = htonl((uint32) batch->nrows);
+    appendBinaryStringInfo(buf, (char *) &n32, 4);
+    for (i = 0; i < batch->natts; i++)
+    {
+        n16 = htons((uint16) batch->attlen[i]);
+        appendBinaryStringInfo(buf, (char *) &n16, 2);
+    }
+
+    for (i = 0; i < batch->natts; i++)
+    {
+        int16   attlen = batch->attlen[i];
+        char   *bitmap;
+        char   *values;
+
+        enlargeStringInfo(buf, bitmaplen + batch->nrows * attlen);
+        bitmap = buf->data + buf->len;
+        memset(bitmap, 0, bitmaplen);
+        values = bitmap + bitmaplen;
+
+        for (row = 0; row < batch->nrows; row++)
+        {
+            Datum   value = batch->values[row * batch->natts + i];
+
+            if (batch->isnull[row * batch->natts + i])
+            {
+                bitmap[row >> 3] |= (1 << (row & 7));
+                continue;
+            }
+
+            switch (attlen)
+            {
+                case sizeof(char):
+                    *values = DatumGetChar(value);
+                    break;
+                case sizeof(int16):
+                    {
+                        int16 v = DatumGetInt16(value);
+                        memcpy(values, &v, sizeof(int16));
+                    }
+                    break;
+                case sizeof(int32):
+                    {
+                        int32 v = DatumGetInt32(value);
+                        memcpy(values, &v, sizeof(int32));
+                    }
+                    break;
+                default:
+                    memcpy(values, &value, attlen);
+                    break;
+            }
+            values += attlen;
+        }
+        buf->len = values - buf->data;
+    }
+}
+
+/* Create the tuplestore used to keep the tuples when node is not ready. */
+static void
+DataPumpCreateTupleStore(SharedQueue squeue, int32 consumerIdx, Tuplestorestate **tuplestore, MemoryContext tmpcxt)
+{
+    int            ptrno PG_USED_FOR_ASSERTS_ONLY;
+    char         storename[64];
+    ConsState  *cstate = &(squeue->sq_consumers[consumerIdx]);
+
+    *tuplestore = tuplestore_begin_datarow(false, work_mem / NumDataNodes, tmpcxt);
+    /* We need is to be able to remember/restore the read position */
+    snprintf(storename, 64, "%s node %d", squeue->sq_key, cstate->cs_node);
+    tuplestore_collect_stat(*tuplestore, storename);
+    /*
+     * Allocate a second read pointer to read from the store. We know
+     * it must have index 1, so needn't store that.
+     */
+    ptrno = tuplestore_alloc_read_pointer(*tuplestore, 0);
+    Assert(ptrno == 1);
+
+    if(g_DataPumpDebug)
+        elog(LOG, "create tuplestore with nodeid %d, cursor %s.", cstate->cs_node, squeue->sq_key);
+}
+
+/*
+ * Send out the rows collected in the batch of the consumer. If the node can
+ * not take them now, they are put into the tuplestore to keep the order.
+ */
+static void
+DataPumpBatchFlush(SharedQueue squeue, int32 consumerIdx, TupleDesc tdesc, Tuplestorestate **tuplestore, MemoryContext tmpcxt)
+{
+    int                    ret;
+    int                    row;
+    DataPumpSenderControl *sender = (DataPumpSenderControl*)squeue->sender;
+    DataPumpNodeControl   *node   = &sender->nodes[consumerIdx];
+    DataPumpBatch         *batch  = node->batch;
+    TupleTableSlot        *slot;
+
+    if (NULL == batch || 0 == batch->nrows)
+    {
+        return;
+    }
+
+    if (NULL == *tuplestore || tuplestore_ateof(*tuplestore))
+    {
+        DataPumpBatchEncode(batch);
+        ret = DataPumpSendDataRow(sender, consumerIdx, squeue->sq_consumers[consumerIdx].cs_node,
+                                  batch->buf.data, batch->buf.len);
+        if (DataPumpOK == ret || DataPumpSndError_unreachable_node == ret)
+        {
+            batch->nrows = 0;
+            return;
+        }
+    }
+
+    if (NULL == *tuplestore)
+    {
+        DataPumpCreateTupleStore(squeue, consumerIdx, tuplestore, tmpcxt);
+    }
+
+    if (NULL == sender->temp_slot)
+    {
+        sender->temp_slot = MakeSingleTupleTableSlot(tdesc);
+    }
+    slot = sender->temp_slot;
+
+    for (row = 0; row < batch->nrows; row++)
+    {
+        ExecClearTuple(slot);
+        memcpy(slot->tts_values, batch->values + row * batch->natts, sizeof(Datum) * batch->natts);
+        memcpy(slot->tts_isnull, batch->isnull + row * batch->natts, sizeof(bool) * batch->natts);
+        ExecStoreVirtualTuple(slot);
+
+        in_data_pump = true;
+        tuplestore_puttupleslot(*tuplestore, slot);
+        in_data_pump = false;
+        node->ntuples_put++;
+    }
+    ExecClearTuple(slot);
+    batch->nrows = 0;
+}
+
 void
 SendDataRemote(SharedQueue squeue, int32 consumerIdx, TupleTableSlot *slot, Tuplestorestate **tuplestore, MemoryContext tmpcxt)
 {// #lizard forgives    
@@ -5460,6 +6964,29 @@ SendDataRemote(SharedQueue squeue, int32 consumerIdx, TupleTableSlot *slot, Tupl
 
     nodeid = cstate->cs_node;
     ret = DataPumpNodeReadyForSend(squeue->sender, consumerIdx, nodeid);
+
+    /* Collect the tuple into the columnar batch if it fits there. */
+    if (DataPumpOK == ret && NULL == slot->tts_datarow &&
+        (NULL == *tuplestore || tuplestore_ateof(*tuplestore)))
+    {
+        int32 maxrows = DataPumpBatchRows(sender, slot->tts_tupleDescriptor);
+
+        if (maxrows > 0)
+        {
+            if (DataPumpBatchAppend(sender, consumerIdx, slot, maxrows))
+            {
+                DataPumpBatchFlush(squeue, consumerIdx, slot->tts_tupleDescriptor, tuplestore, tmpcxt);
+            }
+            return;
+        }
+    }
+
+    /* Rows of the batch go before this one. */
+    if (node->batch && node->batch->nrows > 0)
+    {
+        DataPumpBatchFlush(squeue, consumerIdx, slot->tts_tupleDescriptor, tuplestore, tmpcxt);
+    }
+
     if (DataPumpOK == ret)
     {
         /* No tuplestore created, we send datarow directly. */
@@ -5687,23 +7214,7 @@ SendDataRemote(SharedQueue squeue, int32 consumerIdx, TupleTableSlot *slot, Tupl
     /* Create tuplestore if does not exist.*/
     if (NULL == *tuplestore)
     {
-        int            ptrno PG_USED_FOR_ASSERTS_ONLY;
-        char         storename[64];
-
-
-        *tuplestore = tuplestore_begin_datarow(false, work_mem / NumDataNodes, tmpcxt);
-        /* We need is to be able to remember/restore the read position */
-        snprintf(storename, 64, "%s node %d", squeue->sq_key, cstate->cs_node);
-        tuplestore_collect_stat(*tuplestore, storename);
-        /*
-         * Allocate a second read pointer to read from the store. We know
-         * it must have index 1, so needn't store that.
-         */
-        ptrno = tuplestore_alloc_read_pointer(*tuplestore, 0);
-        Assert(ptrno == 1);
-
-        if(g_DataPumpDebug)
-            elog(LOG, "create tuplestore with nodeid %d, cursor %s.", nodeid, squeue->sq_key);
+        DataPumpCreateTupleStore(squeue, consumerIdx, tuplestore, tmpcxt);
     }
     in_data_pump = true;
     /* Append the slot to the store... */
@@ -6335,22 +7846,29 @@ ExecFastSendDatarow(TupleTableSlot *slot, void *sndctl, int32 nodeindex, MemoryC
 
 void DataPumpWakeupSender(void *sndctl, int32 nodeindex)
 {
-    int32 threadid = 0;
-    int32 step     = 0;
-    DataPumpThreadControl *thread = NULL;
+    uint32 active = 0;
     DataPumpSenderControl *sender   = NULL;
     DataPumpNodeControl   *node     = NULL;
 
     sender   = (DataPumpSenderControl*)sndctl;
-    step = DIVIDE_UP(sender->node_num, sender->thread_num);
-    threadid = nodeindex / step;        
-    
-    thread = &sender->thread_control[threadid];
+
+    /* Scale the senders with the consumers connected so far. */
+    if (sender->thread_started < sender->thread_num)
+    {
+        active = pg_atomic_read_u32(&sender->active_nodes);
+        if (sender->thread_started < DIVIDE_UP(active, DATAPUMP_NODES_PER_THREAD) &&
+            !StartSenderThread(sender))
+        {
+            elog(DEBUG1, DATA_PUMP_PREFIX"could not start more sender, keep %d sender for %s",
+                 sender->thread_started, sender->convert_control.sqname);
+            sender->thread_num = sender->thread_started;
+        }
+    }
     
-    /* Tell thread to send data. */
+    /* Tell any idle thread to send data. */
     node = &sender->nodes[nodeindex];
     SetBorder(node->buffer);
-    ThreadSemaUp(&thread->send_sem);
+    ThreadSemaUp(&sender->send_sem);
 }
 
 void
@@ -6510,6 +8028,8 @@ InitParallelSendNodeControl(int32 nodeId, ParallelSendNodeControl *control, int3
     control->sleep_count        = 0;
     control->current_buffer     = 0;
     control->send_timies        = 0;
+    control->shm_channel        = NULL;
+    DataPumpShmChannelRegisterExit();
 
     /* pointer to data buffer in share memory, set later */
     control->buffer = (ParallelSendDataQueue **)palloc0(sizeof(ParallelSendDataQueue *) * numParallelWorkers);
@@ -6955,6 +8475,11 @@ ParallelSenderSendData(ParallelSendThreadControl *threadControl, bool last_send)
                             node->status = DataPumpSndStatus_done;
                         }
                         spinlock_unlock(&node->lock);
+
+                        if (node->status == DataPumpSndStatus_done && node->shm_channel)
+                        {
+                            DataPumpShmChannelFinish(node->shm_channel);
+                        }
                     }
                 }
             }
@@ -7238,6 +8763,19 @@ RawSendNodeData(ParallelSendNodeControl *node, int32 sock, char * data, int32 le
     int32  offset       = 0;
     int32  nbytes_write = 0;
 
+    if (node->shm_channel)
+    {
+        offset = DataPumpShmChannelWrite(node->shm_channel, data, len);
+        if (offset < len)
+        {
+            /* Ring is full, behave like a stuck socket. */
+            pg_usleep(1000L);
+            node->sleep_count++;
+            *reason = EAGAIN;
+        }
+        return offset;
+    }
+
     while (offset < len)
     {
         nbytes_write = send(sock, data + offset, len - offset, 0);
@@ -7286,6 +8824,12 @@ SetNodeSocket(void *sndctl, int32 nodeindex, int32 nodeId,  int32 socket)
         return DataPumpSndError_node_error;
     }
 
+    /* Announce the shared memory channel before any data goes out. */
+    if (g_DataPumpShmChannel && NO_SOCKET == node->sock && DataPumpSndStatus_no_socket == node->status)
+    {
+        node->shm_channel = DataPumpShmChannelCreate(socket);
+    }
+
     /* Use lock to check status and socket */
     socket_set_nonblocking(socket, true);
     spinlock_lock(&node->lock);
@@ -7396,6 +8940,12 @@ DestoryParallelSendControl (void* sndctl, int nodeid)
         {        
             pfree(sender->nodes[i].buffer);
 
+            if (sender->nodes[i].shm_channel)
+            {
+                DataPumpShmChannelDestroy(sender->nodes[i].shm_channel);
+                sender->nodes[i].shm_channel = NULL;
+            }
+
             if (sender->nodes[i].sock != NO_SOCKET && sender->nodes[i].nodeId != nodeid)
             {
                 close(sender->nodes[i].sock);
@@ -9464,6 +11014,97 @@ int PipeLength(PGPipe *pPipe)
     return len;
 }
 
+/*
+ * pg_stat_get_datapump
+ *        Return the data pump counters of the consumer nodes served by this
+ *        node, used by the pg_stat_datapump view. Times are reported in
+ *        milliseconds.
+ */
+Datum
+pg_stat_get_datapump(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_DATAPUMP_COLS 10
+    ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+    TupleDesc    tupdesc;
+    Tuplestorestate *tupstore;
+    MemoryContext per_query_ctx;
+    MemoryContext oldcontext;
+    DataPumpNodeStat *stats;
+    Oid         *dnOids = NULL;
+    int          numDNodes = 0;
+    int          i;
+
+    /* check to see if caller supports us returning a tuplestore */
+    if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("set-valued function called in context that cannot accept a set")));
+    if (!(rsinfo->allowedModes & SFRM_Materialize))
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("materialize mode required, but it is not " \
+                        "allowed in this context")));
+
+    /* Build a tuple descriptor for our result type */
+    if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+        elog(ERROR, "return type must be a row type");
+
+    per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+    oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+    tupstore = tuplestore_begin_heap(true, false, work_mem);
+    rsinfo->returnMode = SFRM_Materialize;
+    rsinfo->setResult = tupstore;
+    rsinfo->setDesc = tupdesc;
+
+    MemoryContextSwitchTo(oldcontext);
+
+    if (NULL == DataPumpStats)
+        return (Datum) 0;
+
+    stats = (DataPumpNodeStat *) palloc(sizeof(DataPumpStats->nodes));
+    SpinLockAcquire(&DataPumpStats->mutex);
+    memcpy(stats, DataPumpStats->nodes, sizeof(DataPumpStats->nodes));
+    SpinLockRelease(&DataPumpStats->mutex);
+
+    /* Node index is the position of the datanode in the node list. */
+    PgxcNodeGetOids(NULL, &dnOids, NULL, &numDNodes, false);
+
+    for (i = 0; i < TBASE_MAX_DATANODE_NUMBER; i++)
+    {
+        Datum        values[PG_STAT_GET_DATAPUMP_COLS];
+        bool        nulls[PG_STAT_GET_DATAPUMP_COLS];
+        char       *nodename = NULL;
+
+        if (0 == stats[i].senders)
+            continue;
+
+        MemSet(nulls, 0, sizeof(nulls));
+        values[0] = Int32GetDatum(i);
+        if (i < numDNodes)
+            nodename = get_pgxc_nodename(dnOids[i]);
+        if (nodename != NULL)
+            values[1] = CStringGetTextDatum(nodename);
+        else
+            nulls[1] = true;
+        values[2] = Int64GetDatum((int64) stats[i].senders);
+        values[3] = Int64GetDatum((int64) stats[i].max_depth);
+        values[4] = Int64GetDatum((int64) stats[i].stall_count);
+        values[5] = Float8GetDatum(stats[i].stall_time / 1000.0);
+        values[6] = Int64GetDatum((int64) stats[i].raw_bytes);
+        values[7] = Int64GetDatum((int64) stats[i].compressed_bytes);
+        if (stats[i].compressed_bytes > 0)
+            values[8] = Float8GetDatum((double) stats[i].raw_bytes / stats[i].compressed_bytes);
+        else
+            nulls[8] = true;
+        values[9] = Float8GetDatum(stats[i].compress_time / 1000.0);
+
+        tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+    }
+
+    return (Datum) 0;
+}
+
 #endif
 
 const char *
@@ -97,6 +97,7 @@
 #include "utils/ps_status.h"
 #include "utils/timeout.h"
 #ifdef __TBASE__
+#include "commands/sequence.h"
 #include "executor/nodeAgg.h"
 #include "executor/nodeHashjoin.h"
 #include "pgxc/squeue.h"
@@ -203,6 +204,11 @@ static const struct
         "ApplyAuditFgaMain", ApplyAuditFgaMain
     }
 #endif
+#ifdef __TBASE__
+    ,{
+        "SequenceCacheRefillerMain", SequenceCacheRefillerMain
+    }
+#endif
 };
 
 /* Private functions. */
@@ -3607,6 +3607,11 @@ pgstat_get_wait_activity(WaitEventActivity w)
         case WAIT_EVENT_AUDIT_FGA_MAIN:
             event_name = "AuditFgaMain";
             break;
+#endif
+#ifdef __TBASE__
+        case WAIT_EVENT_SEQUENCE_CACHE_MAIN:
+            event_name = "SequenceCacheMain";
+            break;
 #endif
         case WAIT_EVENT_CLUSTER_MONITOR_MAIN:
             event_name = "ClusterMonitorMain";
@@ -3724,6 +3729,14 @@ pgstat_get_wait_ipc(WaitEventIPC w)
         case WAIT_EVENT_SYNC_REP:
             event_name = "SyncRep";
             break;
+#ifdef __TBASE__
+        case WAIT_EVENT_GTS_BROKER:
+            event_name = "GTSBroker";
+            break;
+        case WAIT_EVENT_SHARD_MOVE_FENCE:
+            event_name = "ShardMoveFence";
+            break;
+#endif
             /* no default case, so that compiler will warn */
     }
 
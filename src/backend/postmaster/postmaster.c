@@ -162,6 +162,10 @@
 #include "audit/audit_fga.h"
 #endif
 
+#ifdef __TBASE__
+#include "commands/sequence.h"
+#endif
+
 /*
  * Possible types of a backend. Beyond being the possible bkend_type values in
  * struct bkend, these are OR-able request flag bits for SignalSomeChildren()
@@ -1149,6 +1153,13 @@ PostmasterMain(int argc, char *argv[])
         */
     ApplyAuditFgaRegister();
 
+#ifdef __TBASE__
+    /*
+     * Register the sequence cache refiller
+     */
+    SequenceCacheRefillerRegister();
+#endif
+
     /*
      * process any libraries that should be preloaded at postmaster start
      */
@@ -2832,6 +2843,11 @@ reset_shared(int port)
      * objects if the postmaster crashes and is restarted.
      */
     CreateSharedMemoryAndSemaphores(false, port);
+
+#ifdef __TBASE__
+    /* Data pump channels of the backends that died with the old cycle. */
+    DataPumpShmChannelCleanup(-1);
+#endif
 }
 
 
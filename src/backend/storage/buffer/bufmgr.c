@@ -3387,6 +3387,41 @@ void DropRelfileNodeExtentBuffers(RelFileNode rnode, ExtentID eid)
             UnlockBufHdr(bufHdr, buf_state);
     }
 }
+
+/*
+ * Same as DropRelfileNodeExtentBuffers for a set of extents, with a single
+ * pass over the buffer pool.  The caller must hold AccessExclusiveLock on the
+ * relation.  eids is sorted in place.
+ */
+void DropRelfileNodeExtentsBuffers(RelFileNode rnode, ExtentID *eids, int neids)
+{
+    int            i;
+
+    if (neids == 0)
+        return;
+
+    pg_qsort(eids, neids, sizeof(ExtentID), extentid_comparator);
+
+    for (i = 0; i < NBuffers; i++)
+    {
+        BufferDesc *bufHdr = GetBufferDescriptor(i);
+        uint32        buf_state;
+        ExtentID    eid;
+
+        /* see DropRelfileNodeExtentBuffers about the unlocked precheck */
+        if (!RelFileNodeEquals(bufHdr->tag.rnode, rnode))
+            continue;
+
+        buf_state = LockBufHdr(bufHdr);
+        eid = bufHdr->tag.blockNum / PAGES_PER_EXTENTS;
+        if (RelFileNodeEquals(bufHdr->tag.rnode, rnode) &&
+            bufHdr->tag.forkNum == MAIN_FORKNUM &&
+            bsearch(&eid, eids, neids, sizeof(ExtentID), extentid_comparator) != NULL)
+            InvalidateBuffer(bufHdr);    /* releases spinlock */
+        else
+            UnlockBufHdr(bufHdr, buf_state);
+    }
+}
 #endif
 
 
@@ -4454,6 +4489,25 @@ rnode_comparator(const void *p1, const void *p2)
         return 0;
 }
 
+#ifdef _SHARDING_
+/*
+ * ExtentID qsort/bsearch comparator.
+ */
+int
+extentid_comparator(const void *p1, const void *p2)
+{
+    ExtentID    e1 = *(const ExtentID *) p1;
+    ExtentID    e2 = *(const ExtentID *) p2;
+
+    if (e1 < e2)
+        return -1;
+    else if (e1 > e2)
+        return 1;
+    else
+        return 0;
+}
+#endif
+
 /*
  * Lock buffer header - set BM_LOCKED in buffer state.
  */
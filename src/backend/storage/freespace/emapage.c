@@ -97,7 +97,9 @@
 #include "storage/lmgr.h"
 #include "storage/smgr.h"
 #include "utils/builtins.h"
+#include "utils/hsearch.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "funcapi.h"
 #include "lib/stringinfo.h"
 #include "utils/relcryptmap.h"
@@ -5131,55 +5133,308 @@ repair_eme(Relation rel, BlockNumber blk, ShardID sid)
     
 }
 
+/*---------------------------------------------------------------------------
+ *
+ * Shard free space summary
+ *
+ * Finding an extent with enough free space used to walk the alloc list of
+ * the shard, reading one EMA page per extent. Each backend now keeps, per
+ * relation and shard, a max-tree over the max_freespace of the extents of
+ * the alloc list, built by one walk of the list and searched in O(log n)
+ * afterwards, like the upper levels of a FSM page.
+ *
+ * The summary is only a hint derived from the EMEs, whose freespace is
+ * WAL-logged already: a candidate is checked against its EME before being
+ * returned and its leaf is corrected when stale. Extents which got space
+ * back or were attached by other backends are found by rebuilding the
+ * summary when the search fails, which costs what a failed walk of the list
+ * did before.
+ *
+ *---------------------------------------------------------------------------
+ */
+typedef struct ShardFreeSpaceKey
+{
+    RelFileNode rnode;
+    ShardID     sid;
+} ShardFreeSpaceKey;
+
+typedef struct ShardFreeSpaceTree
+{
+    ShardFreeSpaceKey key;
+    bool        valid;          /* built since the entry was created */
+    int         nleaves;        /* number of extents in the summary */
+    int         capacity;       /* number of leaves, a power of 2 */
+    uint8       *nodes;         /* 2 * capacity - 1 nodes, nodes[0] is the root,
+                                 * a leaf is freespace + 1, 0 if unused */
+    ExtentID    *eids;          /* extent of each leaf */
+} ShardFreeSpaceTree;
+
+#define SFS_MIN_CAPACITY    64
+#define SFS_MAX_ENTRIES     8192
+
+#define SFS_LEAF_NODE(tree, leaf)   ((tree)->capacity - 1 + (leaf))
+
+static HTAB *ShardFreeSpaceHash = NULL;
+static MemoryContext ShardFreeSpaceContext = NULL;
+
 /*
- * add new extent to shard list if there is no available extent
+ * Get the summary of a shard, creating an empty one if needed.
  */
-ExtentID
-GetExtentWithFreeSpace(Relation rel, ShardID sid, uint8 min_cat)
+static ShardFreeSpaceTree *
+sfs_get_tree(Relation rel, ShardID sid)
+{
+    ShardFreeSpaceKey key;
+    ShardFreeSpaceTree *tree;
+    bool        found;
+
+    if (ShardFreeSpaceHash != NULL &&
+        hash_get_num_entries(ShardFreeSpaceHash) >= SFS_MAX_ENTRIES)
+    {
+        /* Forget everything rather than tracking dropped relations */
+        MemoryContextReset(ShardFreeSpaceContext);
+        ShardFreeSpaceHash = NULL;
+    }
+
+    if (ShardFreeSpaceHash == NULL)
+    {
+        HASHCTL     ctl;
+
+        if (ShardFreeSpaceContext == NULL)
+            ShardFreeSpaceContext = AllocSetContextCreate(TopMemoryContext,
+                                                          "shard free space summary",
+                                                          ALLOCSET_DEFAULT_SIZES);
+        MemSet(&ctl, 0, sizeof(ctl));
+        ctl.keysize = sizeof(ShardFreeSpaceKey);
+        ctl.entrysize = sizeof(ShardFreeSpaceTree);
+        ctl.hcxt = ShardFreeSpaceContext;
+        ShardFreeSpaceHash = hash_create("shard free space summary", 256, &ctl,
+                                         HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+    }
+
+    MemSet(&key, 0, sizeof(key));
+    key.rnode = rel->rd_node;
+    key.sid = sid;
+
+    tree = (ShardFreeSpaceTree *) hash_search(ShardFreeSpaceHash, &key, HASH_ENTER, &found);
+    if (!found)
+    {
+        tree->valid = false;
+        tree->nleaves = 0;
+        tree->capacity = SFS_MIN_CAPACITY;
+        tree->nodes = MemoryContextAllocZero(ShardFreeSpaceContext,
+                                             (2 * SFS_MIN_CAPACITY - 1) * sizeof(uint8));
+        tree->eids = MemoryContextAlloc(ShardFreeSpaceContext,
+                                        SFS_MIN_CAPACITY * sizeof(ExtentID));
+    }
+
+    return tree;
+}
+
+/*
+ * Set the value of a leaf and propagate it to the root. Leaves of extents
+ * which left the shard are cleared, so that no search finds them again.
+ */
+static void
+sfs_set_leaf(ShardFreeSpaceTree *tree, int leaf, uint8 value)
+{
+    int         node = SFS_LEAF_NODE(tree, leaf);
+
+    tree->nodes[node] = value;
+    while (node > 0)
+    {
+        int         parent = (node - 1) / 2;
+        int         left = 2 * parent + 1;
+        uint8       newvalue = Max(tree->nodes[left], tree->nodes[left + 1]);
+
+        if (tree->nodes[parent] == newvalue)
+            break;
+        tree->nodes[parent] = newvalue;
+        node = parent;
+    }
+}
+
+/*
+ * Add an extent after the last leaf, doubling the tree when it is full.
+ */
+static void
+sfs_append(ShardFreeSpaceTree *tree, ExtentID eid, uint8 freespace)
+{
+    if (tree->nleaves == tree->capacity)
+    {
+        int         old_capacity = tree->capacity;
+        uint8       *old_nodes = tree->nodes;
+        int         leaf;
+
+        tree->capacity = old_capacity * 2;
+        tree->nodes = MemoryContextAllocZero(ShardFreeSpaceContext,
+                                             (2 * tree->capacity - 1) * sizeof(uint8));
+        tree->eids = repalloc(tree->eids, tree->capacity * sizeof(ExtentID));
+
+        for (leaf = 0; leaf < tree->nleaves; leaf++)
+            sfs_set_leaf(tree, leaf, old_nodes[old_capacity - 1 + leaf]);
+        pfree(old_nodes);
+    }
+
+    tree->eids[tree->nleaves] = eid;
+    sfs_set_leaf(tree, tree->nleaves, freespace + 1);
+    tree->nleaves++;
+}
+
+static void
+sfs_reset(ShardFreeSpaceTree *tree)
+{
+    MemSet(tree->nodes, 0, (2 * tree->capacity - 1) * sizeof(uint8));
+    tree->nleaves = 0;
+}
+
+/*
+ * Find the first leaf with a value of at least min_cat, or -1. Leaves keep
+ * the order of the alloc list, so this is the extent the walk of the list
+ * would have returned.
+ */
+static int
+sfs_search(ShardFreeSpaceTree *tree, uint8 min_cat)
+{
+    int         target = min_cat + 1;
+    int         node = 0;
+
+    if (tree->nodes[0] < target)
+        return -1;
+
+    while (node < tree->capacity - 1)
+    {
+        int         left = 2 * node + 1;
+
+        node = tree->nodes[left] >= target ? left : left + 1;
+    }
+
+    return node - (tree->capacity - 1);
+}
+
+/*
+ * Read the free space of an extent, false if it does not belong to the
+ * shard anymore.
+ */
+static bool
+sfs_extent_freespace(Relation rel, ShardID sid, ExtentID eid, uint8 *freespace)
+{
+    EMAAddress  addr;
+    Buffer      buf;
+    EMAPage     pg;
+    bool        owned = false;
+
+    addr = ema_eid_to_address(eid);
+    buf = extent_readbuffer(rel, addr.physical_page_number, false);
+    if (BufferIsInvalid(buf))
+        return false;
+
+    LockBuffer(buf, BUFFER_LOCK_SHARE);
+    pg = (EMAPage)PageGetContents(BufferGetPage(buf));
+    if (addr.local_idx < pg->n_emes &&
+        pg->ema[addr.local_idx].is_occupied &&
+        pg->ema[addr.local_idx].shardid == sid)
+    {
+        *freespace = pg->ema[addr.local_idx].max_freespace;
+        owned = true;
+    }
+    UnlockReleaseBuffer(buf);
+
+    return owned;
+}
+
+/*
+ * Rebuild the summary from the alloc list of the shard, and return the first
+ * extent with at least min_cat free space.
+ */
+static ExtentID
+sfs_rebuild(Relation rel, ShardID sid, ShardFreeSpaceTree *tree, uint8 min_cat)
 {// #lizard forgives
-    EMAShardAnchor anchor = esa_get_anchor(rel, sid);
+    EMAShardAnchor anchor;
     ExtentID    e_idx;
     ExtentID    e_next;
     ExtentID    result = InvalidExtentID;
     uint8        avail;
 
+    sfs_reset(tree);
+
     LockShard(rel, sid, AccessShareLock);
-    if(ExtentIdIsValid(anchor.alloc_head))
+    anchor = esa_get_anchor(rel, sid);
+    e_idx = anchor.alloc_head;
+
+    while(ExtentIdIsValid(e_idx))
     {
-        e_idx = anchor.alloc_head;
+        ShardID e_sid = InvalidShardID;
+        bool    occupied = false;
+        e_next = ema_next_alloc(rel, e_idx, true, &occupied, &e_sid, NULL, &avail);
 
-        while(ExtentIdIsValid(e_idx))
+        if(!occupied)
         {
-            ShardID e_sid = InvalidShardID;
-            bool    occupied = false;
-            e_next = ema_next_alloc(rel, e_idx, true, &occupied, &e_sid, NULL, &avail);
+            elog(WARNING, "eid %d is in the list of shard %d, but the occupation flag is false.",
+                    e_idx, sid);
+        }
 
-            if(!occupied)
-            {
-                elog(WARNING, "eid %d is in the list of shard %d, but the occupation flag is false.",
-                        e_idx, sid);
-            }
+        if(occupied && e_sid != sid)
+        {
+            elog(WARNING, "eid %d is in the list of shard %d, but shardid of EME is %d.",
+                    e_idx, sid, e_sid);
+        }
 
-            if(occupied && e_sid != sid)
-            {
-                elog(WARNING, "eid %d is in the list of shard %d, but shardid of EME is %d.",
-                        e_idx, sid, e_sid);
-            }
-            
-            if(avail >= min_cat)
-            {
-                result = e_idx;
-                break;
-            }
-            else
-                e_idx = e_next;
-        }            
+        if(occupied && e_sid == sid)
+            sfs_append(tree, e_idx, avail);
+
+        if(!ExtentIdIsValid(result) && avail >= min_cat)
+            result = e_idx;
+
+        e_idx = e_next;
     }
     UnlockShard(rel, sid, AccessShareLock);
+
+    tree->valid = true;
+
+    return result;
+}
+
+/*
+ * add new extent to shard list if there is no available extent
+ */
+ExtentID
+GetExtentWithFreeSpace(Relation rel, ShardID sid, uint8 min_cat)
+{
+    ShardFreeSpaceTree *tree = sfs_get_tree(rel, sid);
+    ExtentID    result = InvalidExtentID;
+
+    while(tree->valid)
+    {
+        int      leaf = sfs_search(tree, min_cat);
+        uint8    avail = 0;
+
+        if(leaf < 0)
+            break;
+
+        if(!sfs_extent_freespace(rel, sid, tree->eids[leaf], &avail))
+        {
+            sfs_set_leaf(tree, leaf, 0);
+            continue;
+        }
+
+        sfs_set_leaf(tree, leaf, avail + 1);
+        if(avail >= min_cat)
+        {
+            result = tree->eids[leaf];
+            break;
+        }
+
+        /* the leaf was stale, lowering it guarantees the loop ends */
+    }
+
+    if(result == InvalidExtentID)
+        result = sfs_rebuild(rel, sid, tree, min_cat);
     
     if(result == InvalidExtentID)
     {
         result = shard_apply_free_extent(rel,sid);
+        if(ExtentIdIsValid(result))
+            sfs_append(tree, result, MAX_FREESPACE);
     }
 
     return result;
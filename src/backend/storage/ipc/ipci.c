@@ -77,12 +77,16 @@
 
 #include "access/clog.h"
 #include "access/commit_ts.h"
+#include "access/gtm.h"
 #include "access/heapam.h"
 #include "access/multixact.h"
 #include "access/nbtree.h"
 #include "access/subtrans.h"
 #include "access/twophase.h"
 #include "commands/async.h"
+#ifdef __TBASE__
+#include "commands/sequence.h"
+#endif
 #include "miscadmin.h"
 #include "pgstat.h"
 #ifdef PGXC
@@ -226,6 +230,9 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 #ifdef __TBASE__        
         size = add_size(size, GTSTrackSize());
         size = add_size(size, RecoveryGTMHostSize());
+        size = add_size(size, GTSBrokerShmemSize());
+        size = add_size(size, HLCShmemSize());
+        size = add_size(size, SequenceCacheShmemSize());
 #endif
 #ifdef __TBASE_DEBUG__
         size = add_size(size, SnapTableShmemSize());
@@ -291,6 +298,7 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 #endif
 #ifdef _SHARDING_
         size = add_size(size, ShardBarrierShmemSize());
+        size = add_size(size, ShardMoveShmemSize());
 #endif
 #ifdef _MLS_
         size = add_size(size, MlsShmemSize());
@@ -376,6 +384,9 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 #ifdef __TBASE__
     GTSTrackInit();
     RecoveryGTMHostInit();
+    GTSBrokerShmemInit();
+    HLCShmemInit();
+    SequenceCacheShmemInit();
 #endif
 
 #ifdef __TBASE_DEBUG__
@@ -466,6 +477,7 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 
 #ifdef _SHARDING_
     ShardBarrierShmemInit();
+    ShardMoveShmemInit();
 #endif
 
 #ifdef __TBASE__
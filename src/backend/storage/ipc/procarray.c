@@ -4137,6 +4137,15 @@ GetGlobalTimestampFromGTM(Snapshot snapshot)
 {
     GlobalTimestamp start_ts;
 
+#ifdef __TBASE__
+    /* Read-only transactions may use the hybrid logical clock */
+    if (enable_hlc_readonly_gts && XactReadOnly &&
+        IS_PGXC_LOCAL_COORDINATOR && !IsStandbyPostgres())
+    {
+        start_ts = (GlobalTimestamp) GetGlobalTimestampHLC();
+    }
+    else
+#endif
     start_ts = (GlobalTimestamp) GetGlobalTimestampGTM();
     snapshot->start_ts = start_ts;
     
@@ -244,6 +244,8 @@ InitProcGlobal(void)
         }
 #ifdef __TBASE__
         LWLockInitialize(&(procs[i].globalxidLock), LWTRANCHE_PROC_DATA);
+        procs[i].gtsBrokerMember = false;
+        pg_atomic_init_u32(&procs[i].gtsBrokerNext, INVALID_PGPROCNO);
 #endif
         procs[i].pgprocno = i;
 
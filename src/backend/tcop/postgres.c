@@ -249,6 +249,7 @@ static void log_disconnections(int code, Datum arg);
 #ifdef __TBASE__
 static void replace_null_with_blank(char *src, int length);
 static bool NeedResourceOwner(const char *stmt_name);
+static void WaitForCommandWithAffinity(void);
 #endif
 
 #ifdef __COLD_HOT__
@@ -736,6 +737,50 @@ ReadCommand(StringInfo inBuf)
     return result;
 }
 
+#ifdef __TBASE__
+/*
+ * Wait for the next command while the session keeps its connections, and give
+ * them back to the pool once it has been idle for connection_affinity_time.
+ * Cleaning up the remote sessions takes network I/O and may fail, so it is
+ * done here between commands rather than from the client read interrupt.
+ */
+static void
+WaitForCommandWithAffinity(void)
+{
+    int rc;
+
+    if (whereToSendOutput != DestRemote || pq_buffer_has_data())
+        return;
+#ifdef USE_OPENSSL
+    if (MyProcPort->ssl_in_use && SSL_pending(MyProcPort->ssl) > 0)
+        return;
+#endif
+
+    for (;;)
+    {
+        rc = WaitLatchOrSocket(MyLatch,
+                               WL_LATCH_SET | WL_SOCKET_READABLE | WL_POSTMASTER_DEATH,
+                               MyProcPort->sock, -1L, WAIT_EVENT_CLIENT_READ);
+        ResetLatch(MyLatch);
+
+        /* Same interrupts as while reading the command */
+        ProcessClientReadInterrupt(true);
+
+        /* ReadCommand finds out about those */
+        if (rc & (WL_SOCKET_READABLE | WL_POSTMASTER_DEATH))
+            return;
+
+        /* Session is idle for connection_affinity_time */
+        if (ConnectionAffinityTimeoutPending)
+        {
+            ConnectionAffinityTimeoutPending = false;
+            pgxc_node_release_idle_handles();
+            return;
+        }
+    }
+}
+#endif
+
 /*
  * ProcessClientReadInterrupt() - Process interrupts specific to client reads
  *
@@ -4797,6 +4842,9 @@ PostgresMain(int argc, char *argv[],
     volatile bool send_ready_for_query = true;
     volatile bool need_report_activity = false;
     bool        disable_idle_in_transaction_timeout = false;
+#ifdef __TBASE__
+    bool        disable_connection_affinity_timeout = false;
+#endif
 
 #ifdef PGXC /* PGXC_DATANODE */
     /* Snapshot info */
@@ -5408,6 +5456,16 @@ PostgresMain(int argc, char *argv[],
 
                 set_ps_display("idle", false);
                 pgstat_report_activity(STATE_IDLE, NULL);
+
+#ifdef __TBASE__
+                /* Give the kept connections back if no command comes in time */
+                if (ConnectionAffinityTime > 0 && is_pgxc_handles_held())
+                {
+                    disable_connection_affinity_timeout = true;
+                    enable_timeout_after(CONNECTION_AFFINITY_TIMEOUT,
+                                         ConnectionAffinityTime);
+                }
+#endif
             }
 
             if(send_ready_for_query)
@@ -5445,6 +5503,10 @@ PostgresMain(int argc, char *argv[],
         DoingCommandRead = true;
 #ifdef __TBASE__
         RESUME_POOLER_RELOAD();
+#endif
+#ifdef __TBASE__
+        if (disable_connection_affinity_timeout)
+            WaitForCommandWithAffinity();
 #endif
         /*
          * (3) read a command (loop blocks here)
@@ -5474,6 +5536,15 @@ PostgresMain(int argc, char *argv[],
             disable_idle_in_transaction_timeout = false;
         }
 
+#ifdef __TBASE__
+        if (disable_connection_affinity_timeout)
+        {
+            disable_timeout(CONNECTION_AFFINITY_TIMEOUT, false);
+            disable_connection_affinity_timeout = false;
+            ConnectionAffinityTimeoutPending = false;
+        }
+#endif
+
         /*
          * (6) check for any other interesting events that happened while we
          * slept.
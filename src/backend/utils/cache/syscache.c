@@ -96,6 +96,9 @@
 #ifdef __COLD_HOT__
 #include "catalog/pgxc_key_values.h"
 #endif
+#ifdef _SHARDING_
+#include "catalog/pg_shard_statistic.h"
+#endif
 
 /*---------------------------------------------------------------------------
 
@@ -1079,6 +1082,19 @@ static const struct cachedesc cacheinfo[] = {
         },
         128
     },
+#endif
+#ifdef _SHARDING_
+    {ShardStatisticRelationId,        /* SHARDSTATRELID */
+        ShardStatisticRelidIndexId,
+        1,
+        {
+            Anum_pg_shard_statistic_starelid,
+            0,
+            0,
+            0
+        },
+        256
+    },
 #endif
     {StatisticExtRelationId,    /* STATEXTNAMENSP */
         StatisticExtNameIndexId,
@@ -100,6 +100,7 @@ volatile uint32 CritSectionCount = 0;
 #ifdef __TBASE__
 volatile int PoolerReloadHoldoffCount = 0;
 volatile int PoolerReloadPending = 0;
+volatile bool ConnectionAffinityTimeoutPending = false;
 #endif
 
 
@@ -90,6 +90,9 @@ static void ShutdownPostgres(int code, Datum arg);
 static void StatementTimeoutHandler(void);
 static void LockTimeoutHandler(void);
 static void IdleInTransactionSessionTimeoutHandler(void);
+#ifdef __TBASE__
+static void ConnectionAffinityTimeoutHandler(void);
+#endif
 static bool ThereIsAtLeastOneRole(void);
 static void process_startup_options(Port *port, bool am_superuser);
 static void process_settings(Oid databaseid, Oid roleid);
@@ -622,6 +625,10 @@ InitPostgres(const char *in_dbname, Oid dboid, const char *username,
         RegisterTimeout(LOCK_TIMEOUT, LockTimeoutHandler);
         RegisterTimeout(IDLE_IN_TRANSACTION_SESSION_TIMEOUT,
                         IdleInTransactionSessionTimeoutHandler);
+#ifdef __TBASE__
+        RegisterTimeout(CONNECTION_AFFINITY_TIMEOUT,
+                        ConnectionAffinityTimeoutHandler);
+#endif
     }
 
     /*
@@ -1302,6 +1309,19 @@ IdleInTransactionSessionTimeoutHandler(void)
     SetLatch(MyLatch);
 }
 
+#ifdef __TBASE__
+/*
+ * The connections are released while waiting for the next command, see
+ * WaitForCommandWithAffinity.
+ */
+static void
+ConnectionAffinityTimeoutHandler(void)
+{
+    ConnectionAffinityTimeoutPending = true;
+    SetLatch(MyLatch);
+}
+#endif
+
 /*
  * Returns true if at least one role is defined in this database cluster.
  */
@@ -126,6 +126,7 @@
 #include "optimizer/plancat.h"
 #include "parser/analyze.h"
 #include "pgxc/groupmgr.h"
+#include "pgxc/shardmap.h"
 #include "utils/lsyscache.h"
 #endif
 
@@ -1185,6 +1186,29 @@ static struct config_bool ConfigureNamesBool[] =
         false,
         NULL, NULL, NULL
     },
+#ifdef __TBASE__
+    {
+        {"enable_gts_broker", PGC_SUSET, QUERY_TUNING_METHOD,
+            gettext_noop("Enables backends to share global timestamp requests to GTM."),
+            gettext_noop("Concurrent requests of the backends of this node are served "
+                         "by a single request to GTM.")
+        },
+        &enable_gts_broker,
+        false,
+        NULL, NULL, NULL
+    },
+    {
+        {"enable_hlc_readonly_gts", PGC_SUSET, QUERY_TUNING_METHOD,
+            gettext_noop("Enables read-only transactions to get their global timestamp "
+                         "from the hybrid logical clock of the coordinator."),
+            gettext_noop("The clock is synchronized with GTM, the snapshots lag "
+                         "behind GTM by hlc_max_skew.")
+        },
+        &enable_hlc_readonly_gts,
+        false,
+        NULL, NULL, NULL
+    },
+#endif
     {
         {"enable_datanode_row_triggers", PGC_POSTMASTER, DEVELOPER_OPTIONS,
             gettext_noop("Enables datanode-only ROW triggers"),
@@ -2095,6 +2119,16 @@ static struct config_bool ConfigureNamesBool[] =
         NULL, NULL, NULL
     },
 
+    {
+        {"enable_datapump_shm_channel", PGC_SIGHUP, CUSTOM_OPTIONS,
+            gettext_noop("send data pump data to consumers on the same host through shared memory."),
+            NULL
+        },
+        &g_DataPumpShmChannel,
+        false,
+        NULL, NULL, NULL
+    },
+
     {
         {"enable_pullup_subquery", PGC_USERSET, CUSTOM_OPTIONS,
             gettext_noop("pullup subquery to make execution more efficient."),
@@ -2536,6 +2570,18 @@ static struct config_bool ConfigureNamesBool[] =
         false,
         NULL, NULL, NULL
     },
+#ifdef __TBASE__
+    {
+        {"enable_committs_cache", PGC_USERSET, CUSTOM_OPTIONS,
+            gettext_noop("Enables backend local copies of commit timestamp pages and "
+                         "reading the shared pages without lock."),
+            NULL
+        },
+        &enable_committs_cache,
+        true,
+        NULL, NULL, NULL
+    },
+#endif
 
 
     {
@@ -3366,6 +3412,19 @@ static struct config_int ConfigureNamesInt[] =
         NULL, NULL, NULL
     },
 
+#ifdef _SHARDING_
+    {
+        {"shard_move_fence_timeout", PGC_SIGHUP, CLIENT_CONN_STATEMENT,
+            gettext_noop("Sets the maximum time a write waits for the fence of a shard being moved."),
+            NULL,
+            GUC_UNIT_MS
+        },
+        &shard_move_fence_timeout,
+        1000, 1, INT_MAX,
+        NULL, NULL, NULL
+    },
+#endif
+
     {
         {"idle_in_transaction_session_timeout", PGC_USERSET, CLIENT_CONN_STATEMENT,
             gettext_noop("Sets the maximum allowed duration of any idling transaction."),
@@ -4417,6 +4476,63 @@ static struct config_int ConfigureNamesInt[] =
         1000, 1, INT_MAX,
         NULL, NULL, NULL
     },
+#ifdef __TBASE__
+    {
+        {"sequence_cache_entries", PGC_POSTMASTER, COORDINATORS,
+            gettext_noop("Sets the number of sequences whose ranges are shared by the backends of the node."),
+            gettext_noop("A value of 0 lets each backend fetch its own ranges from GTM.")
+        },
+        &SequenceCacheEntries,
+        0, 0, INT_MAX / 2,
+        NULL, NULL, NULL
+    },
+
+    {
+        {"sequence_cache_low_watermark", PGC_SIGHUP, COORDINATORS,
+            gettext_noop("Sets the percentage of a shared sequence range below which the next range is fetched in the background."),
+            NULL
+        },
+        &SequenceCacheLowWatermark,
+        50, 0, 100,
+        NULL, NULL, NULL
+    },
+
+    {
+        {"hlc_max_skew", PGC_SIGHUP, COORDINATORS,
+            gettext_noop("Sets the maximum skew between the hybrid logical clock and GTM."),
+            gettext_noop("Read-only snapshots of the hybrid logical clock lag behind "
+                         "GTM by this time. A larger skew found at synchronization "
+                         "sends them to GTM until the next one."),
+            GUC_UNIT_MS
+        },
+        &hlc_max_skew,
+        50, 0, 60000,
+        NULL, NULL, NULL
+    },
+
+    {
+        {"hlc_sync_interval", PGC_SUSET, COORDINATORS,
+            gettext_noop("Sets the longest time the hybrid logical clock is used without "
+                         "synchronizing with GTM."),
+            NULL,
+            GUC_UNIT_MS
+        },
+        &hlc_sync_interval,
+        1000, 0, 3600000,
+        NULL, NULL, NULL
+    },
+
+    {
+        {"hlc_simulated_skew", PGC_SIGHUP, DEVELOPER_OPTIONS,
+            gettext_noop("Moves the local clock read by the hybrid logical clock, for testing."),
+            NULL,
+            GUC_NOT_IN_SAMPLE | GUC_UNIT_MS
+        },
+        &hlc_simulated_skew,
+        0, -3600000, 3600000,
+        NULL, NULL, NULL
+    },
+#endif
 
 #ifdef __TBASE__
     {
@@ -4441,6 +4557,17 @@ static struct config_int ConfigureNamesInt[] =
         NULL, NULL, NULL
     },
 
+    {
+        {"connection_affinity_time", PGC_USERSET, DATA_NODES,
+            gettext_noop("Keep acquired connections across transactions until the session is idle for that time."),
+            gettext_noop("A value of 0 releases connections at the end of each transaction."),
+            GUC_UNIT_MS
+        },
+        &ConnectionAffinityTime,
+        0, 0, INT_MAX,
+        NULL, NULL, NULL
+    },
+
     {
         {"max_pool_size", PGC_POSTMASTER, DATA_NODES,
             gettext_noop("Max pool size."),
@@ -4658,6 +4785,28 @@ static struct config_int ConfigureNamesInt[] =
         1000, 1, INT_MAX,
         NULL, NULL, NULL
     },
+#ifdef __TBASE__
+    {
+        {"remote_dml_batch_rows", PGC_USERSET, UNGROUPED,
+            gettext_noop("Number of maximum rows of INSERT executed on coordinator sent to a datanode without waiting for the result"),
+            gettext_noop("0 sends every row on its own."),
+            0
+        },
+        &RemoteDMLBatchRows,
+        0, 0, 65536,
+        NULL, NULL, NULL
+    },
+    {
+        {"remote_dml_batch_size", PGC_USERSET, UNGROUPED,
+            gettext_noop("Max size of the rows of INSERT executed on coordinator sent to a datanode without waiting for the result"),
+            NULL,
+            GUC_UNIT_KB
+        },
+        &RemoteDMLBatchSize,
+        1024, 1, MAX_KILOBYTES,
+        NULL, NULL, NULL
+    },
+#endif
 #ifdef __TBASE__
     {
         {"sender_thread_num", PGC_SIGHUP, CUSTOM_OPTIONS,
@@ -4709,6 +4858,36 @@ static struct config_int ConfigureNamesInt[] =
         8, 1, 524288,
         NULL, NULL, NULL
     },
+    {
+        {"datapump_shm_channel_size", PGC_SIGHUP, CUSTOM_OPTIONS,
+            gettext_noop("size of each shared memory channel in datapump"),
+            NULL,
+            GUC_UNIT_KB
+        },
+        &g_DataPumpShmChannelSize,
+        1024, 64, 1048576,
+        NULL, NULL, NULL
+    },
+    {
+        {"datapump_batch_rows", PGC_USERSET, CUSTOM_OPTIONS,
+            gettext_noop("max rows sent in one columnar batch by datapump, 0 disables batching"),
+            NULL,
+            0
+        },
+        &g_DataPumpBatchRows,
+        0, 0, 65535,
+        NULL, NULL, NULL
+    },
+    {
+        {"datapump_compress_threshold", PGC_USERSET, CUSTOM_OPTIONS,
+            gettext_noop("min size in bytes of data compressed by datapump senders, -1 disables compression"),
+            NULL,
+            0
+        },
+        &g_DataPumpCompressThreshold,
+        -1, -1, INT_MAX,
+        NULL, NULL, NULL
+    },
     {
         {"archive_autowake_interval", PGC_USERSET, WAL_ARCHIVING,
             gettext_noop("how often to force a poll of the archive status directory in seconds."),
@@ -958,6 +958,10 @@ freeGTM_Conn(GTM_Conn *conn)
 		free(conn->result);
 	}
 #endif
+#ifdef __TBASE__
+    if (conn->async_queue)
+        free(conn->async_queue);
+#endif
 
     free(conn);
 }
@@ -262,6 +262,21 @@ GTMPQgetResult(GTM_Conn *conn)
     if (!conn)
         return NULL;
 
+#ifdef __TBASE__
+    /*
+     * The next reply belongs to an asynchronous request, it cannot be taken
+     * for the reply of a synchronous one. The stream is out of step after
+     * such a misuse, so the connection is not usable any more.
+     */
+    if (gtm_async_pending(conn))
+    {
+        printfGTMPQExpBuffer(&conn->errorMessage,
+                             "synchronous GTM request sent while asynchronous requests are outstanding\n");
+        conn->status = CONNECTION_BAD;
+        return NULL;
+    }
+#endif
+
     /* Parse any available data, if our state permits. */
     while ((res = pqParseInput(conn)) == NULL)
     {
@@ -295,6 +310,21 @@ GTMPQgetResult(GTM_Conn *conn)
     return res;
 }
 
+#ifdef __TBASE__
+/*
+ * Like GTMPQgetResult, but only parse the data already read from the server.
+ * Return NULL if no complete result is available yet.
+ */
+GTM_Result *
+GTMPQparseResult(GTM_Conn *conn)
+{
+    if (!conn)
+        return NULL;
+
+    return pqParseInput(conn);
+}
+#endif
+
 /*
  * return 0 if parsing command is totally completed.
  * return 1 if it needs to be read continuously.
@@ -428,6 +458,10 @@ break;
                 result->gr_status = GTM_RESULT_ERROR;
                 break;
             }
+            if (gtmpqGetc(&result->gr_resdata.grd_gts.gtm_readonly, conn) == EOF)
+            {
+                result->gr_resdata.grd_gts.gtm_readonly = false;
+            }
             break;
 
 
@@ -1043,6 +1077,43 @@ result->gr_status = GTM_RESULT_ERROR;
                 }
             }
 
+            if (result->gr_status == GTM_RESULT_ERROR)
+            {
+                break;
+            }
+
+            /* Server older than the version we asked for sends the base reply */
+            result->gr_resdata.statistic_result.version = GTM_STATISTICS_VERSION_BASE;
+            if (conn->inCursor >= conn->inStart + 5 + result->gr_msglen)
+            {
+                break;
+            }
+
+            if (gtmpqGetInt(&result->gr_resdata.statistic_result.version, sizeof(int32), conn))
+            {
+                result->gr_status = GTM_RESULT_ERROR;
+                break;
+            }
+
+            if (result->gr_resdata.statistic_result.version < GTM_STATISTICS_VERSION_XLOG_FLUSH)
+            {
+                break;
+            }
+
+            if (gtmpqGetInt((int32*) &result->gr_resdata.statistic_result.xlog_flush_info.flush_requests,
+                            sizeof(int32), conn) ||
+                gtmpqGetInt((int32*) &result->gr_resdata.statistic_result.xlog_flush_info.flush_times,
+                            sizeof(int32), conn) ||
+                gtmpqGetInt((int32*) &result->gr_resdata.statistic_result.xlog_flush_info.delayed_flushes,
+                            sizeof(int32), conn) ||
+                gtmpqGetInt((int32*) &result->gr_resdata.statistic_result.xlog_flush_info.avg_flush_costtime,
+                            sizeof(int32), conn) ||
+                gtmpqGetInt((int32*) &result->gr_resdata.statistic_result.xlog_flush_info.max_flush_costtime,
+                            sizeof(int32), conn))
+            {
+                result->gr_status = GTM_RESULT_ERROR;
+            }
+
             break;
         }
 	    case MSG_GET_GTM_ERRORLOG_RESULT:
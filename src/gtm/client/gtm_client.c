@@ -51,6 +51,10 @@ extern char  *application_name;
 void GTM_FreeResult(GTM_Result *result, GTM_PGXCNodeType remote_type);
 
 static GTM_Result *makeEmptyResultIfIsNull(GTM_Result *oldres);
+#ifdef __TBASE__
+static int send_global_timestamp_request(GTM_Conn *conn);
+static Get_GTS_Result receive_global_timestamp(GTM_Conn *conn);
+#endif
 static int commit_prepared_transaction_internal(GTM_Conn *conn,
                                                 GlobalTransactionId gxid, GlobalTransactionId prepared_gxid,
                                                 int waited_xid_count,
@@ -514,11 +518,22 @@ send_failed:
 
 Get_GTS_Result
 get_global_timestamp(GTM_Conn *conn)
-{// #lizard forgives
-    GTM_Result    *res = NULL;
+{
     Get_GTS_Result ret = {InvalidGlobalTimestamp,false};
-    time_t finish_time;
-    
+
+    if (send_global_timestamp_request(conn))
+    {
+        conn->result = makeEmptyResultIfIsNull(conn->result);
+        conn->result->gr_status = GTM_RESULT_COMM_ERROR;
+        return ret;
+    }
+
+    return receive_global_timestamp(conn);
+}
+
+static int
+send_global_timestamp_request(GTM_Conn *conn)
+{
      /* Start the message. */
     if (gtmpqPutMsgStart('C', true, conn) ||
         gtmpqPutInt(MSG_GETGTS, sizeof (GTM_MessageType), conn))
@@ -532,6 +547,19 @@ get_global_timestamp(GTM_Conn *conn)
     if (gtmpqFlush(conn))
         goto send_failed;
 
+    return 0;
+
+send_failed:
+    return -1;
+}
+
+static Get_GTS_Result
+receive_global_timestamp(GTM_Conn *conn)
+{
+    GTM_Result    *res = NULL;
+    Get_GTS_Result ret = {InvalidGlobalTimestamp,false};
+    time_t finish_time;
+
     finish_time = time(NULL) + CLIENT_GTM_TIMEOUT;
     if (gtmpqWaitTimed(true, false, conn, finish_time) ||
         gtmpqReadData(conn) < 0)
@@ -544,19 +572,391 @@ get_global_timestamp(GTM_Conn *conn)
     {
         ret.gts = res->gr_resdata.grd_gts.grd_gts;
         ret.gtm_readonly = res->gr_resdata.grd_gts.gtm_readonly;
-        
-        return ret;
     }
-    else
-        return ret;
+    return ret;
 
 receive_failed:
+    conn->result = makeEmptyResultIfIsNull(conn->result);
+    conn->result->gr_status = GTM_RESULT_COMM_ERROR;
+    return ret;
+}
+
+
+/*
+ * Get one global timestamp on behalf of count requests, which all use it.
+ */
+Get_GTS_Result
+get_global_timestamp_multi(GTM_Conn *conn, int count)
+{
+    Get_GTS_Result ret = {InvalidGlobalTimestamp,false};
+
+     /* Start the message. */
+    if (gtmpqPutMsgStart('C', true, conn) ||
+        gtmpqPutInt(MSG_GETGTS_MULTI, sizeof (GTM_MessageType), conn) ||
+        gtmpqPutInt(count, sizeof (int), conn))
+        goto send_failed;
+
+    /* Finish the message. */
+    if (gtmpqPutMsgEnd(conn))
+        goto send_failed;
+
+    /* Flush to ensure backend gets it. */
+    if (gtmpqFlush(conn))
+        goto send_failed;
+
+    return receive_global_timestamp(conn);
+
 send_failed:
     conn->result = makeEmptyResultIfIsNull(conn->result);
     conn->result->gr_status = GTM_RESULT_COMM_ERROR;
     return ret;
 }
 
+/*
+ * State of the asynchronous requests of a connection. The request of token t
+ * lives in requests[t % GTM_MAX_ASYNC_REQUESTS] until its result is taken by
+ * gtm_async_wait. Replies complete the requests in the order they were sent.
+ */
+typedef struct GTM_AsyncRequest
+{
+    GTM_AsyncToken    token;        /* InvalidGTMAsyncToken if the slot is free */
+    GTM_MessageType   mtype;
+    bool              done;         /* reply read, result is valid */
+    GTM_AsyncResult   result;
+} GTM_AsyncRequest;
+
+typedef struct GTM_AsyncQueue
+{
+    GTM_AsyncToken    last_sent;     /* token of the last request sent */
+    GTM_AsyncToken    last_done;     /* token of the last request answered */
+    int               outstanding;   /* requests not waited for yet */
+    int               msg_start;     /* outCount before the message being built */
+    GTM_AsyncRequest  requests[GTM_MAX_ASYNC_REQUESTS];
+} GTM_AsyncQueue;
+
+static GTM_AsyncToken
+gtm_async_next_token(GTM_AsyncToken token)
+{
+    if (++token == InvalidGTMAsyncToken)
+        ++token;
+    return token;
+}
+
+/*
+ * Drop the message of an asynchronous request that failed, so that what was
+ * put of it is not sent with the next request.
+ */
+static void
+gtm_async_discard(GTM_Conn *conn)
+{
+    GTM_AsyncQueue *queue = conn->async_queue;
+
+    if (conn->outCount > queue->msg_start)
+        conn->outCount = queue->msg_start;
+    conn->outMsgEnd = conn->outCount;
+}
+
+/*
+ * Start an asynchronous request: reserve the slot of the next token and begin
+ * the message. Return NULL if all the slots are taken or the message could
+ * not be started.
+ */
+static GTM_AsyncRequest *
+gtm_async_start(GTM_Conn *conn, GTM_MessageType mtype)
+{
+    GTM_AsyncQueue   *queue = conn->async_queue;
+    GTM_AsyncRequest *request;
+    GTM_AsyncToken    token;
+
+    if (queue == NULL)
+    {
+        queue = (GTM_AsyncQueue *) malloc(sizeof (GTM_AsyncQueue));
+        if (queue == NULL)
+            return NULL;
+        memset(queue, 0, sizeof (GTM_AsyncQueue));
+        conn->async_queue = queue;
+    }
+
+    token = gtm_async_next_token(queue->last_sent);
+    request = &queue->requests[token % GTM_MAX_ASYNC_REQUESTS];
+    if (request->token != InvalidGTMAsyncToken)
+        return NULL;
+
+    queue->msg_start = conn->outCount;
+    if (gtmpqPutMsgStart('C', true, conn) ||
+        gtmpqPutInt(mtype, sizeof (GTM_MessageType), conn))
+    {
+        gtm_async_discard(conn);
+        return NULL;
+    }
+
+    request->mtype = mtype;
+    request->done = false;
+    return request;
+}
+
+/*
+ * Finish and flush the message of an asynchronous request, and account it as
+ * outstanding. Return its token.
+ */
+static GTM_AsyncToken
+gtm_async_finish(GTM_Conn *conn, GTM_AsyncRequest *request)
+{
+    GTM_AsyncQueue *queue = conn->async_queue;
+
+    if (gtmpqPutMsgEnd(conn) ||
+        gtmpqFlush(conn))
+    {
+        gtm_async_discard(conn);
+        conn->result = makeEmptyResultIfIsNull(conn->result);
+        conn->result->gr_status = GTM_RESULT_COMM_ERROR;
+        return InvalidGTMAsyncToken;
+    }
+
+    queue->last_sent = gtm_async_next_token(queue->last_sent);
+    queue->outstanding++;
+    request->token = queue->last_sent;
+    return request->token;
+}
+
+/*
+ * The connection failed, no reply will come. Complete all the requests
+ * not answered yet with a communication error.
+ */
+static void
+gtm_async_fail(GTM_AsyncQueue *queue)
+{
+    GTM_AsyncRequest *request;
+
+    while (queue->last_done != queue->last_sent)
+    {
+        queue->last_done = gtm_async_next_token(queue->last_done);
+        request = &queue->requests[queue->last_done % GTM_MAX_ASYNC_REQUESTS];
+        request->done = true;
+        request->result.status = GTM_RESULT_COMM_ERROR;
+    }
+}
+
+/*
+ * Complete the oldest request not answered yet with its reply.
+ */
+static void
+gtm_async_complete(GTM_AsyncQueue *queue, GTM_Result *res)
+{
+    GTM_AsyncRequest *request;
+    GTM_AsyncResult  *result;
+
+    queue->last_done = gtm_async_next_token(queue->last_done);
+    request = &queue->requests[queue->last_done % GTM_MAX_ASYNC_REQUESTS];
+    result = &request->result;
+
+    memset(result, 0, sizeof (GTM_AsyncResult));
+    result->type = res->gr_type;
+    result->status = res->gr_status;
+    if (res->gr_status == GTM_RESULT_OK)
+    {
+        switch (request->mtype)
+        {
+            case MSG_GETGTS:
+                if (res->gr_type != TXN_BEGIN_GETGTS_RESULT)
+                {
+                    result->status = GTM_RESULT_ERROR;
+                    break;
+                }
+                result->data.gts.gts = res->gr_resdata.grd_gts.grd_gts;
+                result->data.gts.gtm_readonly = res->gr_resdata.grd_gts.gtm_readonly;
+                break;
+
+            case MSG_SEQUENCE_GET_NEXT:
+                if (res->gr_type != SEQUENCE_GET_NEXT_RESULT)
+                {
+                    result->status = GTM_RESULT_ERROR;
+                    break;
+                }
+                result->data.seq.seqval = res->gr_resdata.grd_seq.seqval;
+                result->data.seq.rangemax = res->gr_resdata.grd_seq.rangemax;
+                break;
+
+            default:
+                result->status = GTM_RESULT_ERROR;
+                break;
+        }
+    }
+    request->done = true;
+}
+
+/*
+ * Parse the replies already received, reading more from the socket first.
+ * If wait is true, block until at least one reply is parsed. Return -1 if
+ * the connection failed, all the outstanding requests are failed then.
+ */
+static int
+gtm_async_read(GTM_Conn *conn, bool wait)
+{
+    GTM_AsyncQueue *queue = conn->async_queue;
+    GTM_Result     *res;
+    time_t          finish_time;
+    bool            parsed = false;
+
+    if (!wait && gtmpqReadData(conn) < 0)
+        goto receive_failed;
+
+    while (queue->last_done != queue->last_sent)
+    {
+        if ((res = GTMPQparseResult(conn)) != NULL)
+        {
+            gtm_async_complete(queue, res);
+            parsed = true;
+            continue;
+        }
+
+        if (conn->status == CONNECTION_BAD)
+            goto receive_failed;
+
+        if (!wait || parsed)
+            break;
+
+        finish_time = time(NULL) + CLIENT_GTM_TIMEOUT;
+        if (gtmpqWaitTimed(true, false, conn, finish_time) ||
+            gtmpqReadData(conn) < 0)
+            goto receive_failed;
+    }
+    return 0;
+
+receive_failed:
+    gtm_async_fail(queue);
+    conn->result = makeEmptyResultIfIsNull(conn->result);
+    conn->result->gr_status = GTM_RESULT_COMM_ERROR;
+    return -1;
+}
+
+static GTM_AsyncRequest *
+gtm_async_lookup(GTM_Conn *conn, GTM_AsyncToken token)
+{
+    GTM_AsyncRequest *request;
+
+    if (conn->async_queue == NULL || token == InvalidGTMAsyncToken)
+        return NULL;
+
+    request = &conn->async_queue->requests[token % GTM_MAX_ASYNC_REQUESTS];
+    return request->token == token ? request : NULL;
+}
+
+/*
+ * Send a request for a global timestamp and return without waiting for the
+ * reply. Return InvalidGTMAsyncToken if it could not be sent, or if
+ * GTM_MAX_ASYNC_REQUESTS requests are outstanding already.
+ */
+GTM_AsyncToken
+send_global_timestamp_async(GTM_Conn *conn)
+{
+    GTM_AsyncRequest *request;
+
+    if ((request = gtm_async_start(conn, MSG_GETGTS)) == NULL)
+        return InvalidGTMAsyncToken;
+
+    return gtm_async_finish(conn, request);
+}
+
+/*
+ * Asynchronous version of get_next.
+ */
+GTM_AsyncToken
+send_get_next_async(GTM_Conn *conn, GTM_SequenceKey key,
+                    char *coord_name, int coord_procid, GTM_Sequence range)
+{
+    GTM_AsyncRequest *request;
+    int    coord_namelen = coord_name ? strlen(coord_name) : 0;
+
+    if ((request = gtm_async_start(conn, MSG_SEQUENCE_GET_NEXT)) == NULL)
+        return InvalidGTMAsyncToken;
+
+    if (gtmpqPutInt(key->gsk_keylen, 4, conn) ||
+        gtmpqPutnchar(key->gsk_key, key->gsk_keylen, conn) ||
+        gtmpqPutInt(coord_namelen, 4, conn) ||
+        (coord_namelen > 0 && gtmpqPutnchar(coord_name, coord_namelen, conn)) ||
+        gtmpqPutInt(coord_procid, 4, conn) ||
+        gtmpqPutnchar((char *)&range, sizeof (GTM_Sequence), conn))
+    {
+        gtm_async_discard(conn);
+        conn->result = makeEmptyResultIfIsNull(conn->result);
+        conn->result->gr_status = GTM_RESULT_COMM_ERROR;
+        return InvalidGTMAsyncToken;
+    }
+
+    return gtm_async_finish(conn, request);
+}
+
+/*
+ * Check without blocking whether the reply to the request of token arrived.
+ */
+bool
+gtm_async_poll(GTM_Conn *conn, GTM_AsyncToken token)
+{
+    GTM_AsyncRequest *request = gtm_async_lookup(conn, token);
+
+    if (request == NULL)
+        return false;
+
+    if (!request->done)
+        (void) gtm_async_read(conn, false);
+
+    return request->done;
+}
+
+/*
+ * Wait for the reply to the request of token and return its status. The
+ * result is copied to *result if it is not NULL, and the token is released.
+ */
+int
+gtm_async_wait(GTM_Conn *conn, GTM_AsyncToken token, GTM_AsyncResult *result)
+{
+    GTM_AsyncRequest *request = gtm_async_lookup(conn, token);
+    int               status;
+
+    if (request == NULL)
+        return GTM_RESULT_ERROR;
+
+    while (!request->done)
+    {
+        if (gtm_async_read(conn, true))
+            break;
+    }
+
+    if (result)
+        *result = request->result;
+    status = request->result.status;
+
+    request->token = InvalidGTMAsyncToken;
+    conn->async_queue->outstanding--;
+    return status;
+}
+
+/*
+ * Whether replies to asynchronous requests are still to be read from the
+ * connection. A synchronous request sent then would take the first of them
+ * for its own reply.
+ */
+bool
+gtm_async_pending(GTM_Conn *conn)
+{
+    if (conn == NULL || conn->async_queue == NULL)
+        return false;
+
+    return conn->async_queue->last_done != conn->async_queue->last_sent;
+}
+
+/*
+ * Number of requests sent by the asynchronous API and not waited for yet.
+ */
+int
+gtm_async_outstanding(GTM_Conn *conn)
+{
+    if (conn == NULL || conn->async_queue == NULL)
+        return 0;
+
+    return conn->async_queue->outstanding;
+}
 
 int
 check_gtm_status(GTM_Conn *conn, int *status, GTM_Timestamp *master,XLogRecPtr *master_ptr,int *standby_count,int **slave_is_sync, GTM_Timestamp **standby
@@ -633,6 +1033,9 @@ get_gtm_statistics(GTM_Conn *conn, int clear_flag, int timeout_seconds, GTM_Stat
     if (gtmpqPutInt(clear_flag,sizeof(int),conn))
         goto send_failed;
 
+    if (gtmpqPutInt(GTM_STATISTICS_VERSION, sizeof(int), conn))
+        goto send_failed;
+
     /* Finish the message. */
     if (gtmpqPutMsgEnd(conn))
         goto send_failed;
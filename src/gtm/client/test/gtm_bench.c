@@ -0,0 +1,460 @@
+/*
+ * Load test of GTM with the requests the nodes send: global timestamps,
+ * begin/commit of a GXID, registration of a prepared GID and sequence
+ * nextval. Client threads run a weighted mix of them for a given time, each
+ * on its own connection, and the throughput and latency percentiles of each
+ * operation are reported.
+ *
+ * Latencies are recorded in a log-linear histogram: 64 buckets below 64ns,
+ * then 32 buckets per power of two, so that percentiles are within about 3%
+ * whatever the latency, with fixed memory per thread.
+ */
+#include <sys/types.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "gtm/gtm_c.h"
+#include "gtm/libpq-fe.h"
+#include "gtm/gtm_client.h"
+
+extern int      optind;
+extern char *optarg;
+
+#define HIST_SUB_BUCKET_BITS    6
+#define HIST_SUB_BUCKETS        (1 << HIST_SUB_BUCKET_BITS)
+#define HIST_HALF_BUCKETS       (HIST_SUB_BUCKETS / 2)
+#define HIST_MAX_EXPONENT       40      /* about 18 minutes in ns */
+#define HIST_BUCKETS            (HIST_SUB_BUCKETS + HIST_MAX_EXPONENT * HIST_HALF_BUCKETS)
+
+typedef struct BenchHistogram
+{
+    uint64      counts[HIST_BUCKETS];
+    uint64      total;
+    uint64      sum;            /* ns */
+    uint64      max;            /* ns */
+} BenchHistogram;
+
+typedef enum BenchOp
+{
+    BENCH_GTS,                  /* get a global timestamp */
+    BENCH_TXN,                  /* begin and commit a GXID */
+    BENCH_GID,                  /* register and finish a prepared GID */
+    BENCH_SEQ,                  /* nextval of a sequence */
+    BENCH_OPS
+} BenchOp;
+
+static const char *bench_op_names[BENCH_OPS] = {"gts", "txn", "gid", "seq"};
+
+typedef struct BenchThread
+{
+    pthread_t       thread;
+    int             id;
+    unsigned int    seed;
+    BenchHistogram  hist[BENCH_OPS];
+    uint64          errors[BENCH_OPS];
+} BenchThread;
+
+static char         connect_string[256];
+static int          mix[BENCH_OPS] = {50, 30, 10, 10};
+static int          mix_total = 100;
+static double       warmup_end;
+static double       deadline;
+static GTM_SequenceKeyData seqkey;
+static char         seqname[64];
+
+static double
+now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static uint64
+now_nanoseconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int
+hist_index(uint64 value)
+{
+    int     exponent = 0;
+
+    if (value < HIST_SUB_BUCKETS)
+        return (int) value;
+
+    /* Shift the value into [HIST_HALF_BUCKETS, HIST_SUB_BUCKETS) */
+    while ((value >> exponent) >= HIST_SUB_BUCKETS)
+        exponent++;
+    if (exponent > HIST_MAX_EXPONENT)
+        return HIST_BUCKETS - 1;
+
+    return HIST_SUB_BUCKETS + (exponent - 1) * HIST_HALF_BUCKETS +
+           (int) ((value >> exponent) - HIST_HALF_BUCKETS);
+}
+
+/* Highest value of a bucket */
+static uint64
+hist_value(int index)
+{
+    int     exponent;
+
+    if (index < HIST_SUB_BUCKETS)
+        return index;
+
+    exponent = (index - HIST_SUB_BUCKETS) / HIST_HALF_BUCKETS + 1;
+    return ((uint64) ((index - HIST_SUB_BUCKETS) % HIST_HALF_BUCKETS +
+                      HIST_HALF_BUCKETS + 1) << exponent) - 1;
+}
+
+static void
+hist_record(BenchHistogram *hist, uint64 value)
+{
+    hist->counts[hist_index(value)]++;
+    hist->total++;
+    hist->sum += value;
+    if (value > hist->max)
+        hist->max = value;
+}
+
+static void
+hist_add(BenchHistogram *to, BenchHistogram *from)
+{
+    int     ii;
+
+    for (ii = 0; ii < HIST_BUCKETS; ii++)
+        to->counts[ii] += from->counts[ii];
+    to->total += from->total;
+    to->sum += from->sum;
+    if (from->max > to->max)
+        to->max = from->max;
+}
+
+static uint64
+hist_percentile(BenchHistogram *hist, double percentile)
+{
+    uint64  wanted = (uint64) (hist->total * percentile / 100.0 + 0.5);
+    uint64  seen = 0;
+    int     ii;
+
+    if (wanted == 0)
+        wanted = 1;
+    for (ii = 0; ii < HIST_BUCKETS; ii++)
+    {
+        seen += hist->counts[ii];
+        if (seen >= wanted)
+            return Min(hist_value(ii), hist->max);
+    }
+    return hist->max;
+}
+
+/*
+ * Help display should match
+ */
+static void
+help(const char *progname)
+{
+    printf(_("Usage:\n  %s [OPTION]...\n\n"), progname);
+    printf(_("Options:\n"));
+    printf(_("  -h hostname     GTM proxy/server hostname/IP\n"));
+    printf(_("  -p port         GTM proxy/server port number\n"));
+    printf(_("  -c count        Number of client threads\n"));
+    printf(_("  -d seconds      Duration of the run, after the warmup\n"));
+    printf(_("  -w seconds      Warmup, not measured\n"));
+    printf(_("  -m mix          Weights of the operations, as gts=50,txn=30,gid=10,seq=10\n"));
+}
+
+static bool
+parse_mix(char *arg)
+{
+    char   *item;
+    char   *saveptr = NULL;
+    int     ii;
+
+    memset(mix, 0, sizeof(mix));
+    mix_total = 0;
+    for (item = strtok_r(arg, ",", &saveptr); item != NULL;
+         item = strtok_r(NULL, ",", &saveptr))
+    {
+        char   *eq = strchr(item, '=');
+
+        if (eq == NULL)
+            return false;
+        *eq = '\0';
+        for (ii = 0; ii < BENCH_OPS; ii++)
+        {
+            if (strcmp(item, bench_op_names[ii]) == 0)
+                break;
+        }
+        if (ii == BENCH_OPS || atoi(eq + 1) < 0)
+            return false;
+        mix[ii] = atoi(eq + 1);
+        mix_total += mix[ii];
+    }
+    return mix_total > 0;
+}
+
+static BenchOp
+choose_op(BenchThread *me)
+{
+    int     pick = rand_r(&me->seed) % mix_total;
+    int     ii;
+
+    for (ii = 0; ii < BENCH_OPS - 1; ii++)
+    {
+        if (pick < mix[ii])
+            break;
+        pick -= mix[ii];
+    }
+    return (BenchOp) ii;
+}
+
+/*
+ * Run one operation, return false if GTM reported an error.
+ */
+static bool
+run_op(GTM_Conn *conn, BenchThread *me, BenchOp op, uint64 count)
+{
+    GlobalTransactionId gxid;
+    GTM_Timestamp       timestamp;
+    GTM_Sequence        result;
+    GTM_Sequence        rangemax;
+    char                gid[64];
+
+    switch (op)
+    {
+        case BENCH_GTS:
+            return get_global_timestamp(conn).gts != 0;
+
+        case BENCH_TXN:
+            gxid = begin_transaction(conn, GTM_ISOLATION_RC, NULL, &timestamp);
+            if (!GlobalTransactionIdIsValid(gxid))
+                return false;
+            return commit_transaction(conn, gxid, 0, NULL) >= 0;
+
+        case BENCH_GID:
+            snprintf(gid, sizeof(gid), "gtm_bench_%d_%d_" UINT64_FORMAT,
+                     (int) getpid(), me->id, count);
+            if (start_prepared_transaction(conn, InvalidGlobalTransactionId,
+                                           gid, "gtm_bench") < 0)
+                return false;
+            return finish_gid_gtm(conn, gid) >= 0;
+
+        case BENCH_SEQ:
+            return get_next(conn, &seqkey, "gtm_bench", me->id, 1,
+                            &result, &rangemax) >= 0;
+
+        default:
+            return false;
+    }
+}
+
+static void *
+bench_worker(void *arg)
+{
+    BenchThread    *me = (BenchThread *) arg;
+    GTM_Conn       *conn;
+    uint64          count = 0;
+
+    conn = PQconnectGTM(connect_string);
+    while (now_seconds() < deadline)
+    {
+        BenchOp     op;
+        uint64      start;
+        bool        ok;
+
+        if (conn == NULL || GTMPQstatus(conn) != CONNECTION_OK)
+        {
+            fprintf(stderr, "Thread %d could not connect to GTM: %s\n",
+                    me->id, connect_string);
+            if (conn)
+                GTMPQfinish(conn);
+            sleep(1);
+            conn = PQconnectGTM(connect_string);
+            continue;
+        }
+
+        op = choose_op(me);
+        start = now_nanoseconds();
+        ok = run_op(conn, me, op, count++);
+        if (now_seconds() < warmup_end)
+            continue;
+
+        if (ok)
+            hist_record(&me->hist[op], now_nanoseconds() - start);
+        else
+            me->errors[op]++;
+    }
+
+    if (conn)
+        GTMPQfinish(conn);
+    return NULL;
+}
+
+int
+main(int argc, char *argv[])
+{
+    char           *gtmhost = "localhost";
+    int             gtmport = 6666;
+    int             nthreads = 8;
+    int             duration = 10;
+    int             warmup = 1;
+    int             ii;
+    int             jj;
+    int             opt;
+    GTM_Conn       *conn;
+    BenchThread    *threads;
+    BenchHistogram *all;
+    uint64          errors[BENCH_OPS];
+    uint64          total = 0;
+
+    if (argc > 1)
+    {
+        if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-?") == 0)
+        {
+            help(argv[0]);
+            exit(0);
+        }
+    }
+
+    while ((opt = getopt(argc, argv, "h:p:c:d:w:m:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'h':
+                gtmhost = strdup(optarg);
+                break;
+
+            case 'p':
+                gtmport = atoi(optarg);
+                break;
+
+            case 'c':
+                nthreads = atoi(optarg);
+                break;
+
+            case 'd':
+                duration = atoi(optarg);
+                break;
+
+            case 'w':
+                warmup = atoi(optarg);
+                break;
+
+            case 'm':
+                if (!parse_mix(optarg))
+                {
+                    fprintf(stderr, "Invalid operation mix\n");
+                    help(argv[0]);
+                    exit(1);
+                }
+                break;
+
+            default:
+                fprintf(stderr, "Unrecognized option %c\n", opt);
+                help(argv[0]);
+                exit(1);
+        }
+    }
+
+    if (nthreads <= 0 || duration <= 0 || warmup < 0)
+    {
+        help(argv[0]);
+        exit(1);
+    }
+
+    snprintf(connect_string, sizeof(connect_string),
+             "host=%s port=%d node_name=gtm_bench remote_type=%d",
+             gtmhost, gtmport, GTM_NODE_COORDINATOR);
+
+    /* The sequence used by the seq operation, dropped at the end */
+    conn = PQconnectGTM(connect_string);
+    if (conn == NULL || GTMPQstatus(conn) != CONNECTION_OK)
+    {
+        fprintf(stderr, "Could not connect to GTM: %s\n", connect_string);
+        exit(1);
+    }
+    snprintf(seqname, sizeof(seqname), "gtm_bench.%d", (int) getpid());
+    seqkey.gsk_keylen = strlen(seqname) + 1;
+    seqkey.gsk_key = seqname;
+    if (mix[BENCH_SEQ] > 0 &&
+        open_sequence(conn, &seqkey, 1, 1, INT64CONST(0x7FFFFFFFFFFFFFFE), 1,
+                      true, InvalidGlobalTransactionId))
+    {
+        fprintf(stderr, "Could not create sequence %s\n", seqname);
+        exit(1);
+    }
+
+    threads = (BenchThread *) calloc(nthreads, sizeof(BenchThread));
+    all = (BenchHistogram *) calloc(BENCH_OPS, sizeof(BenchHistogram));
+    memset(errors, 0, sizeof(errors));
+
+    warmup_end = now_seconds() + warmup;
+    deadline = warmup_end + duration;
+    for (ii = 0; ii < nthreads; ii++)
+    {
+        threads[ii].id = ii;
+        threads[ii].seed = (unsigned int) (getpid() + ii);
+        if (pthread_create(&threads[ii].thread, NULL, bench_worker, &threads[ii]))
+        {
+            fprintf(stderr, "Could not create thread %d\n", ii);
+            exit(1);
+        }
+    }
+
+    for (ii = 0; ii < nthreads; ii++)
+    {
+        pthread_join(threads[ii].thread, NULL);
+        for (jj = 0; jj < BENCH_OPS; jj++)
+        {
+            hist_add(&all[jj], &threads[ii].hist[jj]);
+            errors[jj] += threads[ii].errors[jj];
+        }
+    }
+
+    if (mix[BENCH_SEQ] > 0)
+        close_sequence(conn, &seqkey, InvalidGlobalTransactionId);
+    GTMPQfinish(conn);
+
+    printf("%d threads, %d seconds, %s:%d\n", nthreads, duration, gtmhost, gtmport);
+    printf("%-6s %10s %10s %9s %9s %9s %9s %9s %9s %8s\n", "op", "count", "ops/sec",
+           "avg(us)", "p50(us)", "p90(us)", "p99(us)", "p99.9(us)", "max(us)", "errors");
+    for (ii = 0; ii < BENCH_OPS; ii++)
+    {
+        BenchHistogram *hist = &all[ii];
+
+        if (mix[ii] == 0)
+            continue;
+        total += hist->total;
+        if (hist->total == 0)
+        {
+            printf("%-6s %10d %10d %9s %9s %9s %9s %9s %9s %8" INT64_MODIFIER "u\n",
+                   bench_op_names[ii], 0, 0, "-", "-", "-", "-", "-", "-", errors[ii]);
+            continue;
+        }
+        printf("%-6s %10" INT64_MODIFIER "u %10.0f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %8" INT64_MODIFIER "u\n",
+               bench_op_names[ii], hist->total, (double) hist->total / duration,
+               (double) hist->sum / hist->total / 1000.0,
+               hist_percentile(hist, 50) / 1000.0,
+               hist_percentile(hist, 90) / 1000.0,
+               hist_percentile(hist, 99) / 1000.0,
+               hist_percentile(hist, 99.9) / 1000.0,
+               hist->max / 1000.0, errors[ii]);
+    }
+    printf("%-6s %10" INT64_MODIFIER "u %10.0f\n", "total", total, (double) total / duration);
+
+    free(all);
+    free(threads);
+    for (ii = 0; ii < BENCH_OPS; ii++)
+    {
+        if (errors[ii] > 0)
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+#!/bin/bash
+#
+# Run gtm_bench against a local GTM, a GTM with a standby, and a gtm_proxy in
+# front of a GTM with a standby, so that the throughput of each setup can be
+# compared between builds.
+#
+# Usage: gtm_bench.sh [gtm_bench options]
+#
+# The binaries are taken from $BINDIR or the PATH, the data directories are
+# created under $BENCH_DIR and removed at the end.
+
+BINDIR=${BINDIR:-$(dirname $(which gtm 2>/dev/null || echo ./gtm))}
+BENCH_DIR=${BENCH_DIR:-/tmp/gtm_bench.$$}
+GTM_BENCH=${GTM_BENCH:-$(dirname $0)/gtm_bench}
+
+GTM_PORT=${GTM_PORT:-16666}
+STANDBY_PORT=${STANDBY_PORT:-16667}
+PROXY_PORT=${PROXY_PORT:-16668}
+PROXY_THREADS=${PROXY_THREADS:-4}
+
+# Create a data directory with initgtm and append settings to its conf file
+init_node()
+{
+	local type=$1 dir=$2 conf=$3
+	shift 3
+
+	$BINDIR/initgtm -Z $type -D $dir > $dir.init.log 2>&1 || { echo "initgtm failed, see $dir.init.log"; exit 1; }
+	for setting in "$@"
+	do
+		echo "$setting" >> $dir/$conf
+	done
+}
+
+start_node()
+{
+	local mode=$1 dir=$2
+
+	$BINDIR/gtm_ctl start -Z $mode -D $dir -l $dir/bench.log -w > /dev/null || { echo "could not start $mode in $dir"; exit 1; }
+}
+
+stop_node()
+{
+	local mode=$1 dir=$2
+
+	[ -d $dir ] && $BINDIR/gtm_ctl stop -Z $mode -D $dir -m fast -w > /dev/null 2>&1
+}
+
+cleanup()
+{
+	stop_node gtm_proxy $BENCH_DIR/proxy
+	stop_node gtm_standby $BENCH_DIR/standby
+	stop_node gtm $BENCH_DIR/gtm
+	rm -rf $BENCH_DIR
+}
+
+run_bench()
+{
+	echo
+	echo "== $1"
+	$GTM_BENCH -h 127.0.0.1 -p $2 "${@:3}"
+}
+
+trap cleanup EXIT
+rm -rf $BENCH_DIR
+mkdir -p $BENCH_DIR
+
+init_node gtm $BENCH_DIR/gtm gtm.conf \
+	"nodename = 'gtm_bench'" "port = $GTM_PORT" "listen_addresses = '127.0.0.1'"
+start_node gtm $BENCH_DIR/gtm
+run_bench "GTM" $GTM_PORT "$@"
+
+init_node gtm $BENCH_DIR/standby gtm.conf \
+	"nodename = 'gtm_bench_standby'" "port = $STANDBY_PORT" "listen_addresses = '127.0.0.1'" \
+	"startup = STANDBY" "active_host = '127.0.0.1'" "active_port = $GTM_PORT"
+start_node gtm_standby $BENCH_DIR/standby
+run_bench "GTM with standby" $GTM_PORT "$@"
+
+init_node gtm_proxy $BENCH_DIR/proxy gtm_proxy.conf \
+	"nodename = 'gtm_bench_proxy'" "port = $PROXY_PORT" "listen_addresses = '127.0.0.1'" \
+	"gtm_host = '127.0.0.1'" "gtm_port = $GTM_PORT" "worker_threads = $PROXY_THREADS"
+start_node gtm_proxy $BENCH_DIR/proxy
+run_bench "gtm_proxy, GTM with standby" $PROXY_PORT "$@"
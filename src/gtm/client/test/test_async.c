@@ -0,0 +1,226 @@
+/*
+ * Test the asynchronous GTM client API: several requests outstanding on one
+ * connection, completed in order and collected in any order.
+ */
+#include <sys/types.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "gtm/gtm_c.h"
+#include "gtm/libpq-fe.h"
+#include "gtm/gtm_client.h"
+
+#define client_log(x)    printf x
+
+#define TEST_ASYNC_DEPTH    16
+#define TEST_ASYNC_LOOPS    10000
+
+extern int      optind;
+extern char *optarg;
+
+static int failures = 0;
+
+static void
+check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        client_log(("FAILED: %s\n", what));
+        failures++;
+    }
+}
+
+static double
+now_seconds(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/*
+ * Send a window of GTS requests, collect them in reverse order and check
+ * that they were answered in the order they were sent.
+ */
+static void
+test_gts_window(GTM_Conn *conn)
+{
+    GTM_AsyncToken  tokens[TEST_ASYNC_DEPTH];
+    GTM_AsyncResult result;
+    GTM_Timestamp   gts[TEST_ASYNC_DEPTH];
+    int             ii;
+
+    for (ii = 0; ii < TEST_ASYNC_DEPTH; ii++)
+    {
+        tokens[ii] = send_global_timestamp_async(conn);
+        check(tokens[ii] != InvalidGTMAsyncToken, "send GTS request");
+    }
+    check(gtm_async_outstanding(conn) == TEST_ASYNC_DEPTH, "outstanding count");
+
+    /* The last reply comes after all the others */
+    while (!gtm_async_poll(conn, tokens[TEST_ASYNC_DEPTH - 1]))
+        ;
+    check(gtm_async_poll(conn, tokens[0]), "earlier request completed");
+
+    for (ii = TEST_ASYNC_DEPTH - 1; ii >= 0; ii--)
+    {
+        check(gtm_async_wait(conn, tokens[ii], &result) == GTM_RESULT_OK, "wait GTS");
+        gts[ii] = result.data.gts.gts;
+    }
+    check(gtm_async_outstanding(conn) == 0, "no request outstanding");
+
+    for (ii = 1; ii < TEST_ASYNC_DEPTH; ii++)
+        check(gts[ii] > gts[ii - 1], "GTS increases in sending order");
+
+    /* A waited token is released */
+    check(gtm_async_wait(conn, tokens[0], NULL) == GTM_RESULT_ERROR, "released token");
+}
+
+/*
+ * Fill all the slots, the next request must be refused until one is waited
+ * for.
+ */
+static void
+test_gts_limit(GTM_Conn *conn)
+{
+    GTM_AsyncToken  tokens[GTM_MAX_ASYNC_REQUESTS];
+    GTM_AsyncToken  token;
+    int             ii;
+
+    for (ii = 0; ii < GTM_MAX_ASYNC_REQUESTS; ii++)
+        tokens[ii] = send_global_timestamp_async(conn);
+
+    check(send_global_timestamp_async(conn) == InvalidGTMAsyncToken, "request over the limit");
+
+    check(gtm_async_wait(conn, tokens[0], NULL) == GTM_RESULT_OK, "wait first");
+    token = send_global_timestamp_async(conn);
+    check(token != InvalidGTMAsyncToken, "request after a wait");
+
+    for (ii = 1; ii < GTM_MAX_ASYNC_REQUESTS; ii++)
+        check(gtm_async_wait(conn, tokens[ii], NULL) == GTM_RESULT_OK, "wait");
+    check(gtm_async_wait(conn, token, NULL) == GTM_RESULT_OK, "wait last");
+}
+
+/*
+ * Mix sequence and GTS requests, each reply must go to its own request.
+ */
+static void
+test_mixed(GTM_Conn *conn)
+{
+    GTM_SequenceKeyData seqkey;
+    GTM_AsyncToken  seq_tokens[TEST_ASYNC_DEPTH];
+    GTM_AsyncToken  gts_tokens[TEST_ASYNC_DEPTH];
+    GTM_AsyncResult result;
+    char            buf[100];
+    int             ii;
+
+    sprintf(buf, "test_async.%d", (int) getpid());
+    seqkey.gsk_keylen = strlen(buf) + 1;
+    seqkey.gsk_key = buf;
+    if (open_sequence(conn, &seqkey, 1, 1, 1000000, 1, false, InvalidGlobalTransactionId))
+    {
+        check(false, "open sequence");
+        return;
+    }
+
+    for (ii = 0; ii < TEST_ASYNC_DEPTH; ii++)
+    {
+        seq_tokens[ii] = send_get_next_async(conn, &seqkey, "test_async", getpid(), 1);
+        gts_tokens[ii] = send_global_timestamp_async(conn);
+    }
+
+    for (ii = 0; ii < TEST_ASYNC_DEPTH; ii++)
+    {
+        check(gtm_async_wait(conn, gts_tokens[ii], &result) == GTM_RESULT_OK, "wait GTS");
+        check(result.type == TXN_BEGIN_GETGTS_RESULT, "GTS result type");
+        check(gtm_async_wait(conn, seq_tokens[ii], &result) == GTM_RESULT_OK, "wait nextval");
+        check(result.type == SEQUENCE_GET_NEXT_RESULT, "nextval result type");
+        check(result.data.seq.seqval == ii + 1, "nextval value");
+    }
+
+    /* Synchronous calls work again once nothing is outstanding */
+    check(close_sequence(conn, &seqkey, InvalidGlobalTransactionId) == 0, "close sequence");
+}
+
+/*
+ * Compare the rate of synchronous requests with a pipeline keeping
+ * TEST_ASYNC_DEPTH requests outstanding.
+ */
+static void
+test_throughput(GTM_Conn *conn)
+{
+    GTM_AsyncToken  tokens[TEST_ASYNC_DEPTH];
+    double          start;
+    double          sync_time;
+    double          async_time;
+    int             ii;
+
+    start = now_seconds();
+    for (ii = 0; ii < TEST_ASYNC_LOOPS; ii++)
+        check(get_global_timestamp(conn).gts != 0, "synchronous GTS");
+    sync_time = now_seconds() - start;
+
+    start = now_seconds();
+    for (ii = 0; ii < TEST_ASYNC_LOOPS + TEST_ASYNC_DEPTH; ii++)
+    {
+        if (ii >= TEST_ASYNC_DEPTH)
+            check(gtm_async_wait(conn, tokens[ii % TEST_ASYNC_DEPTH], NULL) == GTM_RESULT_OK,
+                  "pipelined GTS");
+        if (ii < TEST_ASYNC_LOOPS)
+            tokens[ii % TEST_ASYNC_DEPTH] = send_global_timestamp_async(conn);
+    }
+    async_time = now_seconds() - start;
+
+    client_log(("%d GTS: synchronous %.0f/sec, pipelined by %d %.0f/sec\n",
+                TEST_ASYNC_LOOPS, TEST_ASYNC_LOOPS / sync_time,
+                TEST_ASYNC_DEPTH, TEST_ASYNC_LOOPS / async_time));
+}
+
+int
+main(int argc, char *argv[])
+{
+    GTM_Conn   *conn;
+    char        connect_string[100];
+    char       *gtmhost = "localhost";
+    int         gtmport = 6666;
+    int         opt;
+
+    while ((opt = getopt(argc, argv, "h:p:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'h':
+                gtmhost = strdup(optarg);
+                break;
+
+            case 'p':
+                gtmport = atoi(optarg);
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-h hostname] [-p port]\n", argv[0]);
+                exit(1);
+        }
+    }
+
+    sprintf(connect_string, "host=%s port=%d node_name=test_async remote_type=%d",
+            gtmhost, gtmport, GTM_NODE_COORDINATOR);
+
+    conn = PQconnectGTM(connect_string);
+    if (conn == NULL || GTMPQstatus(conn) != CONNECTION_OK)
+    {
+        client_log(("Error in connection\n"));
+        exit(1);
+    }
+
+    test_gts_window(conn);
+    test_gts_limit(conn);
+    test_mixed(conn);
+    test_throughput(conn);
+
+    GTMPQfinish(conn);
+
+    client_log(("%s\n", failures ? "FAILED" : "OK"));
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+/*
+ * Measure how many global timestamps GTM issues per second, for a growing
+ * number of client threads each using its own connection.
+ */
+#include <sys/types.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "gtm/gtm_c.h"
+#include "gtm/libpq-fe.h"
+#include "gtm/gtm_client.h"
+
+extern int      optind;
+extern char *optarg;
+
+typedef struct GTSPerfThread
+{
+    pthread_t   thread;
+    char       *connect_string;
+    double      deadline;
+    long        count;
+    long        failed;
+} GTSPerfThread;
+
+static double
+now_seconds(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/*
+ * Help display should match
+ */
+static void
+help(const char *progname)
+{
+    printf(_("Usage:\n  %s [OPTION]...\n\n"), progname);
+    printf(_("Options:\n"));
+    printf(_("  -h hostname     GTM server hostname/IP\n"));
+    printf(_("  -p port         GTM server port number\n"));
+    printf(_("  -t count        Maximum number of threads, doubled from 1\n"));
+    printf(_("  -d seconds      Duration of each run\n"));
+}
+
+static void *
+gts_worker(void *arg)
+{
+    GTSPerfThread  *me = (GTSPerfThread *) arg;
+    GTM_Conn       *conn;
+    Get_GTS_Result  result;
+
+    conn = PQconnectGTM(me->connect_string);
+    if (conn == NULL || GTMPQstatus(conn) != CONNECTION_OK)
+    {
+        fprintf(stderr, "Could not connect to GTM: %s\n", me->connect_string);
+        me->failed++;
+        return NULL;
+    }
+
+    while (now_seconds() < me->deadline)
+    {
+        /* A failed request returns 0 */
+        result = get_global_timestamp(conn);
+        if (result.gts == 0)
+        {
+            me->failed++;
+            break;
+        }
+        me->count++;
+    }
+
+    GTMPQfinish(conn);
+    return NULL;
+}
+
+int
+main(int argc, char *argv[])
+{
+    char            connect_string[100];
+    char           *gtmhost = "localhost";
+    int             gtmport = 6666;
+    int             max_threads = 64;
+    int             duration = 5;
+    int             nthreads;
+    int             ii;
+    int             opt;
+    long            total;
+    long            failed;
+    double          start;
+    double          elapsed;
+    GTSPerfThread  *threads;
+
+    if (argc > 1)
+    {
+        if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-?") == 0)
+        {
+            help(argv[0]);
+            exit(0);
+        }
+    }
+
+    while ((opt = getopt(argc, argv, "h:p:t:d:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'h':
+                gtmhost = strdup(optarg);
+                break;
+
+            case 'p':
+                gtmport = atoi(optarg);
+                break;
+
+            case 't':
+                max_threads = atoi(optarg);
+                break;
+
+            case 'd':
+                duration = atoi(optarg);
+                break;
+
+            default:
+                fprintf(stderr, "Unrecognized option %c\n", opt);
+                help(argv[0]);
+                exit(0);
+        }
+    }
+
+    if (max_threads <= 0 || duration <= 0)
+    {
+        help(argv[0]);
+        exit(1);
+    }
+
+    sprintf(connect_string, "host=%s port=%d node_name=gtsperf remote_type=%d",
+            gtmhost, gtmport, GTM_NODE_COORDINATOR);
+
+    threads = (GTSPerfThread *) calloc(max_threads, sizeof(GTSPerfThread));
+
+    printf("%8s %14s %12s %8s\n", "threads", "gts/sec", "gts/sec/thr", "failed");
+    for (nthreads = 1; nthreads <= max_threads; nthreads *= 2)
+    {
+        start = now_seconds();
+        for (ii = 0; ii < nthreads; ii++)
+        {
+            threads[ii].connect_string = connect_string;
+            threads[ii].deadline = start + duration;
+            threads[ii].count = 0;
+            threads[ii].failed = 0;
+            if (pthread_create(&threads[ii].thread, NULL, gts_worker, &threads[ii]))
+            {
+                fprintf(stderr, "Could not create thread %d\n", ii);
+                exit(1);
+            }
+        }
+
+        total = 0;
+        failed = 0;
+        for (ii = 0; ii < nthreads; ii++)
+        {
+            pthread_join(threads[ii].thread, NULL);
+            total += threads[ii].count;
+            failed += threads[ii].failed;
+        }
+        elapsed = now_seconds() - start;
+
+        printf("%8d %14.0f %12.0f %8ld\n", nthreads, total / elapsed,
+               total / elapsed / nthreads, failed);
+        fflush(stdout);
+
+        /* Always finish with the maximum */
+        if (nthreads < max_threads && nthreads * 2 > max_threads)
+            nthreads = max_threads / 2;
+    }
+
+    free(threads);
+    return 0;
+}
@@ -1190,6 +1190,18 @@ do_stat(void)
                 printf(_("requests per minute: %u\n"), calcu_result[i]);
             }
         }
+
+        if (result->version >= GTM_STATISTICS_VERSION_XLOG_FLUSH)
+        {
+            printf(_("XLOG_FLUSH info:\n"));
+            printf(_("flush requests: %u\n"), result->xlog_flush_info.flush_requests);
+            printf(_("flush times: %u\n"), result->xlog_flush_info.flush_times);
+            printf(_("requests per flush: %.2f\n"), (result->xlog_flush_info.flush_times == 0) ? 0.0 :
+                   (float)result->xlog_flush_info.flush_requests / (float)result->xlog_flush_info.flush_times);
+            printf(_("delayed flushes: %u\n"), result->xlog_flush_info.delayed_flushes);
+            printf(_("avg flush costtime: %u(us)\n"), result->xlog_flush_info.avg_flush_costtime);
+            printf(_("max flush costtime: %u(us)\n"), result->xlog_flush_info.max_flush_costtime);
+        }
     }
     else
     {
@@ -60,7 +60,10 @@ extern int			worker_thread_number;
 #ifdef __TBASE__
 extern bool	enable_gtm_sequence_debug;
 extern int      wal_writer_delay;
+extern int      commit_delay;
+extern int      commit_siblings;
 extern int      checkpoint_interval;
+extern int      store_flush_interval;
 extern char     *archive_command;
 extern bool     archive_mode;
 extern int      max_reserved_wal_number;
@@ -329,6 +332,28 @@ struct config_int ConfigureNamesInt[] =
 		100, 10, INT_MAX, NULL, NULL,
 		0, NULL
 	},
+	{
+		{
+			GTM_OPTNAME_COMMIT_DELAY, GTMC_STARTUP,
+			gettext_noop("Sets the delay in microseconds before a xlog flush, to let more records share it."),
+			NULL,
+			0
+		},
+		&commit_delay,
+		0, 0, 100000, NULL, NULL,
+		0, NULL
+	},
+	{
+		{
+			GTM_OPTNAME_COMMIT_SIBLINGS, GTMC_STARTUP,
+			gettext_noop("Sets the minimum number of other threads waiting for a xlog flush before applying commit_delay."),
+			NULL,
+			0
+		},
+		&commit_siblings,
+		5, 0, 1000, NULL, NULL,
+		0, NULL
+	},
 	{
 		{
 			GTM_OPTNAME_CHECKPOINT_INTERVAL, GTMC_STARTUP,
@@ -340,6 +365,17 @@ struct config_int ConfigureNamesInt[] =
 		30, 1, INT_MAX, NULL, NULL,
 		0, NULL
 	},
+	{
+		{
+			GTM_OPTNAME_STORE_FLUSH_INTERVAL, GTMC_STARTUP,
+			gettext_noop("Checkpointer writes changed map file pages every store_flush_interval second between checkpoints, zero means disabled."),
+			NULL,
+			0
+		},
+		&store_flush_interval,
+		0, 0, INT_MAX, NULL, NULL,
+		0, NULL
+	},
 	{
 		{
 			GTM_OPTNAME_MAX_RESERVED_WAL_NUMBER, GTMC_STARTUP,
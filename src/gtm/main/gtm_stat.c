@@ -25,6 +25,7 @@ extern int32  GTM_StoreGetUsedTxn(void);
 
 
 GTM_Statistics GTMStatistics;
+GTM_XLogFlushStatistics GTMXLogFlushStatistics;
 
 /*
  * Init global gtm statistic handle
@@ -34,6 +35,12 @@ GTM_InitGtmStatistics(void)
 {
     GTMStatistics.stat_start_time = time(NULL);;
     SpinLockInit(&GTMStatistics.lock);
+
+    pg_atomic_init_u32(&GTMXLogFlushStatistics.flush_requests, 0);
+    pg_atomic_init_u32(&GTMXLogFlushStatistics.flush_times, 0);
+    pg_atomic_init_u32(&GTMXLogFlushStatistics.delayed_flushes, 0);
+    pg_atomic_init_u64(&GTMXLogFlushStatistics.total_flush_costtime, 0);
+    pg_atomic_init_u32(&GTMXLogFlushStatistics.max_flush_costtime, 0);
 }
 
 /*
@@ -148,11 +155,68 @@ GTM_UpdateStatistics(GTM_WorkerStatistics* stat_handle, GTM_MessageType mtype, u
     }
 }
 
+/*
+ * Count a xlog flush request which was not yet covered by a previous flush
+ */
+void
+GTM_CountXLogFlushRequest(void)
+{
+    pg_atomic_fetch_add_u32(&GTMXLogFlushStatistics.flush_requests, 1);
+}
+
+/*
+ * Update xlog flush statistics, when a write and fsync is done.
+ * Flushes are serialized by the wal write lock, so max is not raced.
+ */
+void
+GTM_UpdateXLogFlushStatistics(uint32 costtime, bool delayed)
+{
+    pg_atomic_fetch_add_u32(&GTMXLogFlushStatistics.flush_times, 1);
+    pg_atomic_fetch_add_u64(&GTMXLogFlushStatistics.total_flush_costtime, costtime);
+
+    if (delayed)
+    {
+        pg_atomic_fetch_add_u32(&GTMXLogFlushStatistics.delayed_flushes, 1);
+    }
+
+    if (costtime > pg_atomic_read_u32(&GTMXLogFlushStatistics.max_flush_costtime))
+    {
+        pg_atomic_write_u32(&GTMXLogFlushStatistics.max_flush_costtime, costtime);
+    }
+}
+
+/*
+ * Read the xlog flush statistics, and reset them if asked
+ */
+static void
+GTM_GetXLogFlushResult(int clear_flag, GTM_XLogFlushStatisticsItem *result)
+{
+    uint64 total_flush_costtime = 0;
+
+    result->flush_requests = pg_atomic_read_u32(&GTMXLogFlushStatistics.flush_requests);
+    result->flush_times = pg_atomic_read_u32(&GTMXLogFlushStatistics.flush_times);
+    result->delayed_flushes = pg_atomic_read_u32(&GTMXLogFlushStatistics.delayed_flushes);
+    total_flush_costtime = pg_atomic_read_u64(&GTMXLogFlushStatistics.total_flush_costtime);
+    result->max_flush_costtime = pg_atomic_read_u32(&GTMXLogFlushStatistics.max_flush_costtime);
+    result->avg_flush_costtime = (result->flush_times == 0) ? 0 :
+                                 (uint32) (total_flush_costtime / result->flush_times);
+
+    if (clear_flag)
+    {
+        pg_atomic_write_u32(&GTMXLogFlushStatistics.flush_requests, 0);
+        pg_atomic_write_u32(&GTMXLogFlushStatistics.flush_times, 0);
+        pg_atomic_write_u32(&GTMXLogFlushStatistics.delayed_flushes, 0);
+        pg_atomic_write_u64(&GTMXLogFlushStatistics.total_flush_costtime, 0);
+        pg_atomic_write_u32(&GTMXLogFlushStatistics.max_flush_costtime, 0);
+    }
+}
+
 /*
  * Combine the statistics of each thread and calculate the result
  */
 static void
-GTM_GetMergeResult(int clear_flag, pg_time_t *stat_start_time, pg_time_t *stat_end_time, GTM_StatisticsItem *result)
+GTM_GetMergeResult(int clear_flag, pg_time_t *stat_start_time, pg_time_t *stat_end_time, GTM_StatisticsItem *result,
+                   GTM_XLogFlushStatisticsItem *flush_result)
 {
     GTM_ThreadInfo *thrinfo = NULL;
     GTM_WorkerStatistics *stat_handle = NULL;
@@ -205,6 +269,8 @@ GTM_GetMergeResult(int clear_flag, pg_time_t *stat_start_time, pg_time_t *stat_e
         }
     }
 
+    GTM_GetXLogFlushResult(clear_flag, flush_result);
+
     *stat_start_time = GTMStatistics.stat_start_time;
     *stat_end_time = time(NULL);
     for (i = 0; i < CMD_STATISTICS_TYPE_COUNT; i++)
@@ -231,16 +297,23 @@ ProcessGetStatisticsCommand(Port *myport, StringInfo message)
     int32 used_seq = 0;
     int32 used_txn = 0;
     int clear_flag = 0;
+    int version = GTM_STATISTICS_VERSION_BASE;
     int i = 0;
     StringInfoData buf;
     pg_time_t stat_start_time = 0;
     pg_time_t stat_end_time = 0;
     GTM_StatisticsItem result_info[CMD_STATISTICS_TYPE_COUNT];
+    GTM_XLogFlushStatisticsItem flush_info;
 
     clear_flag = pq_getmsgint(message, sizeof (int));
+    if (message->cursor < message->len)
+    {
+        version = pq_getmsgint(message, sizeof (int));
+    }
     pq_getmsgend(message);
+    version = Min(version, GTM_STATISTICS_VERSION);
 
-    GTM_GetMergeResult(clear_flag, &stat_start_time, &stat_end_time, result_info);
+    GTM_GetMergeResult(clear_flag, &stat_start_time, &stat_end_time, result_info, &flush_info);
     used_seq = GTM_StoreGetUsedSeq();
     used_txn = GTM_StoreGetUsedTxn();
 
@@ -266,6 +339,21 @@ ProcessGetStatisticsCommand(Port *myport, StringInfo message)
         pq_sendint(&buf, result_info[i].min_costtime, sizeof(int32));
     }
 
+    /* Clients which know nothing of the version get the base reply only */
+    if (version > GTM_STATISTICS_VERSION_BASE)
+    {
+        pq_sendint(&buf, version, sizeof(int32));
+    }
+
+    if (version >= GTM_STATISTICS_VERSION_XLOG_FLUSH)
+    {
+        pq_sendint(&buf, flush_info.flush_requests, sizeof(int32));
+        pq_sendint(&buf, flush_info.flush_times, sizeof(int32));
+        pq_sendint(&buf, flush_info.delayed_flushes, sizeof(int32));
+        pq_sendint(&buf, flush_info.avg_flush_costtime, sizeof(int32));
+        pq_sendint(&buf, flush_info.max_flush_costtime, sizeof(int32));
+    }
+
     pq_endmessage(myport, &buf);
 
     if (myport->remote_type != GTM_NODE_GTM_PROXY)
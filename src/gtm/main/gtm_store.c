@@ -1998,6 +1998,125 @@ void GTM_StoreSizeInit(void)
     g_GTM_Backup_Timer = INVALID_TIMER_HANDLE;
     GTM_RWLockInit(&g_GTM_Backup_Timer_Lock);
 }
+
+/*
+ * Get the elements [*first, *last) of an array at base of the store which
+ * overlap [offset, end). Returns false if none does.
+ */
+static bool GTM_StoreRangeElements(size_t base, size_t elem_size, int32 count,
+                                   size_t offset, size_t end, int32 *first, int32 *last)
+{
+    size_t array_end = base + elem_size * count;
+
+    if (end <= base || offset >= array_end)
+    {
+        return false;
+    }
+
+    *first = (offset > base) ? (offset - base) / elem_size : 0;
+    *last  = (Min(end, array_end) - base + elem_size - 1) / elem_size;
+    return true;
+}
+
+/*
+ * Check the links of the store elements overlapping [offset, offset + len)
+ * of a store image. Crash recovery uses it on the regions it redid only,
+ * instead of trusting or scanning the whole store.
+ */
+bool GTM_StoreValidateRange(char *image, size_t offset, size_t len)
+{// #lizard forgives
+    size_t                     seq_hash_off;
+    size_t                     txn_hash_off;
+    size_t                     seq_off;
+    size_t                     txn_off;
+    size_t                     end = offset + len;
+    int32                      first;
+    int32                      last;
+    int32                      i;
+    GTMControlHeader          *header;
+    GTM_StoredHashTable       *hashtab;
+    GTM_StoredSeqInfo         *seqinfo;
+    GTM_StoredTransactionInfo *txninfo;
+
+    seq_hash_off = ALIGN_PAGE(sizeof(GTMControlHeader));
+    txn_hash_off = seq_hash_off + ALIGN_PAGE(sizeof(GTM_StoredHashTable));
+    seq_off      = txn_hash_off + ALIGN_PAGE(sizeof(GTM_StoredHashTable));
+    txn_off      = seq_off + ALIGN_PAGE(sizeof(GTM_StoredSeqInfo) * GTM_MAX_SEQ_NUMBER);
+
+    if (offset < sizeof(GTMControlHeader))
+    {
+        header = (GTMControlHeader *) image;
+        if ((header->m_seq_freelist != INVALID_STORAGE_HANDLE && !VALID_SEQ_HANDLE(header->m_seq_freelist)) ||
+            (header->m_txn_freelist != INVALID_STORAGE_HANDLE && !VALID_TXN_HANDLE(header->m_txn_freelist)))
+        {
+            elog(LOG, "GTM_StoreValidateRange invalid freelist seq:%d txn:%d in header.",
+                 header->m_seq_freelist, header->m_txn_freelist);
+            return false;
+        }
+    }
+
+    if (GTM_StoreRangeElements(seq_hash_off, sizeof(GTMStorageHandle), GTM_STORED_HASH_TABLE_NBUCKET,
+                               offset, end, &first, &last))
+    {
+        hashtab = (GTM_StoredHashTable *) (image + seq_hash_off);
+        for (i = first; i < last; i++)
+        {
+            if (hashtab->m_buckets[i] != INVALID_STORAGE_HANDLE && !VALID_SEQ_HANDLE(hashtab->m_buckets[i]))
+            {
+                elog(LOG, "GTM_StoreValidateRange invalid seq bucket:%d handle:%d.", i, hashtab->m_buckets[i]);
+                return false;
+            }
+        }
+    }
+
+    if (GTM_StoreRangeElements(txn_hash_off, sizeof(GTMStorageHandle), GTM_STORED_HASH_TABLE_NBUCKET,
+                               offset, end, &first, &last))
+    {
+        hashtab = (GTM_StoredHashTable *) (image + txn_hash_off);
+        for (i = first; i < last; i++)
+        {
+            if (hashtab->m_buckets[i] != INVALID_STORAGE_HANDLE && !VALID_TXN_HANDLE(hashtab->m_buckets[i]))
+            {
+                elog(LOG, "GTM_StoreValidateRange invalid txn bucket:%d handle:%d.", i, hashtab->m_buckets[i]);
+                return false;
+            }
+        }
+    }
+
+    if (GTM_StoreRangeElements(seq_off, sizeof(GTM_StoredSeqInfo), GTM_MAX_SEQ_NUMBER,
+                               offset, end, &first, &last))
+    {
+        seqinfo = (GTM_StoredSeqInfo *) (image + seq_off);
+        for (i = first; i < last; i++)
+        {
+            if (seqinfo[i].gti_store_handle != i ||
+                (seqinfo[i].gs_next != INVALID_STORAGE_HANDLE && !VALID_SEQ_HANDLE(seqinfo[i].gs_next)))
+            {
+                elog(LOG, "GTM_StoreValidateRange invalid seq:%d handle:%d next:%d.",
+                     i, seqinfo[i].gti_store_handle, seqinfo[i].gs_next);
+                return false;
+            }
+        }
+    }
+
+    if (GTM_StoreRangeElements(txn_off, sizeof(GTM_StoredTransactionInfo), MAX_PREPARED_TXN,
+                               offset, end, &first, &last))
+    {
+        txninfo = (GTM_StoredTransactionInfo *) (image + txn_off);
+        for (i = first; i < last; i++)
+        {
+            if (txninfo[i].gti_store_handle != i ||
+                (txninfo[i].gs_next != INVALID_STORAGE_HANDLE && !VALID_TXN_HANDLE(txninfo[i].gs_next)))
+            {
+                elog(LOG, "GTM_StoreValidateRange invalid txn:%d handle:%d next:%d.",
+                     i, txninfo[i].gti_store_handle, txninfo[i].gs_next);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
 #endif
 
 /*
@@ -121,6 +121,7 @@ GTM_InitTxnManager(void)
     
     for(ii = 0; ii < GTM_MAX_THREADS; ii++)
         GTMTransactions.gt_in_locking[ii].lock = 0;
+    pg_atomic_init_u64(&GTMTransactions.gt_gts_seq, 0);
     /*
      * Initialize the list
      */
@@ -1163,19 +1164,34 @@ GetNextGlobalTransactionId(void)
 }
 
 #ifdef __TBASE__
-GlobalTimestamp
-GetNextGlobalTimestamp(void)
+/*
+ * Begin and end a change of the global timestamp base. Readers retry while
+ * the sequence is odd or has moved under them.
+ */
+static void
+BeginGlobalTimestampUpdate(void)
+{
+    AcquireWriteLock();
+    pg_atomic_fetch_add_u64(&GTMTransactions.gt_gts_seq, 1);
+}
+
+static void
+EndGlobalTimestampUpdate(void)
+{
+    pg_atomic_fetch_add_u64(&GTMTransactions.gt_gts_seq, 1);
+    ReleaseWriteLock();
+}
+
+/*
+ * With enable_gtm_debug every issued timestamp is checked against the last
+ * one, which needs the write lock.
+ */
+static GlobalTimestamp
+GetNextGlobalTimestampDebug(void)
 {
     GlobalTimestamp gts, now, delta, tv_sec, tv_nsec;
 
-    if(enable_gtm_debug)
-    {
-        AcquireWriteLock();
-    }
-    else
-    {
-        AcquireReadLock();
-    }
+    AcquireWriteLock();
     
     now = GTM_TimestampGetMonotonicRawPrecise(&tv_sec, &tv_nsec);
 
@@ -1239,14 +1255,7 @@ GetNextGlobalTimestamp(void)
         
     }
     
-    if(enable_gtm_debug)
-    {
-        ReleaseWriteLock();
-    }
-    else
-    {
-        ReleaseReadLock();
-    }
+    ReleaseWriteLock();
 
     if(enable_gtm_debug)
     {
@@ -1257,6 +1266,47 @@ GetNextGlobalTimestamp(void)
     return gts;
 
 }
+
+/*
+ * Issue a global timestamp: the base plus the raw time elapsed since it was
+ * taken. The base is read like a seqlock, so that the service threads never
+ * write shared memory here and do not fight over a cache line.
+ */
+GlobalTimestamp
+GetNextGlobalTimestamp(void)
+{
+    volatile GTM_Transactions *trans = &GTMTransactions;
+    GlobalTimestamp gts, now, tv_sec, tv_nsec;
+    uint64          seq;
+
+    if(enable_gtm_debug)
+    {
+        return GetNextGlobalTimestampDebug();
+    }
+
+    for (;;)
+    {
+        seq = pg_atomic_read_u64(&GTMTransactions.gt_gts_seq);
+        if (seq & 1)
+        {
+            /* Being rebased, which takes no time, go easy on the writer */
+            pg_spin_delay();
+            continue;
+        }
+        pg_read_barrier();
+
+        now = GTM_TimestampGetMonotonicRawPrecise(&tv_sec, &tv_nsec);
+        gts = trans->gt_global_timestamp + (now - trans->gt_last_cycle);
+
+        pg_read_barrier();
+        if (pg_atomic_read_u64(&GTMTransactions.gt_gts_seq) == seq)
+        {
+            break;
+        }
+    }
+
+    return gts;
+}
 void AcquireWriteLock(void)
 {
     int i;
@@ -1314,7 +1364,7 @@ SyncGlobalTimestamp(void)
 {
     GlobalTimestamp gts, now, delta;
 
-    AcquireWriteLock();
+    BeginGlobalTimestampUpdate();
     now = GTM_TimestampGetMonotonicRaw();
 
     if(enable_gtm_debug)
@@ -1343,7 +1393,7 @@ SyncGlobalTimestamp(void)
         elog(LOG, "syncing global timestamp "INT64_FORMAT " last cycle " INT64_FORMAT " now " INT64_FORMAT, 
                             gts, GTMTransactions.gt_last_cycle, now); 
     }
-    ReleaseWriteLock();
+    EndGlobalTimestampUpdate();
 
     
     return gts;
@@ -1353,39 +1403,28 @@ SyncGlobalTimestamp(void)
 void
 SetNextGlobalTimestamp(GlobalTimestamp gts)
 {
-    AcquireWriteLock();
+    BeginGlobalTimestampUpdate();
     GTMTransactions.gt_global_timestamp = gts;
     GTMTransactions.gt_last_cycle = GTM_TimestampGetMonotonicRaw();
     GTMTransactions.gt_last_issue_timestamp = gts - 1;
-    ReleaseWriteLock();
+    EndGlobalTimestampUpdate();
     
     elog(DEBUG8, "set next global timestamp "INT64_FORMAT " last cycle " INT64_FORMAT, gts, GTMTransactions.gt_last_cycle);
     return;
 }
 
 /*
- * Add for global timestamp; Process MSG_GETGTS message
+ * Get the next global timestamp, making sure the xlog of this GTM has been
+ * synced recently enough for the timestamp to survive a failover.
  */
-void
-ProcessGetGTSCommand(Port *myport, StringInfo message)
-{// #lizard forgives
-    StringInfoData buf;
+static GTM_Timestamp
+GetNextGlobalTimestampChecked(void)
+{
     GTM_Timestamp timestamp;
 #ifdef __XLOG__
     time_t        now;
 #endif
-    
-    pq_getmsgend(message);    
-    
-    if (Recovery_IsStandby())
-    {
-        if (myport->remote_type != GTM_NODE_GTM_CTL && myport->remote_type != GTM_NODE_GTM)
-        {
-            elog(ERROR, "gtm standby can't provide global timestamp.");
-        }
-    }
 
-    /* Get a GTM timestamp */
     timestamp = GetNextGlobalTimestamp();
 #ifdef __XLOG__
     now       = GTM_TimestampGetMonotonicRaw();
@@ -1403,6 +1442,30 @@ ProcessGetGTSCommand(Port *myport, StringInfo message)
             elog(ERROR,"sync time exceeded last:%lu now:%lu",GetMyThreadInfo->last_sync_gts,now);
     }
 #endif
+    return timestamp;
+}
+
+/*
+ * Add for global timestamp; Process MSG_GETGTS message
+ */
+void
+ProcessGetGTSCommand(Port *myport, StringInfo message)
+{
+    StringInfoData buf;
+    GTM_Timestamp timestamp;
+    
+    pq_getmsgend(message);    
+    
+    if (Recovery_IsStandby())
+    {
+        if (myport->remote_type != GTM_NODE_GTM_CTL && myport->remote_type != GTM_NODE_GTM)
+        {
+            elog(ERROR, "gtm standby can't provide global timestamp.");
+        }
+    }
+
+    /* Get a GTM timestamp */
+    timestamp = GetNextGlobalTimestampChecked();
         
     /* Respond to the client */
     pq_beginmessage(&buf, 'S');
@@ -1450,10 +1513,13 @@ ProcessGetGTSCommandMulti(Port *myport, StringInfo message)
     if (gts_count <= 0)
         elog(PANIC, "Zero or less transaction count");
 
-    /* Get a GTM timestamp */
-    timestamp = GTM_TimestampGetCurrent();
+    /*
+     * One timestamp serves all the requests of the batch, the coordinator
+     * hands it to each of its waiting backends.
+     */
+    timestamp = GetNextGlobalTimestampChecked();
 
-    elog(DEBUG7, "GTM processes timestamp.\n");
+    elog(DEBUG7, "GTM processes timestamp for %d requests.\n", gts_count);
     
     BeforeReplyToClientXLogTrigger();
     
@@ -1467,6 +1533,10 @@ ProcessGetGTSCommandMulti(Port *myport, StringInfo message)
         pq_sendbytes(&buf, (char *)&proxyhdr, sizeof (GTM_ProxyMsgHeader));
     }
     pq_sendbytes(&buf, (char *)&timestamp, sizeof(GTM_Timestamp));
+    if (GTMClusterReadOnly)
+    {
+        pq_sendbyte(&buf, true);
+    }
     pq_endmessage(myport, &buf);
 
     if (myport->remote_type != GTM_NODE_GTM_PROXY)
@@ -100,6 +100,8 @@
 #include "gtm/gtm_store.h"
 #include "gtm/pqformat.h"
 #include "gtm/libpq.h"
+#include "gtm/gtm_stat.h"
+#include "gtm/gtm_time.h"
 #include "utils/pg_crc.h"
 
 #undef MIN
@@ -112,6 +114,8 @@ extern GTM_ThreadInfo    *g_basebackup_thread;
 extern bool                 enable_sync_commit;
 extern bool              first_init;
 extern int               max_wal_sender;
+extern int               commit_delay;
+extern int               commit_siblings;
 extern int32             g_GTMStoreMapFile;
 extern size_t            g_GTMStoreSize;
 extern GTMControlHeader  *g_GTM_Store_Header;
@@ -131,7 +135,13 @@ extern bool             recovery_pitr_mode;
 extern int  GTMStartupGTSDelta;
 
 static bool      g_recovery_finish;
-static bool     *g_GTMStoreDirtyMap;
+
+/* one flag per PAGE_SIZE page of the map file, set when the page is changed */
+static bool     *g_GTMStoreDirtyPages;
+static int       g_GTMStorePageCount;
+
+/* crash recovery redoes into this copy of the map file, see GTM_XLogRecovery */
+static char     *g_GTMRedoImage = NULL;
 static GTM_MutexLock g_CheckPointLock;
 extern enum GTM_PromoteStatus promote_status;
 
@@ -176,6 +186,7 @@ static void  XLogWrite(XLogRecPtr req);
 static void  InitXLogCmdHeader(XLogCmdHeader *header,uint32 type);
 
 static XLogRecPtr WaitXLogInsertionsToFinish(XLogRecPtr upto);
+static XLogRecPtr XLogInsertionsFinishedUpto(XLogRecPtr upto);
 static XLogRecPtr XLogCheckPointInsert(void);
 
 static void GenerateStatusFile(uint64 segment_no);
@@ -196,6 +207,12 @@ static void ReleaseXLogRecordWriteLocks(void);
 
 static void NotifyWaitingQueue(void);
 
+static void MarkStoreDirtyPages(size_t offset, size_t len);
+static void LoadRedoImage(void);
+static void FlushRedoImage(void);
+static int  CollectStoreDirtyPages(char *dst);
+static void WriteStoreDirtyPages(char *src, int count);
+
 static void gtm_init_replication_data(GTM_StandbyReplication *replication);
 
 static void GTM_RecoveryUpdateMetaData(XLogRecPtr redo_end_pos,XLogRecPtr preXLogRecord,uint64 segment_no,int idx);
@@ -1156,8 +1173,7 @@ GTM_XLogFileInit(char *data_dir)
     flush      = XLogCtl->LogwrtResult.Flush;
     segment_no = flush / GTM_XLOG_SEG_SIZE;
 
-    g_GTMStoreDirtyMap = (bool *)palloc0(g_GTMStoreSize * sizeof(bool));
-    memset(g_GTMStoreDirtyMap,0,g_GTMStoreSize * sizeof(bool));
+    memset(g_GTMStoreDirtyPages,0,g_GTMStorePageCount * sizeof(bool));
 
     if(Recovery_IsStandby())
         return ;
@@ -1217,6 +1233,7 @@ GTM_XLogCtlDataInit(void)
 
     GTM_RWLockInit(&XLogCtl->segment_lck);
     GTM_MutexLockInit(&XLogCtl->walwrite_lck);
+    pg_atomic_init_u32(&XLogCtl->flush_waiters, 0);
     SpinLockInit(&XLogCtl->walwirte_info_lck);
     SpinLockInit(&XLogCtl->timeline_lck);
 
@@ -1240,9 +1257,13 @@ GTM_XLogCtlDataInit(void)
     Insert->CurrBytePos = ControlData->CurrBytePos;
     Insert->PrevBytePos = ControlData->PrevBytePos;
 
+    g_GTMStorePageCount    = (g_GTMStoreSize + PAGE_SIZE - 1) / PAGE_SIZE;
+    g_GTMStoreDirtyPages   = (bool *)palloc0(g_GTMStorePageCount * sizeof(bool));
+
+    /* dirty runs are made of whole pages, there can't be more than half of them */
     g_checkpointMapperBuff = (char *)palloc(g_GTMStoreSize);
-    g_checkpointDirtySize  = (uint32 *)palloc(sizeof(uint32) * g_GTMStoreSize);
-    g_checkpointDirtyStart = (uint32 *)palloc(sizeof(uint32) * g_GTMStoreSize);
+    g_checkpointDirtySize  = (uint32 *)palloc(sizeof(uint32) * (g_GTMStorePageCount / 2 + 1));
+    g_checkpointDirtyStart = (uint32 *)palloc(sizeof(uint32) * (g_GTMStorePageCount / 2 + 1));
 
     if(enalbe_gtm_xlog_debug || enable_gtm_debug)
     {
@@ -1423,6 +1444,59 @@ OpenMapperFile(char *data_dir)
     }
 }
 
+/*
+ * Read the map file into memory, so that redo overwrites it there and a page
+ * changed by many records is written only once.
+ */
+static void
+LoadRedoImage(void)
+{
+    ssize_t nbytes;
+
+    nbytes = pread(g_GTMStoreMapFile, g_checkpointMapperBuff, g_GTMStoreSize, 0);
+    if (nbytes != g_GTMStoreSize)
+    {
+        elog(LOG, "LoadRedoImage read file:%s failed for:%s, reqiured size:%zu, read size:%zd.",
+             GTM_MAP_FILE_NAME, strerror(errno), g_GTMStoreSize, nbytes);
+        exit(1);
+    }
+
+    memset(g_GTMStoreDirtyPages, 0, g_GTMStorePageCount * sizeof(bool));
+    g_GTMRedoImage = g_checkpointMapperBuff;
+}
+
+/*
+ * Check and write the pages touched by redo. Only these can have changed
+ * since the last checkpoint, so nothing else needs to be validated.
+ */
+static void
+FlushRedoImage(void)
+{
+    int i;
+    int idx;
+    int pages = 0;
+
+    if (g_GTMRedoImage == NULL)
+        return ;
+
+    idx = CollectStoreDirtyPages(NULL);
+    for (i = 0; i < idx; i++)
+    {
+        if (!GTM_StoreValidateRange(g_GTMRedoImage, g_checkpointDirtyStart[i], g_checkpointDirtySize[i]))
+        {
+            elog(LOG, "redo result of map file at %u size %u is invalid",
+                 g_checkpointDirtyStart[i], g_checkpointDirtySize[i]);
+            exit(1);
+        }
+        pages += g_checkpointDirtySize[i] / PAGE_SIZE;
+    }
+
+    WriteStoreDirtyPages(g_GTMRedoImage, idx);
+    g_GTMRedoImage = NULL;
+
+    elog(LOG, "recovery wrote %d of %d map file pages", pages, g_GTMStorePageCount);
+}
+
 /* Close mapper file after the recovery */
 void
 CloseMapperFile(void)
@@ -1761,8 +1835,8 @@ GTM_ThreadWalRedoer_Internal()
     if(xlog_rec != NULL)
         pfree(xlog_rec);
 
-    for(i = 0; i < g_GTMStoreSize;i++)
-        g_GTMStoreDirtyMap[i] = true;
+    for(i = 0; i < g_GTMStorePageCount;i++)
+        g_GTMStoreDirtyPages[i] = true;
 
     if(Recovery_IsStandby())
         DoSlaveCheckPoint(false);
@@ -1860,6 +1934,7 @@ GTM_XLogRecovery(XLogRecPtr startPos,char *data_dir)
     elog(LOG,"start recovery from %X/%X",(uint32)(startPos >> 32),(uint32)startPos);
 
     OpenMapperFile(data_dir);
+    LoadRedoImage();
 
     /* One record must not larger then UsableBytesInSegment */
     xlog_rec = palloc(UsableBytesInSegment);
@@ -2048,6 +2123,7 @@ GTM_XLogRecovery(XLogRecPtr startPos,char *data_dir)
 
 exit_process:
 
+    FlushRedoImage();
     CloseMapperFile();
     if(xlog_rec != NULL)
         pfree(xlog_rec);
@@ -2376,6 +2452,12 @@ RedoRangeOverwrite(XLogCmdRangerOverWrite *cmd)
             }
         }
     }
+    else if(g_GTMRedoImage != NULL)
+    {
+        /* written out once per page at the end of the recovery */
+        memcpy(g_GTMRedoImage + cmd->offset,cmd->data,cmd->bytes);
+        MarkStoreDirtyPages(cmd->offset,cmd->bytes);
+    }
     else
     {
         nbytes = lseek(g_GTMStoreMapFile, cmd->offset, SEEK_SET);
@@ -2533,11 +2615,6 @@ DoSlaveCheckPoint(bool write_check_point)
 void
 DoMasterCheckPoint(bool shutdown)
 {// #lizard forgives
-    int nbytes;
-    int size;
-    int write_start;
-    int i;
-    int ret;
     XLogRecPtr flush_ptr;
     int idx;
 
@@ -2556,28 +2633,7 @@ DoMasterCheckPoint(bool shutdown)
 
     /* we lock header lock here ,because we want to shorten the interval of header lock holding */
     GTM_RWLockAcquire(g_GTM_Store_Head_Lock,GTM_LOCKMODE_READ);
-    memcpy(g_checkpointMapperBuff,g_GTMStoreMapAddr,g_GTMStoreSize);
-
-    for(i = 0 ; i < g_GTMStoreSize ; i++)
-    {
-        while(i < g_GTMStoreSize && !g_GTMStoreDirtyMap[i]) i++;
-
-        write_start = i;
-
-        if( i == g_GTMStoreSize )
-            break;
-
-        size = 0;
-        while(i < g_GTMStoreSize && g_GTMStoreDirtyMap[i])
-        {
-            g_GTMStoreDirtyMap[i] = false;
-            size++;
-            i++;
-        }
-
-        g_checkpointDirtySize[idx]    = size;
-        g_checkpointDirtyStart[idx++] = write_start;
-    }
+    idx = CollectStoreDirtyPages(g_checkpointMapperBuff);
 
     XLogRegisterCheckPoint();
 
@@ -2596,48 +2652,154 @@ DoMasterCheckPoint(bool shutdown)
     }
 
     /* writes all dirty section */
-    for(i = 0 ; i < idx ; i++)
+    WriteStoreDirtyPages(g_checkpointMapperBuff, idx);
+
+    ReleaseXLogInsertLock();
+
+    XLogFlush(flush_ptr);
+
+    /* save checkpoint position to ControlData */
+    GTM_RWLockAcquire(&ControlDataLock,GTM_LOCKMODE_WRITE);
+
+    ControlData->thisTimeLineID = GetCurrentTimeLineID();
+    ControlData->prevCheckPoint = ControlData->checkPoint;
+    ControlData->checkPoint      = flush_ptr - flush_ptr % GTM_XLOG_SEG_SIZE ;  // point to the head of segment
+
+    ControlDataSync(true);
+
+    elog(LOG, "Checkpoint done");
+    GTM_RWLockRelease(&ControlDataLock);
+}
+
+/*
+ * Write the dirty pages of the map file between checkpoints, so that a
+ * checkpoint only has the pages changed since the last round left to write
+ * and one fsync covers many changes. The map file content is only trusted
+ * from the last checkpoint on, xlog redo covers the pages written here.
+ */
+void
+GTM_StoreBackgroundFlush(void)
+{
+    XLogRecPtr  insert_ptr;
+    uint64      bytepos;
+    int         idx;
+
+    if(Recovery_IsStandby())
+        return ;
+
+    GTM_MutexLockAcquire(&g_CheckPointLock);
+
+    /* take a consistent copy of the dirty pages, as checkpoint does */
+    GTM_StoreLock();
+    GTM_RWLockAcquire(g_GTM_Store_Head_Lock,GTM_LOCKMODE_READ);
+    idx = CollectStoreDirtyPages(g_checkpointMapperBuff);
+    GTM_RWLockRelease(g_GTM_Store_Head_Lock);
+    GTM_StoreUnLock();
+
+    if(idx > 0)
+    {
+        /* the xlog of the copied changes goes to disk before them */
+        SpinLockAcquire(&XLogCtl->Insert.insertpos_lck);
+        bytepos = XLogCtl->Insert.CurrBytePos;
+        SpinLockRelease(&XLogCtl->Insert.insertpos_lck);
+        insert_ptr = XLogBytePosToEndRecPtr(bytepos);
+
+        XLogFlush(insert_ptr);
+        WriteStoreDirtyPages(g_checkpointMapperBuff, idx);
+
+        if(enalbe_gtm_xlog_debug)
+            elog(LOG, "GTM_StoreBackgroundFlush wrote %d dirty runs", idx);
+    }
+
+    GTM_MutexLockRelease(&g_CheckPointLock);
+}
+
+/* Remember the pages of the map file covered by [offset, offset + len) are changed */
+static void
+MarkStoreDirtyPages(size_t offset, size_t len)
+{
+    size_t page;
+
+    if(len == 0)
+        return ;
+
+    for(page = offset / PAGE_SIZE; page <= (offset + len - 1) / PAGE_SIZE; page++)
+        g_GTMStoreDirtyPages[page] = true;
+}
+
+/*
+ * Collect the dirty pages into runs in g_checkpointDirtyStart/Size and clear
+ * them. If dst is given, the runs are copied there from the map in memory.
+ * Returns the number of runs.
+ */
+static int
+CollectStoreDirtyPages(char *dst)
+{
+    int    page;
+    int    first;
+    int    idx = 0;
+    size_t start;
+    size_t size;
+
+    for(page = 0; page < g_GTMStorePageCount; page++)
+    {
+        if(!g_GTMStoreDirtyPages[page])
+            continue;
+
+        first = page;
+        while(page < g_GTMStorePageCount && g_GTMStoreDirtyPages[page])
+        {
+            g_GTMStoreDirtyPages[page] = false;
+            page++;
+        }
+
+        start = (size_t) first * PAGE_SIZE;
+        size  = Min((size_t) page * PAGE_SIZE, g_GTMStoreSize) - start;
+
+        if(dst != NULL)
+            memcpy(dst + start, g_GTMStoreMapAddr + start, size);
+
+        g_checkpointDirtyStart[idx] = start;
+        g_checkpointDirtySize[idx++] = size;
+    }
+
+    return idx;
+}
+
+/* Write the collected runs from src to the map file and fsync once */
+static void
+WriteStoreDirtyPages(char *src, int count)
+{
+    int     i;
+    ssize_t nbytes;
+    off_t   write_start;
+    size_t  size;
+
+    for(i = 0 ; i < count ; i++)
     {
         write_start = g_checkpointDirtyStart[i];
         size        = g_checkpointDirtySize[i];
 
-        nbytes = (int) lseek(g_GTMStoreMapFile, write_start, SEEK_SET);
+        nbytes = lseek(g_GTMStoreMapFile, write_start, SEEK_SET);
         if (nbytes != write_start)
         {
             elog(LOG, "could not seek map file for: %s", strerror(errno));
             exit(1);
         }
 
-        nbytes = (int) write(g_GTMStoreMapFile, g_checkpointMapperBuff + write_start, size);
+        nbytes = write(g_GTMStoreMapFile, src + write_start, size);
         if (size != nbytes)
         {
-            elog(LOG, "could not write map for: %s, required bytes:%d, return bytes:%d", strerror(errno), size, nbytes);
+            elog(LOG, "could not write map for: %s, required bytes:%zu, return bytes:%zd", strerror(errno), size, nbytes);
             exit(1);
         }
     }
 
-    ret = fsync(g_GTMStoreMapFile);
-    if (ret)
+    if (fsync(g_GTMStoreMapFile))
     {
         elog(LOG, "could not fsync map file for: %s", strerror(errno));
         exit(1);
     }
-
-    ReleaseXLogInsertLock();
-
-    XLogFlush(flush_ptr);
-
-    /* save checkpoint position to ControlData */
-    GTM_RWLockAcquire(&ControlDataLock,GTM_LOCKMODE_WRITE);
-
-    ControlData->thisTimeLineID = GetCurrentTimeLineID();
-    ControlData->prevCheckPoint = ControlData->checkPoint;
-    ControlData->checkPoint      = flush_ptr - flush_ptr % GTM_XLOG_SEG_SIZE ;  // point to the head of segment
-
-    ControlDataSync(true);
-
-    elog(LOG, "Checkpoint done");
-    GTM_RWLockRelease(&ControlDataLock);
 }
 
 /* wait until all the xlog before upto to copy to the buff */
@@ -2714,6 +2876,63 @@ WaitXLogInsertionsToFinish(XLogRecPtr upto)
     return finishedUpto;
 }
 
+/*
+ * Like WaitXLogInsertionsToFinish, but never sleeps: returns how far past
+ * upto the insertions have finished right now. Used while holding
+ * walwrite_lck, which an inserter switching segment may be waiting for.
+ * All the insertions before upto must have been waited for already.
+ */
+static XLogRecPtr
+XLogInsertionsFinishedUpto(XLogRecPtr upto)
+{
+    uint64        bytepos;
+    XLogRecPtr    finishedUpto;
+    XLogInsertLock *XLogInsertLocks;
+    XLogCtlInsert  *Insert;
+    XLogRecPtr      insertingat;
+    int     i;
+    int lock_id;
+
+    XLogInsertLocks = XLogCtl->insert_lck;
+    Insert = &XLogCtl->Insert;
+
+    SpinLockAcquire(&Insert->insertpos_lck);
+    bytepos = Insert->CurrBytePos;
+    SpinLockRelease(&Insert->insertpos_lck);
+    finishedUpto = XLogBytePosToEndRecPtr(bytepos);
+
+    lock_id = GetMyThreadInfo->insert_lock_id;
+
+    for (i = 0; i < NUM_XLOGINSERT_LOCKS && finishedUpto > upto; i++)
+    {
+        if(i == lock_id)
+            continue;
+
+        if(GTM_MutexLockConditionalAcquire(&XLogInsertLocks[i].l))
+        {
+            GTM_MutexLockRelease(&XLogInsertLocks[i].l);
+            continue;
+        }
+
+        SpinLockAcquire(&XLogInsertLocks[i].m);
+        insertingat = XLogInsertLocks[i].start;
+        SpinLockRelease(&XLogInsertLocks[i].m);
+
+        /* position not published yet, it may be anywhere after upto */
+        if(insertingat == InvalidXLogRecPtr)
+            return upto;
+
+        if(insertingat < finishedUpto)
+            finishedUpto = insertingat;
+    }
+
+    /* we can only flush to the end of the segment at most*/
+    if(finishedUpto <= upto || GetSegmentNo(finishedUpto - 1) > GetSegmentNo(upto - 1))
+        return upto;
+
+    return finishedUpto;
+}
+
 /*
  * Convert an "usable byte position" to the start of XLogRecPtr.
  */
@@ -2826,7 +3045,6 @@ XLogRegisterRangeOverwrite(offset_t offset,
     XLogRecData *rec_data = NULL;
     XLogCmdRangerOverWrite *cmd = NULL;
     XLogRegisterBuff *reg_buff = GetMyThreadInfo->register_buff;
-    int i;
 
     rec_data = (XLogRecData *)palloc(sizeof(XLogRecData));
 
@@ -2857,12 +3075,7 @@ XLogRegisterRangeOverwrite(offset_t offset,
     if(enalbe_gtm_xlog_debug)
         elog(LOG,"%lu %d",offset,len);
 
-    i = offset;
-    while(len)
-    {
-        g_GTMStoreDirtyMap[i++] = true;
-        len--;
-    }
+    MarkStoreDirtyPages(offset,len);
 
 }
 
@@ -3395,6 +3608,11 @@ XLogInCurrentSegment(XLogRecPtr pos)
 
 /*
  * Writer request position to xlog file 
+ *
+ * On the primary this is where group commit happens: threads whose records
+ * are covered by the flush of the lock holder return as soon as they get
+ * the lock, and the holder writes everything that finished insertion while
+ * it was waiting, optionally sleeping commit_delay first to gather more.
  */
 static void
 XLogWrite(XLogRecPtr req)
@@ -3405,10 +3623,11 @@ XLogWrite(XLogRecPtr req)
     int     written;
     uint64  end_pos;
     XLogRecPtr flush_pos;
+    XLogRecPtr finished_pos;
     long long  start_time;
     long long  end_time;
-
-    end_pos = XLogRecPtrToFileOffset(req);
+    GTM_Timestamp flush_start;
+    bool       delayed = false;
 
     GTM_MutexLockAcquire(&XLogCtl->walwrite_lck);
 
@@ -3423,6 +3642,29 @@ XLogWrite(XLogRecPtr req)
         return ;
     }
 
+    if(Recovery_IsStandby() == false)
+    {
+        /*
+         * we are the only one flushing, others queue on walwrite_lck meanwhile.
+         * flush_waiters counts us as well.
+         */
+        if(commit_delay > 0 &&
+           pg_atomic_read_u32(&XLogCtl->flush_waiters) > commit_siblings + 1)
+        {
+            pg_usleep(commit_delay);
+            delayed = true;
+        }
+
+        finished_pos = XLogInsertionsFinishedUpto(req);
+        if(finished_pos > req)
+        {
+            NotifyReplication(finished_pos);
+            req = finished_pos;
+        }
+    }
+
+    end_pos = XLogRecPtrToFileOffset(req);
+
     start_pos = XLogCtl->last_write_idx;
 
     if(end_pos == 0)
@@ -3451,6 +3693,7 @@ XLogWrite(XLogRecPtr req)
     }
 
     start_time = getSystemTime();
+    flush_start = GTM_TimestampGetCurrent();
 
     do
     {
@@ -3481,6 +3724,7 @@ XLogWrite(XLogRecPtr req)
     fsync(XLogCtl->xlog_fd);
     
     end_time = getSystemTime();
+    GTM_UpdateXLogFlushStatistics((uint32) (GTM_TimestampGetCurrent() - flush_start), delayed);
     if(end_time - start_time > warnning_time_cost)
         elog(LOG, "XLogWrite size %ld lsn %X/%X cost %lld ms", total_write, (uint32)(req >> 32), (uint32)req, end_time - start_time);
 
@@ -3521,6 +3765,9 @@ XLogFlush(XLogRecPtr ptr)
     if(flush_pos >= ptr)
         return ;
 
+    GTM_CountXLogFlushRequest();
+    pg_atomic_fetch_add_u32(&XLogCtl->flush_waiters, 1);
+
     if(Recovery_IsStandby() == false)
         write_pos = WaitXLogInsertionsToFinish(ptr);
     else
@@ -3530,6 +3777,8 @@ XLogFlush(XLogRecPtr ptr)
     NotifyReplication(write_pos);
 
     XLogWrite(write_pos);
+
+    pg_atomic_fetch_sub_u32(&XLogCtl->flush_waiters, 1);
 }
 
 /*
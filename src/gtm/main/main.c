@@ -103,7 +103,10 @@ int            scale_factor_threads = 1;
 int            worker_thread_number = 2;
 #ifdef __TBASE__
 int         wal_writer_delay;
+int         commit_delay;
+int         commit_siblings;
 int         checkpoint_interval;
+int         store_flush_interval;
 char        *archive_command;
 bool        archive_mode;
 int         max_reserved_wal_number;
@@ -2543,8 +2546,22 @@ GTM_ThreadCheckPointer(void *argp)
 
             while(start_time < end_time)
             {
-                sleep(end_time - start_time);
+                pg_time_t nap = end_time - start_time;
+
+                if(store_flush_interval > 0 && nap > store_flush_interval)
+                    nap = store_flush_interval;
+
+                sleep(nap);
                 start_time = time(NULL);
+
+                /*
+                 * Write the changed map file pages in the meantime. Off by
+                 * default (store_flush_interval = 0): each round holds
+                 * GTM_StoreLock exclusively while it copies the pages.
+                 */
+                if(store_flush_interval > 0 && start_time < end_time &&
+                   GTM_SHUTTING_DOWN != GTMTransactions.gt_gtm_state)
+                    GTM_StoreBackgroundFlush();
             }
         }
 
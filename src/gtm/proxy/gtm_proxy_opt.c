@@ -52,6 +52,7 @@ extern int GTMProxyPortNumber;
 extern int GTMConnectRetryInterval;
 extern int GTMServerPortNumber;
 extern int GTMProxyWorkerThreads;
+extern int GTMProxyGTSStatsInterval;
 extern char *GTMProxyDataDir;
 extern char *GTMProxyConfigFileName;
 extern char *GTMConfigFileName;
@@ -220,6 +221,17 @@ struct config_int ConfigureNamesInt[] =
 		GTM_PROXY_DEFAULT_WORKERS, 1, INT_MAX, NULL, NULL,
         0, NULL
     },
+    {
+        {
+            GTM_OPTNAME_GTS_STATS_INTERVAL, GTMC_SIGHUP,
+            gettext_noop("Interval in second to log how GTS requests were aggregated, 0 disables."),
+            NULL,
+            GTMOPT_UNIT_TIME
+        },
+        &GTMProxyGTSStatsInterval,
+		60, 0, INT_MAX, NULL, NULL,
+        0, NULL
+    },
     /* End-of-list marker */
     {
 		{NULL, 0, NULL, NULL, 0}, NULL, 0, 0, 0, NULL, NULL, 0, NULL
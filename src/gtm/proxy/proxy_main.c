@@ -137,6 +137,9 @@ char        *GTMServerHost;
 int            GTMServerPortNumber;
 
 int            GTMConnectRetryInterval = 60;
+#ifdef __TBASE__
+int            GTMProxyGTSStatsInterval = 60;
+#endif
 
 #ifdef __XLOG__
 char *recovery_file_name;
@@ -242,6 +245,9 @@ static void UnregisterProxy(void);
 static GTM_Conn *ConnectGTM(void);
 static void ReleaseCmdBackup(GTMProxy_CommandInfo *cmdinfo);
 static void workerThreadReconnectToGTM(void);
+#ifdef __TBASE__
+static void GTMProxy_ReportGTSStats(GTMProxy_ThreadInfo *thrinfo, int batch);
+#endif
 #ifdef USE_ASSERT_CHECKING
 static bool IsProxiedMessage(GTM_MessageType mtype);
 #endif
@@ -1675,6 +1681,9 @@ ProcessCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn,
         case MSG_TXN_COMMIT_MULTI:
         case MSG_TXN_ROLLBACK:
         case MSG_TXN_GET_GXID:
+#ifdef __TBASE__
+        case MSG_GETGTS:
+#endif
             ProcessTransactionCommand(conninfo, gtm_conn, mtype, input_message);
             break;
 
@@ -1892,6 +1901,44 @@ ProcessResponse(GTMProxy_ThreadInfo *thrinfo, GTMProxy_CommandInfo *cmdinfo,
             ReleaseCmdBackup(cmdinfo);
             break;
 
+#ifdef __TBASE__
+        case MSG_GETGTS:
+            /*
+             * A grouped command too. All the clients of the group get the
+             * single timestamp GTM issued for them.
+             */
+            if (res->gr_status == GTM_RESULT_OK)
+            {
+                if (res->gr_type != TXN_BEGIN_GETGTS_MULTI_RESULT)
+                {
+                    ReleaseCmdBackup(cmdinfo);
+                    elog(ERROR, "Wrong result");
+                }
+
+                timestamp = res->gr_resdata.grd_gts.grd_gts;
+
+                pq_beginmessage(&buf, 'S');
+                pq_sendint(&buf, TXN_BEGIN_GETGTS_RESULT, 4);
+                pq_sendbytes(&buf, (char *)&timestamp, sizeof (GTM_Timestamp));
+                if (res->gr_resdata.grd_gts.gtm_readonly)
+                {
+                    pq_sendbyte(&buf, true);
+                }
+                pq_endmessage(cmdinfo->ci_conn->con_port, &buf);
+                pq_flush(cmdinfo->ci_conn->con_port);
+            }
+            else
+            {
+                pq_beginmessage(&buf, 'E');
+                pq_sendbytes(&buf, res->gr_proxy_data, res->gr_msglen);
+                pq_endmessage(cmdinfo->ci_conn->con_port, &buf);
+                pq_flush(cmdinfo->ci_conn->con_port);
+            }
+            cmdinfo->ci_conn->con_pending_msg = MSG_TYPE_INVALID;
+            ReleaseCmdBackup(cmdinfo);
+            break;
+#endif
+
         case MSG_TXN_COMMIT_MULTI:
             if (res->gr_type != TXN_COMMIT_MULTI_RESULT)
             {
@@ -2243,6 +2290,14 @@ ProcessTransactionCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn,
             GTMProxy_CommandPending(conninfo, mtype, cmd_data);
             break;
 
+#ifdef __TBASE__
+        case MSG_GETGTS:
+            /* Folded with the other pending ones into MSG_GETGTS_MULTI */
+            pq_getmsgend(message);
+            GTMProxy_CommandPending(conninfo, mtype, cmd_data);
+            break;
+#endif
+
         case MSG_TXN_BEGIN:
         case MSG_TXN_GET_GXID:
             elog(FATAL, "Support not yet added for these message types");
@@ -2673,6 +2728,47 @@ GTMProxy_ProcessPendingCommands(GTMProxy_ThreadInfo *thrinfo)
                 thrinfo->thr_pending_commands[ii] = gtm_NIL;
                 break;
 
+#ifdef __TBASE__
+            case MSG_GETGTS:
+                /*
+                 * One timestamp serves all the clients asking for one, as
+                 * GTM issues it after all of them asked.
+                 */
+                gtm_foreach (elem, thrinfo->thr_pending_commands[ii])
+                {
+                    cmdinfo = (GTMProxy_CommandInfo *)gtm_lfirst(elem);
+                    Assert(cmdinfo->ci_mtype == ii);
+                    cmdinfo->ci_res_index = res_index++;
+                }
+
+                if (gtmpqPutInt(MSG_GETGTS_MULTI, sizeof (GTM_MessageType), gtm_conn) ||
+                    gtmpqPutInt(res_index, sizeof (int), gtm_conn))
+                    elog(ERROR, "Error sending data");
+
+                /* Finish the message. */
+                Enable_Longjmp();
+                if (gtmpqPutMsgEnd(gtm_conn))
+                    elog(ERROR, "Error finishing the message");
+                Disable_Longjmp();
+
+                GTMProxy_ReportGTSStats(thrinfo, res_index);
+
+                /*
+                 * Move the entire list to the processed command
+                 */
+                thrinfo->thr_processed_commands = gtm_list_concat(thrinfo->thr_processed_commands,
+                        thrinfo->thr_pending_commands[ii]);
+                /*
+                 * Free the list header of the second list, unless
+                 * gtm_list_concat actually returned the second list as-is
+                 * because the first list was empty
+                 */
+                if ((thrinfo->thr_processed_commands != thrinfo->thr_pending_commands[ii]) &&
+                    (thrinfo->thr_pending_commands[ii] != gtm_NIL))
+                    pfree(thrinfo->thr_pending_commands[ii]);
+                thrinfo->thr_pending_commands[ii] = gtm_NIL;
+                break;
+#endif
 
             default:
                 elog(ERROR, "This message type (%d) can not be grouped together", ii);
@@ -2689,6 +2785,49 @@ GTMProxy_ProcessPendingCommands(GTMProxy_ThreadInfo *thrinfo)
     }
 }
 
+#ifdef __TBASE__
+/*
+ * Account a MSG_GETGTS_MULTI sent for batch clients, and log every
+ * gts_stats_interval seconds how many client requests each request to GTM
+ * served on average.
+ */
+static void
+GTMProxy_ReportGTSStats(GTMProxy_ThreadInfo *thrinfo, int batch)
+{
+    time_t now = time(NULL);
+
+    thrinfo->thr_gts_requests += batch;
+    thrinfo->thr_gts_batches++;
+    if (batch > thrinfo->thr_gts_max_batch)
+    {
+        thrinfo->thr_gts_max_batch = batch;
+    }
+
+    if (thrinfo->thr_gts_report_time == 0)
+    {
+        thrinfo->thr_gts_report_time = now;
+    }
+
+    if (GTMProxyGTSStatsInterval <= 0 ||
+        now - thrinfo->thr_gts_report_time < GTMProxyGTSStatsInterval)
+    {
+        return;
+    }
+
+    elog(LOG, "GTS aggregation: %lu client requests in %lu GTM requests, "
+              "factor %.2f, max batch %lu",
+         (unsigned long) thrinfo->thr_gts_requests,
+         (unsigned long) thrinfo->thr_gts_batches,
+         (double) thrinfo->thr_gts_requests / thrinfo->thr_gts_batches,
+         (unsigned long) thrinfo->thr_gts_max_batch);
+
+    thrinfo->thr_gts_requests = 0;
+    thrinfo->thr_gts_batches = 0;
+    thrinfo->thr_gts_max_batch = 0;
+    thrinfo->thr_gts_report_time = now;
+}
+#endif
+
 /*
  * Validate the proposed data directory
  */
@@ -83,6 +83,9 @@ extern const char *commit_ts_identify(uint8 info);
 
 /* GUC parameter */
 extern bool enable_committs_print;
+#ifdef __TBASE__
+extern bool enable_committs_cache;
+#endif
 
 
 #endif                            /* COMMIT_TS_H */
@@ -115,6 +115,22 @@ extern void InitGTM(void);
 extern void CloseGTM(void);
 extern GTM_Timestamp 
 GetGlobalTimestampGTM(void);
+extern bool RequestGlobalTimestampGTM(void);
+extern GTM_Timestamp ReceiveGlobalTimestampGTM(void);
+#ifdef __TBASE__
+extern bool enable_gts_broker;
+extern Size GTSBrokerShmemSize(void);
+extern void GTSBrokerShmemInit(void);
+extern Datum pg_stat_get_gts_broker(PG_FUNCTION_ARGS);
+extern bool enable_hlc_readonly_gts;
+extern int  hlc_max_skew;
+extern int  hlc_sync_interval;
+extern int  hlc_simulated_skew;
+extern GTM_Timestamp GetGlobalTimestampHLC(void);
+extern Size HLCShmemSize(void);
+extern void HLCShmemInit(void);
+extern Datum pg_stat_get_hlc(PG_FUNCTION_ARGS);
+#endif
 extern GlobalTransactionId BeginTranGTM(GTM_Timestamp *timestamp, const char *globalSession);
 extern GlobalTransactionId BeginTranAutovacuumGTM(void);
 extern int CommitTranGTM(GlobalTransactionId gxid, int waited_xid_count,
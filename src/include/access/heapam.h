@@ -127,11 +127,15 @@ extern void heap_rescan_set_params(HeapScanDesc scan, ScanKey key,
 extern void heap_endscan(HeapScanDesc scan);
 extern HeapTuple heap_getnext(HeapScanDesc scan, ScanDirection direction);
 
-extern Size heap_parallelscan_estimate(Snapshot snapshot);
+extern Size heap_parallelscan_estimate(Relation relation, Snapshot snapshot);
 extern void heap_parallelscan_initialize(ParallelHeapScanDesc target,
-							 Relation relation, Snapshot snapshot);
+							 Size size, Relation relation, Snapshot snapshot);
 extern void heap_parallelscan_reinitialize(ParallelHeapScanDesc parallel_scan);
 extern HeapScanDesc heap_beginscan_parallel(Relation, ParallelHeapScanDesc);
+#ifdef _SHARDING_
+extern HeapScanDesc heap_beginscan_shards(Relation relation, Snapshot snapshot,
+					  Bitmapset *shards);
+#endif
 
 extern bool heap_fetch(Relation relation, Snapshot snapshot,
 		   HeapTuple tuple, Buffer *userbuf, bool keep_buf,
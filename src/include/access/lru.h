@@ -74,6 +74,7 @@
 #define LRU_H
 
 #include "access/xlogdefs.h"
+#include "port/atomics.h"
 #include "storage/lwlock.h"
 
 
@@ -153,6 +154,13 @@ typedef struct LruSharedData
     int           *page_lru_count;
     int            latest_page_number;
 
+    /*
+     * The version of a slot is odd while the page it holds or the content of
+     * that page changes, so that LruReadResidentPage can copy from the page
+     * without the partition lock.
+     */
+    pg_atomic_uint32 *page_version;
+
     /*
      * Optional array of WAL flush LSNs associated with entries in the SLRU
      * pages.  If not zero/NULL, we must flush WAL before writing pages (true
@@ -227,6 +235,10 @@ extern int LruReadPage(LruCtl ctl, int partitionno, int pageno, bool write_ok,
                   TransactionId xid);
 extern int LruReadPage_ReadOnly(LruCtl ctl, int partitionno, int pageno,
                            TransactionId xid);
+extern bool LruReadResidentPage(LruCtl ctl, int pageno, int offset, char *dst,
+                           int len);
+extern void LruSlotChangeBegin(LruShared shared, int slotno);
+extern void LruSlotChangeEnd(LruShared shared, int slotno);
 extern int PagenoMappingPartitionno(LruCtl ctl, int pageno);
 extern LWLock * GetPartitionLock(LruCtl ctl, int partitionno);
 extern void LruWritePage(LruCtl ctl, int partitionno, int slotno);
@@ -101,6 +101,15 @@ typedef struct ParallelHeapScanDescData
     BlockNumber phs_startblock; /* starting block number */
 	pg_atomic_uint64 phs_nallocated;	/* number of blocks allocated to
 										 * workers so far. */
+#ifdef _SHARDING_
+    /*
+     * In a scan by extents, workers are handed out whole extents of the
+     * wanted shards instead of blocks, and phs_nallocated counts extents.
+     */
+    bool        phs_extentscan;    /* scan by extents? */
+    int32        phs_nextents;    /* # extents to scan */
+    Size        phs_extents_offset; /* offset of the ExtentID array */
+#endif
     char        phs_snapshot_data[FLEXIBLE_ARRAY_MEMBER];
 }            ParallelHeapScanDescData;
 
@@ -134,6 +143,13 @@ typedef struct HeapScanDescData
     Buffer        rs_cbuf;        /* current buffer in scan, if any */
     /* NB: if rs_cbuf is not InvalidBuffer, we hold a pin on that buffer */
     ParallelHeapScanDesc rs_parallel;    /* parallel scan information */
+#ifdef _SHARDING_
+    /* blocks of the extent handed out to us in a scan by extents */
+    BlockNumber rs_extent_next;    /* next block to return */
+    BlockNumber rs_extent_end;    /* end of the extent */
+    BlockNumber rs_prefetch_next;    /* next block to prefetch */
+    bool        rs_own_parallel;    /* free rs_parallel at scan end? */
+#endif
 
 #ifdef __SUPPORT_DISTRIBUTED_TRANSACTION__
     /* statistic account */
@@ -94,6 +94,9 @@ extern int  transaction_threshold;
 
 #ifdef __TBASE__
 extern bool enable_2pc_recovery_info;
+
+extern void TwoPhaseStatsReportRemote(bool finish, int64 gts_time, int64 fanout_time);
+extern void TwoPhaseStatsReportOnePhase(void);
 #endif
 
 #ifdef __TWO_PHASE_TRANS__
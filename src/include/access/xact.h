@@ -107,6 +107,15 @@ extern int	MyXactFlags;
  */
 #define XACT_FLAGS_ACQUIREDACCESSEXCLUSIVELOCK	(1U << 1)
 
+#ifdef __TBASE__
+/*
+ * XACT_FLAGS_WROTENOWALREL - set when a relation which is not WAL-logged,
+ * temporary or unlogged, is written. Such writes leave XactLastRecEnd alone,
+ * commit needs the flag to know that the local node was written.
+ */
+#define XACT_FLAGS_WROTENOWALREL				(1U << 2)
+#endif
+
 
 /*
  *	start- and end-of-transaction callbacks for dynamically loaded modules
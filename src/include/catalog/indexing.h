@@ -325,6 +325,11 @@ DECLARE_INDEX(pg_partition_interval_index, 8101, on pg_partition_interval using
 #define PgPartitionIntervalRelIndexId     8101
 #endif
 
+#ifdef _SHARDING_
+DECLARE_UNIQUE_INDEX(pg_shard_statistic_relid_index, 9039, on pg_shard_statistic using btree(starelid oid_ops));
+#define ShardStatisticRelidIndexId     9039
+#endif
+
 
 #ifdef _MIGRATE_
 DECLARE_UNIQUE_INDEX(pgxc_shard_map_shard_index, 9024, on pgxc_shard_map using btree(disgroup oid_ops, shardgroupid int4_ops));
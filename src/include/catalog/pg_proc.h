@@ -6846,6 +6846,31 @@ DESCR("set need_mvcc flag");
 DATA(insert OID = 4629 (  tbase_show_need_mvcc PGNSP PGUID 12 1 0 0 0 f f f f t f v r 0 0 23 "" _null_ _null_ _null_ _null_ _null_ tbase_show_need_mvcc _null_ _null_ _null_ ));
 DESCR("show need_mvcc flag");
 
+DATA(insert OID = 4640 (  pg_stat_get_2pc PGNSP PGUID 12 1 0 0 0 f f f f f f v r 0 0 2249 "" "{20,701,701,20,701,701,20,20,701,20,701}" "{o,o,o,o,o,o,o,o,o,o,o}" "{remote_prepares,remote_prepare_gts_time,remote_prepare_time,remote_finishes,remote_finish_gts_time,remote_finish_time,one_phase_commits,prepares,prepare_flush_time,finishes,finish_time}" _null_ _null_ pg_stat_get_2pc _null_ _null_ _null_ ));
+DESCR("statistics: two-phase commit latency by phase");
+
+DATA(insert OID = 4631 (  pg_stat_get_gts_broker PGNSP PGUID 12 1 0 0 0 f f f f f f v r 0 0 2249 "" "{20,20,701,20,701,701}" "{o,o,o,o,o,o}" "{batches,requests,avg_batch_size,max_batch_size,wait_time,gtm_time}" _null_ _null_ pg_stat_get_gts_broker _null_ _null_ _null_ ));
+DESCR("statistics: global timestamp requests coalesced by the GTS broker");
+
+DATA(insert OID = 4633 (  pg_stat_get_hlc PGNSP PGUID 12 1 0 0 0 f f f f f f v r 0 0 2249 "" "{16,20,701,20,20,20,20,701,701}" "{o,o,o,o,o,o,o,o,o}" "{valid,sync_gts,sync_age,syncs,local_snapshots,gtm_snapshots,skew_violations,last_skew,max_skew}" _null_ _null_ pg_stat_get_hlc _null_ _null_ _null_ ));
+DESCR("statistics: hybrid logical clock serving read-only global timestamps");
+
+DATA(insert OID = 4634 (  pg_stat_get_committs_cache PGNSP PGUID 12 1 0 0 0 f f f f f f v r 0 0 2249 "" "{20,20,20,20,701,701,701,701,701}" "{o,o,o,o,o,o,o,o,o}" "{reads,cache_hits,lockfree_reads,locked_reads,hit_ratio,avg_cache_time,avg_lockfree_time,avg_locked_time,time_saved}" _null_ _null_ pg_stat_get_committs_cache _null_ _null_ _null_ ));
+DESCR("statistics: commit timestamp reads by backend local cache, lock-free and locked reads");
+
+DATA(insert OID = 4632 (  pg_stat_get_sequence_cache PGNSP PGUID 12 1 100 0 0 f f f f f t v r 0 0 2249 "" "{26,26,25,20,20,20,20,20,20,701,701,701}" "{o,o,o,o,o,o,o,o,o,o,o,o}" "{datid,relid,seqname,range,cached,hits,misses,refills,refill_failures,avg_refill_time,max_refill_time,avg_miss_time}" _null_ _null_ pg_stat_get_sequence_cache _null_ _null_ _null_ ));
+DESCR("statistics: sequence ranges shared by the backends of this node");
+
+DATA(insert OID = 4635 (  pg_shard_move_fence PGNSP PGUID 12 1 0 0 0 f f f f t f v u 1 0 3220 "25" _null_ _null_ _null_ _null_ _null_ pg_shard_move_fence _null_ _null_ _null_ ));
+DESCR("fence writes to shards being moved, return the LSN to catch up to");
+DATA(insert OID = 4636 (  pg_shard_move_unfence PGNSP PGUID 12 1 0 0 0 f f f f t f v u 1 0 16 "16" _null_ _null_ _null_ _null_ _null_ pg_shard_move_unfence _null_ _null_ _null_ ));
+DESCR("end the fence of shards being moved");
+DATA(insert OID = 4637 (  pg_stat_shard_move PGNSP PGUID 12 1 0 0 0 f f f f f f v r 0 0 2249 "" "{25,23,1184,3220,20,701,20,20,20,1184,701}" "{o,o,o,o,o,o,o,o,o,o,o}" "{fenced_shards,fence_pid,fence_start,fence_lsn,fence_waits,fence_wait_time,fence_timeouts,copy_tuples,copy_bytes,copy_start,copy_rate}" _null_ _null_ pg_stat_shard_move _null_ _null_ _null_ ));
+DESCR("statistics: online shard move fence and copy progress");
+
+DATA(insert OID = 4638 (  pg_stat_get_datapump PGNSP PGUID 12 1 100 0 0 f f f f f t v r 0 0 2249 "" "{23,25,20,20,20,701,20,20,701,701}" "{o,o,o,o,o,o,o,o,o,o}" "{node_index,node_name,senders,max_queue_depth,stalls,stall_time,raw_bytes,compressed_bytes,compress_ratio,compress_time}" _null_ _null_ pg_stat_get_datapump _null_ _null_ _null_ ));
+DESCR("statistics: data pump queue depth, stalls and compression by consumer node");
+
 #endif
 
 /*
@@ -162,4 +162,15 @@ extern void RenameDatabaseSequence(const char* oldname, const char* newname);
 #endif
 #endif
 
+#ifdef __TBASE__
+extern int SequenceCacheEntries;
+extern int SequenceCacheLowWatermark;
+
+extern Size SequenceCacheShmemSize(void);
+extern void SequenceCacheShmemInit(void);
+extern void SequenceCacheRefillerRegister(void);
+extern void SequenceCacheRefillerMain(Datum main_arg);
+extern Datum pg_stat_get_sequence_cache(PG_FUNCTION_ARGS);
+#endif
+
 #endif                            /* SEQUENCE_H */
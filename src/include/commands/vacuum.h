@@ -336,6 +336,12 @@ extern void truncate_extent_tuples(Relation onerel,
                             BlockNumber to_blk, 
                             bool cleanpage, 
                             int *deleted_tuples);
+extern int truncate_shard_extents(Relation onerel,
+                            ExtentID *eids,
+                            int neids,
+                            TransactionId limit_xmin,
+                            bool *released,
+                            int *deleted_tuples);
 extern void reinit_extent_pages(Relation rel, ExtentID eid);
 extern void xlog_reinit_extent_pages(RelFileNode rnode, ExtentID eid);
 extern void ExecVacuumShard(VacuumShardStmt *stmt);
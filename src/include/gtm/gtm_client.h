@@ -271,6 +271,35 @@ typedef struct Get_GTS_Result {
     bool                        gtm_readonly;   /* read only mode for gtm */
 } Get_GTS_Result;
 
+#ifdef __TBASE__
+/*
+ * Asynchronous API: several requests can be outstanding on one connection,
+ * each identified by the token returned when it was sent. GTM answers the
+ * requests of a connection in order, so their replies are matched by
+ * position. All the outstanding requests must be waited for before a
+ * synchronous call is made on the connection.
+ */
+typedef uint32 GTM_AsyncToken;
+
+#define InvalidGTMAsyncToken	0
+#define GTM_MAX_ASYNC_REQUESTS	64
+
+typedef struct GTM_AsyncResult
+{
+	GTM_ResultType		type;
+	int					status;		/* GTM_RESULT_xxx */
+	union
+	{
+		Get_GTS_Result	gts;		/* send_global_timestamp_async */
+		struct
+		{
+			GTM_Sequence	seqval;
+			GTM_Sequence	rangemax;
+		} seq;						/* send_get_next_async */
+	} data;
+} GTM_AsyncResult;
+#endif
+
 /*
  * Connection Management API
  */
@@ -298,6 +327,14 @@ int bkup_begin_transaction(GTM_Conn *conn, GTM_IsolationLevel isolevel,
 						   uint32 client_id, GTM_Timestamp timestamp);
 #ifdef __TBASE__
 Get_GTS_Result get_global_timestamp(GTM_Conn *conn);
+Get_GTS_Result get_global_timestamp_multi(GTM_Conn *conn, int count);
+GTM_AsyncToken send_global_timestamp_async(GTM_Conn *conn);
+GTM_AsyncToken send_get_next_async(GTM_Conn *conn, GTM_SequenceKey key,
+					char *coord_name, int coord_procid, GTM_Sequence range);
+bool gtm_async_poll(GTM_Conn *conn, GTM_AsyncToken token);
+int gtm_async_wait(GTM_Conn *conn, GTM_AsyncToken token, GTM_AsyncResult *result);
+int gtm_async_outstanding(GTM_Conn *conn);
+bool gtm_async_pending(GTM_Conn *conn);
 #ifdef __XLOG__
 int check_gtm_status(GTM_Conn *conn, int *status, GTM_Timestamp *master,XLogRecPtr *master_ptr,
 					 int *standby_count,int **slave_is_sync, GTM_Timestamp **standby ,
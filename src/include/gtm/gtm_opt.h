@@ -352,6 +352,7 @@ const char *const config_type_names[] =\
 #define GTM_OPTNAME_STATUS_READER		"status_reader"
 #define GTM_OPTNAME_SYNCHRONOUS_BACKUP	"synchronous_backup"
 #define GTM_OPTNAME_WORKER_THREADS		"worker_threads"
+#define GTM_OPTNAME_GTS_STATS_INTERVAL	"gts_stats_interval"
 #define GTM_OPTNAME_ENABLE_DEBUG        "enable_gtm_debug"
 #define GTM_OPTNAME_ENABLE_SEQ_DEBUG    "enable_gtm_sequence_debug"
 #define GTM_OPTNAME_SCALE_FACTOR_THREADS		"scale_factor_threads"
@@ -364,7 +365,10 @@ const char *const config_type_names[] =\
 #ifdef __XLOG__
 #define GTM_OPTNAME_SYNCHRONOUS_COMMIT	"synchronous_commit"
 #define GTM_OPTNAME_WAL_WRITER_DELAY    "wal_writer_delay"
+#define GTM_OPTNAME_COMMIT_DELAY        "commit_delay"
+#define GTM_OPTNAME_COMMIT_SIBLINGS     "commit_siblings"
 #define GTM_OPTNAME_CHECKPOINT_INTERVAL "checkpoint_interval"
+#define GTM_OPTNAME_STORE_FLUSH_INTERVAL "store_flush_interval"
 #define GTM_OPTNAME_ARCHIVE_COMMAND     "archive_command"
 #define GTM_OPTNAME_ARCHIVE_MODE        "archive_mode"
 #define GTM_OPTNAME_MAX_RESERVED_WAL_NUMBER      "max_reserved_wal_number"
@@ -104,6 +104,14 @@ typedef struct GTMProxy_ThreadInfo
 
     GTM_Conn                *thr_gtm_conn;        /* Connection to GTM */
 
+#ifdef __TBASE__
+    /* GTS requests of the clients folded into MSG_GETGTS_MULTI */
+    uint64                    thr_gts_requests;
+    uint64                    thr_gts_batches;
+    uint64                    thr_gts_max_batch;
+    time_t                    thr_gts_report_time;
+#endif
+
     /* Reconnect Info */
     int                        can_accept_SIGUSR2;
     int                        reconnect_issued;
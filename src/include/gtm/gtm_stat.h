@@ -47,6 +47,25 @@ typedef struct
     GTM_StatisticsInfo cmd_statistics[CMD_STATISTICS_TYPE_COUNT];
 } GTM_WorkerStatistics;
 
+/*
+ * Version of the MSG_GET_STATISTICS reply. A client asks for a version after
+ * the clear flag, clients which do not get the base reply. Anything added to
+ * the reply goes after the version the server answers with.
+ */
+#define GTM_STATISTICS_VERSION_BASE         0
+#define GTM_STATISTICS_VERSION_XLOG_FLUSH   1
+#define GTM_STATISTICS_VERSION              GTM_STATISTICS_VERSION_XLOG_FLUSH
+
+/* xlog flush statistics, shared by all the threads flushing xlog */
+typedef struct
+{
+    pg_atomic_uint32 flush_requests;        /* flushes asked for, not yet covered on arrival */
+    pg_atomic_uint32 flush_times;           /* write and fsync actually done */
+    pg_atomic_uint32 delayed_flushes;       /* flushes that slept commit_delay first */
+    pg_atomic_uint64 total_flush_costtime;  /* in us */
+    pg_atomic_uint32 max_flush_costtime;    /* in us */
+} CACHE_LINE_ALIGN GTM_XLogFlushStatistics;
+
 typedef struct
 {
     uint32     total_request_times;
@@ -59,6 +78,15 @@ typedef struct
     uint32     min_costtime;
 } GTM_StatisticsItem;
 
+typedef struct
+{
+    uint32     flush_requests;
+    uint32     flush_times;
+    uint32     delayed_flushes;
+    uint32     avg_flush_costtime;
+    uint32     max_flush_costtime;
+} GTM_XLogFlushStatisticsItem;
+
 typedef struct
 {
     pg_time_t          start_time;                            /* statistics info start time */
@@ -66,6 +94,8 @@ typedef struct
     int32              sequences_remained;                    /* sequence remained num */
     int32              txn_remained;                          /* txn remained num */
     GTM_StatisticsItem stat_info[CMD_STATISTICS_TYPE_COUNT];  /* specific cmd statistics info */
+    int32              version;                               /* version of the reply */
+    GTM_XLogFlushStatisticsItem xlog_flush_info;              /* xlog group commit statistics info */
 } GTM_StatisticsResult;
 
 typedef struct
@@ -75,6 +105,7 @@ typedef struct
 } GTM_Statistics;
 
 extern GTM_Statistics GTMStatistics;
+extern GTM_XLogFlushStatistics GTMXLogFlushStatistics;
 
 void GTM_InitGtmStatistics(void);
 
@@ -82,5 +113,9 @@ void GTM_InitStatisticsHandle(void);
 
 void GTM_UpdateStatistics(GTM_WorkerStatistics* stat_handle, GTM_MessageType mtype, uint32 costtime);
 
+void GTM_CountXLogFlushRequest(void);
+
+void GTM_UpdateXLogFlushStatistics(uint32 costtime, bool delayed);
+
 void ProcessGetStatisticsCommand(Port *myport, StringInfo message);
 #endif
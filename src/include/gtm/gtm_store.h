@@ -107,6 +107,7 @@ typedef struct
 
 #ifdef __XLOG__
 extern void  GTM_StoreSizeInit(void);
+extern bool  GTM_StoreValidateRange(char *image, size_t offset, size_t len);
 #endif
 extern int32 GTM_StoreMasterInit(char *data_dir);
 extern int32 GTM_StoreShutDown(void);
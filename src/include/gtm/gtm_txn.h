@@ -165,6 +165,14 @@ typedef struct GTM_Transactions
 	GTM_RWLock			gt_TransArrayLock;
 	pg_atomic_uint32	gt_global_xid;
 
+	/*
+	 * Base of the issued global timestamps. Readers take a consistent copy
+	 * of it without writing anything, see GetNextGlobalTimestamp. Writers
+	 * hold the write lock and make gt_gts_seq odd while changing it. Keep it
+	 * off the cache line of gt_global_xid, which is changed all the time.
+	 */
+	char				gt_gts_pad[CACHE_LINE_SIZE];
+	pg_atomic_uint64	gt_gts_seq;
 	GlobalTimestamp		gt_last_cycle;
 	GlobalTimestamp 	gt_global_timestamp;
 	/* For debug purpose */
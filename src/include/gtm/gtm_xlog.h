@@ -81,6 +81,7 @@
 #include "gtm/heap.h"
 #include "access/xlogdefs.h"
 #include "gtm/gtm_xlog_internal.h"
+#include "port/atomics.h"
 
 #define NUM_XLOGINSERT_LOCKS  8
 
@@ -136,6 +137,7 @@ typedef struct XLogCtlData
 
     GTM_MutexLock  walwrite_lck;
     uint64         last_write_idx;
+    pg_atomic_uint32 flush_waiters;  /* threads in XLogFlush waiting for a write */
     
     s_lock_t       walwirte_info_lck;
     XLogwrtResult  LogwrtResult;
@@ -238,6 +240,7 @@ extern void XLogRegisterCheckPoint(void);
 extern void XLogRegisterTimeStamp(void);
 
 extern void DoCheckPoint(bool shutdown);
+extern void GTM_StoreBackgroundFlush(void);
 extern bool XLogBackgroundFlush(void);
 /*
  * Xlog insert related command.
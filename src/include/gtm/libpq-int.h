@@ -93,6 +93,11 @@ struct gtm_conn
 
     /* Pointer to the result of last operation */
     GTM_Result    *result;
+
+#ifdef __TBASE__
+    /* Requests sent through the asynchronous API, see gtm_client.c */
+    struct GTM_AsyncQueue *async_queue;
+#endif
 };
 
 /* === in fe-misc.c === */
@@ -127,6 +132,9 @@ extern int    gtmpqWriteReady(GTM_Conn *conn);
  * In fe-protocol.c
  */
 GTM_Result * GTMPQgetResult(GTM_Conn *conn);
+#ifdef __TBASE__
+GTM_Result * GTMPQparseResult(GTM_Conn *conn);
+#endif
 extern int gtmpqGetError(GTM_Conn *conn, GTM_Result *result);
 void gtmpqFreeResultData(GTM_Result *result, GTM_PGXCNodeType remote_type);
 
@@ -154,6 +154,7 @@ extern PGDLLIMPORT volatile uint32 CritSectionCount;
 #ifdef __TBASE__
 extern PGDLLIMPORT volatile int PoolerReloadHoldoffCount;
 extern PGDLLIMPORT volatile int PoolerReloadPending;
+extern PGDLLIMPORT volatile bool ConnectionAffinityTimeoutPending;
 #endif
 
 /* in tcop/postgres.c */
@@ -798,6 +798,14 @@ typedef struct RelOptInfo
 
 	/* used for complex delete */
 	ResultRelLocation resultRelLoc;
+
+	/*
+	 * share of the pages and tuples of a shard relation held by each
+	 * datanode, indexed by node index, from pg_shard_statistic (NULL if
+	 * unknown)
+	 */
+	double	   *shard_page_fractions;
+	double	   *shard_tuple_fractions;
 #endif
 
 } RelOptInfo;
@@ -784,6 +784,9 @@ typedef enum
 	WAIT_EVENT_WAL_WRITER_MAIN,
 #ifdef __AUDIT_FGA__
     WAIT_EVENT_AUDIT_FGA_MAIN,
+#endif
+#ifdef __TBASE__
+	WAIT_EVENT_SEQUENCE_CACHE_MAIN,
 #endif
 	WAIT_EVENT_CLUSTER_MONITOR_MAIN
 } WaitEventActivity;
@@ -833,7 +836,11 @@ typedef enum
 	WAIT_EVENT_REPLICATION_ORIGIN_DROP,
 	WAIT_EVENT_REPLICATION_SLOT_DROP,
 	WAIT_EVENT_SAFE_SNAPSHOT,
-	WAIT_EVENT_SYNC_REP
+	WAIT_EVENT_SYNC_REP,
+#ifdef __TBASE__
+	WAIT_EVENT_GTS_BROKER,
+	WAIT_EVENT_SHARD_MOVE_FENCE
+#endif
 } WaitEventIPC;
 
 /* ----------
@@ -62,6 +62,8 @@
 #define BIT_SET(data, bit)   ((1 << (bit)) & (data)) 
 
 extern int DataRowBufferSize;
+extern int RemoteDMLBatchRows;
+extern int RemoteDMLBatchSize;
 
 extern bool need_global_snapshot;
 extern List *executed_node_list;
@@ -98,6 +100,22 @@ typedef enum
 	REMOTE_PARAM_SUBPLAN
 } RemoteParamType;
 
+#ifdef __TBASE__
+/*
+ * Bounded ring of datarows prefetched from one connection while merge sort
+ * reads another one. Rows go to the tuplestore of the connection once the
+ * ring holds DataRowBufferSize worth of data.
+ */
+typedef struct RemoteRowRing
+{
+    RemoteDataRow  *rows;            /* slots, grown on demand */
+    int             size;            /* number of slots */
+    int             head;            /* slot of the oldest row */
+    int             count;           /* number of rows in the ring */
+    long            bytes;           /* size of the rows in the ring */
+} RemoteRowRing;
+#endif
+
 /* Combines results of INSERT statements using multiple values */
 typedef struct CombineTag
 {
@@ -151,13 +169,14 @@ typedef struct ResponseCombiner
      */
     ListCell  **tapemarks;
 #ifdef __TBASE__
-    List            **prerowBuffers;    /* 
-                                          *used for each connection in prefetch with merge_sort, 
-                                          * put datarows in each rowbuffer in order
-                                                                            */
+    RemoteRowRing    *prerowBuffers;    /*
+                                          * used for each connection in prefetch with merge_sort,
+                                          * put datarows in each ring in order
+                                          */
     Tuplestorestate **dataRowBuffer;    /* used for prefetch */
     long             *dataRowMemSize;    /* size of datarow in memory */
     int             *nDataRows;         /* number of datarows in tuplestore */
+    List            *rowBatches;        /* columnar batches of rows being returned */
     TupleTableSlot  *tmpslot;           
     char*            errorNode;            /* node Oid, who raise an error, set when handle_response */
     int              backend_pid;        /* backend_pid, who raise an error, set when handle_response */
@@ -185,6 +204,8 @@ typedef struct ResponseCombiner
     PGXCNodeHandle **conns;        
     int                 ccount;    
     uint64     recv_datarows;
+    uint64     spill_datarows;        /* datarows put into tuplestore */
+    uint64     spill_bytes;           /* size of the datarows put into tuplestore */
 	
 	/* for remote instrument */
 	HTAB            *recv_instr_htbl;        /* received str hash table for each plan_node_id */
@@ -228,6 +249,10 @@ typedef struct RemoteQueryState
     int            su_num_params;
 
     uint32        dml_prepared_mask[WORD_NUMBER_FOR_NODES]; 
+
+    /* rows of remote DML buffered per datanode, see ExecRemoteDML */
+    struct RemoteDMLBatch **dml_batches;
+    int64         dml_rows;            /* rows buffered so far by the statement */
 #endif
 }    RemoteQueryState;
 
@@ -361,6 +386,8 @@ extern bool DataNodeCopyEnd(PGXCNodeHandle *handle, bool is_error);
 
 #ifdef __TBASE__
 extern PGXCNodeAllHandles *get_exec_connections_all_dn(bool is_global_session);
+extern void pgxc_node_acquire_plan_handles(PlannedStmt *stmt);
+extern void pgxc_node_release_idle_handles(void);
 #endif
 
 extern RemoteQueryState *ExecInitRemoteQuery(RemoteQuery *node, EState *estate, int eflags);
@@ -433,6 +460,7 @@ extern void ExecRemoteSubPlanInitDSMWorker(RemoteSubplanState *node,
 extern void ExecRemoteQueryInitializeDSMWorker(RemoteQueryState *node,
                                                ParallelWorkerContext *pwcxt);
 
+extern void ExecFlushRemoteDML(ModifyTableState *mtstate);
 extern bool ExecRemoteDML(ModifyTableState *mtstate, ItemPointer tupleid, HeapTuple oldtuple,
               TupleTableSlot *slot, TupleTableSlot *planSlot, EState *estate, EPQState *epqstate,
               bool canSetTag, TupleTableSlot **returning, UPSERT_ACTION *result,
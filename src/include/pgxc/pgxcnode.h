@@ -130,6 +130,11 @@ struct pgxc_node_handle
 	bool 		plpgsql_need_begin_sub_txn;
 	bool 		plpgsql_need_begin_txn;
 	char        node_type;
+	struct DataPumpShmChannel *shm_channel; /* data pump channel of co-located producer */
+	uint32		shm_doorbells;	/* doorbells of the channel still to come on the socket */
+	int			epoll_sock;		/* socket registered in the backend epoll set */
+	bool		epoll_armed;	/* socket is enabled in the epoll set now */
+	uint32		epoll_gen;		/* last pgxc_node_receive waiting on the socket */
 #endif
 };
 typedef struct pgxc_node_handle PGXCNodeHandle;
@@ -258,6 +263,9 @@ pgxc_node_send_global_timestamp(PGXCNodeHandle *handle, GlobalTimestamp timestam
 extern int	pgxc_node_send_coord_info(PGXCNodeHandle * handle, int coord_pid, TransactionId coord_vxid);
 extern int	pgxc_node_receive(const int conn_count,
 				  PGXCNodeHandle ** connections, struct timeval * timeout);
+extern int	pgxc_node_receive_ready(const int conn_count,
+				  PGXCNodeHandle ** connections, struct timeval * timeout,
+				  PGXCNodeHandle ** ready, int *nready);
 extern bool node_ready_for_query(PGXCNodeHandle *conn);
 extern bool validate_handles(void);
 #else
@@ -265,6 +273,11 @@ extern bool	pgxc_node_receive(const int conn_count,
 				  PGXCNodeHandle ** connections, struct timeval * timeout);
 #endif
 extern int	pgxc_node_read_data(PGXCNodeHandle * conn, bool close_if_error);
+#ifdef __TBASE__
+extern void pgxc_node_shm_channel_attach(PGXCNodeHandle *conn, char *msg, int len);
+extern void pgxc_node_shm_channel_detach(PGXCNodeHandle *conn);
+extern void pgxc_node_inflate_frame(PGXCNodeHandle *conn, char *msg, int len);
+#endif
 extern int	pgxc_node_is_data_enqueued(PGXCNodeHandle *conn);
 
 extern int	send_some(PGXCNodeHandle * handle, int len);
@@ -307,6 +320,7 @@ extern int pgxc_node_send_sessionid(PGXCNodeHandle * handle);
 extern void SerializeSessionId(Size maxsize, char *start_address);
 extern void StartParallelWorkerSessionId(char *address);
 extern bool is_pgxc_handles_init(void);
+extern bool is_pgxc_handles_held(void);
 void delete_leadercn_handle(PGXCNodeAllHandles *pgxc_connections,
 						PGXCNodeHandle* leader_cn_handle);
 #endif
@@ -227,6 +227,9 @@ typedef struct
 	PoolPort	port;
 } PoolHandle;
 
+/* Number of buckets of command time histogram, the last one is unbounded */
+#define POOLER_CMD_HIST_BUCKETS (11)
+
 typedef struct PoolerCmdStatistics
 {
     uint64 total_request_times;     /* command total request times */
@@ -237,11 +240,14 @@ typedef struct PoolerCmdStatistics
     };
     uint64 max_costtime;            /* max time spent processing command */
     uint64 min_costtime;            /* min time spent processing command */
+    uint64 costtime_hist[POOLER_CMD_HIST_BUCKETS]; /* requests by time spent, see g_pooler_cmd_hist_bound */
 } PoolerCmdStatistics;
 
 
 #define POOLER_CMD_COUNT (18)
 
+extern const uint64 g_pooler_cmd_hist_bound[POOLER_CMD_HIST_BUCKETS - 1];
+
 
 
 #define     POOLER_ERROR_MSG_LEN  256
@@ -255,6 +261,9 @@ extern int	PoolerPort;
 extern int	PoolConnKeepAlive;
 extern int	PoolMaintenanceTimeout;
 extern bool PersistentConnections;
+#ifdef __TBASE__
+extern int  ConnectionAffinityTime;
+#endif
 
 extern char *g_PoolerWarmBufferInfo;
 extern char *g_unpooled_database;
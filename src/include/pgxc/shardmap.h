@@ -167,6 +167,8 @@ extern int32 EvaluateShardId(Oid type, bool isNull, Datum dvalue,
                            Oid secType, bool isSecNull, Datum secValue, Oid relid);
 
 extern int TruncateShard(Oid reloid, ShardID sid, int pausetime);
+extern int ReleaseShardExtents(Relation rel, ShardID sid, int pausetime, int64 *tuples);
+extern void AnalyzeShardStatistic(Relation rel);
 
 /* shard barrier */
 extern void ShardBarrierShmemInit(void);
@@ -178,6 +180,17 @@ extern bool IsShardBarriered(RelFileNode rel, ShardID sid);
 extern bool LocalHasShardBarriered(RelFileNode rel, ShardID sid);
 extern void ATEOXact_CleanUpShardBarrier(void);
 
+/* shard move fence */
+extern int  shard_move_fence_timeout;
+extern Size ShardMoveShmemSize(void);
+extern void ShardMoveShmemInit(void);
+extern bool ShardMoveFenceIsActive(void);
+extern void WaitForShardMoveFence(ShardID sid);
+extern void ShardMoveReportCopy(int64 tuples, int64 bytes, bool flush);
+extern Datum pg_shard_move_fence(PG_FUNCTION_ARGS);
+extern Datum pg_shard_move_unfence(PG_FUNCTION_ARGS);
+extern Datum pg_stat_shard_move(PG_FUNCTION_ARGS);
+
 extern void   StatShardRelation(Oid relid, ShardStat *shardstat, int32 shardnumber);
 extern void   StatShardAllRelations(ShardStat *shardstat, int32 shardnumber);
 extern void   GetGroupNodeIndexMap(Oid group, int32 *map);
@@ -64,6 +64,13 @@ typedef struct SQueueHeader *SharedQueue;
 #ifdef __TBASE__
 typedef struct DataPumpSenderControl* DataPumpSender;
 typedef struct ParallelSendControl* ParallelSender;
+typedef struct DataPumpShmChannel DataPumpShmChannel;
+
+/* sent on the socket to wake up a consumer waiting for the shm channel */
+#define DATAPUMP_SHM_DOORBELL   'w'
+
+/* column count of a DataRow carrying a columnar batch of rows */
+#define DATAROW_BATCH_MARKER    (-1)
 #endif
 
 extern Size SharedQueueShmemSize(void);
@@ -151,6 +158,10 @@ extern int32 g_SndThreadBufferSize;
 extern int32 g_SndBatchSize;
 extern int   consumer_connect_timeout;
 extern int   g_DisConsumer_timeout;
+extern bool  g_DataPumpShmChannel;
+extern int32 g_DataPumpShmChannelSize;
+extern int32 g_DataPumpBatchRows;
+extern int32 g_DataPumpCompressThreshold;
 
 extern bool in_data_pump;
 
@@ -165,6 +176,15 @@ extern int32  DataPumpSetNodeSocket(void *sender, int32 nodeindex, int32 nodeId,
 extern bool   DataPumpWaitSenderDone(void *sndctl, bool error);
 extern void   DestoryDataPumpSenderControl (void* sndctl, int nodeid);
 
+extern DataPumpShmChannel *DataPumpShmChannelAttach(char *msg, int len);
+extern int    DataPumpShmChannelRead(DataPumpShmChannel *channel, char *buf, int len);
+extern bool   DataPumpShmChannelReady(DataPumpShmChannel *channel);
+extern void   DataPumpShmChannelDetach(DataPumpShmChannel *channel);
+extern bool   DataPumpShmChannelPrepareWait(DataPumpShmChannel *channel);
+extern uint32 DataPumpShmChannelCancelWait(DataPumpShmChannel *channel);
+extern void   DataPumpShmChannelCleanup(int procno);
+extern Datum  pg_stat_get_datapump(PG_FUNCTION_ARGS);
+
 extern void SendDataRemote(SharedQueue squeue, int32 consumerIdx, TupleTableSlot *slot, Tuplestorestate **tuplestore, MemoryContext tmpcxt);
 
 extern void create_datapump_socket_dir(void);
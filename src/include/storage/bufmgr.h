@@ -212,6 +212,8 @@ extern void DropDatabaseBuffers(Oid dbid);
 #ifdef _SHARDING_
 extern void DropRelfileNodeShardBuffers(RelFileNode rnode, ShardID sid);
 extern void DropRelfileNodeExtentBuffers(RelFileNode rnode, ExtentID eid);
+extern void DropRelfileNodeExtentsBuffers(RelFileNode rnode, ExtentID *eids, int neids);
+extern int    extentid_comparator(const void *p1, const void *p2);
 #endif
 #define RelationGetNumberOfBlocks(reln) \
     RelationGetNumberOfBlocksInFork(reln, MAIN_FORKNUM)
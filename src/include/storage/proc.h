@@ -255,6 +255,14 @@ struct PGPROC
      */
     TransactionId procArrayGroupMemberXid;
 
+#ifdef __TBASE__
+    /* Support for GTS coalescing, see GetGlobalTimestampGTM */
+    bool        gtsBrokerMember;    /* waiting for the leader's GTS */
+    pg_atomic_uint32 gtsBrokerNext; /* next member of the GTS group */
+    GlobalTimestamp gtsBrokerResult;    /* GTS got by the leader */
+    bool        gtsBrokerReadOnly;  /* GTM read only flag got with it */
+#endif
+
     uint32        wait_event_info;    /* proc's wait information */
 
     /* Per-backend LWLock.  Protects fields below (but not group fields). */
@@ -562,6 +562,10 @@ typedef struct ViewOptions
 #define RelationIsSharded(relation) \
 	((relation)->rd_locator_info ? (relation)->rd_locator_info->locatorType == LOCATOR_TYPE_SHARD : false)
 
+/* writes to the relation have to respect the shard move fence */
+#define RelationHasShardMoveFence(relation) \
+	(RelationHasExtent(relation) || RelationIsSharded(relation))
+
 #define RelationHasToast(relation) \
 	OidIsValid((relation)->rd_toastoid)
 #endif
@@ -189,6 +189,9 @@ enum SysCacheIdentifier
     SEQRELID,
 #ifdef __COLD_HOT__
     SHARDKEYVALUE,
+#endif
+#ifdef _SHARDING_
+    SHARDSTATRELID,
 #endif
     STATEXTNAMENSP,
     STATEXTOID,
@@ -0,0 +1,26 @@
+# Commit timestamp cache test
+#
+# s1 looks up the commit timestamp of the transaction of s2 while it is in
+# progress, which copies the page of the entry before it is set.  After s2
+# ends, the entry must be read again instead of being taken from the copy,
+# and later lookups are answered from the copy.  s3 does the same lookups
+# with the cache off, both must agree.
+
+session "s1"
+setup		{ SET enable_committs_cache = on; }
+step "s1_grab"	{ SELECT set_config('cts.xid', l.transactionid::text, false) IS NOT NULL AS grabbed FROM pg_locks l, pg_stat_activity a WHERE l.pid = a.pid AND a.application_name = 'cts_writer' AND l.locktype = 'transactionid' AND l.mode = 'ExclusiveLock'; }
+step "s1_look"	{ SELECT pg_xact_commit_timestamp(current_setting('cts.xid')::xid) IS NOT NULL AS committed; }
+
+session "s2"
+setup		{ SET application_name = 'cts_writer'; }
+step "s2_begin"	{ BEGIN; SELECT txid_current() > 0 AS assigned; }
+step "s2_commit"	{ COMMIT; }
+step "s2_abort"	{ ROLLBACK; }
+
+session "s3"
+setup		{ SET enable_committs_cache = off; }
+step "s3_grab"	{ SELECT set_config('cts.xid', l.transactionid::text, false) IS NOT NULL AS grabbed FROM pg_locks l, pg_stat_activity a WHERE l.pid = a.pid AND a.application_name = 'cts_writer' AND l.locktype = 'transactionid' AND l.mode = 'ExclusiveLock'; }
+step "s3_look"	{ SELECT pg_xact_commit_timestamp(current_setting('cts.xid')::xid) IS NOT NULL AS committed; }
+
+permutation "s2_begin" "s1_grab" "s3_grab" "s1_look" "s3_look" "s2_commit" "s1_look" "s3_look" "s1_look"
+permutation "s2_begin" "s1_grab" "s3_grab" "s1_look" "s2_abort" "s1_look" "s3_look"
@@ -0,0 +1,43 @@
+--
+-- Read-only snapshots from the hybrid logical clock, with a simulated skew
+-- of the local clock
+--
+set enable_hlc_readonly_gts to on;
+set hlc_sync_interval to '1h';
+create table hlc_t(id int, v int);
+-- every GTS got from GTM synchronizes the clock
+insert into hlc_t select i, i from generate_series(1, 100) i;
+create table hlc_stats as select * from pg_stat_hlc;
+select valid from pg_stat_hlc;
+-- once the clock is past the GTS got so far, it serves the snapshot and
+-- still sees the rows inserted above
+begin transaction read only;
+select pg_sleep(0.2);
+commit;
+begin transaction read only;
+select count(*) from hlc_t;
+commit;
+select s.local_snapshots > o.local_snapshots as local_used from pg_stat_hlc s, hlc_stats o;
+-- the clock jumps, the next synchronization finds it and a read-only
+-- transaction goes to GTM once
+delete from hlc_stats;
+insert into hlc_stats select * from pg_stat_hlc;
+-- the skew moves the shared clock, so it is set for the whole node
+alter system set hlc_simulated_skew to '10s';
+select pg_reload_conf();
+select pg_sleep(1);
+show hlc_simulated_skew;
+select count(*) from hlc_t;
+begin transaction read only;
+select count(*) from hlc_t;
+commit;
+select s.skew_violations > o.skew_violations as skew_found,
+       s.gtm_snapshots > o.gtm_snapshots as gtm_used,
+       s.valid
+  from pg_stat_hlc s, hlc_stats o;
+alter system reset hlc_simulated_skew;
+select pg_reload_conf();
+reset hlc_sync_interval;
+reset enable_hlc_readonly_gts;
+drop table hlc_stats;
+drop table hlc_t;
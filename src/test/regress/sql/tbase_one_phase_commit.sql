@@ -0,0 +1,40 @@
+--
+-- Transactions writing a single datanode commit there without implicit 2PC
+--
+create table opc_t(id int, v text) distribute by shard(id);
+create unlogged table opc_unlogged(id int, v text) distribute by shard(id);
+create temp table opc_temp(id int, v text);
+-- local node only read
+select one_phase_commits as base from pg_stat_2pc \gset
+begin;
+select count(*) from pg_class where relname = 'opc_t';
+insert into opc_t values (1, 'a');
+commit;
+select one_phase_commits - :base as one_phase from pg_stat_2pc;
+-- unlogged write
+select one_phase_commits as base from pg_stat_2pc \gset
+begin;
+insert into opc_unlogged values (1, 'b');
+commit;
+select one_phase_commits - :base as one_phase from pg_stat_2pc;
+-- temp write
+select one_phase_commits as base from pg_stat_2pc \gset
+begin;
+insert into opc_temp values (1, 'c');
+commit;
+select one_phase_commits - :base as one_phase from pg_stat_2pc;
+-- local node written as well, two-phase commit
+select one_phase_commits as base from pg_stat_2pc \gset
+begin;
+create table opc_t2(id int, v text) distribute by shard(id);
+insert into opc_t2 values (1, 'd');
+commit;
+select one_phase_commits - :base as one_phase from pg_stat_2pc;
+select * from opc_t;
+select * from opc_unlogged;
+select * from opc_temp;
+select * from opc_t2;
+drop table opc_t;
+drop table opc_t2;
+drop table opc_unlogged;
+drop table opc_temp;
@@ -0,0 +1,30 @@
+--
+-- Per-shard statistics: pg_shard_skew() and the cost of scanning skewed
+-- shards
+--
+create table skew_even(id int, k int, v text) distribute by shard(id);
+create table skew_hot(id int, k int, v text) distribute by shard(k);
+insert into skew_even select i, 1, md5(i::text) from generate_series(1, 20000) i;
+insert into skew_hot select i, 1, md5(i::text) from generate_series(1, 20000) i;
+analyze skew_even;
+analyze skew_hot;
+-- all the rows of skew_hot are in a single shard
+select count(*) as shards, min(skew) as skew, max(rank) as rank,
+       bool_and(nodename is not null) as mapped
+from pg_shard_skew() where relid = 'skew_hot'::regclass;
+select count(*) > 1 as spread, bool_and(nodename is not null) as mapped
+from pg_shard_skew() where relid = 'skew_even'::regclass;
+-- scanning skew_hot lasts as long as the scan of its only datanode
+create function shard_scan_cost(q text) returns float8 language plpgsql as $$
+declare
+    plan json;
+begin
+    execute 'explain (format json) ' || q into plan;
+    return (plan->0->'Plan'->>'Total Cost')::float8;
+end;
+$$;
+select shard_scan_cost('select * from skew_hot') >
+       shard_scan_cost('select * from skew_even') as skewed_costs_more;
+drop function shard_scan_cost(text);
+drop table skew_even;
+drop table skew_hot;
@@ -0,0 +1,43 @@
+--
+-- VACUUM ... SHARDING drops the rows of a shard from a datanode by releasing
+-- its extents
+--
+create table shard_clean_t(id int, v text) distribute by shard(id);
+create index shard_clean_t_v on shard_clean_t(v);
+insert into shard_clean_t select i, md5(i::text) from generate_series(1, 20000) i;
+-- the largest shard of datanode_1
+execute direct on (datanode_1) 'select shardid as sid from shard_clean_t group by shardid order by count(*) desc, shardid limit 1' \gset
+\set cmd 'select count(*) as shard_rows from shard_clean_t where shardid = ' :sid
+execute direct on (datanode_1) :'cmd' \gset
+execute direct on (datanode_1) 'select count(*) as dn_rows from shard_clean_t' \gset
+set client_min_messages to warning;
+\set cmd 'vacuum shard_clean_t sharding(' :sid ')'
+execute direct on (datanode_1) :'cmd';
+reset client_min_messages;
+-- only the rows of the shard are gone, from the heap and from the index
+execute direct on (datanode_1) 'select count(*) as dn_rows_after from shard_clean_t' \gset
+select :shard_rows > 0 as had_rows, :dn_rows_after = :dn_rows - :shard_rows as kept;
+set enable_seqscan to off;
+set enable_bitmapscan to off;
+execute direct on (datanode_1) 'select count(*) as dn_rows_idx from shard_clean_t where v > ''''' \gset
+reset enable_seqscan;
+reset enable_bitmapscan;
+select :dn_rows_idx = :dn_rows_after as index_kept;
+-- the shard takes writes again
+insert into shard_clean_t select i, md5(i::text) from generate_series(1, 20000) i;
+select count(*) = 40000 - :shard_rows as all_rows from shard_clean_t;
+-- a shard moved to another datanode is hidden on this one, its extents are
+-- released by vacuum_hidden_shards
+execute direct on (datanode_1) 'select shardid as hsid from shard_clean_t group by shardid order by count(*) desc, shardid limit 1' \gset
+\set cmd 'select count(*) as extents from pg_extent_info(''shard_clean_t'') where is_occupied and shardid = ' :hsid
+execute direct on (datanode_1) :'cmd' \gset
+move group default_group data from datanode_1 to datanode_2 with (:hsid);
+set client_min_messages to warning;
+\set cmd 'select vacuum_hidden_shards(''' :hsid '#shard_clean_t#0'') > 0 as vacuumed'
+execute direct on (datanode_1) :'cmd';
+reset client_min_messages;
+\set cmd 'select count(*) as extents_after from pg_extent_info(''shard_clean_t'') where is_occupied and shardid = ' :hsid
+execute direct on (datanode_1) :'cmd' \gset
+select :extents > 0 as had_extents, :extents_after < :extents as released;
+move group default_group data from datanode_2 to datanode_1 with (:hsid);
+drop table shard_clean_t;